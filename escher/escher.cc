@@ -25,7 +25,7 @@ std::unique_ptr<impl::CommandBufferPool> NewCommandBufferPool(
     impl::CommandBufferSequencer* sequencer) {
   return std::make_unique<impl::CommandBufferPool>(
       context.device, context.queue, context.queue_family_index, sequencer,
-      true);
+      vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
 }
 
 // Constructor helper.
@@ -37,7 +37,21 @@ std::unique_ptr<impl::CommandBufferPool> NewTransferCommandBufferPool(
   else
     return std::make_unique<impl::CommandBufferPool>(
         context.device, context.transfer_queue,
-        context.transfer_queue_family_index, sequencer, false);
+        context.transfer_queue_family_index, sequencer,
+        vk::QueueFlagBits::eTransfer);
+}
+
+// Constructor helper.
+std::unique_ptr<impl::CommandBufferPool> NewComputeCommandBufferPool(
+    const VulkanContext& context,
+    impl::CommandBufferSequencer* sequencer) {
+  if (!context.compute_queue)
+    return nullptr;
+  else
+    return std::make_unique<impl::CommandBufferPool>(
+        context.device, context.compute_queue,
+        context.compute_queue_family_index, sequencer,
+        vk::QueueFlagBits::eCompute);
 }
 
 // Constructor helper.
@@ -64,6 +78,9 @@ Escher::Escher(VulkanDeviceQueuesPtr device)
       transfer_command_buffer_pool_(
           NewTransferCommandBufferPool(vulkan_context_,
                                        command_buffer_sequencer_.get())),
+      compute_command_buffer_pool_(
+          NewComputeCommandBufferPool(vulkan_context_,
+                                      command_buffer_sequencer_.get())),
       glsl_compiler_(std::make_unique<impl::GlslToSpirvCompiler>()),
       image_cache_(std::make_unique<impl::ImageCache>(this, gpu_allocator())),
       gpu_uploader_(NewGpuUploader(this,
@@ -119,4 +136,12 @@ uint64_t Escher::GetNumGpuBytesAllocated() {
   return gpu_allocator()->total_slab_bytes();
 }
 
+void Escher::set_optimize_meshes(bool optimize) {
+  impl_->mesh_manager()->set_optimize_meshes(optimize);
+}
+
+const VertexCacheStats& Escher::mesh_vertex_cache_stats() const {
+  return impl_->mesh_manager()->vertex_cache_stats();
+}
+
 }  // namespace escher
@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "escher/forward_declarations.h"
+#include "escher/geometry/mesh_optimizer.h"
 #include "escher/shape/mesh_builder_factory.h"
 #include "escher/status.h"
 #include "escher/vk/vulkan_context.h"
@@ -55,6 +56,12 @@ class Escher : public MeshBuilderFactory {
 
   uint64_t GetNumGpuBytesAllocated();
 
+  // If enabled, meshes obtained via NewMeshBuilder() are reordered for better
+  // vertex cache utilization.  See impl::MeshManager::set_optimize_meshes().
+  void set_optimize_meshes(bool optimize);
+  // Vertex cache miss counts of the meshes that were optimized so far.
+  const VertexCacheStats& mesh_vertex_cache_stats() const;
+
   VulkanDeviceQueues* device() const { return device_.get(); }
   vk::Device vk_device() const { return device_->vk_device(); }
   const VulkanContext& vulkan_context() const { return vulkan_context_; }
@@ -76,6 +83,11 @@ class Escher : public MeshBuilderFactory {
   impl::CommandBufferPool* transfer_command_buffer_pool() {
     return transfer_command_buffer_pool_.get();
   }
+  // Pool for CommandBuffers submitted on the compute-only queue (if one
+  // exists), which runs concurrently with the main queue.
+  impl::CommandBufferPool* compute_command_buffer_pool() {
+    return compute_command_buffer_pool_.get();
+  }
 
  private:
   // Friends that need access to impl_.
@@ -93,6 +105,7 @@ class Escher : public MeshBuilderFactory {
   std::unique_ptr<impl::CommandBufferSequencer> command_buffer_sequencer_;
   std::unique_ptr<impl::CommandBufferPool> command_buffer_pool_;
   std::unique_ptr<impl::CommandBufferPool> transfer_command_buffer_pool_;
+  std::unique_ptr<impl::CommandBufferPool> compute_command_buffer_pool_;
   std::unique_ptr<impl::GlslToSpirvCompiler> glsl_compiler_;
   std::unique_ptr<impl::ImageCache> image_cache_;
 
@@ -21,6 +21,7 @@ class Image;
 class ImageFactory;
 class MeshBuilder;
 class MeshBuilderFactory;
+class MeshLod;
 struct MeshSpec;
 class Material;
 class Mesh;
@@ -47,6 +48,7 @@ typedef ftl::RefPtr<Image> ImagePtr;
 typedef ftl::RefPtr<Material> MaterialPtr;
 typedef ftl::RefPtr<Mesh> MeshPtr;
 typedef ftl::RefPtr<MeshBuilder> MeshBuilderPtr;
+typedef ftl::RefPtr<MeshLod> MeshLodPtr;
 typedef ftl::RefPtr<PaperRenderer> PaperRendererPtr;
 typedef ftl::RefPtr<Resource> ResourcePtr;
 typedef ftl::RefPtr<Renderer> RendererPtr;
@@ -63,6 +65,7 @@ class EscherImpl;
 class GlslToSpirvCompiler;
 class GpuUploader;
 class ImageCache;
+class MaterialTextureRegistry;
 class MeshManager;
 class MeshShaderBinding;
 class ModelData;
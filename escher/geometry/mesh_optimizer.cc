@@ -0,0 +1,203 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/geometry/mesh_optimizer.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "ftl/logging.h"
+
+namespace escher {
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+// For each vertex, the list of triangles that reference it, stored as a single
+// array with per-vertex offsets.
+struct VertexTriangleAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  VertexTriangleAdjacency(const uint32_t* indices,
+                          size_t index_count,
+                          size_t vertex_count)
+      : offsets(vertex_count + 1, 0), triangles(index_count) {
+    for (size_t i = 0; i < index_count; ++i) {
+      ++offsets[indices[i] + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < index_count; ++i) {
+      triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  const uint32_t* begin(uint32_t vertex) const {
+    return triangles.data() + offsets[vertex];
+  }
+  const uint32_t* end(uint32_t vertex) const {
+    return triangles.data() + offsets[vertex + 1];
+  }
+  uint32_t count(uint32_t vertex) const {
+    return offsets[vertex + 1] - offsets[vertex];
+  }
+};
+
+}  // namespace
+
+size_t CountVertexCacheMisses(const uint32_t* indices,
+                              size_t index_count,
+                              size_t vertex_count,
+                              size_t cache_size) {
+  // A vertex is in the FIFO cache if fewer than |cache_size| vertices have been
+  // inserted since it was.  Timestamps start beyond |cache_size| so that no
+  // vertex is initially in the cache.
+  std::vector<size_t> cache_timestamps(vertex_count, 0);
+  size_t timestamp = cache_size + 1;
+  size_t misses = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t vertex = indices[i];
+    FTL_DCHECK(vertex < vertex_count);
+    if (timestamp - cache_timestamps[vertex] > cache_size) {
+      cache_timestamps[vertex] = timestamp++;
+      ++misses;
+    }
+  }
+  return misses;
+}
+
+void OptimizeVertexCacheOrder(uint32_t* indices,
+                              size_t index_count,
+                              size_t vertex_count,
+                              size_t cache_size) {
+  FTL_DCHECK(index_count % 3 == 0);
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  const VertexTriangleAdjacency adjacency(indices, index_count, vertex_count);
+
+  // Number of triangles that reference each vertex and have not been emitted.
+  std::vector<uint32_t> live_triangles(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    live_triangles[v] = adjacency.count(v);
+  }
+  std::vector<size_t> cache_timestamps(vertex_count, 0);
+  std::vector<bool> emitted(triangle_count, false);
+  // Recently-referenced vertices, used to restart when the fan reaches a dead
+  // end.
+  std::vector<uint32_t> dead_end_stack;
+  dead_end_stack.reserve(index_count);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(index_count);
+
+  size_t timestamp = cache_size + 1;
+  uint32_t cursor = 0;
+
+  // Return a vertex that still has live triangles, preferring those that were
+  // referenced most recently.
+  auto skip_dead_end = [&]() -> uint32_t {
+    while (!dead_end_stack.empty()) {
+      uint32_t vertex = dead_end_stack.back();
+      dead_end_stack.pop_back();
+      if (live_triangles[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for (; cursor < vertex_count; ++cursor) {
+      if (live_triangles[cursor] > 0) {
+        return cursor;
+      }
+    }
+    return kInvalidIndex;
+  };
+
+  uint32_t fan_vertex = skip_dead_end();
+  while (fan_vertex != kInvalidIndex) {
+    // Emit all remaining triangles around the fanning vertex.
+    candidates.clear();
+    for (const uint32_t* it = adjacency.begin(fan_vertex);
+         it != adjacency.end(fan_vertex); ++it) {
+      const uint32_t triangle = *it;
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (size_t k = 0; k < 3; ++k) {
+        const uint32_t vertex = indices[triangle * 3 + k];
+        output.push_back(vertex);
+        dead_end_stack.push_back(vertex);
+        candidates.push_back(vertex);
+        --live_triangles[vertex];
+        if (timestamp - cache_timestamps[vertex] > cache_size) {
+          cache_timestamps[vertex] = timestamp++;
+        }
+      }
+    }
+
+    // Choose the next fanning vertex: the candidate that entered the cache
+    // earliest among those whose remaining triangles would not push it out of
+    // the cache.
+    uint32_t next_vertex = kInvalidIndex;
+    size_t best_priority = 0;
+    bool found = false;
+    for (uint32_t vertex : candidates) {
+      if (live_triangles[vertex] == 0) {
+        continue;
+      }
+      size_t priority = 0;
+      const size_t age = timestamp - cache_timestamps[vertex];
+      if (age + 2 * live_triangles[vertex] <= cache_size) {
+        priority = age;
+      }
+      if (!found || priority > best_priority) {
+        found = true;
+        best_priority = priority;
+        next_vertex = vertex;
+      }
+    }
+    fan_vertex = found ? next_vertex : skip_dead_end();
+  }
+
+  FTL_DCHECK(output.size() == index_count);
+  memcpy(indices, output.data(), index_count * sizeof(uint32_t));
+}
+
+void OptimizeVertexFetchOrder(uint8_t* vertices,
+                              size_t vertex_stride,
+                              size_t vertex_count,
+                              uint32_t* indices,
+                              size_t index_count) {
+  std::vector<uint32_t> remap(vertex_count, kInvalidIndex);
+  uint32_t next_vertex = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    uint32_t& new_index = remap[indices[i]];
+    if (new_index == kInvalidIndex) {
+      new_index = next_vertex++;
+    }
+    indices[i] = new_index;
+  }
+  for (uint32_t& new_index : remap) {
+    if (new_index == kInvalidIndex) {
+      new_index = next_vertex++;
+    }
+  }
+  FTL_DCHECK(next_vertex == vertex_count);
+
+  std::vector<uint8_t> original(vertices,
+                                vertices + vertex_count * vertex_stride);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    memcpy(vertices + remap[v] * vertex_stride,
+           original.data() + v * vertex_stride, vertex_stride);
+  }
+}
+
+}  // namespace escher
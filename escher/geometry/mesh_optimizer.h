@@ -0,0 +1,61 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace escher {
+
+// Number of entries in the simulated post-transform vertex cache.  Real GPUs
+// vary; this is a conservative value that works well across vendors.
+constexpr size_t kDefaultVertexCacheSize = 16;
+
+// Return the number of vertices that miss in a FIFO post-transform vertex cache
+// of the specified size, when the triangles described by |indices| are drawn in
+// order.  Dividing by the number of triangles gives the average cache miss
+// ratio (ACMR): 3.0 is the worst possible, and ~0.5 is the best possible for
+// large regular meshes.
+size_t CountVertexCacheMisses(const uint32_t* indices,
+                              size_t index_count,
+                              size_t vertex_count,
+                              size_t cache_size = kDefaultVertexCacheSize);
+
+// Reorder the triangles described by |indices| in place to reduce the number of
+// vertex cache misses, using the "Tipsify" algorithm from "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw" (Sander et al. 2007).
+// The winding order of each triangle is preserved.  Runs in time linear in the
+// number of indices.
+void OptimizeVertexCacheOrder(uint32_t* indices,
+                              size_t index_count,
+                              size_t vertex_count,
+                              size_t cache_size = kDefaultVertexCacheSize);
+
+// Reorder the vertices in place so that they are stored in the order that they
+// are first referenced by |indices|, and rewrite |indices| to match.  This
+// improves the locality of vertex fetches, and should be done after
+// OptimizeVertexCacheOrder().  Vertices that aren't referenced by any index are
+// moved to the end.
+void OptimizeVertexFetchOrder(uint8_t* vertices,
+                              size_t vertex_stride,
+                              size_t vertex_count,
+                              uint32_t* indices,
+                              size_t index_count);
+
+// Accumulates the effect of OptimizeVertexCacheOrder() over many meshes.
+struct VertexCacheStats {
+  size_t triangle_count = 0;
+  size_t misses_before = 0;
+  size_t misses_after = 0;
+
+  float acmr_before() const {
+    return triangle_count ? float(misses_before) / triangle_count : 0.f;
+  }
+  float acmr_after() const {
+    return triangle_count ? float(misses_after) / triangle_count : 0.f;
+  }
+};
+
+}  // namespace escher
@@ -6,10 +6,12 @@
 
 #include <math.h>
 #include <algorithm>
+#include <vector>
 
 #include "escher/impl/model_data.h"
 #include "escher/shape/mesh_builder.h"
 #include "escher/shape/mesh_builder_factory.h"
+#include "escher/shape/rounded_rect.h"
 #include "ftl/logging.h"
 
 namespace escher {
@@ -28,9 +30,11 @@ struct VertexAttributePointers {
 // will be null.
 VertexAttributePointers GetVertexAttributePointers(uint8_t* vertex,
                                                    size_t vertex_size,
-                                                   const MeshSpec& spec,
+                                                   const MeshSpec& mesh_spec,
                                                    MeshBuilderPtr builder) {
   FTL_CHECK(builder->vertex_stride() <= vertex_size);
+  // Vertices are always passed to the builder without compact encodings.
+  const MeshSpec spec = mesh_spec.GetDecodedSpec();
 
   VertexAttributePointers attribute_pointers{};
 
@@ -304,6 +308,86 @@ MeshPtr NewRectangleMesh(MeshBuilderFactory* factory,
   return mesh;
 }
 
+namespace {
+
+// Return the minimum screen size of a circle or ring for which the specified
+// number of subdivisions is used.  Both have 4 << subdivisions vertices around
+// their outer perimeter.
+float GetCircleLodMinScreenSize(int subdivisions) {
+  return subdivisions == 0
+             ? 0.f
+             : GetMaxCircleScreenDiameter(4 << (subdivisions - 1));
+}
+
+}  // namespace
+
+MeshLodPtr NewCircleMeshLod(MeshBuilderFactory* factory,
+                            const MeshSpec& spec,
+                            int max_subdivisions,
+                            vec2 center,
+                            float radius,
+                            float offset_magnitude) {
+  FTL_DCHECK(max_subdivisions >= 0);
+  auto lod = ftl::MakeRefCounted<MeshLod>();
+  for (int subdivisions = 0; subdivisions <= max_subdivisions;
+       ++subdivisions) {
+    lod->AddLevel(NewCircleMesh(factory, spec, subdivisions, center, radius,
+                                offset_magnitude),
+                  GetCircleLodMinScreenSize(subdivisions));
+  }
+  return lod;
+}
+
+MeshLodPtr NewRingMeshLod(MeshBuilderFactory* factory,
+                          const MeshSpec& spec,
+                          int max_subdivisions,
+                          vec2 center,
+                          float outer_radius,
+                          float inner_radius,
+                          float outer_offset_magnitude,
+                          float inner_offset_magnitude) {
+  FTL_DCHECK(max_subdivisions >= 0);
+  auto lod = ftl::MakeRefCounted<MeshLod>();
+  for (int subdivisions = 0; subdivisions <= max_subdivisions;
+       ++subdivisions) {
+    lod->AddLevel(NewRingMesh(factory, spec, subdivisions, center,
+                              outer_radius, inner_radius,
+                              outer_offset_magnitude, inner_offset_magnitude),
+                  GetCircleLodMinScreenSize(subdivisions));
+  }
+  return lod;
+}
+
+MeshPtr NewUnitRoundedRectMesh(MeshBuilderFactory* factory,
+                               uint32_t corner_divisions) {
+  MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPositionOffset};
+
+  // The deformation depends only on the corner divisions, so any spec will do.
+  const RoundedRectSpec rect_spec(1.f, 1.f, 0.5f, 0.5f, 0.5f, 0.5f);
+  auto counts =
+      GetRoundedRectMeshVertexAndIndexCounts(rect_spec, corner_divisions);
+  const uint32_t vertex_count = counts.first;
+  const uint32_t index_count = counts.second;
+  const size_t stride = spec.GetStride();
+
+  std::vector<uint8_t> vertices(vertex_count * stride);
+  GenerateUnitRoundedRectVertices(spec, vertices.data(), vertices.size(),
+                                  corner_divisions);
+  std::vector<uint16_t> indices(index_count);
+  GenerateRoundedRectIndices(indices.data(), index_count * sizeof(uint16_t),
+                             corner_divisions);
+
+  MeshBuilderPtr builder =
+      factory->NewMeshBuilder(spec, vertex_count, index_count);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    builder->AddVertexData(&vertices[i * stride], stride);
+  }
+  for (uint16_t index : indices) {
+    builder->AddIndex(index);
+  }
+  return builder->Build();
+}
+
 MeshPtr NewFullScreenMesh(MeshBuilderFactory* factory) {
   MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kUV};
 
@@ -8,6 +8,7 @@
 
 #include "escher/forward_declarations.h"
 #include "escher/geometry/types.h"
+#include "escher/shape/mesh_lod.h"
 
 namespace escher {
 
@@ -47,6 +48,35 @@ MeshPtr NewRingMesh(MeshBuilderFactory* factory,
                     float outer_offset_magnitude = 0.f,
                     float inner_offset_magnitude = 0.f);
 
+// Tessellate a circle at each number of subdivisions from 0 to
+// |max_subdivisions|, and return the tessellations as levels of detail.  Each
+// level is used when the circle is too large on screen for the previous level
+// to approximate it accurately.
+MeshLodPtr NewCircleMeshLod(MeshBuilderFactory* factory,
+                            const MeshSpec& spec,
+                            int max_subdivisions,
+                            vec2 center,
+                            float radius,
+                            float offset_magnitude = 0.f);
+
+// Tessellate a ring at each number of subdivisions from 0 to
+// |max_subdivisions|, and return the tessellations as levels of detail.  See
+// NewCircleMeshLod().
+MeshLodPtr NewRingMeshLod(MeshBuilderFactory* factory,
+                          const MeshSpec& spec,
+                          int max_subdivisions,
+                          vec2 center,
+                          float outer_radius,
+                          float inner_radius,
+                          float outer_offset_magnitude = 0.f,
+                          float inner_offset_magnitude = 0.f);
+
+// Tessellate a canonical rounded-rect, which the vertex shader deforms into
+// any RoundedRectSpec; see GenerateUnitRoundedRectVertices().  The returned
+// mesh has only position and position-offset attributes.
+MeshPtr NewUnitRoundedRectMesh(MeshBuilderFactory* factory,
+                               uint32_t corner_divisions);
+
 // Tessellate a full-screen mesh.  The returned mesh has only position and UV
 // coordinates.
 MeshPtr NewFullScreenMesh(MeshBuilderFactory* factory);
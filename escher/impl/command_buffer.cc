@@ -131,7 +131,7 @@ void CommandBuffer::DrawMesh(const MeshPtr& mesh) {
   command_buffer_.bindVertexBuffers(vbo_binding, 1, &vbo, &vbo_offset);
   command_buffer_.bindIndexBuffer(mesh->vk_index_buffer(),
                                   mesh->index_buffer_offset(),
-                                  vk::IndexType::eUint32);
+                                  mesh->index_type());
   command_buffer_.drawIndexed(mesh->num_indices(), 1, 0, 0, 0);
 }
 
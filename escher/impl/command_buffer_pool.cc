@@ -14,8 +14,11 @@ CommandBufferPool::CommandBufferPool(vk::Device device,
                                      vk::Queue queue,
                                      uint32_t queue_family_index,
                                      CommandBufferSequencer* sequencer,
-                                     bool supports_graphics_and_compute)
-    : device_(device), queue_(queue), sequencer_(sequencer) {
+                                     vk::QueueFlags queue_flags)
+    : device_(device),
+      queue_(queue),
+      queue_family_index_(queue_family_index),
+      sequencer_(sequencer) {
   FTL_DCHECK(device);
   FTL_DCHECK(queue);
   vk::CommandPoolCreateInfo info;
@@ -29,7 +32,11 @@ CommandBufferPool::CommandBufferPool(vk::Device device,
                          vk::PipelineStageFlagBits::eBottomOfPipe |
                          vk::PipelineStageFlagBits::eHost |
                          vk::PipelineStageFlagBits::eAllCommands;
-  if (supports_graphics_and_compute) {
+  if (queue_flags & vk::QueueFlagBits::eCompute) {
+    pipeline_stage_mask_ |= vk::PipelineStageFlagBits::eDrawIndirect |
+                            vk::PipelineStageFlagBits::eComputeShader;
+  }
+  if (queue_flags & vk::QueueFlagBits::eGraphics) {
     pipeline_stage_mask_ |=
         vk::PipelineStageFlagBits::eDrawIndirect |
         vk::PipelineStageFlagBits::eVertexInput |
@@ -44,7 +51,6 @@ CommandBufferPool::CommandBufferPool(vk::Device device,
         vk::PipelineStageFlagBits::eEarlyFragmentTests |
         vk::PipelineStageFlagBits::eLateFragmentTests |
         vk::PipelineStageFlagBits::eColorAttachmentOutput |
-        vk::PipelineStageFlagBits::eComputeShader |
         vk::PipelineStageFlagBits::eAllGraphics;
   }
 }
@@ -22,11 +22,13 @@ class CommandBuffer;
 class CommandBufferPool : CommandBufferSequencerController {
  public:
   // The CommandBufferPool does not take ownership of the device and queue.
+  // |queue_flags| are the operations supported by the queue; every queue
+  // supports transfers.
   CommandBufferPool(vk::Device device,
                     vk::Queue queue,
                     uint32_t queue_family_index,
                     CommandBufferSequencer* sequencer,
-                    bool supports_graphics_and_compute);
+                    vk::QueueFlags queue_flags);
 
   // If there are still any pending buffers, this will block until they are
   // finished.
@@ -42,10 +44,12 @@ class CommandBufferPool : CommandBufferSequencerController {
 
   vk::Device device() const { return device_; }
   vk::Queue queue() const { return queue_; }
+  uint32_t queue_family_index() const { return queue_family_index_; }
 
  private:
   const vk::Device device_;
   const vk::Queue queue_;
+  const uint32_t queue_family_index_;
   // Rule out pipeline stages that are not supported on our queue.
   vk::PipelineStageFlags pipeline_stage_mask_;
 
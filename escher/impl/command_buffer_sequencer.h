@@ -40,6 +40,12 @@ class CommandBufferSequencer {
   // monotonically-increasing.
   uint64_t latest_sequence_number() { return latest_sequence_number_; }
 
+  // Get the highest sequence number such that all CommandBuffers with equal or
+  // lower sequence number have finished execution.
+  uint64_t last_finished_sequence_number() {
+    return last_finished_sequence_number_;
+  }
+
  private:
   // Allow listeners to register/unregister themselves.
   friend class CommandBufferSequencerListener;
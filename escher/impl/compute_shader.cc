@@ -181,6 +181,27 @@ void ComputeShader::Dispatch(std::vector<TexturePtr> textures,
                              uint32_t y,
                              uint32_t z,
                              const void* push_constants) {
+  Bind(textures, buffers, command_buffer, push_constants);
+  command_buffer->get().dispatch(x, y, z);
+}
+
+void ComputeShader::DispatchIndirect(std::vector<TexturePtr> textures,
+                                     std::vector<BufferPtr> buffers,
+                                     CommandBuffer* command_buffer,
+                                     const BufferPtr& indirect_buffer,
+                                     vk::DeviceSize offset,
+                                     const void* push_constants) {
+  FTL_DCHECK(offset + sizeof(vk::DispatchIndirectCommand) <=
+             indirect_buffer->size());
+  Bind(textures, buffers, command_buffer, push_constants);
+  command_buffer->KeepAlive(indirect_buffer);
+  command_buffer->get().dispatchIndirect(indirect_buffer->get(), offset);
+}
+
+void ComputeShader::Bind(const std::vector<TexturePtr>& textures,
+                         const std::vector<BufferPtr>& buffers,
+                         CommandBuffer* command_buffer,
+                         const void* push_constants) {
   // Push constants must be provided if and only if the pipeline is configured
   // to use them.
   FTL_DCHECK((push_constants_size_ == 0) == (push_constants == nullptr));
@@ -216,7 +237,6 @@ void ComputeShader::Dispatch(std::vector<TexturePtr> textures,
   vk_command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
                                        vk_pipeline_layout, 0, 1,
                                        &descriptor_set, 0, nullptr);
-  vk_command_buffer.dispatch(x, y, z);
 }
 
 }  // namespace impl
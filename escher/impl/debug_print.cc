@@ -13,6 +13,7 @@
 #include "escher/renderer/image.h"
 #include "escher/scene/camera.h"
 #include "escher/scene/viewing_volume.h"
+#include "escher/shape/shape_cache.h"
 
 namespace escher {
 
@@ -78,6 +79,34 @@ std::ostream& operator<<(std::ostream& str, const MeshAttribute& attr) {
     case MeshAttribute::kStride:
       str << "kStride";
       break;
+    case MeshAttribute::kColor:
+      str << "kColor";
+      break;
+  }
+  return str;
+}
+
+std::ostream& operator<<(std::ostream& str,
+                         const MeshAttributeEncoding& encoding) {
+  switch (encoding) {
+    case MeshAttributeEncoding::kPositionHalfFloat:
+      str << "kPositionHalfFloat";
+      break;
+    case MeshAttributeEncoding::kPositionSnorm16:
+      str << "kPositionSnorm16";
+      break;
+    case MeshAttributeEncoding::kPositionOffsetHalfFloat:
+      str << "kPositionOffsetHalfFloat";
+      break;
+    case MeshAttributeEncoding::kPositionOffsetSnorm16:
+      str << "kPositionOffsetSnorm16";
+      break;
+    case MeshAttributeEncoding::kUVUnorm16:
+      str << "kUVUnorm16";
+      break;
+    case MeshAttributeEncoding::kPerimeterPosUnorm16:
+      str << "kPerimeterPosUnorm16";
+      break;
   }
   return str;
 }
@@ -87,9 +116,10 @@ std::ostream& operator<<(std::ostream& str, const MeshSpec& spec) {
   str << "MeshSpec[";
   // TODO: would be nice to guarantee that we don't miss any.  Too bad we can't
   // enumerate over the values in an enum class.
-  std::array<MeshAttribute, 4> all_flags = {
+  std::array<MeshAttribute, 5> all_flags = {
       {MeshAttribute::kPosition, MeshAttribute::kPositionOffset,
-       MeshAttribute::kUV, MeshAttribute::kPerimeterPos}};
+       MeshAttribute::kUV, MeshAttribute::kPerimeterPos,
+       MeshAttribute::kColor}};
   for (auto flag : all_flags) {
     if (spec.flags & flag) {
       // Put a pipe after the previous flag, if there is one.
@@ -101,6 +131,18 @@ std::ostream& operator<<(std::ostream& str, const MeshSpec& spec) {
       str << flag;
     }
   }
+  std::array<MeshAttributeEncoding, 6> all_encodings = {
+      {MeshAttributeEncoding::kPositionHalfFloat,
+       MeshAttributeEncoding::kPositionSnorm16,
+       MeshAttributeEncoding::kPositionOffsetHalfFloat,
+       MeshAttributeEncoding::kPositionOffsetSnorm16,
+       MeshAttributeEncoding::kUVUnorm16,
+       MeshAttributeEncoding::kPerimeterPosUnorm16}};
+  for (auto encoding : all_encodings) {
+    if (spec.encodings & encoding) {
+      str << " " << encoding;
+    }
+  }
   str << "]";
   return str;
 }
@@ -131,7 +173,10 @@ std::ostream& operator<<(std::ostream& str,
       << ", is_clippee: " << spec.is_clippee
       << ", depth_prepass: " << spec.use_depth_prepass
       << ", has_material: " << spec.has_material
-      << ", is_opaque: " << spec.is_opaque << "]";
+      << ", is_opaque: " << spec.is_opaque
+      << ", bindless: " << spec.use_bindless_material_textures
+      << ", rounded_rect: " << spec.is_rounded_rect
+      << ", analytic_shape: " << spec.is_analytic_shape << "]";
   return str;
 }
 
@@ -189,6 +234,15 @@ std::ostream& operator<<(std::ostream& str, const Camera& camera) {
              << "\nprojection: " << camera.projection() << "]";
 }
 
+std::ostream& operator<<(std::ostream& str, const ShapeCacheStats& stats) {
+  return str << "ShapeCacheStats[hits:" << stats.hit_count
+             << " misses:" << stats.miss_count
+             << " hit-rate:" << stats.hit_rate()
+             << " evictions:" << stats.eviction_count
+             << " bytes-uploaded:" << stats.bytes_uploaded
+             << " bytes-saved:" << stats.bytes_saved << "]";
+}
+
 }  // namespace escher
 
 #endif  // #if !defined(NDEBUG)
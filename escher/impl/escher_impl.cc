@@ -67,6 +67,9 @@ void EscherImpl::Cleanup() {
   if (auto pool = transfer_command_buffer_pool()) {
     pool->Cleanup();
   }
+  if (auto pool = compute_command_buffer_pool()) {
+    pool->Cleanup();
+  }
 }
 
 const VulkanContext& EscherImpl::vulkan_context() {
@@ -85,6 +88,10 @@ CommandBufferPool* EscherImpl::transfer_command_buffer_pool() {
   return escher_->transfer_command_buffer_pool();
 }
 
+CommandBufferPool* EscherImpl::compute_command_buffer_pool() {
+  return escher_->compute_command_buffer_pool();
+}
+
 ImageCache* EscherImpl::image_cache() {
   return escher_->image_cache();
 }
@@ -33,6 +33,7 @@ class EscherImpl {
   CommandBufferSequencer* command_buffer_sequencer();
   CommandBufferPool* command_buffer_pool();
   CommandBufferPool* transfer_command_buffer_pool();
+  CommandBufferPool* compute_command_buffer_pool();
   GpuAllocator* gpu_allocator();
   GpuUploader* gpu_uploader();
   PipelineCache* pipeline_cache();
@@ -0,0 +1,125 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/material_texture_registry.h"
+
+#include <algorithm>
+
+#include "escher/escher.h"
+#include "escher/util/trace_macros.h"
+
+namespace escher {
+namespace impl {
+
+// Each new version of the texture array requires a new descriptor set, but
+// these are only written when textures come and go.
+constexpr uint32_t kInitialDescriptorSetCount = 4;
+
+// Slots that must remain available for the other samplers used by the
+// bindless fragment shader (i.e. the light texture).
+constexpr uint32_t kReservedSamplerCount = 1;
+
+MaterialTextureRegistry::MaterialTextureRegistry(Escher* escher)
+    : device_(escher->vulkan_context().device),
+      capacity_(GetCapacity(escher->device()->caps())),
+      pool_(escher,
+            GetDescriptorSetLayoutCreateInfo(),
+            kInitialDescriptorSetCount),
+      textures_(std::max(capacity_, 1U), kFallbackTextureIndex + 1) {}
+
+MaterialTextureRegistry::~MaterialTextureRegistry() = default;
+
+uint32_t MaterialTextureRegistry::GetCapacity(
+    const VulkanDeviceQueues::Caps& caps) {
+  if (!caps.shader_sampled_image_array_dynamic_indexing) {
+    return 0;
+  }
+  uint32_t limit = std::min(caps.max_per_stage_descriptor_samplers,
+                            caps.max_per_stage_descriptor_sampled_images);
+  if (limit <= kReservedSamplerCount + kFallbackTextureIndex + 1) {
+    // No room for any textures other than the fallback.
+    return 0;
+  }
+  limit -= kReservedSamplerCount;
+  return limit < kMaxTextureCount ? limit : kMaxTextureCount;
+}
+
+vk::DescriptorSetLayoutCreateInfo
+MaterialTextureRegistry::GetDescriptorSetLayoutCreateInfo() {
+  // Even if unsupported, create a valid (if useless) layout.
+  binding_.binding = kDescriptorSetSamplerBinding;
+  binding_.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  binding_.descriptorCount = std::max(capacity_, 1U);
+  binding_.stageFlags = vk::ShaderStageFlagBits::eFragment;
+  vk::DescriptorSetLayoutCreateInfo info;
+  info.bindingCount = 1;
+  info.pBindings = &binding_;
+  return info;
+}
+
+uint32_t MaterialTextureRegistry::GetIndex(const TexturePtr& texture) {
+  FTL_DCHECK(supported());
+  if (!texture) {
+    return kFallbackTextureIndex;
+  }
+
+  uint32_t index;
+  const uint32_t previous_count = textures_.size();
+  if (textures_.Insert(texture, &index)) {
+    // A newly-registered texture requires a new descriptor set.
+    dirty_ |= textures_.size() != previous_count;
+    return index;
+  }
+  FTL_LOG(ERROR) << "MaterialTextureRegistry is full (" << capacity_
+                 << " textures); using fallback.";
+  return kFallbackTextureIndex;
+}
+
+void MaterialTextureRegistry::ReleaseUnusedTextures() {
+  TRACE_DURATION("gfx", "escher::MaterialTextureRegistry::ReleaseUnused");
+  if (textures_.ReleaseUnused() > 0) {
+    dirty_ = true;
+  }
+}
+
+DescriptorSetAllocationPtr MaterialTextureRegistry::ObtainDescriptorSet(
+    const TexturePtr& fallback_texture) {
+  FTL_DCHECK(supported());
+  FTL_DCHECK(fallback_texture);
+  if (!dirty_ && current_allocation_ &&
+      current_fallback_texture_ == fallback_texture) {
+    return current_allocation_;
+  }
+  TRACE_DURATION("gfx", "escher::MaterialTextureRegistry::ObtainDescriptorSet",
+                 "texture_count", texture_count());
+
+  // Previous versions of the descriptor set may still be referenced by pending
+  // command buffers, so rather than updating in place, write a fresh one.
+  current_allocation_ = pool_.Allocate(1, nullptr);
+  current_fallback_texture_ = fallback_texture;
+  dirty_ = false;
+
+  std::vector<vk::DescriptorImageInfo> image_infos(capacity_);
+  for (uint32_t i = 0; i < capacity_; ++i) {
+    const TexturePtr& texture =
+        textures_.at(i) ? textures_.at(i) : current_fallback_texture_;
+    image_infos[i].imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    image_infos[i].imageView = texture->image_view();
+    image_infos[i].sampler = texture->sampler();
+  }
+
+  vk::WriteDescriptorSet write;
+  write.dstSet = current_allocation_->get(0);
+  write.dstBinding = kDescriptorSetSamplerBinding;
+  write.dstArrayElement = 0;
+  write.descriptorCount = capacity_;
+  write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  write.pImageInfo = image_infos.data();
+  device_.updateDescriptorSets(1, &write, 0, nullptr);
+
+  return current_allocation_;
+}
+
+}  // namespace impl
+}  // namespace escher
@@ -0,0 +1,97 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "escher/forward_declarations.h"
+#include "escher/impl/descriptor_set_pool.h"
+#include "escher/renderer/texture.h"
+#include "escher/util/ref_ptr_slot_table.h"
+#include "escher/vk/vulkan_device_queues.h"
+#include "ftl/macros.h"
+
+namespace escher {
+namespace impl {
+
+// Assigns stable indices to material textures, and exposes all registered
+// textures to shaders via a single array of combined image-samplers.  This
+// allows objects with different textures to share pipelines and descriptor
+// sets; see ModelDisplayListFlag::kUseBindlessMaterialTextures.
+class MaterialTextureRegistry {
+ public:
+  // Upper bound on capacity(); the actual capacity also depends on the
+  // device's per-stage descriptor limits.
+  static constexpr uint32_t kMaxTextureCount = 128;
+  // Objects without a material texture use this index; the corresponding slot
+  // always contains the fallback texture passed to ObtainDescriptorSet().
+  static constexpr uint32_t kFallbackTextureIndex = 0;
+  // layout(set = 2, ...)
+  static constexpr uint32_t kDescriptorSetIndex = 2;
+  // layout(set = 2, binding = 0) uniform sampler2D material_textures[...];
+  static constexpr uint32_t kDescriptorSetSamplerBinding = 0;
+
+  explicit MaterialTextureRegistry(Escher* escher);
+  ~MaterialTextureRegistry();
+
+  // Return the size of the texture array that a device with |caps| supports,
+  // including the fallback slot, or 0 if the device cannot dynamically index
+  // an array of samplers.
+  static uint32_t GetCapacity(const VulkanDeviceQueues::Caps& caps);
+
+  // Return true if the device supports bindless material textures.  If not,
+  // the registry must not be used.
+  bool supported() const { return capacity_ > 0; }
+
+  // Size of the texture array in the fragment shader; see MAX_MATERIAL_TEXTURES
+  // in model_pipeline_cache.cc.
+  uint32_t capacity() const { return capacity_; }
+
+  // Return the index of |texture| within the texture array, registering it if
+  // necessary.  The index remains stable for as long as |texture| is retained
+  // by someone other than the registry.  If the array is full, an error is
+  // logged and kFallbackTextureIndex is returned.
+  uint32_t GetIndex(const TexturePtr& texture);
+
+  // Free the slots of all textures that are retained only by the registry.
+  // Textures referenced by a pending display list are never released, because
+  // the display list also retains them.  Called once per frame, before any
+  // display lists are built.
+  void ReleaseUnusedTextures();
+
+  // Return a descriptor set containing every registered texture; unused slots
+  // refer to |fallback_texture|.  A new set is only written when textures have
+  // been registered or released since the previous call; otherwise, the
+  // previous set is returned.  The caller must retain the allocation for as
+  // long as the descriptor set is in use.
+  DescriptorSetAllocationPtr ObtainDescriptorSet(
+      const TexturePtr& fallback_texture);
+
+  vk::DescriptorSetLayout layout() const { return pool_.layout(); }
+
+  // Number of textures currently registered, not including the fallback.
+  uint32_t texture_count() const { return textures_.size(); }
+
+ private:
+  vk::DescriptorSetLayoutCreateInfo GetDescriptorSetLayoutCreateInfo();
+
+  vk::Device device_;
+  const uint32_t capacity_;
+  // Must be initialized before |pool_|, which refers to it.
+  vk::DescriptorSetLayoutBinding binding_;
+  DescriptorSetPool pool_;
+
+  // The slot at kFallbackTextureIndex is reserved, and always empty.
+  RefPtrSlotTable<Texture> textures_;
+
+  DescriptorSetAllocationPtr current_allocation_;
+  TexturePtr current_fallback_texture_;
+  bool dirty_ = true;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MaterialTextureRegistry);
+};
+
+}  // namespace impl
+}  // namespace escher
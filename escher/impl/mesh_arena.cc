@@ -0,0 +1,181 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/mesh_arena.h"
+
+#include <algorithm>
+
+#include "escher/escher.h"
+#include "escher/impl/command_buffer_sequencer.h"
+#include "escher/util/trace_macros.h"
+#include "escher/vk/buffer.h"
+
+namespace escher {
+namespace impl {
+
+class MeshArena::MeshBuilder : public escher::MeshBuilder {
+ public:
+  MeshBuilder(MeshArena* arena,
+              const MeshSpec& spec,
+              size_t max_vertex_count,
+              size_t max_index_count,
+              GpuUploader::Writer vertex_writer,
+              GpuUploader::Writer index_writer);
+  ~MeshBuilder() override;
+
+  MeshPtr Build() override;
+
+ private:
+  MeshArena* arena_;
+  bool is_built_;
+  GpuUploader::Writer vertex_writer_;
+  GpuUploader::Writer index_writer_;
+};
+
+MeshArena::MeshBuilder::MeshBuilder(MeshArena* arena,
+                                    const MeshSpec& spec,
+                                    size_t max_vertex_count,
+                                    size_t max_index_count,
+                                    GpuUploader::Writer vertex_writer,
+                                    GpuUploader::Writer index_writer)
+    : escher::MeshBuilder(spec,
+                          max_vertex_count,
+                          max_index_count,
+                          vertex_writer.ptr(),
+                          index_writer.ptr()),
+      arena_(arena),
+      is_built_(false),
+      vertex_writer_(std::move(vertex_writer)),
+      index_writer_(std::move(index_writer)) {}
+
+MeshArena::MeshBuilder::~MeshBuilder() {}
+
+MeshPtr MeshArena::MeshBuilder::Build() {
+  FTL_DCHECK(!is_built_);
+  if (is_built_) {
+    return MeshPtr();
+  }
+  is_built_ = true;
+  FTL_DCHECK(spec_.flags & MeshAttribute::kPosition);
+
+  vec2 position_scale;
+  vec2 position_bias;
+  EncodeVertices(&position_scale, &position_bias);
+  CompactIndices();
+
+  const vk::DeviceSize vertex_data_size = vertex_count_ * spec_.GetStride();
+  const vk::DeviceSize index_data_size = index_count_ * index_size();
+  Allocation allocation = arena_->AllocateRanges(
+      spec_, vertex_data_size, index_data_size, index_size());
+  Block* block = allocation.block;
+
+  vertex_writer_.WriteBuffer(block->vertex_buffer,
+                             {0, allocation.vertex_offset, vertex_data_size},
+                             Semaphore::New(arena_->device()));
+  vertex_writer_.Submit();
+
+  index_writer_.WriteBuffer(block->index_buffer,
+                            {0, allocation.index_offset, index_data_size},
+                            SemaphorePtr());
+  index_writer_.Submit();
+
+  // The writers' CommandBuffers have just marked the block's buffers as being
+  // used by them.
+  allocation.upload_sequence_number =
+      std::max(block->vertex_buffer->sequence_number(),
+               block->index_buffer->sequence_number());
+
+  auto mesh = ftl::MakeRefCounted<Mesh>(
+      arena_, spec_, ComputeBoundingBox(), vertex_count_, index_count_,
+      block->vertex_buffer, block->index_buffer, index_type(),
+      allocation.vertex_offset, allocation.index_offset, position_scale,
+      position_bias);
+  mesh->SetWaitSemaphore(block->vertex_buffer->TakeWaitSemaphore());
+
+  arena_->allocations_[mesh.get()] = allocation;
+  return mesh;
+}
+
+MeshArena::MeshArena(Escher* escher,
+                     vk::DeviceSize vertex_block_size,
+                     vk::DeviceSize index_block_size)
+    : ResourceRecycler(escher),
+      uploader_(escher->gpu_uploader()),
+      allocator_(escher->gpu_allocator()),
+      buffer_recycler_(escher->resource_recycler()),
+      vertex_block_size_(vertex_block_size),
+      index_block_size_(index_block_size) {}
+
+MeshArena::~MeshArena() {
+  FTL_DCHECK(allocations_.empty());
+}
+
+MeshBuilderPtr MeshArena::NewMeshBuilder(const MeshSpec& spec,
+                                         size_t max_vertex_count,
+                                         size_t max_index_count) {
+  size_t stride = spec.GetStride();
+  return AdoptRef(new MeshArena::MeshBuilder(
+      this, spec, max_vertex_count, max_index_count,
+      uploader_->GetWriter(max_vertex_count * stride),
+      uploader_->GetWriter(
+          max_index_count *
+          MeshSpec::GetIndexSize(MeshSpec::GetIndexType(max_vertex_count)))));
+}
+
+MeshArena::Allocation MeshArena::AllocateRanges(const MeshSpec& spec,
+                                                vk::DeviceSize vertex_size,
+                                                vk::DeviceSize index_size,
+                                                size_t index_alignment) {
+  ranges_.FreeFinishedAllocations(
+      escher()->command_buffer_sequencer()->last_finished_sequence_number());
+
+  Allocation allocation;
+  if (ranges_.Allocate(spec, vertex_size, index_size, index_alignment,
+                       &allocation)) {
+    return allocation;
+  }
+
+  // No existing block has room; create a new one that is large enough.
+  TRACE_DURATION("gfx", "escher::MeshArena::AllocateRanges[new block]",
+                 "block_count", ranges_.block_count() + 1);
+  const vk::DeviceSize vertex_capacity =
+      std::max(vertex_size, vertex_block_size_);
+  const vk::DeviceSize index_capacity =
+      std::max(index_size, index_block_size_);
+  auto vertex_buffer = Buffer::New(buffer_recycler_, allocator_,
+                                   vertex_capacity,
+                                   vk::BufferUsageFlagBits::eVertexBuffer |
+                                       vk::BufferUsageFlagBits::eTransferSrc |
+                                       vk::BufferUsageFlagBits::eTransferDst,
+                                   vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto index_buffer = Buffer::New(buffer_recycler_, allocator_, index_capacity,
+                                  vk::BufferUsageFlagBits::eIndexBuffer |
+                                      vk::BufferUsageFlagBits::eTransferSrc |
+                                      vk::BufferUsageFlagBits::eTransferDst,
+                                  vk::MemoryPropertyFlagBits::eDeviceLocal);
+  ranges_.AddBlock(spec, std::make_unique<Block>(
+                             std::move(vertex_buffer), std::move(index_buffer),
+                             vertex_capacity, index_capacity));
+
+  bool success = ranges_.Allocate(spec, vertex_size, index_size,
+                                  index_alignment, &allocation);
+  FTL_CHECK(success);
+  return allocation;
+}
+
+void MeshArena::RecycleResource(std::unique_ptr<Resource> resource) {
+  FTL_DCHECK(resource->IsKindOf<Mesh>());
+  auto it = allocations_.find(static_cast<Mesh*>(resource.get()));
+  FTL_DCHECK(it != allocations_.end());
+
+  // The Mesh is no longer referenced by any pending CommandBuffer, but if it
+  // was never drawn then the upload of its data might still be pending.
+  ranges_.Free(
+      it->second,
+      escher()->command_buffer_sequencer()->last_finished_sequence_number());
+  allocations_.erase(it);
+}
+
+}  // namespace impl
+}  // namespace escher
@@ -0,0 +1,84 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "escher/impl/gpu_uploader.h"
+#include "escher/impl/mesh_range_allocator.h"
+#include "escher/resources/resource_recycler.h"
+#include "escher/shape/mesh_builder.h"
+#include "escher/shape/mesh_builder_factory.h"
+
+namespace escher {
+namespace impl {
+
+// Generates Meshes whose vertices and indices are sub-allocated from a few
+// large Buffers, instead of allocating a pair of Buffers per Mesh.  Meshes that
+// share a MeshSpec share the same Buffers, differing only by their vertex and
+// index buffer offsets.  This greatly reduces the number of Vulkan allocations
+// when there are many small Meshes (e.g. one per stroke in Sketchy), and keeps
+// similar Meshes adjacent in memory.
+//
+// The arena is the ResourceRecycler of every Mesh that it builds: when a Mesh
+// is no longer referenced by any pending CommandBuffer, its ranges are returned
+// to the arena and reused by subsequent Meshes.
+//
+// Not thread-safe.
+class MeshArena : public MeshBuilderFactory, public ResourceRecycler {
+ public:
+  static constexpr vk::DeviceSize kDefaultVertexBlockSize = 1024 * 1024;
+  static constexpr vk::DeviceSize kDefaultIndexBlockSize = 512 * 1024;
+
+  // Meshes that are too large to fit into a block of the specified size are
+  // given a dedicated block.
+  explicit MeshArena(Escher* escher,
+                     vk::DeviceSize vertex_block_size = kDefaultVertexBlockSize,
+                     vk::DeviceSize index_block_size = kDefaultIndexBlockSize);
+  ~MeshArena() override;
+
+  // The returned MeshBuilder is not thread-safe.
+  MeshBuilderPtr NewMeshBuilder(const MeshSpec& spec,
+                                size_t max_vertex_count,
+                                size_t max_index_count) override;
+
+  // Total number of blocks, across all MeshSpecs.
+  size_t block_count() const { return ranges_.block_count(); }
+  // Total number of bytes of vertex and index data that are occupied by live
+  // Meshes, or by Meshes that are waiting to be recycled.
+  vk::DeviceSize bytes_allocated() const { return ranges_.bytes_allocated(); }
+
+ private:
+  class MeshBuilder;
+  using Block = MeshRangeAllocator::Block;
+  using Allocation = MeshRangeAllocator::Allocation;
+
+  // Find free ranges of the specified sizes in a block for |spec|, creating a
+  // new block if necessary.  The index range is aligned to |index_alignment|.
+  Allocation AllocateRanges(const MeshSpec& spec,
+                            vk::DeviceSize vertex_size,
+                            vk::DeviceSize index_size,
+                            size_t index_alignment);
+
+  // |ResourceRecycler|
+  void RecycleResource(std::unique_ptr<Resource> resource) override;
+
+  GpuUploader* const uploader_;
+  GpuAllocator* const allocator_;
+  ResourceRecycler* const buffer_recycler_;
+  const vk::DeviceSize vertex_block_size_;
+  const vk::DeviceSize index_block_size_;
+
+  MeshRangeAllocator ranges_;
+  std::unordered_map<Mesh*, Allocation> allocations_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MeshArena);
+};
+
+}  // namespace impl
+}  // namespace escher
@@ -39,7 +39,9 @@ MeshBuilderPtr MeshManager::NewMeshBuilder(const MeshSpec& spec,
   return AdoptRef(new MeshManager::MeshBuilder(
       this, spec, max_vertex_count, max_index_count,
       uploader_->GetWriter(max_vertex_count * stride),
-      uploader_->GetWriter(max_index_count * sizeof(uint32_t))));
+      uploader_->GetWriter(
+          max_index_count *
+          MeshSpec::GetIndexSize(MeshSpec::GetIndexType(max_vertex_count)))));
 }
 
 MeshManager::MeshBuilder::MeshBuilder(MeshManager* manager,
@@ -48,58 +50,46 @@ MeshManager::MeshBuilder::MeshBuilder(MeshManager* manager,
                                       size_t max_index_count,
                                       GpuUploader::Writer vertex_writer,
                                       GpuUploader::Writer index_writer)
-    : escher::MeshBuilder(max_vertex_count,
+    : escher::MeshBuilder(spec,
+                          max_vertex_count,
                           max_index_count,
-                          spec.GetStride(),
                           vertex_writer.ptr(),
-                          reinterpret_cast<uint32_t*>(index_writer.ptr())),
+                          index_writer.ptr()),
       manager_(manager),
-      spec_(spec),
       is_built_(false),
       vertex_writer_(std::move(vertex_writer)),
       index_writer_(std::move(index_writer)) {}
 
 MeshManager::MeshBuilder::~MeshBuilder() {}
 
-BoundingBox MeshManager::MeshBuilder::ComputeBoundingBox() const {
-  FTL_DCHECK(vertex_count_ > 0);
-  // This method will need adjustments when we support 3D vertices.
-  FTL_DCHECK(spec_.flags & MeshAttribute::kPosition);
-  uint8_t* vertex_ptr = vertex_staging_buffer_;
-
-  vec2* pos = reinterpret_cast<vec2*>(vertex_ptr);
-  vec3 min(*pos, 0);
-  vec3 max(*pos, 0);
-
-  for (size_t i = 1; i < vertex_count_; ++i) {
-    vertex_ptr += vertex_stride_;
-    pos = reinterpret_cast<vec2*>(vertex_ptr);
-    min = glm::min(min, vec3(*pos, 0));
-    max = glm::max(max, vec3(*pos, 0));
-  }
-
-  return BoundingBox(min, max);
-}
-
 MeshPtr MeshManager::MeshBuilder::Build() {
   FTL_DCHECK(!is_built_);
   if (is_built_) {
     return MeshPtr();
   }
   is_built_ = true;
+  FTL_DCHECK(spec_.flags & MeshAttribute::kPosition);
 
   vk::Device device = manager_->device_;
   GpuAllocator* allocator = manager_->allocator_;
 
+  vec2 position_scale;
+  vec2 position_bias;
+  if (manager_->optimize_meshes_) {
+    OptimizeVertexOrder(&manager_->vertex_cache_stats_);
+  }
+  EncodeVertices(&position_scale, &position_bias);
+  CompactIndices();
+
   // TODO: use eTransferDstOptimal instead of eTransferDst?
   auto vertex_buffer = Buffer::New(manager_->resource_recycler(), allocator,
-                                   vertex_count_ * vertex_stride_,
+                                   vertex_count_ * spec_.GetStride(),
                                    vk::BufferUsageFlagBits::eVertexBuffer |
                                        vk::BufferUsageFlagBits::eTransferSrc |
                                        vk::BufferUsageFlagBits::eTransferDst,
                                    vk::MemoryPropertyFlagBits::eDeviceLocal);
   auto index_buffer = Buffer::New(manager_->resource_recycler(), allocator,
-                                  index_count_ * sizeof(uint32_t),
+                                  index_count_ * index_size(),
                                   vk::BufferUsageFlagBits::eIndexBuffer |
                                       vk::BufferUsageFlagBits::eTransferDst,
                                   vk::MemoryPropertyFlagBits::eDeviceLocal);
@@ -114,7 +104,8 @@ MeshPtr MeshManager::MeshBuilder::Build() {
 
   auto mesh = ftl::MakeRefCounted<Mesh>(
       manager_->resource_recycler(), spec_, ComputeBoundingBox(), vertex_count_,
-      index_count_, vertex_buffer, std::move(index_buffer));
+      index_count_, vertex_buffer, std::move(index_buffer), index_type(), 0,
+      0, position_scale, position_bias);
 
   mesh->SetWaitSemaphore(vertex_buffer->TakeWaitSemaphore());
   return mesh;
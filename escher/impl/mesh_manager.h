@@ -40,6 +40,17 @@ class MeshManager : public MeshBuilderFactory {
 
   ResourceRecycler* resource_recycler() const { return resource_recycler_; }
 
+  // If enabled, Build() reorders the triangles and vertices of each mesh for
+  // vertex cache and fetch locality before uploading it.  This costs CPU time
+  // in Build(), so it is disabled by default.
+  void set_optimize_meshes(bool optimize) { optimize_meshes_ = optimize; }
+  bool optimize_meshes() const { return optimize_meshes_; }
+
+  // Vertex cache miss counts of all meshes optimized so far.
+  const VertexCacheStats& vertex_cache_stats() const {
+    return vertex_cache_stats_;
+  }
+
  private:
   void UpdateBusyResources();
 
@@ -56,10 +67,7 @@ class MeshManager : public MeshBuilderFactory {
     MeshPtr Build() override;
 
    private:
-    BoundingBox ComputeBoundingBox() const;
-
     MeshManager* manager_;
-    MeshSpec spec_;
     bool is_built_;
     GpuUploader::Writer vertex_writer_;
     GpuUploader::Writer index_writer_;
@@ -73,6 +81,8 @@ class MeshManager : public MeshBuilderFactory {
   const vk::Queue queue_;
 
   std::atomic<uint32_t> builder_count_;
+  bool optimize_meshes_ = false;
+  VertexCacheStats vertex_cache_stats_;
 };
 
 }  // namespace impl
@@ -0,0 +1,136 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/mesh_range_allocator.h"
+
+#include <algorithm>
+
+#include "escher/vk/buffer.h"
+
+namespace escher {
+namespace impl {
+
+MeshRangeAllocator::Block::Block(BufferPtr vertex_buffer_in,
+                                 BufferPtr index_buffer_in,
+                                 vk::DeviceSize vertex_capacity,
+                                 vk::DeviceSize index_capacity)
+    : vertex_buffer(std::move(vertex_buffer_in)),
+      index_buffer(std::move(index_buffer_in)),
+      vertex_ranges(vertex_capacity),
+      index_ranges(index_capacity) {}
+
+MeshRangeAllocator::Block::~Block() = default;
+
+MeshRangeAllocator::MeshRangeAllocator() = default;
+
+MeshRangeAllocator::~MeshRangeAllocator() = default;
+
+bool MeshRangeAllocator::Allocate(const MeshSpec& spec,
+                                  vk::DeviceSize vertex_size,
+                                  vk::DeviceSize index_size,
+                                  size_t index_alignment,
+                                  Allocation* allocation_out) {
+  FTL_DCHECK(vertex_size > 0 && index_size > 0);
+
+  // Aligning vertex ranges to the stride keeps every vertex at a whole-numbered
+  // index from the start of the buffer.  Meshes with 16-bit and 32-bit indices
+  // share the index buffer, and Vulkan requires the index buffer offset to be
+  // a multiple of the index size.
+  const size_t vertex_alignment = spec.GetStride();
+
+  auto it = blocks_.find(spec);
+  if (it == blocks_.end()) {
+    return false;
+  }
+  for (auto& block : it->second) {
+    size_t vertex_offset;
+    size_t index_offset;
+    if (!block->vertex_ranges.Allocate(vertex_size, vertex_alignment,
+                                       &vertex_offset)) {
+      continue;
+    }
+    if (!block->index_ranges.Allocate(index_size, index_alignment,
+                                      &index_offset)) {
+      block->vertex_ranges.Free(vertex_offset, vertex_size);
+      continue;
+    }
+    allocation_out->spec = spec;
+    allocation_out->block = block.get();
+    allocation_out->vertex_offset = vertex_offset;
+    allocation_out->vertex_size = vertex_size;
+    allocation_out->index_offset = index_offset;
+    allocation_out->index_size = index_size;
+    allocation_out->upload_sequence_number = 0;
+    return true;
+  }
+  return false;
+}
+
+void MeshRangeAllocator::AddBlock(const MeshSpec& spec,
+                                  std::unique_ptr<Block> block) {
+  FTL_DCHECK(block);
+  blocks_[spec].push_back(std::move(block));
+}
+
+void MeshRangeAllocator::Free(const Allocation& allocation,
+                              uint64_t last_finished_sequence_number) {
+  if (allocation.upload_sequence_number <= last_finished_sequence_number) {
+    FreeRanges(allocation);
+  } else {
+    pending_allocations_.push_back(allocation);
+  }
+}
+
+void MeshRangeAllocator::FreeFinishedAllocations(
+    uint64_t last_finished_sequence_number) {
+  auto it = pending_allocations_.begin();
+  while (it != pending_allocations_.end()) {
+    if (it->upload_sequence_number <= last_finished_sequence_number) {
+      FreeRanges(*it);
+      it = pending_allocations_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void MeshRangeAllocator::FreeRanges(const Allocation& allocation) {
+  Block* block = allocation.block;
+  block->vertex_ranges.Free(allocation.vertex_offset, allocation.vertex_size);
+  block->index_ranges.Free(allocation.index_offset, allocation.index_size);
+
+  if (block->vertex_ranges.empty()) {
+    FTL_DCHECK(block->index_ranges.empty());
+    auto& blocks = blocks_[allocation.spec];
+    auto it = std::find_if(
+        blocks.begin(), blocks.end(),
+        [block](const std::unique_ptr<Block>& b) { return b.get() == block; });
+    FTL_DCHECK(it != blocks.end());
+    if (it != blocks.begin()) {
+      blocks.erase(it);
+    }
+  }
+}
+
+size_t MeshRangeAllocator::block_count() const {
+  size_t count = 0;
+  for (auto& pair : blocks_) {
+    count += pair.second.size();
+  }
+  return count;
+}
+
+vk::DeviceSize MeshRangeAllocator::bytes_allocated() const {
+  vk::DeviceSize bytes = 0;
+  for (auto& pair : blocks_) {
+    for (auto& block : pair.second) {
+      bytes += block->vertex_ranges.bytes_allocated() +
+               block->index_ranges.bytes_allocated();
+    }
+  }
+  return bytes;
+}
+
+}  // namespace impl
+}  // namespace escher
@@ -0,0 +1,106 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "escher/forward_declarations.h"
+#include "escher/shape/mesh_spec.h"
+#include "escher/util/range_allocator.h"
+#include "ftl/macros.h"
+#include "ftl/memory/ref_ptr.h"
+
+namespace escher {
+namespace impl {
+
+// Tracks which ranges of MeshArena's blocks are occupied by Meshes.  Each
+// block is a pair of vertex and index buffers that are shared by Meshes with
+// the same MeshSpec.  This is separate from MeshArena, so that it can be tested
+// without a Vulkan device.
+//
+// Not thread-safe.
+class MeshRangeAllocator {
+ public:
+  // A pair of vertex and index buffers, and the bookkeeping of which ranges
+  // within them are available.
+  struct Block {
+    Block(BufferPtr vertex_buffer,
+          BufferPtr index_buffer,
+          vk::DeviceSize vertex_capacity,
+          vk::DeviceSize index_capacity);
+    ~Block();
+
+    BufferPtr vertex_buffer;
+    BufferPtr index_buffer;
+    RangeAllocator vertex_ranges;
+    RangeAllocator index_ranges;
+  };
+
+  // The ranges occupied by a single Mesh.
+  struct Allocation {
+    MeshSpec spec;
+    Block* block;
+    vk::DeviceSize vertex_offset;
+    vk::DeviceSize vertex_size;
+    vk::DeviceSize index_offset;
+    vk::DeviceSize index_size;
+    // Sequence number of the last CommandBuffer that uploaded data into the
+    // ranges.  The ranges cannot be reused until it has finished, even if the
+    // Mesh was never drawn.
+    uint64_t upload_sequence_number;
+  };
+
+  MeshRangeAllocator();
+  ~MeshRangeAllocator();
+
+  // Find free ranges of the specified sizes in one of the blocks for |spec|.
+  // The vertex range is aligned to the stride of |spec|, and the index range
+  // to |index_alignment|.  Return false if no block has room.
+  bool Allocate(const MeshSpec& spec,
+                vk::DeviceSize vertex_size,
+                vk::DeviceSize index_size,
+                size_t index_alignment,
+                Allocation* allocation_out);
+
+  // Make |block| available to subsequent allocations for |spec|.
+  void AddBlock(const MeshSpec& spec, std::unique_ptr<Block> block);
+
+  // Free the ranges of |allocation|, or defer this until a call to
+  // FreeFinishedAllocations() if its upload has not finished.  Blocks that
+  // become empty are destroyed, except for the first block of each MeshSpec,
+  // so that its buffers aren't repeatedly destroyed and recreated.
+  void Free(const Allocation& allocation,
+            uint64_t last_finished_sequence_number);
+
+  // Free the ranges of all deferred allocations whose upload has finished.
+  void FreeFinishedAllocations(uint64_t last_finished_sequence_number);
+
+  // Total number of blocks, across all MeshSpecs.
+  size_t block_count() const;
+  // Total number of bytes of vertex and index data that are occupied by
+  // allocations, including those whose release has been deferred.
+  vk::DeviceSize bytes_allocated() const;
+  // Number of allocations whose release has been deferred.
+  size_t pending_allocation_count() const {
+    return pending_allocations_.size();
+  }
+
+ private:
+  void FreeRanges(const Allocation& allocation);
+
+  std::unordered_map<MeshSpec, std::vector<std::unique_ptr<Block>>,
+                     MeshSpec::Hash>
+      blocks_;
+  std::vector<Allocation> pending_allocations_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MeshRangeAllocator);
+};
+
+}  // namespace impl
+}  // namespace escher
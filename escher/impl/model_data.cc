@@ -17,6 +17,9 @@ namespace impl {
 // deal.
 constexpr uint32_t kInitialPerModelDescriptorSetCount = 50;
 constexpr uint32_t kInitialPerObjectDescriptorSetCount = 200;
+// Bindless per-object sets are shared by all objects whose data is in the same
+// uniform buffer, so far fewer are needed.
+constexpr uint32_t kInitialPerObjectBindlessDescriptorSetCount = 20;
 
 ModelData::ModelData(Escher* escher, GpuAllocator* allocator)
     : device_(escher->vulkan_context().device),
@@ -27,7 +30,12 @@ ModelData::ModelData(Escher* escher, GpuAllocator* allocator)
       per_object_descriptor_set_pool_(
           escher,
           GetPerObjectDescriptorSetLayoutCreateInfo(),
-          kInitialPerObjectDescriptorSetCount) {}
+          kInitialPerObjectDescriptorSetCount),
+      per_object_bindless_descriptor_set_pool_(
+          escher,
+          GetPerObjectBindlessDescriptorSetLayoutCreateInfo(),
+          kInitialPerObjectBindlessDescriptorSetCount),
+      material_texture_registry_(escher) {}
 
 ModelData::~ModelData() {}
 
@@ -81,6 +89,26 @@ ModelData::GetPerObjectDescriptorSetLayoutCreateInfo() {
   return *ptr;
 }
 
+const vk::DescriptorSetLayoutCreateInfo&
+ModelData::GetPerObjectBindlessDescriptorSetLayoutCreateInfo() {
+  constexpr uint32_t kNumBindings = 1;
+  static vk::DescriptorSetLayoutBinding bindings[kNumBindings];
+  static vk::DescriptorSetLayoutCreateInfo info;
+  static vk::DescriptorSetLayoutCreateInfo* ptr = nullptr;
+  if (!ptr) {
+    auto& uniform_binding = bindings[0];
+    uniform_binding.binding = 0;
+    uniform_binding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+    uniform_binding.descriptorCount = 1;
+    uniform_binding.stageFlags =
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    info.bindingCount = kNumBindings;
+    info.pBindings = bindings;
+    ptr = &info;
+  }
+  return *ptr;
+}
+
 const MeshShaderBinding& ModelData::GetMeshShaderBinding(MeshSpec spec) {
   auto ptr = mesh_shader_binding_cache_[spec].get();
   if (ptr) {
@@ -89,51 +117,54 @@ const MeshShaderBinding& ModelData::GetMeshShaderBinding(MeshSpec spec) {
 
   std::vector<vk::VertexInputAttributeDescription> attributes;
 
-  vk::DeviceSize stride = 0;
-  if (spec.flags & MeshAttribute::kPosition) {
-    vk::VertexInputAttributeDescription attribute;
-    attribute.location = kPositionAttributeLocation;
-    attribute.binding = 0;
-    attribute.format = vk::Format::eR32G32Sfloat;
-    attribute.offset = stride;
-
-    stride += sizeof(vec2);
-    attributes.push_back(attribute);
-  }
-  if (spec.flags & MeshAttribute::kPositionOffset) {
-    vk::VertexInputAttributeDescription attribute;
-    attribute.location = kPositionOffsetAttributeLocation;
-    attribute.binding = 0;
-    attribute.format = vk::Format::eR32G32Sfloat;
-    attribute.offset = stride;
-
-    stride += sizeof(vec2);
-    attributes.push_back(attribute);
-  }
-  if (spec.flags & MeshAttribute::kUV) {
-    vk::VertexInputAttributeDescription attribute;
-    attribute.location = kUVAttributeLocation;
-    attribute.binding = 0;
-    attribute.format = vk::Format::eR32G32Sfloat;
-    attribute.offset = stride;
-
-    stride += sizeof(vec2);
-    attributes.push_back(attribute);
+  auto add_attribute = [&attributes, &spec](MeshAttribute flag,
+                                            uint32_t location,
+                                            vk::Format format) {
+    if (spec.flags & flag) {
+      vk::VertexInputAttributeDescription attribute;
+      attribute.location = location;
+      attribute.binding = 0;
+      attribute.format = format;
+      attribute.offset = spec.GetAttributeOffset(flag);
+      attributes.push_back(attribute);
+    }
+  };
+
+  // Compact encodings are normalized or half-float formats, which are read as
+  // floats by the vertex shader.
+  vk::Format position_format = vk::Format::eR32G32Sfloat;
+  if (spec.encodings & MeshAttributeEncoding::kPositionHalfFloat) {
+    position_format = vk::Format::eR16G16Sfloat;
+  } else if (spec.encodings & MeshAttributeEncoding::kPositionSnorm16) {
+    position_format = vk::Format::eR16G16Snorm;
   }
-  if (spec.flags & MeshAttribute::kPerimeterPos) {
-    vk::VertexInputAttributeDescription attribute;
-    attribute.location = kPerimeterPosAttributeLocation;
-    attribute.binding = 0;
-    attribute.format = vk::Format::eR32Sfloat;
-    attribute.offset = stride;
-
-    stride += sizeof(float);
-    attributes.push_back(attribute);
+  vk::Format position_offset_format = vk::Format::eR32G32Sfloat;
+  if (spec.encodings & MeshAttributeEncoding::kPositionOffsetHalfFloat) {
+    position_offset_format = vk::Format::eR16G16Sfloat;
+  } else if (spec.encodings & MeshAttributeEncoding::kPositionOffsetSnorm16) {
+    position_offset_format = vk::Format::eR16G16Snorm;
   }
+  vk::Format uv_format = spec.encodings & MeshAttributeEncoding::kUVUnorm16
+                             ? vk::Format::eR16G16Unorm
+                             : vk::Format::eR32G32Sfloat;
+  vk::Format perimeter_pos_format =
+      spec.encodings & MeshAttributeEncoding::kPerimeterPosUnorm16
+          ? vk::Format::eR16Unorm
+          : vk::Format::eR32Sfloat;
+
+  add_attribute(MeshAttribute::kPosition, kPositionAttributeLocation,
+                position_format);
+  add_attribute(MeshAttribute::kPositionOffset,
+                kPositionOffsetAttributeLocation, position_offset_format);
+  add_attribute(MeshAttribute::kUV, kUVAttributeLocation, uv_format);
+  add_attribute(MeshAttribute::kPerimeterPos, kPerimeterPosAttributeLocation,
+                perimeter_pos_format);
+  add_attribute(MeshAttribute::kColor, kColorAttributeLocation,
+                vk::Format::eR32G32B32A32Sfloat);
 
   vk::VertexInputBindingDescription binding;
   binding.binding = 0;
-  binding.stride = stride;
+  binding.stride = spec.GetStride();
   binding.inputRate = vk::VertexInputRate::eVertex;
 
   auto msb = std::make_unique<MeshShaderBinding>(std::move(binding),
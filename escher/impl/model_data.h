@@ -10,6 +10,7 @@
 
 #include "escher/geometry/types.h"
 #include "escher/impl/descriptor_set_pool.h"
+#include "escher/impl/material_texture_registry.h"
 #include "escher/impl/uniform_buffer_pool.h"
 #include "escher/shape/modifier_wobble.h"
 #include "ftl/macros.h"
@@ -27,6 +28,7 @@ class ModelData {
   static constexpr uint32_t kPositionOffsetAttributeLocation = 1;
   static constexpr uint32_t kUVAttributeLocation = 2;
   static constexpr uint32_t kPerimeterPosAttributeLocation = 3;
+  static constexpr uint32_t kColorAttributeLocation = 4;
 
   // Describes per-model data accessible by shaders.
   struct PerModel {
@@ -62,6 +64,18 @@ class ModelData {
     // Temporary hack.  Soon, per-object params for shape-modifiers, etc. will
     // only be provided to the pipelines that need them.
     ModifierWobble wobble;
+    // Only used by pipelines that index into the MaterialTextureRegistry's
+    // texture array, instead of binding a texture per-object.
+    uint32_t material_texture_index;
+    // Only used by kRoundedRect shapes, whose vertex shader deforms a
+    // canonical mesh into the specified rounded-rect.  Radii are in clockwise
+    // order, starting from top-left.
+    vec2 rounded_rect_size;
+    vec4 rounded_rect_radii;
+    // Only used by analytic shapes, which are drawn as a quad enclosing the
+    // rounded-rect above.  The quad extends this far beyond the rounded-rect
+    // on each axis, so that its anti-aliased edges are not clipped.
+    vec2 analytic_shape_margin;
   };
 
   // If no allocator is provided, Escher's default one will be used.
@@ -80,6 +94,17 @@ class ModelData {
     return &per_object_descriptor_set_pool_;
   }
 
+  // Used instead of per_object_descriptor_set_pool() when material textures
+  // are obtained from material_texture_registry().  These sets contain only a
+  // dynamic uniform buffer, so a single set can be shared by many objects.
+  DescriptorSetPool* per_object_bindless_descriptor_set_pool() {
+    return &per_object_bindless_descriptor_set_pool_;
+  }
+
+  MaterialTextureRegistry* material_texture_registry() {
+    return &material_texture_registry_;
+  }
+
   vk::DescriptorSetLayout per_model_layout() const {
     return per_model_descriptor_set_pool_.layout();
   }
@@ -88,6 +113,14 @@ class ModelData {
     return per_object_descriptor_set_pool_.layout();
   }
 
+  vk::DescriptorSetLayout per_object_bindless_layout() const {
+    return per_object_bindless_descriptor_set_pool_.layout();
+  }
+
+  vk::DescriptorSetLayout material_texture_layout() const {
+    return material_texture_registry_.layout();
+  }
+
   const MeshShaderBinding& GetMeshShaderBinding(MeshSpec spec);
 
  private:
@@ -97,11 +130,15 @@ class ModelData {
   GetPerModelDescriptorSetLayoutCreateInfo();
   static const vk::DescriptorSetLayoutCreateInfo&
   GetPerObjectDescriptorSetLayoutCreateInfo();
+  static const vk::DescriptorSetLayoutCreateInfo&
+  GetPerObjectBindlessDescriptorSetLayoutCreateInfo();
 
   vk::Device device_;
   UniformBufferPool uniform_buffer_pool_;
   DescriptorSetPool per_model_descriptor_set_pool_;
   DescriptorSetPool per_object_descriptor_set_pool_;
+  DescriptorSetPool per_object_bindless_descriptor_set_pool_;
+  MaterialTextureRegistry material_texture_registry_;
 
   std::unordered_map<MeshSpec,
                      std::unique_ptr<MeshShaderBinding>,
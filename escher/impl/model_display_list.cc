@@ -17,11 +17,13 @@ const ResourceTypeInfo ModelDisplayList::kTypeInfo(
 
 ModelDisplayList::ModelDisplayList(ResourceRecycler* resource_recycler,
                                    vk::DescriptorSet stage_data,
+                                   vk::DescriptorSet material_textures,
                                    std::vector<Item> items,
                                    std::vector<TexturePtr> textures,
                                    std::vector<ResourcePtr> resources)
     : Resource(resource_recycler),
       stage_data_(stage_data),
+      material_textures_(material_textures),
       items_(std::move(items)),
       textures_(std::move(textures)),
       resources_(std::move(resources)) {}
@@ -22,10 +22,15 @@ class ModelDisplayList : public Resource {
     ModelPipeline* pipeline;
     MeshPtr mesh;
     uint32_t stencil_reference;
+    // Offset of the object's PerObject data within the uniform buffer bound
+    // by |descriptor_set|.  Only used by pipelines that use bindless material
+    // textures; otherwise each object has its own descriptor set.
+    uint32_t dynamic_offset = 0;
   };
 
   ModelDisplayList(ResourceRecycler* resource_recycler,
                    vk::DescriptorSet stage_data,
+                   vk::DescriptorSet material_textures,
                    std::vector<Item> items,
                    std::vector<TexturePtr> textures,
                    std::vector<ResourcePtr> resources);
@@ -36,8 +41,13 @@ class ModelDisplayList : public Resource {
   // TODO: consider rename
   vk::DescriptorSet stage_data() const { return stage_data_; }
 
+  // Null unless the display list was built with
+  // ModelDisplayListFlag::kUseBindlessMaterialTextures.
+  vk::DescriptorSet material_textures() const { return material_textures_; }
+
  private:
   vk::DescriptorSet stage_data_;
+  vk::DescriptorSet material_textures_;
 
   std::vector<Item> items_;
   std::vector<TexturePtr> textures_;
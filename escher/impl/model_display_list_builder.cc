@@ -4,9 +4,13 @@
 
 #include "escher/impl/model_display_list_builder.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <glm/gtx/transform.hpp>
 
 #include "escher/impl/command_buffer.h"
+#include "escher/impl/material_texture_registry.h"
 #include "escher/impl/model_pipeline_cache.h"
 #include "escher/impl/model_renderer.h"
 #include "escher/scene/camera.h"
@@ -52,8 +56,12 @@ ModelDisplayListBuilder::ModelDisplayListBuilder(
     : device_(device),
       volume_(stage.viewing_volume()),
       camera_transform_(AdjustCameraTransform(stage, camera, scale)),
+      lod_camera_transform_(camera.projection() * camera.transform()),
       use_material_textures_(!(flags & ModelDisplayListFlag::kUseDepthPrepass)),
       disable_depth_test_(flags & ModelDisplayListFlag::kDisableDepthTest),
+      use_analytic_shapes_(flags & ModelDisplayListFlag::kUseAnalyticShapes),
+      use_bindless_material_textures_(
+          flags & ModelDisplayListFlag::kUseBindlessMaterialTextures),
       white_texture_(white_texture),
       illumination_texture_(illumination_texture ? illumination_texture
                                                  : white_texture),
@@ -63,6 +71,9 @@ ModelDisplayListBuilder::ModelDisplayListBuilder(
           model_data->per_model_descriptor_set_pool()),
       per_object_descriptor_set_pool_(
           model_data->per_object_descriptor_set_pool()),
+      per_object_bindless_descriptor_set_pool_(
+          model_data->per_object_bindless_descriptor_set_pool()),
+      material_texture_registry_(model_data->material_texture_registry()),
       pipeline_cache_(pipeline_cache) {
   FTL_DCHECK(white_texture_);
 
@@ -70,6 +81,8 @@ ModelDisplayListBuilder::ModelDisplayListBuilder(
   pipeline_spec_.sample_count = sample_count;
   pipeline_spec_.use_depth_prepass =
       bool(flags & ModelDisplayListFlag::kUseDepthPrepass);
+  pipeline_spec_.use_bindless_material_textures =
+      use_bindless_material_textures_;
 
   // Obtain a uniform buffer and write the PerModel data to it.
   PrepareUniformBufferForWriteOfSize(sizeof(ModelData::PerModel), 0);
@@ -131,14 +144,21 @@ void ModelDisplayListBuilder::AddClipperObject(const Object& object) {
 
   PrepareUniformBufferForWriteOfSize(sizeof(ModelData::PerObject),
                                      kMinUniformBufferOffsetAlignment);
+  const uint32_t uniform_offset = uniform_buffer_write_index_;
   vk::DescriptorSet descriptor_set = ObtainPerObjectDescriptorSet();
-  UpdateDescriptorSetForObject(object, descriptor_set);
+  const MeshPtr& mesh = SelectMeshForObject(object);
+  UpdateDescriptorSetForObject(object, mesh, descriptor_set);
 
   ModelDisplayList::Item item;
   item.descriptor_set = descriptor_set;
-  item.mesh = renderer_->GetMeshForShape(object.shape());
+  item.dynamic_offset = use_bindless_material_textures_ ? uniform_offset : 0;
+  item.mesh = mesh;
   pipeline_spec_.mesh_spec = item.mesh->spec();
   pipeline_spec_.shape_modifiers = object.shape().modifiers();
+  pipeline_spec_.is_analytic_shape = IsAnalyticShape(object.shape());
+  pipeline_spec_.is_rounded_rect =
+      !pipeline_spec_.is_analytic_shape &&
+      object.shape().type() == Shape::Type::kRoundedRect;
   pipeline_spec_.is_clippee = clip_depth_ > 0;
   pipeline_spec_.clipper_state =
       ModelPipelineSpec::ClipperState::kBeginClipChildren;
@@ -189,6 +209,8 @@ void ModelDisplayListBuilder::AddClipperAndClippeeObjects(
     ModelDisplayList::Item item = items_[index];
     pipeline_spec_.mesh_spec = item.mesh->spec();
     pipeline_spec_.shape_modifiers = ShapeModifiers();
+    pipeline_spec_.is_rounded_rect = item.pipeline->spec().is_rounded_rect;
+    pipeline_spec_.is_analytic_shape = item.pipeline->spec().is_analytic_shape;
     pipeline_spec_.is_clippee = is_clippee;
     pipeline_spec_.clipper_state =
         ModelPipelineSpec::ClipperState::kEndClipChildren;
@@ -212,14 +234,21 @@ void ModelDisplayListBuilder::AddNonClipperObject(const Object& object) {
     // Simply push the item.
     PrepareUniformBufferForWriteOfSize(sizeof(ModelData::PerObject),
                                        kMinUniformBufferOffsetAlignment);
+    const uint32_t uniform_offset = uniform_buffer_write_index_;
     vk::DescriptorSet descriptor_set = ObtainPerObjectDescriptorSet();
-    UpdateDescriptorSetForObject(object, descriptor_set);
+    const MeshPtr& mesh = SelectMeshForObject(object);
+    UpdateDescriptorSetForObject(object, mesh, descriptor_set);
 
     ModelDisplayList::Item item;
     item.descriptor_set = descriptor_set;
-    item.mesh = renderer_->GetMeshForShape(object.shape());
+    item.dynamic_offset = use_bindless_material_textures_ ? uniform_offset : 0;
+    item.mesh = mesh;
     pipeline_spec_.mesh_spec = item.mesh->spec();
     pipeline_spec_.shape_modifiers = object.shape().modifiers();
+    pipeline_spec_.is_analytic_shape = IsAnalyticShape(object.shape());
+    pipeline_spec_.is_rounded_rect =
+        !pipeline_spec_.is_analytic_shape &&
+        object.shape().type() == Shape::Type::kRoundedRect;
     pipeline_spec_.is_clippee = clip_depth_ > 0;
     pipeline_spec_.clipper_state =
         ModelPipelineSpec::ClipperState::kNoClipChildren;
@@ -249,8 +278,89 @@ void ModelDisplayListBuilder::AddObject(const Object& object) {
   }
 }
 
+const MeshPtr& ModelDisplayListBuilder::SelectMeshForObject(
+    const Object& object) {
+  const Shape& shape = object.shape();
+  if (IsAnalyticShape(shape)) {
+    return renderer_->analytic_shape_mesh();
+  }
+  if (shape.type() == Shape::Type::kRoundedRect) {
+    // Choose the canonical mesh with enough corner divisions for the largest
+    // corner, as it appears on screen.
+    const RoundedRectSpec& spec = shape.rounded_rect();
+    const float max_radius =
+        std::max(std::max(spec.top_left_radius, spec.top_right_radius),
+                 std::max(spec.bottom_right_radius, spec.bottom_left_radius));
+    const float max_extent = std::max(spec.width, spec.height);
+    const float radius_pixels =
+        max_extent > 0.f
+            ? ComputeScreenSize(object) * max_radius / max_extent
+            : 0.f;
+    return renderer_->GetUnitRoundedRectMesh(
+        GetRoundedRectCornerDivisionTier(radius_pixels));
+  }
+  const MeshLodPtr& mesh_lod = shape.mesh_lod();
+  if (mesh_lod) {
+    return mesh_lod->SelectMesh(ComputeScreenSize(object));
+  }
+  return renderer_->GetMeshForShape(shape);
+}
+
+float ModelDisplayListBuilder::ComputeScreenSize(const Object& object) const {
+  const mat4 transform = lod_camera_transform_ * object.transform();
+  const BoundingBox box = object.shape().bounding_box();
+  const vec3 corners[2] = {box.min(), box.max()};
+
+  vec2 ndc_min(std::numeric_limits<float>::max());
+  vec2 ndc_max(std::numeric_limits<float>::lowest());
+  for (int i = 0; i < 8; ++i) {
+    vec4 pos = transform * vec4(corners[i & 1].x, corners[(i >> 1) & 1].y,
+                                corners[(i >> 2) & 1].z, 1.f);
+    if (pos.w <= 0.f) {
+      // Part of the object is behind the camera; be conservative and use the
+      // finest level of detail.
+      return std::numeric_limits<float>::infinity();
+    }
+    vec2 ndc = vec2(pos) / pos.w;
+    ndc_min = glm::min(ndc_min, ndc);
+    ndc_max = glm::max(ndc_max, ndc);
+  }
+  // NDC range from -1 to 1 across the viewing volume.
+  const vec2 size =
+      0.5f * (ndc_max - ndc_min) * vec2(volume_.width(), volume_.height());
+  return std::max(size.x, size.y);
+}
+
+bool ModelDisplayListBuilder::IsAnalyticShape(const Shape& shape) const {
+  const Shape::Type type = shape.type();
+  return use_analytic_shapes_ && !shape.modifiers() &&
+         (type == Shape::Type::kRect || type == Shape::Type::kCircle ||
+          type == Shape::Type::kRoundedRect);
+}
+
+vec2 ModelDisplayListBuilder::ComputePixelSize(const Object& object,
+                                               vec2 position) const {
+  const mat4 transform = lod_camera_transform_ * object.transform();
+  const vec4 origin = transform * vec4(position, 0.f, 1.f);
+  const vec4 x_step = transform * vec4(position + vec2(1.f, 0.f), 0.f, 1.f);
+  const vec4 y_step = transform * vec4(position + vec2(0.f, 1.f), 0.f, 1.f);
+  if (origin.w <= 0.f || x_step.w <= 0.f || y_step.w <= 0.f) {
+    return vec2(0.f, 0.f);
+  }
+  // Number of pixels spanned by a unit step along each axis.
+  const vec2 half_viewport = 0.5f * vec2(volume_.width(), volume_.height());
+  const vec2 ndc = vec2(origin) / origin.w;
+  const float x_pixels =
+      glm::length((vec2(x_step) / x_step.w - ndc) * half_viewport);
+  const float y_pixels =
+      glm::length((vec2(y_step) / y_step.w - ndc) * half_viewport);
+  return vec2(x_pixels > 0.f ? 1.f / x_pixels : 0.f,
+              y_pixels > 0.f ? 1.f / y_pixels : 0.f);
+}
+
 void ModelDisplayListBuilder::UpdateDescriptorSetForObject(
     const Object& object,
+    const MeshPtr& mesh,
     vk::DescriptorSet descriptor_set) {
   auto per_object = reinterpret_cast<ModelData::PerObject*>(
       &(uniform_buffer_->ptr()[uniform_buffer_write_index_]));
@@ -260,12 +370,48 @@ void ModelDisplayListBuilder::UpdateDescriptorSetForObject(
 
   // Push uniforms for scale/translation and color.
   per_object->transform = camera_transform_ * object.transform();
+  if (mesh->spec().HasEncodedPositions()) {
+    // Meshes with compact position encodings store positions relative to a
+    // per-mesh scale and bias, which is cheaper to apply here than per-vertex.
+    per_object->transform = per_object->transform *
+                            glm::translate(vec3(mesh->position_bias(), 0.f)) *
+                            glm::scale(vec3(mesh->position_scale(), 1.f));
+  }
   per_object->color = mat ? mat->color() : vec4(1, 1, 1, 1);  // always opaque
+  const Shape& shape = object.shape();
+  if (shape.type() == Shape::Type::kRoundedRect) {
+    const RoundedRectSpec& spec = shape.rounded_rect();
+    per_object->rounded_rect_size = vec2(spec.width, spec.height);
+    per_object->rounded_rect_radii =
+        vec4(spec.top_left_radius, spec.top_right_radius,
+             spec.bottom_right_radius, spec.bottom_left_radius);
+  }
+  if (IsAnalyticShape(shape)) {
+    // The fragment shader evaluates the signed-distance function of a
+    // rounded-rect centered at |center|; describe rects and circles as such.
+    vec2 center(0.f, 0.f);
+    if (shape.type() == Shape::Type::kRect) {
+      // See NewSimpleRectangleMesh().
+      center = vec2(0.5f, 0.5f);
+      per_object->rounded_rect_size = vec2(1.f, 1.f);
+      per_object->rounded_rect_radii = vec4(0.f, 0.f, 0.f, 0.f);
+    } else if (shape.type() == Shape::Type::kCircle) {
+      // See ModelRenderer::CreateCircle().
+      per_object->rounded_rect_size = vec2(2.f, 2.f);
+      per_object->rounded_rect_radii = vec4(1.f, 1.f, 1.f, 1.f);
+    }
+    per_object->transform =
+        per_object->transform * glm::translate(vec3(center, 0.f));
+    // A one-pixel margin leaves room for the anti-aliased edge.
+    per_object->analytic_shape_margin = ComputePixelSize(object, center);
+  }
 
   // Find the texture to use, either the object's material's texture, or
   // the default texture if the material doesn't have one.
   vk::ImageView image_view;
   vk::Sampler sampler;
+  uint32_t material_texture_index =
+      MaterialTextureRegistry::kFallbackTextureIndex;
   if (auto& texture = mat ? mat->texture() : nullptr) {
     if (!use_material_textures_) {
       // The object's material has a texture, but we choose not to use it.
@@ -274,6 +420,9 @@ void ModelDisplayListBuilder::UpdateDescriptorSetForObject(
     } else {
       image_view = object.material()->image_view();
       sampler = object.material()->sampler();
+      if (use_bindless_material_textures_) {
+        material_texture_index = material_texture_registry_->GetIndex(texture);
+      }
       textures_.push_back(texture);
     }
   } else {
@@ -288,9 +437,13 @@ void ModelDisplayListBuilder::UpdateDescriptorSetForObject(
     per_object->wobble = wobble ? *wobble : ModifierWobble();
   }
 
-  // Update each descriptor in the PerObject descriptor set.
-  {
-    // A pair of writes; order doesn't matter.
+  if (use_bindless_material_textures_) {
+    // The shared descriptor set already refers to the uniform buffer, and the
+    // texture is found by index; there is no descriptor to update.
+    per_object->material_texture_index = material_texture_index;
+  } else {
+    // Update each descriptor in the PerObject descriptor set.  A pair of
+    // writes; order doesn't matter.
     vk::WriteDescriptorSet writes[ModelData::PerObject::kDescriptorCount];
 
     auto& buffer_write = writes[0];
@@ -348,14 +501,29 @@ ModelDisplayListPtr ModelDisplayListBuilder::Build(
   }
   uniform_buffers_.clear();
 
+  // Obtain the texture array only after all objects have been added, since
+  // adding them may have registered new textures.
+  vk::DescriptorSet material_textures_descriptor_set;
+  if (use_bindless_material_textures_) {
+    DescriptorSetAllocationPtr material_textures_allocation =
+        material_texture_registry_->ObtainDescriptorSet(white_texture_);
+    material_textures_descriptor_set = material_textures_allocation->get(0);
+    resources_.push_back(std::move(material_textures_allocation));
+  }
+
   auto display_list = ftl::MakeRefCounted<ModelDisplayList>(
       renderer_->resource_recycler(), per_model_descriptor_set_,
-      std::move(items_), std::move(textures_), std::move(resources_));
+      material_textures_descriptor_set, std::move(items_),
+      std::move(textures_), std::move(resources_));
   command_buffer->KeepAlive(display_list);
   return display_list;
 }
 
 vk::DescriptorSet ModelDisplayListBuilder::ObtainPerObjectDescriptorSet() {
+  if (use_bindless_material_textures_) {
+    return ObtainPerObjectBindlessDescriptorSet();
+  }
+
   if (!per_object_descriptor_set_allocation_ ||
       per_object_descriptor_set_index_ >=
           per_object_descriptor_set_allocation_->size()) {
@@ -375,6 +543,37 @@ vk::DescriptorSet ModelDisplayListBuilder::ObtainPerObjectDescriptorSet() {
   return ds;
 }
 
+vk::DescriptorSet
+ModelDisplayListBuilder::ObtainPerObjectBindlessDescriptorSet() {
+  // A single descriptor set is shared by all objects whose PerObject data is
+  // written to the same uniform buffer; each object's data is selected by the
+  // dynamic offset that is stored in its ModelDisplayList::Item.
+  if (per_object_bindless_descriptor_set_buffer_ == uniform_buffer_->get()) {
+    return per_object_bindless_descriptor_set_;
+  }
+
+  DescriptorSetAllocationPtr allocation =
+      per_object_bindless_descriptor_set_pool_->Allocate(1, nullptr);
+  per_object_bindless_descriptor_set_ = allocation->get(0);
+  per_object_bindless_descriptor_set_buffer_ = uniform_buffer_->get();
+  resources_.push_back(std::move(allocation));
+
+  vk::WriteDescriptorSet buffer_write;
+  buffer_write.dstSet = per_object_bindless_descriptor_set_;
+  buffer_write.dstBinding = ModelData::PerObject::kDescriptorSetUniformBinding;
+  buffer_write.dstArrayElement = 0;
+  buffer_write.descriptorCount = 1;
+  buffer_write.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+  vk::DescriptorBufferInfo buffer_info;
+  buffer_info.buffer = uniform_buffer_->get();
+  buffer_info.range = sizeof(ModelData::PerObject);
+  buffer_info.offset = 0;
+  buffer_write.pBufferInfo = &buffer_info;
+  device_.updateDescriptorSets(1, &buffer_write, 0, nullptr);
+
+  return per_object_bindless_descriptor_set_;
+}
+
 void ModelDisplayListBuilder::PrepareUniformBufferForWriteOfSize(
     size_t size,
     size_t alignment) {
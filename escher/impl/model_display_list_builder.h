@@ -57,9 +57,26 @@ class ModelDisplayListBuilder {
 
   void PrepareUniformBufferForWriteOfSize(size_t size, size_t alignment);
   vk::DescriptorSet ObtainPerObjectDescriptorSet();
+  vk::DescriptorSet ObtainPerObjectBindlessDescriptorSet();
   void UpdateDescriptorSetForObject(const Object& object,
+                                    const MeshPtr& mesh,
                                     vk::DescriptorSet descriptor_set);
 
+  // Return the mesh to draw for the object's shape.  If the shape has levels
+  // of detail, one is chosen based on the object's size on screen.
+  const MeshPtr& SelectMeshForObject(const Object& object);
+  // Return the larger of the width and height, in pixels, of the screen-space
+  // bounds of the object's shape.  Returns infinity if the bounds cross the
+  // camera plane.
+  float ComputeScreenSize(const Object& object) const;
+  // Return true if the object's shape is drawn as a quad, whose fragment
+  // shader evaluates the shape's signed-distance function.
+  bool IsAnalyticShape(const Shape& shape) const;
+  // Return the size of a pixel, measured along the x and y axes of the
+  // object's coordinate system at |position|.  Returns zero if |position| is
+  // behind the camera.
+  vec2 ComputePixelSize(const Object& object, vec2 position) const;
+
   const vk::Device device_;
 
   const ViewingVolume volume_;
@@ -68,6 +85,11 @@ class ModelDisplayListBuilder {
   // particular display list.
   const mat4 camera_transform_;
 
+  // Global camera view/projection matrix, without any adjustment for
+  // downsampling.  Used to choose levels of detail, so that every display list
+  // for a frame chooses the same ones.
+  const mat4 lod_camera_transform_;
+
   // If this is false, use |default_white_texture_| instead of a material's
   // existing texture (e.g. to save bandwidth during depth-only passes).
   const bool use_material_textures_;
@@ -75,6 +97,15 @@ class ModelDisplayListBuilder {
   // If this is true, entirely disable all depth-testing.
   const bool disable_depth_test_;
 
+  // If this is true, rects, circles and rounded-rects are drawn as analytic
+  // shapes; see IsAnalyticShape().
+  const bool use_analytic_shapes_;
+
+  // If this is true, per-object descriptor sets contain only a dynamic uniform
+  // buffer, and are shared between all objects whose PerObject data resides in
+  // the same buffer.  Textures are obtained via |material_texture_registry_|.
+  const bool use_bindless_material_textures_;
+
   const TexturePtr white_texture_;
   const TexturePtr illumination_texture_;
 
@@ -98,10 +129,17 @@ class ModelDisplayListBuilder {
   UniformBufferPool* const uniform_buffer_pool_;
   DescriptorSetPool* const per_model_descriptor_set_pool_;
   DescriptorSetPool* const per_object_descriptor_set_pool_;
+  DescriptorSetPool* const per_object_bindless_descriptor_set_pool_;
+  MaterialTextureRegistry* const material_texture_registry_;
   ModelPipelineCache* const pipeline_cache_;
 
   DescriptorSetAllocationPtr per_object_descriptor_set_allocation_;
 
+  // Only used when |use_bindless_material_textures_| is true.  The descriptor
+  // set that refers to |uniform_buffer_|, if one has been allocated yet.
+  vk::DescriptorSet per_object_bindless_descriptor_set_;
+  vk::Buffer per_object_bindless_descriptor_set_buffer_;
+
   BufferPtr uniform_buffer_;
   uint32_t uniform_buffer_write_index_ = 0;
   uint32_t per_object_descriptor_set_index_ = 0;
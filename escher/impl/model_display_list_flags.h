@@ -17,7 +17,14 @@ enum class ModelDisplayListFlag {
   kSortByPipeline = 1 << 0,
   kUseDepthPrepass = 1 << 1,
   kDisableDepthTest = 1 << 2,
-  kShareDescriptorSetsBetweenObjects = 1 << 3
+  kShareDescriptorSetsBetweenObjects = 1 << 3,
+  // Rather than binding a texture per-object, index into the array of textures
+  // maintained by MaterialTextureRegistry.
+  kUseBindlessMaterialTextures = 1 << 4,
+  // Draw rects, circles and rounded-rects as quads, whose fragment shader
+  // evaluates a signed-distance function to find the shape's anti-aliased
+  // edges.
+  kUseAnalyticShapes = 1 << 5
 };
 
 using ModelDisplayListFlags = vk::Flags<ModelDisplayListFlag>;
@@ -48,7 +55,10 @@ struct FlagTraits<escher::impl::ModelDisplayListFlag> {
                VkFlags(escher::impl::ModelDisplayListFlag::kUseDepthPrepass) |
                VkFlags(escher::impl::ModelDisplayListFlag::kDisableDepthTest) |
                VkFlags(escher::impl::ModelDisplayListFlag::
-                           kShareDescriptorSetsBetweenObjects)
+                           kShareDescriptorSetsBetweenObjects) |
+               VkFlags(escher::impl::ModelDisplayListFlag::
+                           kUseBindlessMaterialTextures) |
+               VkFlags(escher::impl::ModelDisplayListFlag::kUseAnalyticShapes)
   };
 };
 
@@ -20,6 +20,7 @@ class ModelPipeline {
                 vk::PipelineLayout pipeline_layout);
   ~ModelPipeline();
 
+  const ModelPipelineSpec& spec() const { return spec_; }
   vk::Pipeline pipeline() const { return pipeline_; }
   vk::PipelineLayout pipeline_layout() const { return pipeline_layout_; }
 
@@ -27,6 +28,12 @@ class ModelPipeline {
   // VK_DYNAMIC_STATE_STENCIL_REFERENCE.
   bool HasDynamicStencilState() const { return spec_.is_clippee; }
 
+  // Return true if this pipeline's layout expects a dynamic per-object uniform
+  // buffer, and the MaterialTextureRegistry's texture array.
+  bool UsesBindlessMaterialTextures() const {
+    return spec_.use_bindless_material_textures;
+  }
+
  private:
   friend class ModelPipelineCache;
 
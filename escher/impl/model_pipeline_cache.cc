@@ -4,7 +4,12 @@
 
 #include "escher/impl/model_pipeline_cache.h"
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 #include "escher/geometry/types.h"
+#include "escher/impl/material_texture_registry.h"
 #include "escher/impl/mesh_shader_binding.h"
 #include "escher/impl/model_data.h"
 #include "escher/impl/model_pipeline.h"
@@ -26,6 +31,11 @@ constexpr char g_vertex_src[] = R"GLSL(
 
   layout(location = 0) out vec2 fragUV;
 
+  #ifdef HAS_VERTEX_COLOR
+  layout(location = 4) in vec4 inColor;
+  layout(location = 1) out vec4 fragColor;
+  #endif
+
   layout(set = 1, binding = 0) uniform PerObject {
     mat4 transform;
     vec4 color;
@@ -39,6 +49,9 @@ constexpr char g_vertex_src[] = R"GLSL(
     // Halfway between min and max depth.
     gl_Position = transform * vec4(inPosition, 0, 1);
     fragUV = inUV;
+  #ifdef HAS_VERTEX_COLOR
+    fragColor = inColor;
+  #endif
   }
   )GLSL";
 
@@ -54,6 +67,11 @@ constexpr char g_vertex_wobble_src[] = R"GLSL(
 
     layout(location = 0) out vec2 fragUV;
 
+    #ifdef HAS_VERTEX_COLOR
+    layout(location = 4) in vec4 inColor;
+    layout(location = 1) out vec4 fragColor;
+    #endif
+
     layout(set = 0, binding = 0) uniform PerModel {
       vec2 frag_coord_to_uv_multiplier;
       float time;
@@ -124,9 +142,140 @@ constexpr char g_vertex_wobble_src[] = R"GLSL(
       float offset_scale = EvalSineParams_0() + EvalSineParams_1() + EvalSineParams_2();
       gl_Position = transform * vec4(inPosition + offset_scale * inPositionOffset, 0, 1);
       fragUV = inUV;
+    #ifdef HAS_VERTEX_COLOR
+      fragColor = inColor;
+    #endif
     }
     )GLSL";
 
+// Deforms the canonical rounded-rect mesh into the object's rounded-rect.  Must
+// match DeformUnitRoundedRectVertex().
+constexpr char g_vertex_rounded_rect_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  // Attribute locations must match constants in model_data.h.  See
+  // GenerateUnitRoundedRectVertices().
+  layout(location = 0) in vec2 inCornerSign;
+  layout(location = 1) in vec2 inCornerDirection;
+
+  layout(location = 0) out vec2 fragUV;
+
+  layout(set = 1, binding = 0) uniform PerObject {
+    mat4 transform;
+    vec4 color;
+    // Skip over ModelData::PerObject::wobble and material_texture_index.
+    layout(offset = 120) vec2 rounded_rect_size;
+    // Clockwise, starting from top-left.
+    layout(offset = 128) vec4 rounded_rect_radii;
+  };
+
+  out gl_PerVertex {
+    vec4 gl_Position;
+  };
+
+  float CornerRadius(vec2 corner_sign) {
+    if (corner_sign.y < 0.0) {
+      return corner_sign.x < 0.0 ? rounded_rect_radii.x : rounded_rect_radii.y;
+    } else {
+      return corner_sign.x > 0.0 ? rounded_rect_radii.z : rounded_rect_radii.w;
+    }
+  }
+
+  vec2 CornerCenter(vec2 corner_sign) {
+    return corner_sign * (0.5 * rounded_rect_size - CornerRadius(corner_sign));
+  }
+
+  void main() {
+    vec2 pos;
+    if (inCornerSign == vec2(0.0)) {
+      // The central vertex is the average of the four corner centers.
+      pos = 0.25 * (CornerCenter(vec2(-1.0, -1.0)) +
+                    CornerCenter(vec2(1.0, -1.0)) +
+                    CornerCenter(vec2(1.0, 1.0)) +
+                    CornerCenter(vec2(-1.0, 1.0)));
+    } else {
+      pos = CornerCenter(inCornerSign) +
+            CornerRadius(inCornerSign) * inCornerDirection;
+    }
+    gl_Position = transform * vec4(pos, 0, 1);
+    fragUV = pos / rounded_rect_size + 0.5;
+  }
+  )GLSL";
+
+// Draws the quad that encloses an analytic shape, which is described by the
+// same PerObject fields as the rounded-rect above.  The quad is made from the
+// unit square (see NewSimpleRectangleMesh()), and extends beyond the shape by
+// |analytic_shape_margin|.
+constexpr char g_vertex_analytic_shape_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  // Attribute locations must match constants in model_data.h.
+  layout(location = 0) in vec2 inPosition;
+
+  layout(location = 0) out vec2 fragUV;
+  layout(location = 2) out vec2 fragShapePosition;
+
+  layout(set = 1, binding = 0) uniform PerObject {
+    mat4 transform;
+    vec4 color;
+    // Skip over ModelData::PerObject::wobble and material_texture_index.
+    layout(offset = 120) vec2 rounded_rect_size;
+    layout(offset = 144) vec2 analytic_shape_margin;
+  };
+
+  out gl_PerVertex {
+    vec4 gl_Position;
+  };
+
+  void main() {
+    vec2 half_extent = 0.5 * rounded_rect_size + analytic_shape_margin;
+    vec2 pos = (2.0 * inPosition - 1.0) * half_extent;
+    gl_Position = transform * vec4(pos, 0, 1);
+    fragUV = pos / rounded_rect_size + 0.5;
+    fragShapePosition = pos;
+  }
+  )GLSL";
+
+// Appended to the fragment shaders of analytic shapes, which declare the
+// PerObject fields that it uses.  Must match RoundedRectSpec::SignedDistance().
+constexpr char g_analytic_shape_distance_src[] = R"GLSL(
+  float AnalyticShapeDistance(vec2 pos) {
+    vec4 r = rounded_rect_radii;
+    float radius = pos.y < 0.0 ? (pos.x < 0.0 ? r.x : r.y)
+                               : (pos.x < 0.0 ? r.w : r.z);
+    vec2 offset = abs(pos) - 0.5 * rounded_rect_size + radius;
+    return min(max(offset.x, offset.y), 0.0) +
+           length(max(offset, vec2(0.0))) - radius;
+  }
+  )GLSL";
+
+// Used instead of a fragment shader by pipelines that write only depth and
+// stencil, so that they cover only the analytic shape, not the entire quad.
+constexpr char g_fragment_analytic_shape_mask_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  layout(location = 2) in vec2 inShapePosition;
+
+  layout(set = 1, binding = 0) uniform PerObject {
+    mat4 transform;
+    vec4 color;
+    layout(offset = 120) vec2 rounded_rect_size;
+    layout(offset = 128) vec4 rounded_rect_radii;
+  };
+
+  // See g_analytic_shape_distance_src.
+  float AnalyticShapeDistance(vec2 pos);
+
+  void main() {
+    if (AnalyticShapeDistance(inShapePosition) > 0.0) {
+      discard;
+    }
+  }
+  )GLSL";
+
 constexpr char g_fragment_src[] = R"GLSL(
   #version 450
   #extension GL_ARB_separate_shader_objects : enable
@@ -143,18 +292,113 @@ constexpr char g_fragment_src[] = R"GLSL(
   layout(set = 1, binding = 0) uniform PerObject {
     mat4 transform;
     vec4 color;
+  #ifdef ANALYTIC_SHAPE
+    layout(offset = 120) vec2 rounded_rect_size;
+    layout(offset = 128) vec4 rounded_rect_radii;
+  #endif
   };
 
   layout(set = 1, binding = 1) uniform sampler2D material_tex;
 
+  #ifdef HAS_VERTEX_COLOR
+  layout(location = 1) in vec4 inColor;
+  #endif
+
+  #ifdef ANALYTIC_SHAPE
+  layout(location = 2) in vec2 inShapePosition;
+  // See g_analytic_shape_distance_src.
+  float AnalyticShapeDistance(vec2 pos);
+  #endif
+
   layout(location = 0) out vec4 outColor;
 
   void main() {
     vec4 light = texture(light_tex, gl_FragCoord.xy * frag_coord_to_uv_multiplier);
     outColor = light.r * color * texture(material_tex, inUV);
+  #ifdef HAS_VERTEX_COLOR
+    outColor *= inColor;
+  #endif
+  #ifdef ANALYTIC_SHAPE
+    // Fade out over the pixel that straddles the shape's edge.
+    float dist = AnalyticShapeDistance(inShapePosition);
+    float coverage = clamp(0.5 - dist / max(fwidth(dist), 1e-6), 0.0, 1.0);
+    if (coverage <= 0.0) {
+      discard;
+    }
+    outColor.a *= coverage;
+  #endif
+  }
+  )GLSL";
+
+// Identical to g_fragment_src, except that the material texture is looked up in
+// the MaterialTextureRegistry's array, rather than being bound per-object.
+constexpr char g_fragment_bindless_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  layout(location = 0) in vec2 inUV;
+
+  layout(set = 0, binding = 0) uniform PerModel {
+    vec2 frag_coord_to_uv_multiplier;
+    float time;
+  };
+
+  layout(set = 0, binding = 1) uniform sampler2D light_tex;
+
+  layout(set = 1, binding = 0) uniform PerObject {
+    mat4 transform;
+    vec4 color;
+    // Skip over ModelData::PerObject::wobble.
+    layout(offset = 116) uint material_texture_index;
+  #ifdef ANALYTIC_SHAPE
+    layout(offset = 120) vec2 rounded_rect_size;
+    layout(offset = 128) vec4 rounded_rect_radii;
+  #endif
+  };
+
+  // MAX_MATERIAL_TEXTURES is defined by MaterialTextureRegistry::capacity().
+  layout(set = 2, binding = 0) uniform sampler2D material_textures[MAX_MATERIAL_TEXTURES];
+
+  #ifdef HAS_VERTEX_COLOR
+  layout(location = 1) in vec4 inColor;
+  #endif
+
+  #ifdef ANALYTIC_SHAPE
+  layout(location = 2) in vec2 inShapePosition;
+  // See g_analytic_shape_distance_src.
+  float AnalyticShapeDistance(vec2 pos);
+  #endif
+
+  layout(location = 0) out vec4 outColor;
+
+  void main() {
+    vec4 light = texture(light_tex, gl_FragCoord.xy * frag_coord_to_uv_multiplier);
+    outColor = light.r * color *
+        texture(material_textures[material_texture_index], inUV);
+  #ifdef HAS_VERTEX_COLOR
+    outColor *= inColor;
+  #endif
+  #ifdef ANALYTIC_SHAPE
+    // Fade out over the pixel that straddles the shape's edge.
+    float dist = AnalyticShapeDistance(inShapePosition);
+    float coverage = clamp(0.5 - dist / max(fwidth(dist), 1e-6), 0.0, 1.0);
+    if (coverage <= 0.0) {
+      discard;
+    }
+    outColor.a *= coverage;
+  #endif
   }
   )GLSL";
 
+static_assert(offsetof(ModelData::PerObject, material_texture_index) == 116,
+              "must match g_fragment_bindless_src");
+static_assert(offsetof(ModelData::PerObject, rounded_rect_size) == 120,
+              "must match g_vertex_rounded_rect_src");
+static_assert(offsetof(ModelData::PerObject, rounded_rect_radii) == 128,
+              "must match g_vertex_rounded_rect_src");
+static_assert(offsetof(ModelData::PerObject, analytic_shape_margin) == 144,
+              "must match g_vertex_analytic_shape_src");
+
 }  // namespace
 
 ModelPipelineCache::ModelPipelineCache(ModelData* model_data,
@@ -189,6 +433,7 @@ std::pair<vk::Pipeline, vk::PipelineLayout> NewPipelineHelper(
     ModelData* model_data,
     vk::ShaderModule vertex_module,
     vk::ShaderModule fragment_module,
+    bool enable_color_write,
     bool enable_depth_write,
     bool enable_blending,
     vk::CompareOp depth_compare_op,
@@ -341,7 +586,7 @@ std::pair<vk::Pipeline, vk::PipelineLayout> NewPipelineHelper(
   multisampling.rasterizationSamples = sample_count;
 
   vk::PipelineColorBlendAttachmentState color_blend_attachment;
-  if (fragment_module) {
+  if (enable_color_write) {
     color_blend_attachment.colorWriteMask =
         vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
         vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
@@ -420,34 +665,73 @@ std::unique_ptr<ModelPipeline> ModelPipelineCache::NewPipeline(
   std::future<SpirvData> vertex_spirv_future;
   std::future<SpirvData> fragment_spirv_future;
 
-  if (spec.shape_modifiers & ShapeModifier::kWobble) {
+  // Meshes with per-vertex color pass it through to the fragment shader.
+  std::string preamble;
+  if (spec.mesh_spec.flags & MeshAttribute::kColor) {
+    preamble = "#define HAS_VERTEX_COLOR\n";
+  }
+
+  if (spec.is_analytic_shape) {
+    FTL_DCHECK(!spec.shape_modifiers && !spec.is_rounded_rect);
+    preamble += "#define ANALYTIC_SHAPE\n";
     vertex_spirv_future =
         compiler_.Compile(vk::ShaderStageFlagBits::eVertex,
-                          {{g_vertex_wobble_src}}, std::string(), "main");
-  } else {
+                          {{g_vertex_analytic_shape_src}}, preamble, "main");
+  } else if (spec.is_rounded_rect) {
+    FTL_DCHECK(!spec.shape_modifiers);
     vertex_spirv_future =
-        compiler_.Compile(vk::ShaderStageFlagBits::eVertex, {{g_vertex_src}},
-                          std::string(), "main");
+        compiler_.Compile(vk::ShaderStageFlagBits::eVertex,
+                          {{g_vertex_rounded_rect_src}}, preamble, "main");
+  } else if (spec.shape_modifiers & ShapeModifier::kWobble) {
+    vertex_spirv_future =
+        compiler_.Compile(vk::ShaderStageFlagBits::eVertex,
+                          {{g_vertex_wobble_src}}, preamble, "main");
+  } else {
+    vertex_spirv_future = compiler_.Compile(
+        vk::ShaderStageFlagBits::eVertex, {{g_vertex_src}}, preamble, "main");
   }
 
   // The depth-only pre-pass uses a different renderpass and a cheap fragment
   // shader.
   vk::RenderPass render_pass = depth_prepass_;
   const bool enable_depth_write = spec.has_material && !spec.disable_depth_test;
+  const bool enable_color_write = !spec.use_depth_prepass && spec.has_material;
+  // Analytic shapes always need a fragment shader, to discard the parts of the
+  // quad that are outside the shape.
   const bool omit_fragment_shader =
-      spec.use_depth_prepass || !spec.has_material;
-  const bool enable_blending = !spec.is_opaque && !omit_fragment_shader;
+      !enable_color_write && !spec.is_analytic_shape;
+  // Analytic shapes blend their anti-aliased edges, even if they are opaque.
+  const bool enable_blending =
+      (!spec.is_opaque || spec.is_analytic_shape) && enable_color_write;
   const vk::CompareOp depth_compare_op = vk::CompareOp::eLess;
-  if (omit_fragment_shader) {
-    // Omit fragment shader.
+  if (!enable_color_write) {
     if (!spec.use_depth_prepass) {
       render_pass = lighting_pass_;
     }
+    if (spec.is_analytic_shape) {
+      fragment_spirv_future = compiler_.Compile(
+          vk::ShaderStageFlagBits::eFragment,
+          {g_fragment_analytic_shape_mask_src, g_analytic_shape_distance_src},
+          preamble, "main");
+    }
   } else {
     render_pass = lighting_pass_;
+    std::vector<std::string> fragment_src{spec.use_bindless_material_textures
+                                              ? g_fragment_bindless_src
+                                              : g_fragment_src};
+    std::string fragment_preamble = preamble;
+    if (spec.use_bindless_material_textures) {
+      auto registry = model_data_->material_texture_registry();
+      FTL_DCHECK(registry->supported());
+      fragment_preamble += "#define MAX_MATERIAL_TEXTURES " +
+                           std::to_string(registry->capacity()) + "\n";
+    }
+    if (spec.is_analytic_shape) {
+      fragment_src.push_back(g_analytic_shape_distance_src);
+    }
     fragment_spirv_future =
         compiler_.Compile(vk::ShaderStageFlagBits::eFragment,
-                          {{g_fragment_src}}, std::string(), "main");
+                          std::move(fragment_src), fragment_preamble, "main");
   }
 
   // Wait for completion of asynchronous shader compilation.
@@ -473,10 +757,20 @@ std::unique_ptr<ModelPipeline> ModelPipelineCache::NewPipeline(
         ESCHER_CHECKED_VK_RESULT(device.createShaderModule(module_info));
   }
 
+  std::vector<vk::DescriptorSetLayout> descriptor_set_layouts;
+  if (spec.use_bindless_material_textures) {
+    descriptor_set_layouts = {model_data_->per_model_layout(),
+                              model_data_->per_object_bindless_layout(),
+                              model_data_->material_texture_layout()};
+  } else {
+    descriptor_set_layouts = {model_data_->per_model_layout(),
+                              model_data_->per_object_layout()};
+  }
+
   auto pipeline_and_layout = NewPipelineHelper(
-      model_data_, vertex_module, fragment_module, enable_depth_write,
-      enable_blending, depth_compare_op, render_pass,
-      {model_data_->per_model_layout(), model_data_->per_object_layout()}, spec,
+      model_data_, vertex_module, fragment_module, enable_color_write,
+      enable_depth_write, enable_blending, depth_compare_op, render_pass,
+      std::move(descriptor_set_layouts), spec,
       SampleCountFlagBitsFromInt(spec.sample_count));
 
   device.destroyShaderModule(vertex_module);
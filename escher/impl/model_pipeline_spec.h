@@ -39,6 +39,15 @@ struct ModelPipelineSpec {
   bool is_opaque = false;
   // Entirely disable depth test and depth write.
   bool disable_depth_test = false;
+  // Material textures are obtained by indexing into the texture array of the
+  // MaterialTextureRegistry, instead of from a per-object descriptor.
+  bool use_bindless_material_textures = false;
+  // The mesh is the canonical rounded-rect, which the vertex shader deforms
+  // into the object's RoundedRectSpec.
+  bool is_rounded_rect = false;
+  // The mesh is a quad that encloses an analytic shape; the fragment shader
+  // discards fragments outside the shape, and anti-aliases its edges.
+  bool is_analytic_shape = false;
 };
 #pragma pack(pop)
 
@@ -53,7 +62,11 @@ inline bool operator==(const ModelPipelineSpec& spec1,
          spec1.is_clippee == spec2.is_clippee &&
          spec1.use_depth_prepass == spec2.use_depth_prepass &&
          spec1.has_material == spec2.has_material &&
-         spec1.is_opaque == spec2.is_opaque;
+         spec1.is_opaque == spec2.is_opaque &&
+         spec1.use_bindless_material_textures ==
+             spec2.use_bindless_material_textures &&
+         spec1.is_rounded_rect == spec2.is_rounded_rect &&
+         spec1.is_analytic_shape == spec2.is_analytic_shape;
 }
 
 inline bool operator!=(const ModelPipelineSpec& spec1,
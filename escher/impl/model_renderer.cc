@@ -9,6 +9,7 @@
 #include "escher/impl/command_buffer.h"
 #include "escher/impl/escher_impl.h"
 #include "escher/impl/image_cache.h"
+#include "escher/impl/material_texture_registry.h"
 #include "escher/impl/mesh_manager.h"
 #include "escher/impl/model_data.h"
 #include "escher/impl/model_display_list.h"
@@ -20,6 +21,7 @@
 #include "escher/scene/model.h"
 #include "escher/scene/shape.h"
 #include "escher/scene/stage.h"
+#include "escher/shape/rounded_rect.h"
 #include "escher/util/image_utils.h"
 #include "escher/util/trace_macros.h"
 
@@ -38,6 +40,10 @@ ModelRenderer::ModelRenderer(EscherImpl* escher,
       model_data_(model_data) {
   rectangle_ = CreateRectangle();
   circle_ = CreateCircle();
+  for (uint32_t corner_divisions : kRoundedRectCornerDivisionTiers) {
+    unit_rounded_rects_.push_back(
+        NewUnitRoundedRectMesh(mesh_manager_, corner_divisions));
+  }
   white_texture_ = CreateWhiteTexture(escher);
 
   CreateRenderPasses(pre_pass_color_format, lighting_pass_color_format,
@@ -204,6 +210,15 @@ void ModelRenderer::Draw(const Stage& stage,
         vk_command_buffer.bindDescriptorSets(
             vk::PipelineBindPoint::eGraphics, current_pipeline_layout,
             ModelData::PerModel::kDescriptorSetIndex, 1, &ds, 0, nullptr);
+
+        if (item.pipeline->UsesBindlessMaterialTextures()) {
+          FTL_DCHECK(display_list->material_textures());
+          vk::DescriptorSet textures_ds = display_list->material_textures();
+          vk_command_buffer.bindDescriptorSets(
+              vk::PipelineBindPoint::eGraphics, current_pipeline_layout,
+              MaterialTextureRegistry::kDescriptorSetIndex, 1, &textures_ds, 0,
+              nullptr);
+        }
       }
     }
 
@@ -215,9 +230,18 @@ void ModelRenderer::Draw(const Stage& stage,
     }
 
     vk::DescriptorSet ds = item.descriptor_set;
-    vk_command_buffer.bindDescriptorSets(
-        vk::PipelineBindPoint::eGraphics, current_pipeline_layout,
-        ModelData::PerObject::kDescriptorSetIndex, 1, &ds, 0, nullptr);
+    if (item.pipeline->UsesBindlessMaterialTextures()) {
+      // The descriptor set is shared with other objects; select this object's
+      // PerObject data via the dynamic offset.
+      vk_command_buffer.bindDescriptorSets(
+          vk::PipelineBindPoint::eGraphics, current_pipeline_layout,
+          ModelData::PerObject::kDescriptorSetIndex, 1, &ds, 1,
+          &item.dynamic_offset);
+    } else {
+      vk_command_buffer.bindDescriptorSets(
+          vk::PipelineBindPoint::eGraphics, current_pipeline_layout,
+          ModelData::PerObject::kDescriptorSetIndex, 1, &ds, 0, nullptr);
+    }
 
     command_buffer->DrawMesh(item.mesh);
   }
@@ -231,6 +255,8 @@ const MeshPtr& ModelRenderer::GetMeshForShape(const Shape& shape) const {
       return circle_;
     case Shape::Type::kMesh:
       return shape.mesh();
+    case Shape::Type::kRoundedRect:
+      return unit_rounded_rects_.back();
     case Shape::Type::kNone: {
       FTL_DCHECK(false);
       static const MeshPtr kNone;
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "escher/forward_declarations.h"
 #include "escher/impl/model_data.h"
 #include "escher/impl/model_display_list_flags.h"
@@ -53,8 +55,20 @@ class ModelRenderer {
                                         const TexturePtr& illumination_texture,
                                         CommandBuffer* command_buffer);
 
+  // For kRoundedRect shapes, returns the finest canonical rounded-rect; see
+  // GetUnitRoundedRectMesh().
   const MeshPtr& GetMeshForShape(const Shape& shape) const;
 
+  // Return the canonical rounded-rect mesh with the corner divisions specified
+  // by kRoundedRectCornerDivisionTiers[tier].
+  const MeshPtr& GetUnitRoundedRectMesh(size_t tier) const {
+    return unit_rounded_rects_[tier];
+  }
+
+  // Return the unit square, which encloses analytic shapes; see
+  // ModelDisplayListFlag::kUseAnalyticShapes.
+  const MeshPtr& analytic_shape_mesh() const { return rectangle_; }
+
  private:
   void CreateRenderPasses(vk::Format pre_pass_color_format,
                           vk::Format lighting_pass_color_format,
@@ -78,6 +92,7 @@ class ModelRenderer {
 
   MeshPtr rectangle_;
   MeshPtr circle_;
+  std::vector<MeshPtr> unit_rounded_rects_;
 
   TexturePtr white_texture_;
 };
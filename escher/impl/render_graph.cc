@@ -0,0 +1,670 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/render_graph.h"
+
+#include <algorithm>
+
+#include "escher/impl/command_buffer.h"
+#include "escher/impl/command_buffer_pool.h"
+#include "escher/renderer/image_factory.h"
+#include "escher/util/trace_macros.h"
+#include "ftl/logging.h"
+
+namespace escher {
+namespace impl {
+
+namespace {
+
+constexpr size_t kUnassigned = static_cast<size_t>(-1);
+
+struct UsageInfo {
+  vk::ImageLayout layout;
+  vk::PipelineStageFlags stages;
+  vk::AccessFlags read_access;
+  vk::AccessFlags write_access;
+};
+
+UsageInfo GetUsageInfo(RenderGraph::Usage usage) {
+  switch (usage) {
+    case RenderGraph::Usage::kColorAttachment:
+      return {vk::ImageLayout::eColorAttachmentOptimal,
+              vk::PipelineStageFlagBits::eColorAttachmentOutput,
+              vk::AccessFlagBits::eColorAttachmentRead,
+              vk::AccessFlagBits::eColorAttachmentRead |
+                  vk::AccessFlagBits::eColorAttachmentWrite};
+    case RenderGraph::Usage::kDepthAttachment:
+      return {vk::ImageLayout::eDepthStencilAttachmentOptimal,
+              vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                  vk::PipelineStageFlagBits::eLateFragmentTests,
+              vk::AccessFlagBits::eDepthStencilAttachmentRead,
+              vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                  vk::AccessFlagBits::eDepthStencilAttachmentWrite};
+    case RenderGraph::Usage::kSampled:
+      return {vk::ImageLayout::eShaderReadOnlyOptimal,
+              vk::PipelineStageFlagBits::eFragmentShader |
+                  vk::PipelineStageFlagBits::eComputeShader,
+              vk::AccessFlagBits::eShaderRead, vk::AccessFlags()};
+    case RenderGraph::Usage::kGeneral:
+      return {vk::ImageLayout::eGeneral,
+              vk::PipelineStageFlagBits::eFragmentShader |
+                  vk::PipelineStageFlagBits::eComputeShader,
+              vk::AccessFlagBits::eShaderRead,
+              vk::AccessFlagBits::eShaderRead |
+                  vk::AccessFlagBits::eShaderWrite};
+    case RenderGraph::Usage::kTransferSrc:
+      return {vk::ImageLayout::eTransferSrcOptimal,
+              vk::PipelineStageFlagBits::eTransfer,
+              vk::AccessFlagBits::eTransferRead, vk::AccessFlags()};
+    case RenderGraph::Usage::kTransferDst:
+      return {vk::ImageLayout::eTransferDstOptimal,
+              vk::PipelineStageFlagBits::eTransfer,
+              vk::AccessFlagBits::eTransferRead,
+              vk::AccessFlagBits::eTransferWrite};
+  }
+  FTL_CHECK(false);
+  return {};
+}
+
+bool IsAttachment(RenderGraph::Usage usage) {
+  return usage == RenderGraph::Usage::kColorAttachment ||
+         usage == RenderGraph::Usage::kDepthAttachment;
+}
+
+// The stages of the usages that a compute-only queue supports.
+vk::PipelineStageFlags GetComputeQueueStages() {
+  return vk::PipelineStageFlagBits::eComputeShader |
+         vk::PipelineStageFlagBits::eTransfer;
+}
+
+}  // namespace
+
+struct RenderGraph::ImageState {
+  // False until the first pass that uses the image.
+  bool accessed = false;
+  // The queue of the last pass that used the image.
+  Queue queue = Queue::kGraphics;
+  vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+  // The stages and accesses of the last write.
+  vk::PipelineStageFlags write_stages;
+  vk::AccessFlags write_access;
+  // The stages that have read the image since the last barrier or write.
+  vk::PipelineStageFlags read_stages;
+  // The stages that the last write has been made visible to.
+  vk::PipelineStageFlags visible_stages;
+};
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(ImageId image,
+                                                         Usage usage) {
+  graph_->AddAccess(pass_, {image, usage, true, false,
+                            vk::ImageLayout::eUndefined});
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(
+    ImageId image,
+    Usage usage,
+    vk::ImageLayout final_layout) {
+  FTL_DCHECK(GetUsageInfo(usage).write_access);
+  graph_->AddAccess(pass_, {image, usage, false, true, final_layout});
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Modify(
+    ImageId image,
+    Usage usage,
+    vk::ImageLayout final_layout) {
+  FTL_DCHECK(GetUsageInfo(usage).write_access);
+  graph_->AddAccess(pass_, {image, usage, true, true, final_layout});
+  return *this;
+}
+
+RenderGraph::RenderGraph(ImageFactory* image_factory)
+    : image_factory_(image_factory) {}
+
+RenderGraph::~RenderGraph() {}
+
+RenderGraph::ImageId RenderGraph::ImportImage(ImagePtr image,
+                                              vk::ImageLayout final_layout) {
+  ImageEntry entry;
+  entry.kind = ImageKind::kImported;
+  entry.image = std::move(image);
+  entry.final_layout = final_layout;
+  images_.push_back(std::move(entry));
+  return images_.size() - 1;
+}
+
+RenderGraph::ImageId RenderGraph::ImportPreservedImage(
+    ImagePtr image,
+    vk::ImageLayout layout,
+    vk::ImageLayout final_layout) {
+  FTL_DCHECK(layout != vk::ImageLayout::eUndefined);
+  ImageId id = ImportImage(std::move(image), final_layout);
+  images_[id].initial_layout = layout;
+  return id;
+}
+
+RenderGraph::ImageId RenderGraph::CreateImage(const ImageInfo& info) {
+  ImageEntry entry;
+  entry.kind = ImageKind::kTransient;
+  entry.info = info;
+  entry.transient_index = kUnassigned;
+  images_.push_back(std::move(entry));
+  return images_.size() - 1;
+}
+
+RenderGraph::ImageId RenderGraph::DeclareImage() {
+  ImageEntry entry;
+  entry.kind = ImageKind::kDeclared;
+  images_.push_back(std::move(entry));
+  return images_.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name,
+                                              PassFunc func,
+                                              Queue queue) {
+  FTL_DCHECK(!compiled_);
+  Pass pass;
+  pass.name = name;
+  pass.func = std::move(func);
+  pass.queue = queue;
+  passes_.push_back(std::move(pass));
+  return PassBuilder(this, passes_.size() - 1);
+}
+
+void RenderGraph::EnableAsyncCompute(CommandBufferPool* compute_pool,
+                                     uint32_t graphics_queue_family,
+                                     uint32_t compute_queue_family) {
+  FTL_DCHECK(!compiled_);
+  async_compute_ = true;
+  compute_pool_ = compute_pool;
+  graphics_queue_family_ = graphics_queue_family;
+  compute_queue_family_ = compute_queue_family;
+}
+
+void RenderGraph::AddAccess(PassId pass, const Access& access) {
+  FTL_DCHECK(!compiled_);
+  FTL_DCHECK(pass < passes_.size());
+  FTL_DCHECK(access.image < images_.size());
+  auto& accesses = passes_[pass].accesses;
+  // Each pass may use an image in only one way.
+  FTL_DCHECK(std::none_of(
+      accesses.begin(), accesses.end(),
+      [&access](const Access& other) { return other.image == access.image; }));
+  FTL_DCHECK(access.writes ||
+             access.final_layout == vk::ImageLayout::eUndefined);
+  accesses.push_back(access);
+}
+
+void RenderGraph::Compile() {
+  FTL_DCHECK(!compiled_);
+  if (!async_compute_) {
+    for (auto& pass : passes_) {
+      pass.queue = Queue::kGraphics;
+    }
+  }
+  CullPasses();
+  AssignTransientImages();
+  DeriveBarriers();
+  compiled_ = true;
+}
+
+void RenderGraph::CullPasses() {
+  // Visit the passes in reverse, tracking which images will be read by a
+  // needed pass before they are next overwritten.  Imported images are always
+  // needed, since they outlive the graph.
+  std::vector<bool> needed(images_.size());
+  for (size_t i = 0; i < images_.size(); ++i) {
+    needed[i] = images_[i].kind == ImageKind::kImported;
+  }
+  for (size_t i = passes_.size(); i-- > 0;) {
+    Pass& pass = passes_[i];
+    pass.culled = std::none_of(
+        pass.accesses.begin(), pass.accesses.end(),
+        [&needed](const Access& a) { return a.writes && needed[a.image]; });
+    if (pass.culled) {
+      continue;
+    }
+    for (auto& access : pass.accesses) {
+      if (access.writes && !access.reads) {
+        needed[access.image] = false;
+      }
+    }
+    for (auto& access : pass.accesses) {
+      if (access.reads) {
+        needed[access.image] = true;
+      }
+    }
+  }
+}
+
+void RenderGraph::AssignTransientImages() {
+  // Find the first and last pass that uses each transient image.
+  std::vector<size_t> first_use(images_.size(), kUnassigned);
+  std::vector<size_t> last_use(images_.size(), kUnassigned);
+  for (size_t i = 0; i < passes_.size(); ++i) {
+    if (passes_[i].culled) {
+      continue;
+    }
+    for (auto& access : passes_[i].accesses) {
+      if (first_use[access.image] == kUnassigned) {
+        first_use[access.image] = i;
+      }
+      last_use[access.image] = i;
+    }
+  }
+
+  // Assign each transient to an image that is not in use during its lifetime,
+  // and has the same ImageInfo; if there is none, add a new image.
+  std::vector<size_t> free_images;
+  for (size_t i = 0; i < passes_.size(); ++i) {
+    if (passes_[i].culled) {
+      continue;
+    }
+    for (auto& access : passes_[i].accesses) {
+      ImageEntry& entry = images_[access.image];
+      if (entry.kind != ImageKind::kTransient ||
+          first_use[access.image] != i) {
+        continue;
+      }
+      auto it = std::find_if(free_images.begin(), free_images.end(),
+                             [this, &entry](size_t index) {
+                               return transient_images_[index].first ==
+                                      entry.info;
+                             });
+      if (it != free_images.end()) {
+        entry.transient_index = *it;
+        free_images.erase(it);
+      } else {
+        entry.transient_index = transient_images_.size();
+        transient_images_.push_back({entry.info, ImagePtr()});
+      }
+    }
+    for (auto& access : passes_[i].accesses) {
+      const ImageEntry& entry = images_[access.image];
+      if (entry.kind == ImageKind::kTransient && last_use[access.image] == i) {
+        free_images.push_back(entry.transient_index);
+      }
+    }
+  }
+}
+
+void RenderGraph::DeriveBarriers() {
+  // The state of each imported or declared image, followed by that of each
+  // distinct transient image.
+  std::vector<ImageState> states(images_.size() + transient_images_.size());
+  std::vector<bool> used(images_.size());
+
+  // Preserved images were written by earlier work on the graphics queue,
+  // which the first pass that uses them must wait for.
+  for (ImageId id = 0; id < images_.size(); ++id) {
+    if (images_[id].initial_layout != vk::ImageLayout::eUndefined) {
+      ImageState& state = states[id];
+      state.accessed = true;
+      state.layout = images_[id].initial_layout;
+      state.write_stages = vk::PipelineStageFlagBits::eAllCommands;
+      state.write_access = vk::AccessFlagBits::eMemoryWrite;
+    }
+  }
+
+  for (auto& pass : passes_) {
+    if (pass.culled) {
+      continue;
+    }
+    for (auto& access : pass.accesses) {
+      const ImageEntry& entry = images_[access.image];
+      ImageState& state =
+          entry.kind == ImageKind::kTransient
+              ? states[images_.size() + entry.transient_index]
+              : states[access.image];
+      UsageInfo info = GetUsageInfo(access.usage);
+      if (pass.queue == Queue::kAsyncCompute) {
+        info.stages = info.stages & GetComputeQueueStages();
+        FTL_DCHECK(info.stages) << "Pass " << pass.name
+                                << " uses an image in a way that a compute "
+                                   "queue does not support.";
+      }
+      const bool first_use = !used[access.image];
+      used[access.image] = true;
+      // Images have undefined contents when they are first used, even if
+      // they are transients that reuse an image that is already in use,
+      // unless they are preserved.
+      const bool discard =
+          !access.reads ||
+          (first_use && entry.initial_layout == vk::ImageLayout::eUndefined);
+      const vk::AccessFlags dst_access =
+          (access.reads ? info.read_access : vk::AccessFlags()) |
+          (access.writes ? info.write_access : vk::AccessFlags());
+
+      if (state.accessed && state.queue != pass.queue) {
+        // The pass waits on a semaphore that is signaled once the other
+        // queue's work is done, and which makes its writes available.  The
+        // barriers are only needed to transfer the image between queue
+        // families, unless its contents are discarded, and to change its
+        // layout.  Both are chained to the semaphore wait.
+        pass.wait_stages |= info.stages;
+        const uint32_t src_family = GetQueueFamily(state.queue);
+        const uint32_t dst_family = GetQueueFamily(pass.queue);
+        const bool transfer = !discard && src_family != dst_family;
+
+        Barrier barrier;
+        barrier.image = access.image;
+        barrier.old_layout =
+            discard ? vk::ImageLayout::eUndefined : state.layout;
+        barrier.new_layout = info.layout;
+        if (transfer) {
+          barrier.src_queue_family = src_family;
+          barrier.dst_queue_family = dst_family;
+          Barrier release = barrier;
+          release.src_stages = state.write_stages | state.read_stages;
+          release.src_access = state.write_access;
+          release.dst_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+          release.dst_access = vk::AccessFlags();
+          pass.release_barriers.push_back(release);
+        }
+        if (transfer || (barrier.old_layout != barrier.new_layout &&
+                         !(discard && IsAttachment(access.usage)))) {
+          barrier.src_stages = info.stages;
+          barrier.src_access = vk::AccessFlags();
+          barrier.dst_stages = info.stages;
+          barrier.dst_access = dst_access;
+          pass.barriers.push_back(barrier);
+        }
+
+        // Later barriers on this queue need only wait for this pass.
+        if (state.write_stages) {
+          state.write_stages = info.stages;
+        }
+        state.write_access = vk::AccessFlags();
+        state.read_stages = vk::PipelineStageFlags();
+        state.visible_stages = info.stages;
+      } else {
+        bool needs_barrier;
+        if (entry.kind == ImageKind::kDeclared && first_use) {
+          // The pass creates the image, and is responsible for its layout.
+          FTL_DCHECK(access.writes && !access.reads);
+          needs_barrier = false;
+        } else if (discard && !state.accessed && IsAttachment(access.usage)) {
+          // The render pass transitions the image from eUndefined.
+          needs_barrier = false;
+        } else {
+          needs_barrier = state.layout != info.layout || access.writes ||
+                          (state.write_stages &&
+                           (info.stages & ~state.visible_stages) !=
+                               vk::PipelineStageFlags());
+        }
+
+        if (needs_barrier) {
+          Barrier barrier;
+          barrier.image = access.image;
+          barrier.old_layout =
+              discard ? vk::ImageLayout::eUndefined : state.layout;
+          barrier.new_layout = info.layout;
+          barrier.src_stages = state.write_stages | state.read_stages;
+          barrier.src_access = state.write_access;
+          barrier.dst_stages = info.stages;
+          barrier.dst_access = dst_access;
+          pass.barriers.push_back(barrier);
+
+          state.read_stages = vk::PipelineStageFlags();
+          state.visible_stages = info.stages;
+        }
+      }
+
+      state.accessed = true;
+      state.queue = pass.queue;
+      state.layout = info.layout;
+      if (access.writes) {
+        state.write_stages = info.stages;
+        state.write_access = info.write_access;
+        state.read_stages = vk::PipelineStageFlags();
+        state.visible_stages = vk::PipelineStageFlags();
+        if (access.final_layout != vk::ImageLayout::eUndefined) {
+          state.layout = access.final_layout;
+        }
+      } else {
+        state.read_stages |= info.stages;
+      }
+    }
+  }
+
+  // Leave the imported images in the layouts that were asked for, and return
+  // those that were last used on the compute queue to the graphics queue.
+  for (ImageId id = 0; id < images_.size(); ++id) {
+    const ImageEntry& entry = images_[id];
+    const ImageState& state = states[id];
+    if (entry.kind != ImageKind::kImported || !state.accessed) {
+      continue;
+    }
+    Barrier barrier;
+    barrier.image = id;
+    barrier.old_layout = state.layout;
+    barrier.new_layout = entry.final_layout == vk::ImageLayout::eUndefined
+                             ? state.layout
+                             : entry.final_layout;
+    barrier.dst_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+    barrier.dst_access = vk::AccessFlags();
+
+    if (state.queue == Queue::kGraphics) {
+      if (barrier.new_layout != barrier.old_layout) {
+        barrier.src_stages = state.write_stages | state.read_stages;
+        barrier.src_access = state.write_access;
+        final_barriers_.push_back(barrier);
+      }
+      continue;
+    }
+
+    final_wait_stages_ = vk::PipelineStageFlagBits::eAllCommands;
+    const uint32_t src_family = GetQueueFamily(state.queue);
+    const uint32_t dst_family = GetQueueFamily(Queue::kGraphics);
+    if (src_family != dst_family) {
+      barrier.src_queue_family = src_family;
+      barrier.dst_queue_family = dst_family;
+      Barrier release = barrier;
+      release.src_stages = state.write_stages | state.read_stages;
+      release.src_access = state.write_access;
+      final_release_barriers_.push_back(release);
+    } else if (barrier.new_layout == barrier.old_layout) {
+      continue;
+    }
+    barrier.src_stages = vk::PipelineStageFlagBits::eAllCommands;
+    barrier.src_access = vk::AccessFlags();
+    final_barriers_.push_back(barrier);
+  }
+}
+
+uint32_t RenderGraph::GetQueueFamily(Queue queue) const {
+  return queue == Queue::kAsyncCompute ? compute_queue_family_
+                                       : graphics_queue_family_;
+}
+
+void RenderGraph::Execute(
+    const std::function<CommandBuffer*()>& command_buffer,
+    const SubmitFunc& submit) {
+  TRACE_DURATION("gfx", "escher::impl::RenderGraph::Execute");
+  if (!compiled_) {
+    Compile();
+  }
+  FTL_DCHECK(image_factory_ || transient_images_.empty());
+  FTL_DCHECK(!async_compute_ || (compute_pool_ && submit));
+  for (auto& transient : transient_images_) {
+    transient.second = image_factory_->NewImage(transient.first);
+  }
+
+  std::vector<bool> used(images_.size());
+  for (auto& pass : passes_) {
+    if (pass.culled) {
+      continue;
+    }
+    TRACE_DURATION("gfx", "escher::impl::RenderGraph::ExecutePass", "name",
+                   pass.name);
+    if (pass.wait_stages) {
+      SynchronizeQueues(pass.queue, pass.wait_stages, pass.release_barriers,
+                        command_buffer, submit);
+    }
+    CommandBuffer* cmd_buf = pass.queue == Queue::kGraphics
+                                 ? command_buffer()
+                                 : GetComputeCommandBuffer();
+    for (auto& access : pass.accesses) {
+      ImageEntry& entry = images_[access.image];
+      if (entry.kind == ImageKind::kImported && !used[access.image]) {
+        cmd_buf->TakeWaitSemaphore(entry.image,
+                                   GetUsageInfo(access.usage).stages);
+      }
+      used[access.image] = true;
+    }
+    RecordBarriers(cmd_buf, pass.barriers);
+    pass.func(cmd_buf);
+    for (auto& access : pass.accesses) {
+      cmd_buf->KeepAlive(GetImage(access.image));
+    }
+  }
+  if (final_wait_stages_) {
+    SynchronizeQueues(Queue::kGraphics, final_wait_stages_,
+                      final_release_barriers_, command_buffer, submit);
+  }
+  if (!final_barriers_.empty()) {
+    RecordBarriers(command_buffer(), final_barriers_);
+  }
+  // The last pass on the compute queue is always waited for, either by a later
+  // graphics pass or at the end of the frame, which submits its commands.
+  FTL_DCHECK(!compute_command_buffer_);
+
+  // The command buffers keep the transient images alive until they are
+  // finished, after which they are returned to the factory.
+  for (auto& transient : transient_images_) {
+    transient.second = nullptr;
+  }
+}
+
+CommandBuffer* RenderGraph::GetComputeCommandBuffer() {
+  if (!compute_command_buffer_) {
+    compute_command_buffer_ = compute_pool_->GetCommandBuffer();
+  }
+  return compute_command_buffer_;
+}
+
+void RenderGraph::SynchronizeQueues(
+    Queue queue,
+    vk::PipelineStageFlags wait_stages,
+    const std::vector<Barrier>& release_barriers,
+    const std::function<CommandBuffer*()>& command_buffer,
+    const SubmitFunc& submit) {
+  TRACE_DURATION("gfx", "escher::impl::RenderGraph::SynchronizeQueues");
+  auto semaphore = Semaphore::New(compute_pool_->device());
+  if (queue == Queue::kGraphics) {
+    CommandBuffer* compute = GetComputeCommandBuffer();
+    RecordBarriers(compute, release_barriers);
+    compute->AddSignalSemaphore(semaphore);
+    compute->Submit(compute_pool_->queue(), nullptr);
+    compute_command_buffer_ = nullptr;
+    // Submit the graphics work that has already been recorded, so that it
+    // doesn't wait too.
+    submit(SemaphorePtr());
+    command_buffer()->AddWaitSemaphore(std::move(semaphore), wait_stages);
+  } else {
+    RecordBarriers(command_buffer(), release_barriers);
+    submit(semaphore);
+    if (compute_command_buffer_) {
+      compute_command_buffer_->Submit(compute_pool_->queue(), nullptr);
+      compute_command_buffer_ = nullptr;
+    }
+    GetComputeCommandBuffer()->AddWaitSemaphore(std::move(semaphore),
+                                                wait_stages);
+  }
+}
+
+void RenderGraph::RecordBarriers(CommandBuffer* command_buffer,
+                                 const std::vector<Barrier>& barriers) {
+  if (barriers.empty()) {
+    return;
+  }
+  vk::PipelineStageFlags src_stages;
+  vk::PipelineStageFlags dst_stages;
+  std::vector<vk::ImageMemoryBarrier> image_barriers;
+  image_barriers.reserve(barriers.size());
+  for (auto& b : barriers) {
+    const ImagePtr& image = GetImage(b.image);
+    vk::ImageMemoryBarrier barrier;
+    barrier.srcAccessMask = b.src_access;
+    barrier.dstAccessMask = b.dst_access;
+    barrier.oldLayout = b.old_layout;
+    barrier.newLayout = b.new_layout;
+    barrier.srcQueueFamilyIndex = b.src_queue_family;
+    barrier.dstQueueFamilyIndex = b.dst_queue_family;
+    barrier.image = image->get();
+    if (image->has_depth() || image->has_stencil()) {
+      if (image->has_depth()) {
+        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+      }
+      if (image->has_stencil()) {
+        barrier.subresourceRange.aspectMask |=
+            vk::ImageAspectFlagBits::eStencil;
+      }
+    } else {
+      barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    }
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    image_barriers.push_back(barrier);
+
+    src_stages |= b.src_stages;
+    dst_stages |= b.dst_stages;
+  }
+  if (!src_stages) {
+    // Nothing to wait for; only the layout transitions must happen.
+    src_stages = vk::PipelineStageFlagBits::eTopOfPipe;
+  }
+  command_buffer->get().pipelineBarrier(
+      src_stages, dst_stages, vk::DependencyFlags(), 0, nullptr, 0, nullptr,
+      static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+}
+
+const ImagePtr& RenderGraph::GetImage(ImageId image) const {
+  FTL_DCHECK(image < images_.size());
+  const ImageEntry& entry = images_[image];
+  if (entry.kind == ImageKind::kTransient) {
+    FTL_DCHECK(entry.transient_index != kUnassigned);
+    return transient_images_[entry.transient_index].second;
+  }
+  return entry.image;
+}
+
+void RenderGraph::SetImage(ImageId image, ImagePtr value) {
+  FTL_DCHECK(image < images_.size());
+  FTL_DCHECK(images_[image].kind == ImageKind::kDeclared);
+  images_[image].image = std::move(value);
+}
+
+bool RenderGraph::is_culled(PassId pass) const {
+  FTL_DCHECK(compiled_ && pass < passes_.size());
+  return passes_[pass].culled;
+}
+
+RenderGraph::Queue RenderGraph::queue(PassId pass) const {
+  FTL_DCHECK(compiled_ && pass < passes_.size());
+  return passes_[pass].queue;
+}
+
+const std::vector<RenderGraph::Barrier>& RenderGraph::barriers(
+    PassId pass) const {
+  FTL_DCHECK(compiled_ && pass < passes_.size());
+  return passes_[pass].barriers;
+}
+
+bool RenderGraph::waits_for_other_queue(PassId pass) const {
+  FTL_DCHECK(compiled_ && pass < passes_.size());
+  return !!passes_[pass].wait_stages;
+}
+
+const std::vector<RenderGraph::Barrier>& RenderGraph::release_barriers(
+    PassId pass) const {
+  FTL_DCHECK(compiled_ && pass < passes_.size());
+  return passes_[pass].release_barriers;
+}
+
+}  // namespace impl
+}  // namespace escher
@@ -0,0 +1,275 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "escher/forward_declarations.h"
+#include "escher/renderer/image.h"
+#include "escher/renderer/semaphore_wait.h"
+#include "ftl/macros.h"
+
+namespace escher {
+
+class ImageFactory;
+
+namespace impl {
+
+// A render graph describes one frame as a sequence of passes, each of which
+// declares the images that it reads and writes.  From these declarations the
+// graph derives:
+//   - which passes are needed: a pass is culled unless it writes an image that
+//     is read by a later pass that is needed, or an imported image that no
+//     later pass overwrites.
+//   - the image memory barriers between passes, including layout transitions.
+//     Consecutive reads of an image in the same layout need no barrier, and
+//     the barriers before each pass are recorded with a single command.
+//   - the lifetime of each transient image.  Transient images are obtained
+//     from an ImageFactory when the graph is executed, and a transient whose
+//     lifetime has ended is reused for a later one with the same ImageInfo.
+//   - if async compute is enabled, the synchronization between the passes on
+//     the graphics queue and those on the compute queue: each time a pass
+//     uses an image that was last used on the other queue, the other queue's
+//     command buffer is submitted to signal a semaphore that the pass waits
+//     on, and ownership of the image is transferred between queue families.
+//
+// A graph is built, compiled and executed once per frame.  Passes are executed
+// in the order in which they were added.  Not thread-safe.
+class RenderGraph {
+ public:
+  typedef uint32_t ImageId;
+  typedef uint32_t PassId;
+
+  // How a pass uses an image.  Each usage implies the layout that the image
+  // must be in when the pass begins, and the pipeline stages and memory
+  // accesses of the pass.
+  enum class Usage {
+    // Render pass attachments.
+    kColorAttachment,
+    kDepthAttachment,
+    // Sampled by a fragment or compute shader, in eShaderReadOnlyOptimal.
+    kSampled,
+    // Sampled, loaded or stored by a fragment or compute shader, in eGeneral.
+    kGeneral,
+    // The source or destination of a copy, blit or resolve.
+    kTransferSrc,
+    kTransferDst,
+  };
+
+  // The queue that a pass is submitted to.
+  enum class Queue {
+    kGraphics,
+    // The compute-only queue if async compute is enabled, and otherwise the
+    // graphics queue.  Passes on it may only use kSampled, kGeneral and
+    // transfer usages.
+    kAsyncCompute,
+  };
+
+  // A barrier that the graph records before a pass, or at the end of the
+  // frame.
+  struct Barrier {
+    ImageId image;
+    vk::ImageLayout old_layout;
+    vk::ImageLayout new_layout;
+    vk::PipelineStageFlags src_stages;
+    vk::AccessFlags src_access;
+    vk::PipelineStageFlags dst_stages;
+    vk::AccessFlags dst_access;
+    // If these differ, the barrier releases or acquires the image as part of
+    // a transfer of ownership between queue families.
+    uint32_t src_queue_family = VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dst_queue_family = VK_QUEUE_FAMILY_IGNORED;
+  };
+
+  // Records the commands of a pass into |command_buffer|.  The images of the
+  // pass are available from GetImage().
+  typedef std::function<void(CommandBuffer* command_buffer)> PassFunc;
+
+  // Submits the graphics command buffer, signaling |semaphore| (if any) when
+  // it has finished, so that later passes are recorded into a new one.
+  typedef std::function<void(const SemaphorePtr& semaphore)> SubmitFunc;
+
+  // Declares the images used by a pass.  Returned by AddPass().
+  class PassBuilder {
+   public:
+    // The pass reads |image|.
+    PassBuilder& Read(ImageId image, Usage usage);
+    // The pass overwrites |image| without reading its previous contents, and
+    // leaves it in |final_layout| (e.g. the final layout of a render pass
+    // attachment).  If |final_layout| is eUndefined, the usage's layout is
+    // assumed.
+    PassBuilder& Write(
+        ImageId image,
+        Usage usage,
+        vk::ImageLayout final_layout = vk::ImageLayout::eUndefined);
+    // The pass reads |image|, and writes to it.
+    PassBuilder& Modify(
+        ImageId image,
+        Usage usage,
+        vk::ImageLayout final_layout = vk::ImageLayout::eUndefined);
+
+    PassId id() const { return pass_; }
+
+   private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph* graph, PassId pass) : graph_(graph), pass_(pass) {}
+
+    RenderGraph* graph_;
+    PassId pass_;
+  };
+
+  // |image_factory| provides the transient images; it may be null if the graph
+  // is only compiled, and never executed.
+  explicit RenderGraph(ImageFactory* image_factory);
+  ~RenderGraph();
+
+  // Add an image that outlives the graph, such as the frame's output.  Its
+  // contents are not preserved from before the frame, and it is left in
+  // |final_layout| when the graph has executed; if |final_layout| is
+  // eUndefined, it is left in whichever layout it was last used in.  If the
+  // image has a wait semaphore, the first pass that uses it waits on it.
+  ImageId ImportImage(
+      ImagePtr image,
+      vk::ImageLayout final_layout = vk::ImageLayout::eUndefined);
+  // Add an image that outlives the graph, and whose contents are preserved
+  // from before the frame, such as a history that is accumulated over several
+  // frames.  It must be in |layout|, and have last been used on the graphics
+  // queue.  Otherwise the same as ImportImage().
+  ImageId ImportPreservedImage(
+      ImagePtr image,
+      vk::ImageLayout layout,
+      vk::ImageLayout final_layout = vk::ImageLayout::eUndefined);
+  // Add a transient image, which is allocated when the graph is executed.
+  ImageId CreateImage(const ImageInfo& info);
+  // Add an image that is created by the first pass that writes it, which must
+  // call SetImage() and leave it in the layout that it declared.  Used for
+  // images made by helpers such as SsdoAccelerator.
+  ImageId DeclareImage();
+
+  PassBuilder AddPass(const char* name,
+                      PassFunc func,
+                      Queue queue = Queue::kGraphics);
+
+  // Run the kAsyncCompute passes on the queue of |compute_pool|.  Images are
+  // only transferred between the queues if their families differ.  Must be
+  // called before Compile(); if it isn't, every pass runs on the graphics
+  // queue.  |compute_pool| may be null if the graph is only compiled.
+  void EnableAsyncCompute(CommandBufferPool* compute_pool,
+                          uint32_t graphics_queue_family,
+                          uint32_t compute_queue_family);
+
+  // Cull passes, assign transient images, and derive barriers.  Called by
+  // Execute() if necessary.
+  void Compile();
+
+  // Record the passes.  |command_buffer| is called before each graphics pass
+  // to obtain the command buffer to record into, since passes may submit
+  // partial frames.  |submit| is required if async compute is enabled.
+  void Execute(const std::function<CommandBuffer*()>& command_buffer,
+               const SubmitFunc& submit = SubmitFunc());
+
+  // The image with the specified ID.  Transient images are only available
+  // while the graph executes, and declared images only once they have been
+  // set.
+  const ImagePtr& GetImage(ImageId image) const;
+  void SetImage(ImageId image, ImagePtr value);
+
+  // The results of Compile().
+  bool is_culled(PassId pass) const;
+  // The queue that the pass runs on, taking into account whether async
+  // compute is enabled.
+  Queue queue(PassId pass) const;
+  // Recorded on the pass's queue before the pass, including those that
+  // acquire images from the other queue.
+  const std::vector<Barrier>& barriers(PassId pass) const;
+  // Whether the pass waits for the work on the other queue, and the barriers
+  // that release the images that it acquires, which are recorded on the other
+  // queue before it is submitted.
+  bool waits_for_other_queue(PassId pass) const;
+  const std::vector<Barrier>& release_barriers(PassId pass) const;
+  const std::vector<Barrier>& final_barriers() const { return final_barriers_; }
+  // The number of distinct images that the transients are assigned to.
+  size_t transient_image_count() const { return transient_images_.size(); }
+
+ private:
+  enum class ImageKind { kImported, kTransient, kDeclared };
+
+  struct ImageEntry {
+    ImageKind kind;
+    ImagePtr image;
+    ImageInfo info;
+    vk::ImageLayout final_layout = vk::ImageLayout::eUndefined;
+    // For preserved imported images, the layout before the frame.
+    vk::ImageLayout initial_layout = vk::ImageLayout::eUndefined;
+    // For transient images, the index in transient_images_ once compiled.
+    size_t transient_index = 0;
+  };
+
+  struct Access {
+    ImageId image;
+    Usage usage;
+    bool reads;
+    bool writes;
+    vk::ImageLayout final_layout;
+  };
+
+  struct Pass {
+    const char* name;
+    PassFunc func;
+    Queue queue;
+    std::vector<Access> accesses;
+    bool culled = false;
+    std::vector<Barrier> barriers;
+    std::vector<Barrier> release_barriers;
+    // The stages of the pass that wait for the other queue, if any.
+    vk::PipelineStageFlags wait_stages;
+  };
+
+  // The state of an image, or of a transient image that several transients
+  // are assigned to, as the passes are compiled.
+  struct ImageState;
+
+  void AddAccess(PassId pass, const Access& access);
+  void CullPasses();
+  void AssignTransientImages();
+  void DeriveBarriers();
+  uint32_t GetQueueFamily(Queue queue) const;
+  CommandBuffer* GetComputeCommandBuffer();
+  // Submit the command buffer of the queue that |queue| waits for, signaling
+  // a semaphore, and make the next command buffer of |queue| wait on it.
+  void SynchronizeQueues(Queue queue,
+                         vk::PipelineStageFlags wait_stages,
+                         const std::vector<Barrier>& release_barriers,
+                         const std::function<CommandBuffer*()>& command_buffer,
+                         const SubmitFunc& submit);
+  void RecordBarriers(CommandBuffer* command_buffer,
+                      const std::vector<Barrier>& barriers);
+
+  ImageFactory* const image_factory_;
+  std::vector<ImageEntry> images_;
+  std::vector<Pass> passes_;
+  // The ImageInfo of each distinct transient image, and the image while the
+  // graph executes.
+  std::vector<std::pair<ImageInfo, ImagePtr>> transient_images_;
+  std::vector<Barrier> final_barriers_;
+  // Return the imported images that were last used on the compute queue to
+  // the graphics queue at the end of the frame.
+  std::vector<Barrier> final_release_barriers_;
+  vk::PipelineStageFlags final_wait_stages_;
+  bool compiled_ = false;
+
+  bool async_compute_ = false;
+  CommandBufferPool* compute_pool_ = nullptr;
+  uint32_t graphics_queue_family_ = VK_QUEUE_FAMILY_IGNORED;
+  uint32_t compute_queue_family_ = VK_QUEUE_FAMILY_IGNORED;
+  // The open command buffer on the compute queue while the graph executes.
+  CommandBuffer* compute_command_buffer_ = nullptr;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(RenderGraph);
+};
+
+}  // namespace impl
+}  // namespace escher
@@ -363,6 +363,51 @@ void main() {
 }
 )GLSL";
 
+constexpr char g_tile_list_kernel_src[] = R"GLSL(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D lookupTable;
+
+// Must match SsdoAccelerator::TileListHeader (C++).
+layout (binding = 1) buffer TileList {
+  uint group_count_x;
+  uint group_count_y;
+  uint group_count_z;
+  uint padding;
+  uvec2 tiles[];
+} tile_list;
+
+layout(push_constant) uniform TileListConfig {
+  ivec2 cell_count;
+  int tile_size;
+} pushed;
+
+void main() {
+  ivec2 tile = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 first_cell = tile * pushed.tile_size;
+  if (any(greaterThanEqual(first_cell, pushed.cell_count))) {
+    return;
+  }
+  ivec2 end_cell = min(first_cell + pushed.tile_size, pushed.cell_count);
+
+  bool needed = false;
+  for (int y = first_cell.y; y < end_cell.y && !needed; ++y) {
+    for (int x = first_cell.x; x < end_cell.x && !needed; ++x) {
+      vec4 packed = texelFetch(lookupTable, ivec2(x, y) / 4, 0);
+      needed = ((int(packed[y % 4] * 255.0) >> ((x % 4) * 2)) & 3) != 0;
+    }
+  }
+
+  if (needed) {
+    uint index = atomicAdd(tile_list.group_count_x, 1);
+    tile_list.tiles[index] = uvec2(tile);
+  }
+}
+)GLSL";
+
 }  // namespace
 
 SsdoAccelerator::SsdoAccelerator(Escher* escher, ImageFactory* image_factory)
@@ -419,7 +464,9 @@ TexturePtr SsdoAccelerator::GenerateLookupTable(CommandBuffer* command_buffer,
   kernel_->Dispatch({depth_texture, tmp_texture}, {}, command_buffer,
                     work_groups_x, work_groups_y, 1, nullptr);
 
-  timestamper->AddTimestamp("generated SSDO acceleration lookup table");
+  if (timestamper) {
+    timestamper->AddTimestamp("generated SSDO acceleration lookup table");
+  }
   return tmp_texture;
 }
 
@@ -463,7 +510,9 @@ TexturePtr SsdoAccelerator::GenerateNullLookupTable(
   null_kernel_->Dispatch({depth_texture, tmp_texture}, {}, command_buffer,
                          work_groups_x, work_groups_y, 1, nullptr);
 
-  timestamper->AddTimestamp("generated null SSDO acceleration lookup table");
+  if (timestamper) {
+    timestamper->AddTimestamp("generated null SSDO acceleration lookup table");
+  }
   return tmp_texture;
 }
 
@@ -504,11 +553,94 @@ TexturePtr SsdoAccelerator::UnpackLookupTable(
                            command_buffer, work_groups_x, work_groups_y, 1,
                            nullptr);
 
-  timestamper->AddTimestamp(
-      "finished unpacking SSDO acceleration table for debug visualization");
+  if (timestamper) {
+    timestamper->AddTimestamp(
+        "finished unpacking SSDO acceleration table for debug visualization");
+  }
 
   return result_texture;
 }
 
+BufferPtr SsdoAccelerator::GenerateTileList(CommandBuffer* command_buffer,
+                                            const TexturePtr& lookup_table,
+                                            uint32_t width,
+                                            uint32_t height,
+                                            uint32_t tile_size,
+                                            Timestamper* timestamper) {
+  TRACE_DURATION("gfx", "escher::SsdoAccelerator::GenerateTileList");
+  FTL_DCHECK(tile_size > 0);
+
+  // Size of the tiles processed by each workgroup of the compute kernel.  Must
+  // match the value in the compute shader source code.
+  constexpr uint32_t kLocalSize = 8;
+
+  uint32_t tiles_x = width / tile_size + (width % tile_size > 0 ? 1 : 0);
+  uint32_t tiles_y = height / tile_size + (height % tile_size > 0 ? 1 : 0);
+  uint32_t work_groups_x =
+      tiles_x / kLocalSize + (tiles_x % kLocalSize > 0 ? 1 : 0);
+  uint32_t work_groups_y =
+      tiles_y / kLocalSize + (tiles_y % kLocalSize > 0 ? 1 : 0);
+
+  vk::DeviceSize buffer_size =
+      sizeof(TileListHeader) + tiles_x * tiles_y * 2 * sizeof(uint32_t);
+  BufferPtr buffer = Buffer::New(escher_->resource_recycler(),
+                                 escher_->gpu_allocator(), buffer_size,
+                                 vk::BufferUsageFlagBits::eStorageBuffer |
+                                     vk::BufferUsageFlagBits::eIndirectBuffer |
+                                     vk::BufferUsageFlagBits::eTransferDst,
+                                 vk::MemoryPropertyFlagBits::eDeviceLocal);
+  command_buffer->KeepAlive(buffer);
+
+  // Start with an empty list.
+  TileListHeader header;
+  header.dispatch = vk::DispatchIndirectCommand(0, 1, 1);
+  header.padding = 0;
+  command_buffer->get().updateBuffer(buffer->get(), 0, sizeof(header),
+                                     &header);
+
+  vk::BufferMemoryBarrier barrier;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask =
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer->get();
+  barrier.offset = 0;
+  barrier.size = buffer_size;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 0,
+      nullptr, 1, &barrier, 0, nullptr);
+
+  if (!tile_list_kernel_) {
+    FTL_DLOG(INFO) << "Lazily instantiating tile_list_kernel_";
+    tile_list_kernel_ = std::make_unique<ComputeShader>(
+        escher_,
+        std::vector<vk::ImageLayout>{vk::ImageLayout::eShaderReadOnlyOptimal},
+        std::vector<vk::DescriptorType>{vk::DescriptorType::eStorageBuffer},
+        3 * sizeof(int32_t), g_tile_list_kernel_src);
+  }
+  int32_t push_constants[3] = {static_cast<int32_t>(width),
+                               static_cast<int32_t>(height),
+                               static_cast<int32_t>(tile_size)};
+  tile_list_kernel_->Dispatch({lookup_table}, {buffer}, command_buffer,
+                              work_groups_x, work_groups_y, 1, push_constants);
+
+  // Make the list available to the kernels that are dispatched over it.
+  barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead |
+                          vk::AccessFlagBits::eShaderRead;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eDrawIndirect |
+          vk::PipelineStageFlagBits::eComputeShader,
+      vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+
+  if (timestamper) {
+    timestamper->AddTimestamp("generated SSDO tile list");
+  }
+  return buffer;
+}
+
 }  // namespace impl
 }  // namespace escher
@@ -32,6 +32,9 @@ class SsdoAccelerator {
   // significant bits.  Of each pair of bits, the less-significant one indicates
   // whether SSDO sampling is required, and the other indicates whether SSDO
   // filtering is required.
+  //
+  // |command_buffer| may be on the compute queue, in which case |timestamper|
+  // should be null; here and below, a null |timestamper| is ignored.
   TexturePtr GenerateLookupTable(CommandBuffer* command_buffer,
                                  const TexturePtr& depth_texture,
                                  vk::ImageUsageFlags image_flags,
@@ -49,6 +52,29 @@ class SsdoAccelerator {
                                uint32_t output_height,
                                Timestamper* timestamper);
 
+  // The start of the buffer returned by GenerateTileList().  It is followed by
+  // the tiles, each of which is a pair of uint32_t: the x and y index of the
+  // tile.
+  struct TileListHeader {
+    // The number of tiles, in |x|; |y| and |z| are 1.
+    vk::DispatchIndirectCommand dispatch;
+    uint32_t padding;
+  };
+
+  // Return a buffer that lists the tiles of |tile_size| x |tile_size| cells of
+  // |lookup_table| that contain any cell where SSDO sampling or filtering is
+  // required, in no particular order.  |width| and |height| are those of the
+  // depth image that the table was generated from.  The header of the list
+  // can be used as the argument of ComputeShader::DispatchIndirect(), so that
+  // a kernel with a workgroup per tile runs only on the listed tiles.
+  // |lookup_table| must be in eShaderReadOnlyOptimal layout.
+  BufferPtr GenerateTileList(CommandBuffer* command_buffer,
+                             const TexturePtr& lookup_table,
+                             uint32_t width,
+                             uint32_t height,
+                             uint32_t tile_size,
+                             Timestamper* timestamper);
+
   bool enabled() const { return enabled_; }
   void set_enabled(bool enabled) { enabled_ = enabled; }
 
@@ -72,6 +98,8 @@ class SsdoAccelerator {
   // Used by UnpackLookupTable() to unpack an image in the same format as
   // generated by GenerateLookupTable().
   std::unique_ptr<ComputeShader> unpack_kernel_;
+  // Used by GenerateTileList().
+  std::unique_ptr<ComputeShader> tile_list_kernel_;
 
   // If |enabled| is false, calls GenerateNullLookupTable(), which has
   // negligible cost.
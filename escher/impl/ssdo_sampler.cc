@@ -4,6 +4,8 @@
 
 #include "escher/impl/ssdo_sampler.h"
 
+#include <algorithm>
+
 #include "escher/escher.h"
 #include "escher/impl/command_buffer.h"
 #include "escher/impl/glsl_compiler.h"
@@ -16,6 +18,7 @@
 #include "escher/renderer/framebuffer.h"
 #include "escher/renderer/image.h"
 #include "escher/renderer/texture.h"
+#include "escher/renderer/timestamper.h"
 #include "escher/resources/resource_recycler.h"
 #include "escher/shape/mesh.h"
 
@@ -25,7 +28,8 @@ namespace impl {
 namespace {
 
 // Must match the descriptor set index used for textures in the fragment shaders
-// below (g_sampler_fragment_src and g_filter_fragment_src).
+// below (g_sampler_fragment_src, g_filter_fragment_src, g_upsample_fragment_src
+// and g_temporal_fragment_src).
 constexpr char kTextureDescriptorSetBindIndex = 0;
 
 constexpr char g_vertex_src[] = R"GLSL(
@@ -73,6 +77,15 @@ constexpr char g_sampler_fragment_src[] = R"GLSL(
 
     // The size of the viewing volume in (width, height, depth).
     vec3 viewing_volume;
+
+    // The factor by which the output is scaled down from the screen.
+    float downsample_factor;
+
+    // Rotates the pattern of samples given by the noise texture.
+    float noise_offset;
+
+    // The number of screen-space samples to use in the computation.
+    int tap_count;
   } pushed;
 
   // Depth information about the scene.
@@ -92,10 +105,7 @@ constexpr char g_sampler_fragment_src[] = R"GLSL(
   // Must match SsdoSampler::kNoiseSize (C++).
   const int kNoiseSize = 5;
 
-  // The number of screen-space samples to use in the computation.
-  const int kTapCount = 8;
-
-  // These should be relatively primary to each other and to kTapCount;
+  // These should be relatively primary to each other and to the tap count;
   // TODO: only kSpirals.x is used... should .y also be used?
   const vec2 kSpirals = vec2(7.0, 5.0);
 
@@ -136,9 +146,10 @@ constexpr char g_sampler_fragment_src[] = R"GLSL(
   }
 
   void main() {
-    // gl_FragCoord.x ranges from 0.5 to (screen_width - 0.5), and similarly for
+    // gl_FragCoord.x ranges from 0.5 to (output_width - 0.5), and similarly for
     // height, so we adjust them to range from 0.0 to screen_width/height.
-    vec2 accel_coords = (gl_FragCoord.xy - vec2(0.5, 0.5)) / kSsdoAccelPackedDownsampleFactor;
+    vec2 accel_coords = (gl_FragCoord.xy - vec2(0.5, 0.5)) *
+        pushed.downsample_factor / kSsdoAccelPackedDownsampleFactor;
 
     // Consult the accelerator; exit early if no shadow is possible,
     vec4 accel = texture(accelerator, accel_coords);
@@ -150,6 +161,7 @@ constexpr char g_sampler_fragment_src[] = R"GLSL(
     }
 
     vec2 seed = texture(noise, fract(gl_FragCoord.xy / float(kNoiseSize))).rg;
+    seed.x = fract(seed.x + pushed.noise_offset);
 
     float sampled_depth = texture(depth_map, fragment_uv).r;
     float fragment_z = sampled_depth * -pushed.viewing_volume.z;
@@ -157,12 +169,12 @@ constexpr char g_sampler_fragment_src[] = R"GLSL(
     float fill_light_intensity = 1.0 - key_light_intensity;
 
     float L = 0.0;
-    for (int i = 0; i < kTapCount; ++i) {
-      float alpha = (float(i) + 0.5) / float(kTapCount);
+    for (int i = 0; i < pushed.tap_count; ++i) {
+      float alpha = (float(i) + 0.5) / float(pushed.tap_count);
       L += key_light_intensity * sampleKeyIllumination(fragment_uv, fragment_z, alpha, seed);
       L += fill_light_intensity * sampleFillIllumination(fragment_uv, fragment_z, alpha, seed);
     }
-    L = clamp(L / float(kTapCount), 0.0, 1.0);
+    L = clamp(L / float(pushed.tap_count), 0.0, 1.0);
 
     outColor = vec4(L, sampled_depth, 0.0, 1.0);
   }
@@ -186,6 +198,7 @@ constexpr char g_filter_fragment_src[] = R"GLSL(
   layout(push_constant) uniform FilterConfig {
     vec2 stride;
     float scene_depth;
+    float downsample_factor;
   } pushed;
 
   // Texture containing unfiltered illumination data.
@@ -204,9 +217,10 @@ constexpr char g_filter_fragment_src[] = R"GLSL(
   const float kSsdoAccelPackedDownsampleFactor = kSsdoAccelDownsampleFactor * 4;
 
   void main() {
-    // gl_FragCoord.x ranges from 0.5 to (screen_width - 0.5), and similarly for
+    // gl_FragCoord.x ranges from 0.5 to (output_width - 0.5), and similarly for
     // height, so we adjust them to range from 0.0 to screen_width/height.
-    vec2 accel_coords = (gl_FragCoord.xy - vec2(0.5, 0.5)) / kSsdoAccelPackedDownsampleFactor;
+    vec2 accel_coords = (gl_FragCoord.xy - vec2(0.5, 0.5)) *
+        pushed.downsample_factor / kSsdoAccelPackedDownsampleFactor;
 
     // Consult the accelerator; exit early if no shadow is possible,
     vec4 accel = texture(accelerator, accel_coords);
@@ -244,30 +258,239 @@ constexpr char g_filter_fragment_src[] = R"GLSL(
   }
 )GLSL";
 
-// TODO: this is currently EXTREMELY slow: see comment on SampleUsingKernel().
-constexpr char g_sampler_kernel_src[] = R"GLSL(
+// Scales the filtered output of g_filter_fragment_src, which was computed from
+// a downsampled depth buffer, back up to the size of the full-resolution depth
+// buffer.  Each pixel is a bilinear blend of the four nearest downsampled
+// pixels, weighted by how closely their depth matches the pixel's, so that
+// illumination doesn't bleed across the edges of objects.
+constexpr char g_upsample_fragment_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  // Texture coordinates generated by the vertex shader.
+  layout(location = 0) in vec2 fragment_uv;
+
+  layout(location = 0) out vec4 outColor;
+
+  // Uniform parameters.
+  layout(push_constant) uniform UpsampleConfig {
+    float scene_depth;
+  } pushed;
+
+  // Texture containing downsampled, filtered illumination data.
+  layout(set = 0, binding = 0) uniform sampler2D illumination;
+
+  // The full-resolution depth buffer.
+  layout(set = 0, binding = 1) uniform sampler2D depth_map;
+
+  void main() {
+    float depth = texture(depth_map, fragment_uv).r;
+    // The depth stored alongside the illumination has been quantized to 8 bits,
+    // so quantize this depth to match.
+    float key = round(depth * 255.0) / 255.0 * pushed.scene_depth;
+
+    ivec2 size = textureSize(illumination, 0);
+    vec2 coords = fragment_uv * vec2(size) - vec2(0.5, 0.5);
+    ivec2 base = ivec2(floor(coords));
+    vec2 blend = fract(coords);
+
+    float sum = 0.0;
+    float total_weight = 0.0;
+    float closest_illumination = 1.0;
+    float closest_distance = pushed.scene_depth;
+
+    for (int i = 0; i < 4; ++i) {
+      ivec2 offset = ivec2(i & 1, i >> 1);
+      vec4 tap = texelFetch(
+          illumination, clamp(base + offset, ivec2(0, 0), size - 1), 0);
+      float tap_distance = abs(tap.y * pushed.scene_depth - key);
+
+      vec2 position_weights = mix(1.0 - blend, blend, vec2(offset));
+      float tap_weight = position_weights.x * position_weights.y *
+          max(0.0, 1.0 - tap_distance);
+      sum += tap_weight * tap.x;
+      total_weight += tap_weight;
+
+      if (tap_distance < closest_distance) {
+        closest_distance = tap_distance;
+        closest_illumination = tap.x;
+      }
+    }
+
+    // If none of the taps lie on the same surface as this pixel (e.g. a thin
+    // object that fell between the downsampled pixels), use the closest one.
+    float L = total_weight > 0.001 ? sum / total_weight : closest_illumination;
+    outColor = vec4(L, depth, 0.0, 1.0);
+  }
+)GLSL";
+
+// Blends the noisy output of g_sampler_fragment_src into the output of this
+// shader from the previous frame.  Each pixel is reprojected into the previous
+// frame, and its history is rejected if it was outside the view or belonged to
+// a different surface there, which is detected by comparing depths.  Pixels
+// without a history instead take a depth-weighted average of this frame's
+// samples over one tile of the noise texture, which removes the noise pattern
+// much as the filter passes do.
+constexpr char g_temporal_fragment_src[] = R"GLSL(
+  #version 450
+  #extension GL_ARB_separate_shader_objects : enable
+
+  // Texture coordinates generated by the vertex shader.
+  layout(location = 0) in vec2 fragment_uv;
+
+  layout(location = 0) out vec4 outColor;
+
+  // Uniform parameters.
+  layout(push_constant) uniform TemporalConfig {
+    // Maps normalized device coordinates, with depth as the Z-coordinate, to
+    // those of the same point in the previous frame.
+    mat4 reprojection;
+
+    // The weight of the history, or 0 if there is none.
+    float history_weight;
+  } pushed;
+
+  // Texture containing unfiltered illumination data for this frame.
+  layout(set = 0, binding = 0) uniform sampler2D illumination;
+
+  // The output of this shader in the previous frame.
+  layout(set = 0, binding = 1) uniform sampler2D history;
+
+  // Depth information about the scene, at the resolution of the illumination.
+  layout(set = 0, binding = 2) uniform sampler2D depth_map;
+
+  // Must match SsdoSampler::kNoiseSize (C++).
+  const int kNoiseSize = 5;
+
+  // Depths that differ by more than this are considered to belong to different
+  // surfaces.  The depth stored in the history has been quantized to 8 bits.
+  const float kDepthTolerance = 1.5 / 255.0;
+
+  void main() {
+    vec4 current = texture(illumination, fragment_uv);
+    float depth = texture(depth_map, fragment_uv).r;
+
+    vec4 previous =
+        pushed.reprojection * vec4(fragment_uv * 2.0 - 1.0, depth, 1.0);
+    previous.xyz /= previous.w;
+    vec2 previous_uv = previous.xy * 0.5 + 0.5;
+
+    if (pushed.history_weight > 0.0 &&
+        all(greaterThanEqual(previous_uv, vec2(0.0, 0.0))) &&
+        all(lessThanEqual(previous_uv, vec2(1.0, 1.0)))) {
+      vec4 history_tap = texture(history, previous_uv);
+      if (abs(history_tap.y - previous.z) <= kDepthTolerance) {
+        float L = mix(current.x, history_tap.x, pushed.history_weight);
+        outColor = vec4(L, depth, 0.0, 1.0);
+        return;
+      }
+    }
+
+    vec2 texel_size = 1.0 / vec2(textureSize(illumination, 0));
+    float sum = 0.0;
+    float total_weight = 0.0;
+    for (int y = -kNoiseSize / 2; y <= kNoiseSize / 2; ++y) {
+      for (int x = -kNoiseSize / 2; x <= kNoiseSize / 2; ++x) {
+        vec2 tap_uv = fragment_uv + vec2(x, y) * texel_size;
+        float tap_depth = texture(depth_map, tap_uv).r;
+        float tap_weight =
+            max(0.0, 1.0 - abs(tap_depth - depth) / kDepthTolerance);
+        sum += tap_weight * texture(illumination, tap_uv).x;
+        total_weight += tap_weight;
+      }
+    }
+    // The center tap always has a weight of 1.
+    outColor = vec4(sum / total_weight, depth, 0.0, 1.0);
+  }
+)GLSL";
+
+// Scales a depth buffer down by an integer factor.  Taking the minimum or the
+// maximum depth of each footprint in a checkerboard pattern, rather than the
+// average, avoids inventing depths that lie between two surfaces, and keeps
+// both surfaces at an edge available to g_upsample_fragment_src.
+constexpr char g_depth_downsample_kernel_src[] = R"GLSL(
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(local_size_x = 4, local_size_y = 4) in;
+layout(local_size_x = 8, local_size_y = 8) in;
 
 layout (binding = 0) uniform sampler2D depthTexture;
-layout (binding = 1, rgba8) uniform image2D resultImage;
-layout (binding = 2, rgba8) uniform image2D noiseImage;
+layout (binding = 1, r32f) uniform writeonly image2D resultImage;
+
+layout(push_constant) uniform DownsampleConfig {
+  int downsample_factor;
+} pushed;
+
+void main() {
+  ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(pos, imageSize(resultImage)))) {
+    return;
+  }
+
+  ivec2 base = pos * pushed.downsample_factor;
+  float min_depth = 1.0;
+  float max_depth = 0.0;
+  for (int y = 0; y < pushed.downsample_factor; ++y) {
+    for (int x = 0; x < pushed.downsample_factor; ++x) {
+      float depth = texelFetch(depthTexture, base + ivec2(x, y), 0).r;
+      min_depth = min(min_depth, depth);
+      max_depth = max(max_depth, depth);
+    }
+  }
+
+  float depth = ((pos.x + pos.y) & 1) == 0 ? min_depth : max_depth;
+  imageStore(resultImage, pos, vec4(depth, 0.0, 0.0, 0.0));
+}
+)GLSL";
+
+// Size of the workgroups of g_depth_downsample_kernel_src.
+constexpr uint32_t kDepthDownsampleWorkgroupSize = 8;
+
+// Same algorithm as g_sampler_fragment_src, implemented as a compute kernel.
+// Each workgroup processes a square tile of pixels, which is taken from a list
+// generated by SsdoAccelerator::GenerateTileList(), so that tiles where no
+// pixel can be shadowed are never visited.  The workgroup loads the depths of
+// the tile and of an apron around it into shared memory, so that the taps of
+// all of the pixels can be read from there instead of from the texture.  Taps
+// that reach beyond the apron, which only happens if the output is larger than
+// the viewing volume, fall back to sampling the texture.
+//
+// Writing to the kColorFormat output requires the
+// shaderStorageImageExtendedFormats device feature.
+constexpr char g_sampler_kernel_src[] = R"GLSL(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
 
-// Uniform parameters.
+// Must match SsdoSampler::kSamplerKernelTileSize (C++).
+layout(local_size_x = 16, local_size_y = 16) in;
+const int kTileSize = 16;
+
+// Must match SsdoSampler::kShadowRadius (C++), which is the farthest that any
+// tap reaches, in pixels of a full-resolution output.
+const int kApron = 16;
+const int kCacheSize = kTileSize + 2 * kApron;
+
+layout(binding = 0) uniform sampler2D depth_map;
+layout(binding = 1) uniform sampler2D accelerator;
+layout(binding = 2) uniform sampler2D noise;
+layout(binding = 3, rg8) uniform writeonly image2D resultImage;
+
+// Must match SsdoAccelerator::TileListHeader (C++).
+layout(binding = 4) readonly buffer TileList {
+  uint group_count_x;
+  uint group_count_y;
+  uint group_count_z;
+  uint padding;
+  uvec2 tiles[];
+} tile_list;
+
+// Uniform parameters; see g_sampler_fragment_src.
 layout(push_constant) uniform SamplerConfig {
-  // A description of the directional key light:
-  //
-  //  * theta, phi: The direction from which the light is received. The first
-  //    coordinate is theta (the the azimuthal angle, in radians) and the second
-  //    coordinate is phi (the polar angle, in radians).
-  //  * dispersion: The angular variance in the light, in radians.
-  //  * intensity: The amount of light emitted.
   vec4 key_light;
-
-  // The size of the viewing volume in (width, height, depth).
   vec3 viewing_volume;
+  float downsample_factor;
+  float noise_offset;
+  int tap_count;
 } pushed;
 
 const float kPi = 3.14159265359;
@@ -275,16 +498,38 @@ const float kPi = 3.14159265359;
 // Must match SsdoSampler::kNoiseSize (C++).
 const int kNoiseSize = 5;
 
-// The number of screen-space samples to use in the computation.
-const int kTapCount = 8;
-
-// These should be relatively primary to each other and to kTapCount;
-// TODO: only kSpirals.x is used... should .y also be used?
+// See g_sampler_fragment_src.
 const vec2 kSpirals = vec2(7.0, 5.0);
-
-// TODO(abarth): Make the shader less sensitive to this parameter.
 const float kSampleRadius = 16.0;  // screen pixels.
 
+// Must match SsdoSampler::kSsdoAccelDownsampleFactor (C++).
+const int kSsdoAccelDownsampleFactor = 8;
+
+shared float cached_depth[kCacheSize][kCacheSize];
+
+ivec2 depth_map_size;
+ivec2 cache_origin;
+
+// Return the depth of the pixel that contains |pos|, which is measured in
+// pixels.  Like the texture's sampler, coordinates outside the depth map wrap
+// around.
+float fetchDepth(vec2 pos) {
+  ivec2 cache_pos = ivec2(floor(pos)) - cache_origin;
+  if (all(greaterThanEqual(cache_pos, ivec2(0, 0))) &&
+      all(lessThan(cache_pos, ivec2(kCacheSize, kCacheSize)))) {
+    return cached_depth[cache_pos.y][cache_pos.x];
+  }
+  return texture(depth_map, pos / vec2(depth_map_size)).r;
+}
+
+// Return the 2-bit value of the accelerator cell that contains |pixel|.
+int getAcceleratorCell(ivec2 pixel) {
+  ivec2 cell = pixel * int(pushed.downsample_factor) /
+      kSsdoAccelDownsampleFactor;
+  vec4 accel = texelFetch(accelerator, cell / 4, 0);
+  return (int(accel[cell.y % 4] * 255.0) >> ((cell.x % 4) * 2)) & 3;
+}
+
 float sampleKeyIllumination(vec2 pos,
                             float fragment_z,
                             float alpha,
@@ -294,12 +539,11 @@ float sampleKeyIllumination(vec2 pos,
   float theta = key_light0.x + fract(seed.x + alpha * kSpirals.x) * key_light_dispersion;
   float radius = alpha * kSampleRadius;
 
-  float raw_depth = texture(depthTexture,
-                            pos + radius * vec2(cos(theta), sin(theta))).r;
-  float tap_z = raw_depth * -pushed.viewing_volume.z;
+  vec2 tap_delta = radius * vec2(cos(theta), sin(theta)) *
+      vec2(depth_map_size) / pushed.viewing_volume.xy;
+  float tap_z = fetchDepth(pos + tap_delta) * -pushed.viewing_volume.z;
 
-  // TODO: use clamp here, once we can use GLSL standard library.
-  return 1.0 - max(0.0, (tap_z - fragment_z) / radius);
+  return 1.0 - clamp((tap_z - fragment_z) / radius, 0.0, 1.0);
 }
 
 float sampleFillIllumination(vec2 pos,
@@ -309,50 +553,186 @@ float sampleFillIllumination(vec2 pos,
   float theta = 2.0 * kPi * (seed.x + alpha * kSpirals.x);
   float radius = alpha * kSampleRadius;
 
-  float raw_depth = texture(depthTexture,
-                            pos + radius * vec2(cos(theta), sin(theta))).r;
-  float tap_z = raw_depth * -pushed.viewing_volume.z;
+  vec2 tap_delta = radius * vec2(cos(theta), sin(theta)) *
+      vec2(depth_map_size) / pushed.viewing_volume.xy;
+  float tap_z = fetchDepth(pos + tap_delta) * -pushed.viewing_volume.z;
 
-  return 1.0 - max(0.0, (tap_z - fragment_z) / radius);
+  return 1.0 - clamp((tap_z - fragment_z) / radius, 0.0, 1.0);
 }
 
-// Size of square region that is computed by each invocation of the kernel.
-const int kSize = 4;
 void main() {
-  uint x = gl_GlobalInvocationID.x * kSize;
-  uint y = gl_GlobalInvocationID.y * kSize;
-
-  for (int xx = 0; xx < kSize; ++xx) {
-    for (int yy = 0; yy < kSize; ++yy) {
-      vec2 pos = vec2(x + xx, y + yy);
-      vec2 seed = imageLoad(noiseImage,
-                            ivec2(fract(pos / float(kNoiseSize)).rg)).rg;
-
-      float sampled_depth = texture(depthTexture, pos).r;
-      float fragment_z = sampled_depth * -pushed.viewing_volume.z;
-      float key_light_intensity = pushed.key_light.w;
-      float fill_light_intensity = 1.0 - key_light_intensity;
-
-      float L = 0.0;
-      for (int i = 0; i < kTapCount; ++i) {
-        float alpha = (float(i) + 0.5) / float(kTapCount);
-        L += key_light_intensity * sampleKeyIllumination(pos, fragment_z, alpha, seed);
-        L += fill_light_intensity * sampleFillIllumination(pos, fragment_z, alpha, seed);
-      }
-      L = clamp(L / float(kTapCount), 0.0, 1.0);
+  depth_map_size = textureSize(depth_map, 0);
+  ivec2 tile_origin = ivec2(tile_list.tiles[gl_WorkGroupID.x]) * kTileSize;
+  cache_origin = tile_origin - ivec2(kApron, kApron);
+
+  // Load the tile and its apron.
+  for (int i = int(gl_LocalInvocationIndex); i < kCacheSize * kCacheSize;
+       i += kTileSize * kTileSize) {
+    ivec2 cache_pos = ivec2(i % kCacheSize, i / kCacheSize);
+    ivec2 texel = (cache_origin + cache_pos) % depth_map_size;
+    texel = (texel + depth_map_size) % depth_map_size;
+    cached_depth[cache_pos.y][cache_pos.x] = texelFetch(depth_map, texel, 0).r;
+  }
+  barrier();
+
+  ivec2 pixel = tile_origin + ivec2(gl_LocalInvocationID.xy);
+  if (any(greaterThanEqual(pixel, depth_map_size))) {
+    return;
+  }
+  if (getAcceleratorCell(pixel) == 0) {
+    // The output was cleared to the unshadowed result.
+    return;
+  }
 
-      // TODO: This ensures that shadows aren't pure-black.  Replace this with
-      // something more principled/controllable.
-      L = L * 0.75 + 0.25;
+  vec2 seed = texelFetch(noise, pixel % kNoiseSize, 0).rg;
+  seed.x = fract(seed.x + pushed.noise_offset);
 
-      imageStore(resultImage, ivec2(pos), vec4(L, sampled_depth, 0.0, 1.0));
-    }
+  vec2 pos = vec2(pixel) + vec2(0.5, 0.5);
+  float sampled_depth = fetchDepth(pos);
+  float fragment_z = sampled_depth * -pushed.viewing_volume.z;
+  float key_light_intensity = pushed.key_light.w;
+  float fill_light_intensity = 1.0 - key_light_intensity;
+
+  float L = 0.0;
+  for (int i = 0; i < pushed.tap_count; ++i) {
+    float alpha = (float(i) + 0.5) / float(pushed.tap_count);
+    L += key_light_intensity * sampleKeyIllumination(pos, fragment_z, alpha, seed);
+    L += fill_light_intensity * sampleFillIllumination(pos, fragment_z, alpha, seed);
+  }
+  L = clamp(L / float(pushed.tap_count), 0.0, 1.0);
+
+  imageStore(resultImage, pixel, vec4(L, sampled_depth, 0.0, 1.0));
+}
+)GLSL";
+
+// Same algorithm as g_filter_fragment_src, implemented as a compute kernel.
+// Each workgroup filters a square tile of pixels along one direction.  Like
+// g_sampler_kernel_src, the tiles are taken from a list generated by
+// SsdoAccelerator::GenerateTileList().  Each line of the tile is loaded into
+// shared memory, together with the kRadius texels on either side of it, so
+// that every tap is read from there.
+//
+// Writing to the kColorFormat output requires the
+// shaderStorageImageExtendedFormats device feature.
+constexpr char g_filter_kernel_src[] = R"GLSL(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Must match SsdoSampler::kFilterKernelTileSize (C++).
+layout(local_size_x = 8, local_size_y = 8) in;
+const int kTileSize = 8;
+
+// See g_filter_fragment_src.
+const int kRadius = 4;
+const int kLineLength = kTileSize + 2 * kRadius;
+
+layout(binding = 0) uniform sampler2D illumination;
+layout(binding = 1) uniform sampler2D accelerator;
+layout(binding = 2, rg8) uniform writeonly image2D resultImage;
+
+// Must match SsdoAccelerator::TileListHeader (C++).
+layout(binding = 3) readonly buffer TileList {
+  uint group_count_x;
+  uint group_count_y;
+  uint group_count_z;
+  uint padding;
+  uvec2 tiles[];
+} tile_list;
+
+// Uniform parameters; see g_filter_fragment_src.
+layout(push_constant) uniform FilterConfig {
+  // The direction to filter in: either (1, 0) or (0, 1).
+  vec2 stride;
+  float scene_depth;
+  float downsample_factor;
+} pushed;
+
+// Must match SsdoSampler::kSsdoAccelDownsampleFactor (C++).
+const int kSsdoAccelDownsampleFactor = 8;
+
+// The illumination and depth of each line of the tile, along the direction of
+// the filter.
+shared vec2 cached_taps[kTileSize][kLineLength];
+
+// Return the 2-bit value of the accelerator cell that contains |pixel|.
+int getAcceleratorCell(ivec2 pixel) {
+  ivec2 cell = pixel * int(pushed.downsample_factor) /
+      kSsdoAccelDownsampleFactor;
+  vec4 accel = texelFetch(accelerator, cell / 4, 0);
+  return (int(accel[cell.y % 4] * 255.0) >> ((cell.x % 4) * 2)) & 3;
+}
+
+int component(ivec2 v, ivec2 direction) {
+  return v.x * direction.x + v.y * direction.y;
+}
+
+void main() {
+  ivec2 size = textureSize(illumination, 0);
+  ivec2 along = ivec2(pushed.stride);
+  ivec2 across = ivec2(1, 1) - along;
+  ivec2 tile_origin = ivec2(tile_list.tiles[gl_WorkGroupID.x]) * kTileSize;
+
+  // Load the lines of the tile.  Like the fragment shader's sampler,
+  // coordinates outside the image wrap around.
+  for (int i = int(gl_LocalInvocationIndex); i < kTileSize * kLineLength;
+       i += kTileSize * kTileSize) {
+    int line = i / kLineLength;
+    int offset = i % kLineLength;
+    ivec2 texel = tile_origin + line * across + (offset - kRadius) * along;
+    texel = (texel % size + size) % size;
+    cached_taps[line][offset] = texelFetch(illumination, texel, 0).rg;
   }
+  barrier();
+
+  ivec2 local_pos = ivec2(gl_LocalInvocationID.xy);
+  ivec2 pixel = tile_origin + local_pos;
+  if (any(greaterThanEqual(pixel, size))) {
+    return;
+  }
+  if (getAcceleratorCell(pixel) == 0) {
+    // The output was cleared to the unshadowed result.
+    return;
+  }
+
+  int line = component(local_pos, across);
+  int center = component(local_pos, along) + kRadius;
+  vec2 center_tap = cached_taps[line][center];
+  float center_key = center_tap.y * pushed.scene_depth;
+
+  float sum = center_tap.x;
+  float total_weight = 1.0;
+
+  for (int r = 1; r <= kRadius; ++r) {
+    vec2 left_tap = cached_taps[line][center - r];
+    float left_tap_key = left_tap.y * pushed.scene_depth;
+    float left_key_weight = max(0.0, 1.0 - abs(left_tap_key - center_key));
+
+    vec2 right_tap = cached_taps[line][center + r];
+    float right_tap_key = right_tap.y * pushed.scene_depth;
+    float right_key_weight = max(0.0, 1.0 - abs(right_tap_key - center_key));
+
+    float position_weight = float(kRadius - r + 1) / float(kRadius + 1);
+    float tap_weight = position_weight * left_key_weight * right_key_weight;
+
+    sum += tap_weight * left_tap.x + tap_weight * right_tap.x;
+    total_weight += 2.0 * tap_weight;
+  }
+
+  float filtered_illumination = sum / total_weight;
+  imageStore(resultImage, pixel,
+             vec4(filtered_illumination, center_tap.y, 0.0, 1.0));
 }
 )GLSL";
 
+struct SsdoPipelines {
+  PipelinePtr sampler;
+  PipelinePtr filter;
+  PipelinePtr upsample;
+  PipelinePtr temporal;
+};
+
 // TODO: refactor this into a PipelineBuilder class.
-std::pair<PipelinePtr, PipelinePtr> CreatePipelines(
+SsdoPipelines CreatePipelines(
     vk::Device device,
     vk::RenderPass render_pass,
     const MeshShaderBinding& mesh_shader_binding,
@@ -367,6 +747,12 @@ std::pair<PipelinePtr, PipelinePtr> CreatePipelines(
   auto filter_fragment_spirv_future =
       compiler->Compile(vk::ShaderStageFlagBits::eFragment,
                         {{g_filter_fragment_src}}, std::string(), "main");
+  auto upsample_fragment_spirv_future =
+      compiler->Compile(vk::ShaderStageFlagBits::eFragment,
+                        {{g_upsample_fragment_src}}, std::string(), "main");
+  auto temporal_fragment_spirv_future =
+      compiler->Compile(vk::ShaderStageFlagBits::eFragment,
+                        {{g_temporal_fragment_src}}, std::string(), "main");
 
   vk::ShaderModule vertex_module;
   {
@@ -469,9 +855,11 @@ std::pair<PipelinePtr, PipelinePtr> CreatePipelines(
   vk::PushConstantRange push_constants;
   push_constants.stageFlags = vk::ShaderStageFlagBits::eFragment;
   push_constants.offset = 0;
-  // This allows us to share a pipeline-layout between two pipelines.
-  push_constants.size = std::max(sizeof(SsdoSampler::SamplerConfig),
-                                 sizeof(SsdoSampler::FilterConfig));
+  // This allows us to share a pipeline-layout between all of the pipelines.
+  push_constants.size = std::max({sizeof(SsdoSampler::SamplerConfig),
+                                  sizeof(SsdoSampler::FilterConfig),
+                                  sizeof(SsdoSampler::UpsampleConfig),
+                                  sizeof(SsdoSampler::TemporalConfig)});
 
   vk::PipelineLayoutCreateInfo pipeline_layout_info;
   pipeline_layout_info.setLayoutCount = 1;
@@ -533,11 +921,48 @@ std::pair<PipelinePtr, PipelinePtr> CreatePipelines(
   auto filter_pipeline = ftl::MakeRefCounted<Pipeline>(
       device, vk_filter_pipeline, pipeline_layout, PipelineSpec());
 
+  // Pipeline configuration specific to the SSDO upsample pass.
+  vk::ShaderModule upsample_fragment_module;
+  {
+    SpirvData spirv = upsample_fragment_spirv_future.get();
+
+    vk::ShaderModuleCreateInfo module_info;
+    module_info.codeSize = spirv.size() * sizeof(uint32_t);
+    module_info.pCode = spirv.data();
+    upsample_fragment_module =
+        ESCHER_CHECKED_VK_RESULT(device.createShaderModule(module_info));
+  }
+  fragment_stage_info.module = upsample_fragment_module;
+  vk::Pipeline vk_upsample_pipeline = ESCHER_CHECKED_VK_RESULT(
+      device.createGraphicsPipeline(nullptr, pipeline_info));
+  auto upsample_pipeline = ftl::MakeRefCounted<Pipeline>(
+      device, vk_upsample_pipeline, pipeline_layout, PipelineSpec());
+
+  // Pipeline configuration specific to the SSDO temporal accumulation pass.
+  vk::ShaderModule temporal_fragment_module;
+  {
+    SpirvData spirv = temporal_fragment_spirv_future.get();
+
+    vk::ShaderModuleCreateInfo module_info;
+    module_info.codeSize = spirv.size() * sizeof(uint32_t);
+    module_info.pCode = spirv.data();
+    temporal_fragment_module =
+        ESCHER_CHECKED_VK_RESULT(device.createShaderModule(module_info));
+  }
+  fragment_stage_info.module = temporal_fragment_module;
+  vk::Pipeline vk_temporal_pipeline = ESCHER_CHECKED_VK_RESULT(
+      device.createGraphicsPipeline(nullptr, pipeline_info));
+  auto temporal_pipeline = ftl::MakeRefCounted<Pipeline>(
+      device, vk_temporal_pipeline, pipeline_layout, PipelineSpec());
+
   device.destroyShaderModule(vertex_module);
   device.destroyShaderModule(sampler_fragment_module);
   device.destroyShaderModule(filter_fragment_module);
+  device.destroyShaderModule(upsample_fragment_module);
+  device.destroyShaderModule(temporal_fragment_module);
 
-  return {sampler_pipeline, filter_pipeline};
+  return {sampler_pipeline, filter_pipeline, upsample_pipeline,
+          temporal_pipeline};
 }
 
 vk::RenderPass CreateRenderPass(vk::Device device) {
@@ -610,6 +1035,45 @@ vk::RenderPass CreateRenderPass(vk::Device device) {
   return ESCHER_CHECKED_VK_RESULT(device.createRenderPass(info));
 }
 
+// Clear |image|, which must be in eGeneral layout, to the output of the
+// kernels for pixels that can't be shadowed, so that the kernels need only
+// visit the tiles listed by SsdoAccelerator::GenerateTileList().
+void ClearToUnshadowed(CommandBuffer* command_buffer, const ImagePtr& image) {
+  vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+  // The render graph's barrier into eGeneral only waits for, and makes the
+  // image available to, the fragment and compute shader stages.  Extend it to
+  // the transfer stage, so that the clear waits for earlier shader accesses.
+  vk::ImageMemoryBarrier barrier;
+  barrier.srcAccessMask =
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.oldLayout = vk::ImageLayout::eGeneral;
+  barrier.newLayout = vk::ImageLayout::eGeneral;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image->get();
+  barrier.subresourceRange = range;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eFragmentShader |
+          vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr,
+      0, nullptr, 1, &barrier);
+
+  vk::ClearColorValue clear_value(std::array<float, 4>{{1.f, 0.f, 0.f, 1.f}});
+  command_buffer->get().clearColorImage(image->get(), vk::ImageLayout::eGeneral,
+                                        clear_value, range);
+
+  // Make the cleared image available to the kernel that writes it.
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask =
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 0,
+      nullptr, 0, nullptr, 1, &barrier);
+}
+
 }  // namespace
 
 SsdoSampler::SsdoSampler(Escher* escher,
@@ -627,10 +1091,25 @@ SsdoSampler::SsdoSampler(Escher* escher,
       render_pass_(CreateRenderPass(device_)),
       sampler_kernel_(escher,
                       {vk::ImageLayout::eShaderReadOnlyOptimal,
-                       vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral},
-                      {},
+                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                       vk::ImageLayout::eGeneral},
+                      {vk::DescriptorType::eStorageBuffer},
                       sizeof(SamplerConfig),
-                      g_sampler_kernel_src) {
+                      g_sampler_kernel_src),
+      filter_kernel_(escher,
+                     {vk::ImageLayout::eShaderReadOnlyOptimal,
+                      vk::ImageLayout::eShaderReadOnlyOptimal,
+                      vk::ImageLayout::eGeneral},
+                     {vk::DescriptorType::eStorageBuffer},
+                     sizeof(FilterConfig),
+                     g_filter_kernel_src),
+      depth_downsample_kernel_(escher,
+                               {vk::ImageLayout::eShaderReadOnlyOptimal,
+                                vk::ImageLayout::eGeneral},
+                               {},
+                               sizeof(int32_t),
+                               g_depth_downsample_kernel_src) {
   FTL_DCHECK(noise_image->width() == kNoiseSize &&
              noise_image->height() == kNoiseSize);
 
@@ -641,8 +1120,10 @@ SsdoSampler::SsdoSampler(Escher* escher,
       CreatePipelines(device_, render_pass_,
                       model_data->GetMeshShaderBinding(full_screen_->spec()),
                       pool_.layout(), escher->glsl_compiler());
-  sampler_pipeline_ = pipelines.first;
-  filter_pipeline_ = pipelines.second;
+  sampler_pipeline_ = pipelines.sampler;
+  filter_pipeline_ = pipelines.filter;
+  upsample_pipeline_ = pipelines.upsample;
+  temporal_pipeline_ = pipelines.temporal;
 }
 
 SsdoSampler::~SsdoSampler() {
@@ -651,7 +1132,7 @@ SsdoSampler::~SsdoSampler() {
 
 const vk::DescriptorSetLayoutCreateInfo&
 SsdoSampler::GetDescriptorSetLayoutCreateInfo() {
-  constexpr uint32_t kNumBindings = 3;
+  constexpr uint32_t kNumBindings = kTextureBindingCount;
   static vk::DescriptorSetLayoutBinding bindings[kNumBindings];
   static vk::DescriptorSetLayoutCreateInfo info;
   static vk::DescriptorSetLayoutCreateInfo* ptr = nullptr;
@@ -686,11 +1167,12 @@ SsdoSampler::GetDescriptorSetLayoutCreateInfo() {
   return *ptr;
 }
 
-void SsdoSampler::Sample(CommandBuffer* command_buffer,
-                         const FramebufferPtr& framebuffer,
-                         const TexturePtr& depth_texture,
-                         const TexturePtr& accelerator_texture,
-                         const SamplerConfig* push_constants) {
+void SsdoSampler::DrawFullScreen(CommandBuffer* command_buffer,
+                                 const FramebufferPtr& framebuffer,
+                                 const PipelinePtr& pipeline,
+                                 const Textures& textures,
+                                 const void* push_constants,
+                                 uint32_t push_constants_size) {
   auto vk_command_buffer = command_buffer->get();
   auto descriptor_set = pool_.Allocate(1, command_buffer)->get(0);
 
@@ -699,51 +1181,31 @@ void SsdoSampler::Sample(CommandBuffer* command_buffer,
   viewport.height = framebuffer->height();
   vk_command_buffer.setViewport(0, 1, &viewport);
 
-  constexpr uint32_t kUpdatedDescriptorCount = 3;
+  constexpr uint32_t kUpdatedDescriptorCount = kTextureBindingCount;
   vk::WriteDescriptorSet writes[kUpdatedDescriptorCount];
+  vk::DescriptorImageInfo texture_infos[kUpdatedDescriptorCount];
   for (uint32_t i = 0; i < kUpdatedDescriptorCount; ++i) {
-    // Common to all image descriptors.
+    texture_infos[i].imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    texture_infos[i].imageView = textures[i]->image_view();
+    texture_infos[i].sampler = textures[i]->sampler();
+
     writes[i].dstSet = descriptor_set;
+    writes[i].dstBinding = i;
     writes[i].dstArrayElement = 0;
     writes[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
     writes[i].descriptorCount = 1;
+    writes[i].pImageInfo = &texture_infos[i];
   }
-
-  // Specific to depth texture.
-  vk::DescriptorImageInfo depth_texture_info;
-  depth_texture_info.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  depth_texture_info.imageView = depth_texture->image_view();
-  depth_texture_info.sampler = depth_texture->sampler();
-  writes[0].dstBinding = 0;
-  writes[0].pImageInfo = &depth_texture_info;
-
-  // Specific to accelerator texture.
-  vk::DescriptorImageInfo accelerator_texture_info;
-  accelerator_texture_info.imageLayout =
-      vk::ImageLayout::eShaderReadOnlyOptimal;
-  accelerator_texture_info.imageView = accelerator_texture->image_view();
-  accelerator_texture_info.sampler = accelerator_texture->sampler();
-  writes[1].dstBinding = 1;
-  writes[1].pImageInfo = &accelerator_texture_info;
-
-  // Specific to noise texture.
-  vk::DescriptorImageInfo noise_texture_info;
-  noise_texture_info.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  noise_texture_info.imageView = noise_texture_->image_view();
-  noise_texture_info.sampler = noise_texture_->sampler();
-  writes[2].dstBinding = 2;
-  writes[2].pImageInfo = &noise_texture_info;
-
   device_.updateDescriptorSets(kUpdatedDescriptorCount, writes, 0, nullptr);
 
   vk::ClearValue clear_value(
       vk::ClearColorValue(std::array<uint32_t, 4>{{0, 0, 0, 0}}));
   command_buffer->BeginRenderPass(render_pass_, framebuffer, &clear_value, 1);
   {
-    auto vk_pipeline_layout = sampler_pipeline_->layout();
+    auto vk_pipeline_layout = pipeline->layout();
 
     vk_command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
-                                   sampler_pipeline_->get());
+                                   pipeline->get());
 
     vk_command_buffer.bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics, vk_pipeline_layout,
@@ -751,30 +1213,37 @@ void SsdoSampler::Sample(CommandBuffer* command_buffer,
 
     vk_command_buffer.pushConstants(vk_pipeline_layout,
                                     vk::ShaderStageFlagBits::eFragment, 0,
-                                    sizeof(SamplerConfig), push_constants);
+                                    push_constants_size, push_constants);
 
     command_buffer->DrawMesh(full_screen_);
   }
   command_buffer->EndRenderPass();
 }
 
-// TODO: this is currently EXTREMELY slow.  We need to dispatch far fewer
-// threads, but dispatching 1/16th as many (as we would if we batched 4x4
-// regions) is still very slow, even without modifying the kernel to do 16x as
-// much work in each invocation!  Something else is wrong, and figuring out what
-// probably needs better tools.  For now, the fragment shader version should be
-// used instead.
+void SsdoSampler::Sample(CommandBuffer* command_buffer,
+                         const FramebufferPtr& framebuffer,
+                         const TexturePtr& depth_texture,
+                         const TexturePtr& accelerator_texture,
+                         const SamplerConfig* push_constants) {
+  DrawFullScreen(command_buffer, framebuffer, sampler_pipeline_,
+                 {{depth_texture, accelerator_texture, noise_texture_}},
+                 push_constants, sizeof(SamplerConfig));
+}
+
 void SsdoSampler::SampleUsingKernel(CommandBuffer* command_buffer,
                                     const TexturePtr& depth_texture,
+                                    const TexturePtr& accelerator_texture,
                                     const TexturePtr& output_texture,
+                                    const BufferPtr& tile_list,
                                     const SamplerConfig* push_constants) {
   FTL_DCHECK(depth_texture->width() == output_texture->width());
   FTL_DCHECK(depth_texture->height() == output_texture->height());
-  uint32_t width = depth_texture->width();
-  uint32_t height = depth_texture->width();
+  FTL_DCHECK(output_texture->image()->format() == kColorFormat);
 
-  sampler_kernel_.Dispatch({depth_texture, output_texture, noise_texture_}, {},
-                           command_buffer, width, height, 1, push_constants);
+  ClearToUnshadowed(command_buffer, output_texture->image());
+  sampler_kernel_.DispatchIndirect(
+      {depth_texture, accelerator_texture, noise_texture_, output_texture},
+      {tile_list}, command_buffer, tile_list, 0, push_constants);
 }
 
 void SsdoSampler::Filter(CommandBuffer* command_buffer,
@@ -782,82 +1251,135 @@ void SsdoSampler::Filter(CommandBuffer* command_buffer,
                          const TexturePtr& unfiltered_illumination,
                          const TexturePtr& accelerator_texture,
                          const FilterConfig* push_constants) {
-  auto vk_command_buffer = command_buffer->get();
-  auto descriptor_set = pool_.Allocate(1, command_buffer)->get(0);
-
-  vk::Viewport viewport;
-  viewport.width = framebuffer->width();
-  viewport.height = framebuffer->height();
-  vk_command_buffer.setViewport(0, 1, &viewport);
+  // TODO: the noise texture is unused by the shader, but we set it anyway so
+  // that we can use the same pipeline-layout for all pipelines.
+  DrawFullScreen(
+      command_buffer, framebuffer, filter_pipeline_,
+      {{unfiltered_illumination, accelerator_texture, noise_texture_}},
+      push_constants, sizeof(FilterConfig));
+}
 
-  constexpr uint32_t kUpdatedDescriptorCount = 3;
-  vk::WriteDescriptorSet writes[kUpdatedDescriptorCount];
-  for (uint32_t i = 0; i < kUpdatedDescriptorCount; ++i) {
-    // Common to all image descriptors.
-    writes[i].dstSet = descriptor_set;
-    writes[i].dstArrayElement = 0;
-    writes[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
-    writes[i].descriptorCount = 1;
+void SsdoSampler::FilterUsingKernel(CommandBuffer* command_buffer,
+                                    const TexturePtr& unfiltered_illumination,
+                                    const TexturePtr& intermediate_illumination,
+                                    const TexturePtr& output_illumination,
+                                    const TexturePtr& accelerator_texture,
+                                    const BufferPtr& tile_list,
+                                    const FilterConfig* push_constants,
+                                    Timestamper* timestamper) {
+  uint32_t width = output_illumination->width();
+  uint32_t height = output_illumination->height();
+  FTL_DCHECK(unfiltered_illumination->width() == width &&
+             unfiltered_illumination->height() == height);
+  FTL_DCHECK(intermediate_illumination->width() == width &&
+             intermediate_illumination->height() == height);
+
+  // The vertical pass reads the intermediate image beyond the listed tiles.
+  ClearToUnshadowed(command_buffer, intermediate_illumination->image());
+  ClearToUnshadowed(command_buffer, output_illumination->image());
+
+  // The kernel interprets the stride as the direction to filter in.
+  FilterConfig config = *push_constants;
+  config.stride = vec2(1.f, 0.f);
+  filter_kernel_.DispatchIndirect(
+      {unfiltered_illumination, accelerator_texture,
+       intermediate_illumination},
+      {tile_list}, command_buffer, tile_list, 0, &config);
+  if (timestamper) {
+    timestamper->AddTimestamp("finished SSDO horizontal filter kernel");
   }
 
-  // Specific to illumination texture.
-  vk::DescriptorImageInfo light_tex_info;
-  light_tex_info.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  light_tex_info.imageView = unfiltered_illumination->image_view();
-  light_tex_info.sampler = unfiltered_illumination->sampler();
-  writes[0].dstBinding = 0;
-  writes[0].pImageInfo = &light_tex_info;
-
-  // Specific to accelerator texture.
-  vk::DescriptorImageInfo accelerator_texture_info;
-  accelerator_texture_info.imageLayout =
-      vk::ImageLayout::eShaderReadOnlyOptimal;
-  accelerator_texture_info.imageView = accelerator_texture->image_view();
-  accelerator_texture_info.sampler = accelerator_texture->sampler();
-  writes[1].dstBinding = 1;
-  writes[1].pImageInfo = &accelerator_texture_info;
-
-  // Specific to noise texture.
-  // TODO: this is unused by the shader, but we set it anyway so that we can
-  // use the same pipeline-layout for the sampler and filter pipelines.
-  vk::DescriptorImageInfo noise_texture_info;
-  noise_texture_info.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  noise_texture_info.imageView = noise_texture_->image_view();
-  noise_texture_info.sampler = noise_texture_->sampler();
-  writes[2].dstBinding = 2;
-  writes[2].pImageInfo = &noise_texture_info;
-
-  device_.updateDescriptorSets(kUpdatedDescriptorCount, writes, 0, nullptr);
-
-  vk::ClearValue clear_value(
-      vk::ClearColorValue(std::array<uint32_t, 4>{{0, 0, 0, 0}}));
-  command_buffer->BeginRenderPass(render_pass_, framebuffer, &clear_value, 1);
-  {
-    auto vk_pipeline_layout = sampler_pipeline_->layout();
-
-    vk_command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
-                                   filter_pipeline_->get());
+  // The vertical pass samples what the horizontal pass wrote.  Both are
+  // compute dispatches, so there is no need to wait for any other stage.
+  vk::ImageMemoryBarrier barrier;
+  barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+  barrier.oldLayout = vk::ImageLayout::eGeneral;
+  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = intermediate_illumination->image()->get();
+  barrier.subresourceRange = vk::ImageSubresourceRange(
+      vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 0,
+      nullptr, 0, nullptr, 1, &barrier);
+
+  config.stride = vec2(0.f, 1.f);
+  filter_kernel_.DispatchIndirect(
+      {intermediate_illumination, accelerator_texture, output_illumination},
+      {tile_list}, command_buffer, tile_list, 0, &config);
+  if (timestamper) {
+    timestamper->AddTimestamp("finished SSDO vertical filter kernel");
+  }
+}
 
-    vk_command_buffer.bindDescriptorSets(
-        vk::PipelineBindPoint::eGraphics, vk_pipeline_layout,
-        kTextureDescriptorSetBindIndex, 1, &descriptor_set, 0, nullptr);
+void SsdoSampler::DownsampleDepth(CommandBuffer* command_buffer,
+                                  const TexturePtr& depth_texture,
+                                  const TexturePtr& output_texture,
+                                  uint32_t downsample_factor) {
+  FTL_DCHECK(downsample_factor > 0 &&
+             kSsdoAccelDownsampleFactor % downsample_factor == 0);
+  FTL_DCHECK(output_texture->image()->format() == kDownsampledDepthFormat);
+  FTL_DCHECK(depth_texture->width() ==
+             output_texture->width() * downsample_factor);
+  FTL_DCHECK(depth_texture->height() ==
+             output_texture->height() * downsample_factor);
+
+  uint32_t width = output_texture->width();
+  uint32_t height = output_texture->height();
+  uint32_t work_groups_x = (width + kDepthDownsampleWorkgroupSize - 1) /
+                           kDepthDownsampleWorkgroupSize;
+  uint32_t work_groups_y = (height + kDepthDownsampleWorkgroupSize - 1) /
+                           kDepthDownsampleWorkgroupSize;
+
+  int32_t push_constants = static_cast<int32_t>(downsample_factor);
+  depth_downsample_kernel_.Dispatch({depth_texture, output_texture}, {},
+                                    command_buffer, work_groups_x,
+                                    work_groups_y, 1, &push_constants);
+}
 
-    vk_command_buffer.pushConstants(vk_pipeline_layout,
-                                    vk::ShaderStageFlagBits::eFragment, 0,
-                                    sizeof(FilterConfig), push_constants);
+void SsdoSampler::Upsample(CommandBuffer* command_buffer,
+                           const FramebufferPtr& framebuffer,
+                           const TexturePtr& filtered_illumination,
+                           const TexturePtr& depth_texture,
+                           const UpsampleConfig* push_constants) {
+  FTL_DCHECK(depth_texture->width() == framebuffer->width() &&
+             depth_texture->height() == framebuffer->height());
+
+  // TODO: the noise texture is unused by the shader, but we set it anyway so
+  // that we can use the same pipeline-layout for all pipelines.
+  DrawFullScreen(command_buffer, framebuffer, upsample_pipeline_,
+                 {{filtered_illumination, depth_texture, noise_texture_}},
+                 push_constants, sizeof(UpsampleConfig));
+}
 
-    command_buffer->DrawMesh(full_screen_);
-  }
-  command_buffer->EndRenderPass();
+void SsdoSampler::Accumulate(CommandBuffer* command_buffer,
+                             const FramebufferPtr& framebuffer,
+                             const TexturePtr& unfiltered_illumination,
+                             const TexturePtr& history,
+                             const TexturePtr& depth_texture,
+                             const TemporalConfig* push_constants) {
+  FTL_DCHECK(unfiltered_illumination->width() == framebuffer->width() &&
+             unfiltered_illumination->height() == framebuffer->height());
+  FTL_DCHECK(history->width() == framebuffer->width() &&
+             history->height() == framebuffer->height());
+
+  DrawFullScreen(command_buffer, framebuffer, temporal_pipeline_,
+                 {{unfiltered_illumination, history, depth_texture}},
+                 push_constants, sizeof(TemporalConfig));
 }
 
-SsdoSampler::SamplerConfig::SamplerConfig(const Stage& stage)
+SsdoSampler::SamplerConfig::SamplerConfig(const Stage& stage,
+                                          uint32_t downsample_factor)
     : key_light(vec4(stage.key_light().direction(),
                      stage.key_light().dispersion(),
                      stage.key_light().intensity())),
       viewing_volume(vec3(stage.viewing_volume().width(),
                           stage.viewing_volume().height(),
-                          stage.viewing_volume().depth())) {}
+                          stage.viewing_volume().depth())),
+      downsample_factor(static_cast<float>(downsample_factor)) {}
 
 }  // namespace impl
 }  // namespace escher
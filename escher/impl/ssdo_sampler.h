@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "escher/forward_declarations.h"
 #include "escher/geometry/types.h"
 #include "escher/impl/compute_shader.h"
@@ -27,11 +29,30 @@ class SsdoSampler {
   // Must match the fragment shader in ssdo_sampler.cc
   const static uint32_t kShadowRadius = 16;
 
+  // The number of samples per pixel that Sample() takes by default.
+  const static uint32_t kTapCount = 8;
+
   // Amount by which the SsdoAccelerator table is scaled down in each dimension,
   // not including bit-packing.
   // Must match the fragment shader in ssdo_sampler.cc
   constexpr static uint32_t kSsdoAccelDownsampleFactor = 8;
 
+  // The factors by which sampling and filtering may be scaled down in each
+  // dimension.  Each divides kSsdoAccelDownsampleFactor, so that every
+  // downsampled pixel lies within a single cell of the SsdoAccelerator table.
+  constexpr static uint32_t kMaxDownsampleFactor = 4;
+
+  // Size of the square tiles of output pixels that are processed by
+  // SampleUsingKernel() and FilterUsingKernel().  The tile lists passed to
+  // them must be generated with a tile size, in SsdoAccelerator cells, of the
+  // kernel's tile size times the downsample factor, divided by
+  // kSsdoAccelDownsampleFactor.
+  constexpr static uint32_t kSamplerKernelTileSize = 16;
+  constexpr static uint32_t kFilterKernelTileSize = 8;
+
+  // Format of the image produced by DownsampleDepth().
+  const static vk::Format kDownsampledDepthFormat = vk::Format::eR32Sfloat;
+
   // TODO: eR8G8Srgb would be preferable, but must check if it is supported.
   // TODO: validate this choice via performance profiling.
   const static vk::Format kColorFormat = vk::Format::eR8G8Unorm;
@@ -39,14 +60,35 @@ class SsdoSampler {
   struct SamplerConfig {
     vec4 key_light;
     vec3 viewing_volume;
+    // The factor by which the output is scaled down from the screen.
+    float downsample_factor;
+    // Rotates the pattern of samples given by the noise texture, so that
+    // successive frames can take different samples.
+    float noise_offset = 0.f;
+    int32_t tap_count = kTapCount;
 
     // Convenient way to populate SamplerConfig from a Stage.
-    SamplerConfig(const Stage& stage);
+    SamplerConfig(const Stage& stage, uint32_t downsample_factor = 1);
   };
 
   struct FilterConfig {
     vec2 stride;
     float scene_depth;
+    // The factor by which the illumination is scaled down from the screen.
+    float downsample_factor;
+  };
+
+  struct UpsampleConfig {
+    float scene_depth;
+  };
+
+  struct TemporalConfig {
+    // Maps a point's normalized device coordinates in this frame, with depth
+    // as the Z-coordinate, to its coordinates in the previous frame.
+    mat4 reprojection;
+    // The weight of a pixel's history, versus that of this frame's sample,
+    // or 0 if there is no history.
+    float history_weight;
   };
 
   static const vk::DescriptorSetLayoutCreateInfo&
@@ -67,13 +109,19 @@ class SsdoSampler {
               const SamplerConfig* push_constants);
 
   // Same algorithm as Sample(), implemented with a compute kernel instead of
-  // a fragment shader.  Currently very inefficient, but keeping around for
-  // experimentation: it seems that there's no fundamental reason that this
-  // version cannot exceed the performance of the fragment shader version.
-  // TODO: improve or delete.
+  // a fragment shader, and interchangeable with it.  The kernel is dispatched
+  // indirectly over |tile_list|, which is generated by
+  // SsdoAccelerator::GenerateTileList(); pixels outside the listed tiles are
+  // cleared to the unshadowed result.  Each workgroup caches the depths around
+  // its tile in shared memory.  |output_texture| must have format
+  // kColorFormat, which requires the shaderStorageImageExtendedFormats device
+  // feature, and its image must be in eGeneral layout and have the
+  // eTransferDst usage.
   void SampleUsingKernel(CommandBuffer* command_buffer,
                          const TexturePtr& depth_texture,
+                         const TexturePtr& accelerator_texture,
                          const TexturePtr& output_texture,
+                         const BufferPtr& tile_list,
                          const SamplerConfig* push_constants);
 
   // Filter the noisy output from Sample().  This should be called twice, to
@@ -85,11 +133,74 @@ class SsdoSampler {
               const TexturePtr& accelerator_texture,
               const FilterConfig* push_constants);
 
+  // Same algorithm as calling Filter() twice, implemented with a compute
+  // kernel: |unfiltered_illumination| is filtered horizontally into
+  // |intermediate_illumination|, and that vertically into
+  // |output_illumination|.  The stride of |push_constants| is ignored.  Like
+  // SampleUsingKernel(), the kernel is dispatched indirectly over |tile_list|,
+  // and each workgroup caches the lines of its tile in shared memory.  The
+  // intermediate and output images have the same requirements as the output
+  // of SampleUsingKernel(); the intermediate is left in
+  // eShaderReadOnlyOptimal.
+  void FilterUsingKernel(CommandBuffer* command_buffer,
+                         const TexturePtr& unfiltered_illumination,
+                         const TexturePtr& intermediate_illumination,
+                         const TexturePtr& output_illumination,
+                         const TexturePtr& accelerator_texture,
+                         const BufferPtr& tile_list,
+                         const FilterConfig* push_constants,
+                         Timestamper* timestamper);
+
+  // Scale |depth_texture| down by |downsample_factor| in each dimension, into
+  // |output_texture|, whose format must be kDownsampledDepthFormat and whose
+  // image must be in eGeneral layout.  Each output pixel takes either the
+  // nearest or the farthest depth in its footprint, alternating in a
+  // checkerboard, so that both sides of a depth discontinuity are sampled.
+  void DownsampleDepth(CommandBuffer* command_buffer,
+                       const TexturePtr& depth_texture,
+                       const TexturePtr& output_texture,
+                       uint32_t downsample_factor);
+
+  // Scale filtered illumination that was sampled from the output of
+  // DownsampleDepth() back up to the size of |framebuffer|.  Each pixel blends
+  // the nearest downsampled pixels that lie on the same surface, according to
+  // |depth_texture|, which must be the full-resolution depth buffer.
+  void Upsample(CommandBuffer* command_buffer,
+                const FramebufferPtr& framebuffer,
+                const TexturePtr& filtered_illumination,
+                const TexturePtr& depth_texture,
+                const UpsampleConfig* push_constants);
+
+  // Blend the output of Sample() into |history|, the output of this method in
+  // the previous frame, writing the result into |framebuffer|.  The history of
+  // each pixel is found by reprojecting it with the depth from |depth_texture|,
+  // and is rejected if it was not visible in the previous frame.  Rejected
+  // pixels are filtered instead, so the result needs no further filtering.
+  void Accumulate(CommandBuffer* command_buffer,
+                  const FramebufferPtr& framebuffer,
+                  const TexturePtr& unfiltered_illumination,
+                  const TexturePtr& history,
+                  const TexturePtr& depth_texture,
+                  const TemporalConfig* push_constants);
+
   // TODO: This is exposed so that PaperRenderer can use it to create
   // Framebuffers, but it would be nice to find a way to remove this.
   vk::RenderPass render_pass() { return render_pass_; }
 
  private:
+  // The number of textures bound by each of the fragment shaders.
+  static constexpr uint32_t kTextureBindingCount = 3;
+  typedef std::array<TexturePtr, kTextureBindingCount> Textures;
+
+  // Bind |textures| and draw a full-screen quad into |framebuffer| with
+  // |pipeline|, which must be one of the fragment-shader pipelines.
+  void DrawFullScreen(CommandBuffer* command_buffer,
+                      const FramebufferPtr& framebuffer,
+                      const PipelinePtr& pipeline,
+                      const Textures& textures,
+                      const void* push_constants,
+                      uint32_t push_constants_size);
+
   const vk::Device device_;
   DescriptorSetPool pool_;
   MeshPtr full_screen_;
@@ -97,7 +208,11 @@ class SsdoSampler {
   vk::RenderPass render_pass_;
   PipelinePtr sampler_pipeline_;
   PipelinePtr filter_pipeline_;
+  PipelinePtr upsample_pipeline_;
+  PipelinePtr temporal_pipeline_;
   ComputeShader sampler_kernel_;
+  ComputeShader filter_kernel_;
+  ComputeShader depth_downsample_kernel_;
 };
 
 }  // namespace impl
@@ -2,11 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 #include "escher/escher.h"
 #include "escher/impl/command_buffer_pool.h"
 #include "escher/impl/escher_impl.h"
 #include "escher/impl/wobble_modifier_absorber.h"
 #include "escher/resources/resource_recycler.h"
+#include "escher/shape/mesh_spec.h"
 
 namespace escher {
 namespace impl {
@@ -21,7 +26,9 @@ constexpr char g_compute_wobble_src[] = R"GLSL(
     #extension GL_ARB_separate_shader_objects : enable
 
     layout(push_constant) uniform PushConstants {
+      uint base_vertex;
       uint num_vertices;
+      uint num_objects;
     };
 
     // Attribute order must match that is defined in model_data.h
@@ -35,20 +42,10 @@ constexpr char g_compute_wobble_src[] = R"GLSL(
       float perimeter;
     };
 
-    layout(binding = 0) buffer Vertices {
-      Vertex vertices[];
-    };
-
-    layout(local_size_x = 32) in;
-
-    layout(binding = 1) uniform PerModel {
-      vec2 frag_coord_to_uv_multiplier;
-      float time;
-    };
-
-    layout(binding = 2) uniform PerObject {
-      mat4 transform;
-      vec4 color;
+    // Must match WobbleModifierAbsorber::ObjectEntry.
+    struct Object {
+      uint first_vertex;
+      uint end_vertex;
       // Corresponds to ModifierWobble::SineParams[0].
       float speed_0;
       float amplitude_0;
@@ -61,41 +58,60 @@ constexpr char g_compute_wobble_src[] = R"GLSL(
       float speed_2;
       float amplitude_2;
       float frequency_2;
-      // TODO: for some reason, I can't say:
-      //   SineParams sine_params[kNumSineParams];
-      // nor:
-      //   SineParams sine_params_0;
-      //   SineParams sine_params_1;
-      //   SineParams sine_params_2;
-      // ... if I try, the GLSL compiler produces SPIR-V, but the "SC"
-      // validation layer complains when trying to create a vk::ShaderModule
-      // from that SPIR-V.  Note: if we ignore the warning and proceed, nothing
-      // explodes.  Nevertheless, we'll leave it this way for now, to be safe.
+      // TODO: an array of SineParams would be nicer, but the validation
+      // layer rejects the SPIR-V that the GLSL compiler produces for one.
     };
 
-    // TODO: workaround.  See discussion in PerObject struct, above.
-    float EvalSineParams_0(uint idx) {
-      float arg = frequency_0 * vertices[idx].perimeter + speed_0 * time;
-      return amplitude_0 * sin(arg);
-    }
-    float EvalSineParams_1(uint idx) {
-      float arg = frequency_1 * vertices[idx].perimeter + speed_1 * time;
-      return amplitude_1 * sin(arg);
+    layout(binding = 0) buffer Vertices {
+      Vertex vertices[];
+    };
+
+    layout(local_size_x = 32) in;
+
+    layout(binding = 1) uniform PerModel {
+      vec2 frag_coord_to_uv_multiplier;
+      float time;
+    };
+
+    // Sorted by vertex range, which covers [0, num_vertices) without gaps.
+    layout(std430, binding = 2) readonly buffer Objects {
+      Object objects[];
+    };
+
+    // Return the index of the object that contains vertex |idx|.
+    uint FindObject(uint idx) {
+      uint lo = 0;
+      uint hi = num_objects - 1;
+      while (lo < hi) {
+        uint mid = (lo + hi) / 2;
+        if (idx < objects[mid].end_vertex) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      return lo;
     }
-    float EvalSineParams_2(uint idx) {
-      float arg = frequency_2 * vertices[idx].perimeter + speed_2 * time;
-      return amplitude_2 * sin(arg);
+
+    float EvalSineParams(float speed, float amplitude, float frequency,
+                         float perimeter) {
+      return amplitude * sin(frequency * perimeter + speed * time);
     }
 
     void main() {
-      uint idx = gl_GlobalInvocationID.x;
+      uint idx = base_vertex + gl_GlobalInvocationID.x;
       if (idx >= num_vertices)
         return;
 
-      // TODO: workaround.  See discussion in PerObject struct, above.
+      Object obj = objects[FindObject(idx)];
+      float perimeter = vertices[idx].perimeter;
       float offset_scale =
-
-          EvalSineParams_0(idx) + EvalSineParams_1(idx) + EvalSineParams_2(idx);
+          EvalSineParams(obj.speed_0, obj.amplitude_0, obj.frequency_0,
+                         perimeter) +
+          EvalSineParams(obj.speed_1, obj.amplitude_1, obj.frequency_1,
+                         perimeter) +
+          EvalSineParams(obj.speed_2, obj.amplitude_2, obj.frequency_2,
+                         perimeter);
       vertices[idx].pos_x =
           vertices[idx].pos_x + offset_scale * vertices[idx].offset_x;
       vertices[idx].pos_y =
@@ -103,6 +119,25 @@ constexpr char g_compute_wobble_src[] = R"GLSL(
     }
     )GLSL";
 
+// The layout of the kernel's Vertex struct: 32-bit float attributes, in the
+// same order.  Meshes with any other layout, including compact encodings, are
+// left for the vertex shader to wobble.
+const MeshSpec kKernelMeshSpec{
+    MeshAttribute::kPosition | MeshAttribute::kPositionOffset |
+    MeshAttribute::kUV | MeshAttribute::kPerimeterPos};
+
+// Vulkan guarantees at least this many workgroups per dimension of a dispatch;
+// larger batches are split into several dispatches.
+constexpr uint32_t kMaxGroupCount = 65535;
+
+// Index data must be aligned to the size of the index type.  Align each mesh's
+// indices to 4 bytes, which suits both 16- and 32-bit indices.
+constexpr vk::DeviceSize kIndexAlignment = 4;
+
+vk::DeviceSize AlignUp(vk::DeviceSize offset, vk::DeviceSize alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
 }  // namespace
 
 WobbleModifierAbsorber::WobbleModifierAbsorber(Escher* escher)
@@ -117,81 +152,150 @@ WobbleModifierAbsorber::WobbleModifierAbsorber(Escher* escher)
           NewUniformBuffer(sizeof(ModelData::PerModel))),
       per_model_uniform_data_(
           reinterpret_cast<ModelData::PerModel*>(
-              per_model_uniform_buffer_->ptr())) {}
+              per_model_uniform_buffer_->ptr())) {
+  static_assert(sizeof(ObjectEntry) == 11 * sizeof(uint32_t),
+                "ObjectEntry must match the kernel's Object struct.");
+}
 
 void WobbleModifierAbsorber::AbsorbWobbleIfAny(Model* model) {
-  // frag_coord_to_uv_multiplier is not used; won't populate.
-  per_model_uniform_data_->time = model->time();
-  bool is_per_model_uniform_buffer_barrier_applied = false;
-
+  // Gather the wobbly objects, and lay out their vertices and then their
+  // indices in the compute buffer.  The vertices are contiguous, so that the
+  // kernel can treat them as a single array.
+  const vk::DeviceSize vertex_stride = kKernelMeshSpec.GetStride();
+  struct Absorbee {
+    Object* object;
+    vk::DeviceSize vertex_offset;
+    vk::DeviceSize index_offset;
+  };
+  std::vector<Absorbee> absorbees;
+  uint32_t num_vertices = 0;
   for (auto& object : model->mutable_objects()) {
     if (!(object.shape().modifiers() & ShapeModifier::kWobble)) {
       continue;
     }
+    const MeshPtr& mesh = object.shape().mesh();
+    if (!(mesh->spec() == kKernelMeshSpec)) {
+      continue;
+    }
+    absorbees.push_back({&object, num_vertices * vertex_stride, 0});
+    num_vertices += mesh->num_vertices();
+  }
+  if (absorbees.empty()) {
+    return;
+  }
+  vk::DeviceSize compute_buffer_size = num_vertices * vertex_stride;
+  for (auto& absorbee : absorbees) {
+    const MeshPtr& mesh = absorbee.object->shape().mesh();
+    absorbee.index_offset = AlignUp(compute_buffer_size, kIndexAlignment);
+    compute_buffer_size =
+        absorbee.index_offset + mesh->num_indices() * mesh->index_size();
+  }
 
-    auto& vertex_buffer = object.shape().mesh()->vertex_buffer();
-    auto compute_buffer =
-        Buffer::New(recycler_, allocator_, vertex_buffer->size(),
-                    vk::BufferUsageFlagBits::eVertexBuffer |
-                        vk::BufferUsageFlagBits::eStorageBuffer |
-                        vk::BufferUsageFlagBits::eTransferDst,
-                    vk::MemoryPropertyFlagBits::eDeviceLocal);
-    // TODO(longqic): Do not allocate a new uniform buffer for each new object.
-    // See ModelDisplayListBuilder::PrepareUniformBufferForWriteOfSize().
-    auto per_object_uniform_buffer =
-        NewUniformBuffer(sizeof(ModelData::PerObject));
-    auto per_object_uniform_data =
-        reinterpret_cast<ModelData::PerObject*>(
-            per_object_uniform_buffer->ptr());
-
-    // For memory transfer.
-    CommandBuffer* command_buffer = command_buffer_pool_->GetCommandBuffer();
-    command_buffer->KeepAlive(vertex_buffer);
-    command_buffer->KeepAlive(compute_buffer);
-
-    vk::BufferCopy region(0, 0, vertex_buffer->size());
-    command_buffer->get().copyBuffer(
-        vertex_buffer->get(), compute_buffer->get(), 1, &region);
-
-    SemaphorePtr vertex_buffer_ready = vertex_buffer->TakeWaitSemaphore();
-    command_buffer->AddWaitSemaphore(vertex_buffer_ready,
+  // Each mesh may occupy only part of its buffers (e.g. if it was allocated
+  // by a MeshArena), and those parts may be reused once the original mesh
+  // dies.  Therefore, copy both its vertices and its indices into the compute
+  // buffer, so that the modified mesh doesn't depend on the original.
+  auto compute_buffer =
+      Buffer::New(recycler_, allocator_, compute_buffer_size,
+                  vk::BufferUsageFlagBits::eVertexBuffer |
+                      vk::BufferUsageFlagBits::eIndexBuffer |
+                      vk::BufferUsageFlagBits::eStorageBuffer |
+                      vk::BufferUsageFlagBits::eTransferDst,
+                  vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto object_buffer =
+      Buffer::New(recycler_, allocator_, absorbees.size() * sizeof(ObjectEntry),
+                  vk::BufferUsageFlagBits::eStorageBuffer,
+                  vk::MemoryPropertyFlagBits::eHostVisible);
+  auto object_entries = reinterpret_cast<ObjectEntry*>(object_buffer->ptr());
+
+  CommandBuffer* command_buffer = command_buffer_pool_->GetCommandBuffer();
+  command_buffer->KeepAlive(compute_buffer);
+  command_buffer->KeepAlive(object_buffer);
+
+  // Meshes allocated by a MeshArena share their buffers, so gather the copies
+  // from each source buffer into a single command.
+  std::map<VkBuffer, std::vector<vk::BufferCopy>> copies;
+  for (size_t i = 0; i < absorbees.size(); ++i) {
+    const Absorbee& absorbee = absorbees[i];
+    const MeshPtr& mesh = absorbee.object->shape().mesh();
+    command_buffer->KeepAlive(mesh);
+    command_buffer->KeepAlive(mesh->vertex_buffer());
+    command_buffer->KeepAlive(mesh->index_buffer());
+    copies[static_cast<VkBuffer>(mesh->vk_vertex_buffer())].push_back(
+        vk::BufferCopy(mesh->vertex_buffer_offset(), absorbee.vertex_offset,
+                       mesh->num_vertices() * vertex_stride));
+    copies[static_cast<VkBuffer>(mesh->vk_index_buffer())].push_back(
+        vk::BufferCopy(mesh->index_buffer_offset(), absorbee.index_offset,
+                       mesh->num_indices() * mesh->index_size()));
+
+    // The upload semaphore is transferred from the vertex buffer to the mesh
+    // when the mesh is built.
+    command_buffer->AddWaitSemaphore(mesh->TakeWaitSemaphore(),
                                      vk::PipelineStageFlagBits::eTransfer);
-    SemaphorePtr compute_buffer_ready = Semaphore::New(vulkan_context_.device);
-    command_buffer->AddSignalSemaphore(compute_buffer_ready);
-    command_buffer->Submit(vulkan_context_.transfer_queue, nullptr);
-
-    // For compute.
-    command_buffer = command_buffer_pool_->GetCommandBuffer();
-    command_buffer->KeepAlive(compute_buffer);
-    command_buffer->KeepAlive(per_object_uniform_buffer);
-
-    if (!is_per_model_uniform_buffer_barrier_applied) {
-      ApplyBarrierForUniformBuffer(command_buffer, per_model_uniform_buffer_);
-      is_per_model_uniform_buffer_barrier_applied = true;
-    }
 
     // Transform and color are not used; won't populate.
-    per_object_uniform_data->wobble =
-        *object.shape_modifier_data<ModifierWobble>();
-    ApplyBarrierForUniformBuffer(command_buffer, per_object_uniform_buffer);
-
-    uint32_t num_vertices = object.shape().mesh()->num_vertices();
-    uint32_t group_count =
-        num_vertices / kLocalSize + num_vertices % kLocalSize;
-    push_constants_[0] = static_cast<uint32_t>(compute_buffer->size());
+    ObjectEntry& entry = object_entries[i];
+    entry.first_vertex = absorbee.vertex_offset / vertex_stride;
+    entry.end_vertex = entry.first_vertex + mesh->num_vertices();
+    entry.wobble = *absorbee.object->shape_modifier_data<ModifierWobble>();
+  }
+  for (auto& pair : copies) {
+    command_buffer->get().copyBuffer(vk::Buffer(pair.first),
+                                     compute_buffer->get(),
+                                     pair.second.size(), pair.second.data());
+  }
+
+  // frag_coord_to_uv_multiplier is not used; won't populate.
+  per_model_uniform_data_->time = model->time();
+  ApplyBarrierForHostWrites(command_buffer);
+
+  vk::BufferMemoryBarrier barrier;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask =
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = compute_buffer->get();
+  barrier.offset = 0;
+  barrier.size = compute_buffer_size;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 0,
+      nullptr, 1, &barrier, 0, nullptr);
+
+  // The indices follow the vertices in |compute_buffer|; the kernel must not
+  // touch them.
+  push_constants_[1] = num_vertices;
+  push_constants_[2] = absorbees.size();
+  const uint32_t max_vertices_per_dispatch = kMaxGroupCount * kLocalSize;
+  for (uint32_t base_vertex = 0; base_vertex < num_vertices;
+       base_vertex += max_vertices_per_dispatch) {
+    const uint32_t dispatch_vertices =
+        std::min(num_vertices - base_vertex, max_vertices_per_dispatch);
+    push_constants_[0] = base_vertex;
     kernel_->Dispatch(
         std::vector<TexturePtr>{},
-        std::vector<BufferPtr>{compute_buffer,
-                               per_model_uniform_buffer_,
-                               per_object_uniform_buffer},
-        command_buffer, group_count, 1, 1, push_constants_.data());
-
-    SemaphorePtr absorbed = Semaphore::New(vulkan_context_.device);
-    command_buffer->AddWaitSemaphore(compute_buffer_ready,
-                                     vk::PipelineStageFlagBits::eComputeShader);
-    command_buffer->AddSignalSemaphore(absorbed);
+        std::vector<BufferPtr>{compute_buffer, per_model_uniform_buffer_,
+                               object_buffer},
+        command_buffer, (dispatch_vertices + kLocalSize - 1) / kLocalSize, 1, 1,
+        push_constants_.data());
+  }
 
-    MeshPtr original_mesh = object.shape().mesh();
+  // The modified meshes are drawn by command buffers that are submitted later
+  // to the same queue, so a barrier makes the results visible to all of them;
+  // no semaphore is needed.
+  barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead |
+                          vk::AccessFlagBits::eIndexRead;
+  command_buffer->get().pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eVertexInput, vk::DependencyFlags(), 0,
+      nullptr, 1, &barrier, 0, nullptr);
+  command_buffer->Submit(vulkan_context_.queue, nullptr);
+
+  for (auto& absorbee : absorbees) {
+    Object& object = *absorbee.object;
+    const MeshPtr& original_mesh = object.shape().mesh();
     MeshPtr modified_mesh =
         ftl::MakeRefCounted<Mesh>(recycler_,
                                   original_mesh->spec(),
@@ -199,11 +303,11 @@ void WobbleModifierAbsorber::AbsorbWobbleIfAny(Model* model) {
                                   original_mesh->num_vertices(),
                                   original_mesh->num_indices(),
                                   compute_buffer,
-                                  original_mesh->index_buffer());
+                                  compute_buffer,
+                                  original_mesh->index_type(),
+                                  absorbee.vertex_offset,
+                                  absorbee.index_offset);
     object.mutable_shape().set_mesh(modified_mesh);
-    modified_mesh->SetWaitSemaphore(absorbed);
-    command_buffer->Submit(vulkan_context_.queue, nullptr);
-
     object.remove_shape_modifier<ModifierWobble>();
   }
 }
@@ -215,7 +319,7 @@ std::unique_ptr<ComputeShader> WobbleModifierAbsorber::NewKernel() {
       std::vector<vk::DescriptorType>{
           vk::DescriptorType::eStorageBuffer,
           vk::DescriptorType::eUniformBuffer,
-          vk::DescriptorType::eUniformBuffer},
+          vk::DescriptorType::eStorageBuffer},
       sizeof(uint32_t) * push_constants_.size(),
       g_compute_wobble_src);
 }
@@ -226,21 +330,16 @@ BufferPtr WobbleModifierAbsorber::NewUniformBuffer(vk::DeviceSize size) {
                      vk::MemoryPropertyFlagBits::eHostVisible);
 }
 
-void WobbleModifierAbsorber::ApplyBarrierForUniformBuffer(
-    CommandBuffer *command_buffer, const BufferPtr &buffer_ptr) {
-  vk::BufferMemoryBarrier barrier;
+void WobbleModifierAbsorber::ApplyBarrierForHostWrites(
+    CommandBuffer* command_buffer) {
+  vk::MemoryBarrier barrier;
   barrier.srcAccessMask = vk::AccessFlagBits::eHostWrite;
-  barrier.dstAccessMask = vk::AccessFlagBits::eUniformRead;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.buffer = buffer_ptr->get();
-  barrier.offset = 0;
-  barrier.size = buffer_ptr->size();
+  barrier.dstAccessMask =
+      vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
   command_buffer->get().pipelineBarrier(
       vk::PipelineStageFlagBits::eHost,
-      vk::PipelineStageFlagBits::eVertexShader |
-          vk::PipelineStageFlagBits::eFragmentShader,
-      vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+      vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 1,
+      &barrier, 0, nullptr, 0, nullptr);
 }
 
 }  // namespace impl
@@ -15,6 +15,12 @@ namespace escher {
 namespace impl {
 
 // A helper class that absorbs wobble modifier into the vertex buffer.
+//
+// All of a model's wobbly objects are absorbed together: their vertices and
+// indices are gathered into a single buffer, and one dispatch of the kernel
+// wobbles every vertex, looking up the parameters of the vertex's object in a
+// table.  The copies and the dispatch are recorded into one command buffer,
+// so the cost per frame does not grow with the number of objects.
 // Not thread-safe.
 class WobbleModifierAbsorber {
  public:
@@ -23,10 +29,20 @@ class WobbleModifierAbsorber {
   void AbsorbWobbleIfAny(Model* model);
 
  private:
+  // An entry in the table of wobbly objects that is read by the kernel.  Must
+  // match the Object struct in the kernel's source.
+  struct ObjectEntry {
+    // The range of the object's vertices in the compute buffer, in vertices.
+    uint32_t first_vertex;
+    uint32_t end_vertex;
+    ModifierWobble wobble;
+  };
+
   std::unique_ptr<ComputeShader> NewKernel();
   BufferPtr NewUniformBuffer(vk::DeviceSize size);
-  void ApplyBarrierForUniformBuffer(CommandBuffer *command_buffer,
-                                    const BufferPtr &buffer_ptr);
+  // Make the uniform and object tables written by the host visible to the
+  // kernel.
+  void ApplyBarrierForHostWrites(CommandBuffer* command_buffer);
 
   Escher* const escher_;
   const VulkanContext& vulkan_context_;
@@ -36,7 +52,9 @@ class WobbleModifierAbsorber {
   ResourceRecycler* const recycler_;
   const std::unique_ptr<ComputeShader> kernel_;
 
-  std::array<uint32_t, 1> push_constants_;
+  // The first vertex of the current dispatch, the number of vertices, and the
+  // number of objects.
+  std::array<uint32_t, 3> push_constants_;
   const BufferPtr per_model_uniform_buffer_;
   ModelData::PerModel* const per_model_uniform_data_;
 
@@ -44,4 +62,4 @@ class WobbleModifierAbsorber {
 };
 
 }  // namespace impl
-}  // namespace escher
\ No newline at end of file
+}  // namespace escher
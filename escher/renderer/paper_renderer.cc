@@ -4,6 +4,10 @@
 
 #include "escher/renderer/paper_renderer.h"
 
+#include <cmath>
+#include <utility>
+
+#include "escher/escher.h"
 #include "escher/geometry/tessellation.h"
 #include "escher/impl/command_buffer.h"
 #include "escher/impl/command_buffer_pool.h"
@@ -14,6 +18,7 @@
 #include "escher/impl/model_display_list.h"
 #include "escher/impl/model_pipeline_cache.h"
 #include "escher/impl/model_renderer.h"
+#include "escher/impl/render_graph.h"
 #include "escher/impl/ssdo_accelerator.h"
 #include "escher/impl/ssdo_sampler.h"
 #include "escher/impl/vulkan_utils.h"
@@ -24,12 +29,7 @@
 #include "escher/util/depth_to_color.h"
 #include "escher/util/image_utils.h"
 #include "escher/util/trace_macros.h"
-
-// If 1 uses a compute kernel to perform SSDO sampling, otherwise uses a
-// fragment shader.  For not-yet-understood reasons, the compute kernel is
-// drastically inefficient.
-// TODO: try to improve the compute kernel, and if that fails, delete this code.
-#define SSDO_SAMPLING_USES_KERNEL 0
+#include "escher/vk/vulkan_device_queues.h"
 
 namespace escher {
 
@@ -48,6 +48,26 @@ constexpr bool kSkipFiltering = false;
 
 constexpr uint32_t kLightingPassSampleCount = 1;
 
+// The number of samples per pixel that SSDO takes each frame when it is
+// accumulated over several frames.
+constexpr int32_t kSsdoTemporalTapCount = 2;
+
+// The weight of the accumulated SSDO history, versus that of each new frame.
+constexpr float kSsdoHistoryWeight = 0.875f;
+
+// The amount by which the SSDO noise pattern is rotated each frame, as a
+// fraction of a turn.  The golden ratio spreads successive frames' samples
+// evenly.
+constexpr double kSsdoNoiseOffsetPerFrame = 0.6180339887;
+
+// The downsampled depth made by DrawSsdoDepthDownsamplePass() is stored in a
+// color image.
+vk::ImageAspectFlags GetSsdoDepthAspect(const ImagePtr& depth) {
+  return depth->format() == impl::SsdoSampler::kDownsampledDepthFormat
+             ? vk::ImageAspectFlagBits::eColor
+             : vk::ImageAspectFlagBits::eDepth;
+}
+
 }  // namespace
 
 PaperRenderer::PaperRenderer(Escher* escher)
@@ -81,6 +101,9 @@ PaperRenderer::~PaperRenderer() {
   if (escher()->transfer_command_buffer_pool()) {
     escher()->transfer_command_buffer_pool()->Cleanup();
   }
+  if (escher()->compute_command_buffer_pool()) {
+    escher()->compute_command_buffer_pool()->Cleanup();
+  }
 }
 
 void PaperRenderer::DrawDepthPrePass(const ImagePtr& depth_image,
@@ -105,7 +128,12 @@ void PaperRenderer::DrawDepthPrePass(const ImagePtr& depth_image,
   auto display_list_flags =
       ModelDisplayListFlag::kUseDepthPrepass |
       (sort_by_pipeline_ ? ModelDisplayListFlag::kSortByPipeline
-                         : ModelDisplayListFlag::kNull);
+                         : ModelDisplayListFlag::kNull) |
+      (use_bindless_material_textures_
+           ? ModelDisplayListFlag::kUseBindlessMaterialTextures
+           : ModelDisplayListFlag::kNull) |
+      (use_analytic_shapes_ ? ModelDisplayListFlag::kUseAnalyticShapes
+                            : ModelDisplayListFlag::kNull);
   ModelDisplayListPtr display_list = model_renderer_->CreateDisplayList(
       stage, model, camera, display_list_flags, scale, 1, TexturePtr(),
       command_buffer);
@@ -118,131 +146,228 @@ void PaperRenderer::DrawDepthPrePass(const ImagePtr& depth_image,
   command_buffer->EndRenderPass();
 }
 
-void PaperRenderer::DrawSsdoPasses(const ImagePtr& depth_in,
-                                   const ImagePtr& color_out,
-                                   const ImagePtr& color_aux,
-                                   const TexturePtr& accelerator_texture,
-                                   const Stage& stage) {
-  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoPasses");
-
-  FTL_DCHECK(color_out->width() == color_aux->width() &&
-             color_out->height() == color_aux->height());
-  uint32_t width = color_out->width();
-  uint32_t height = color_out->height();
+void PaperRenderer::DrawSsdoDepthDownsamplePass(const ImagePtr& depth_in,
+                                                const ImagePtr& depth_out) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoDepthDownsamplePass",
+                 "width", depth_out->width(), "height", depth_out->height());
 
   auto command_buffer = current_frame();
 
-  auto fb_out = ftl::MakeRefCounted<Framebuffer>(
-      escher(), width, height, std::vector<ImagePtr>{color_out},
-      ssdo_->render_pass());
+  TexturePtr depth_texture = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), depth_in, vk::Filter::eNearest,
+      vk::ImageAspectFlagBits::eDepth);
+  command_buffer->KeepAlive(depth_texture);
+  TexturePtr output_texture = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), depth_out, vk::Filter::eNearest,
+      vk::ImageAspectFlagBits::eColor);
+  command_buffer->KeepAlive(output_texture);
 
-  auto fb_aux = ftl::MakeRefCounted<Framebuffer>(
-      escher(), width, height, std::vector<ImagePtr>{color_aux},
-      ssdo_->render_pass());
+  ssdo_->DownsampleDepth(command_buffer, depth_texture, output_texture,
+                         ssdo_downsample_factor_);
 
-  command_buffer->KeepAlive(fb_out);
-  command_buffer->KeepAlive(fb_aux);
+  AddTimestamp("finished SSDO depth downsample");
+}
+
+void PaperRenderer::DrawSsdoSamplingPass(
+    const ImagePtr& depth_in,
+    const ImagePtr& color_out,
+    const TexturePtr& accelerator_texture,
+    const Stage& stage) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoSamplingPass");
+
+  auto command_buffer = current_frame();
   command_buffer->KeepAlive(accelerator_texture);
 
-#if SSDO_SAMPLING_USES_KERNEL
   TexturePtr depth_texture = ftl::MakeRefCounted<Texture>(
       escher()->resource_recycler(), depth_in, vk::Filter::eNearest,
-      vk::ImageAspectFlagBits::eDepth);
+      GetSsdoDepthAspect(depth_in));
+  command_buffer->KeepAlive(depth_texture);
 
-  TexturePtr output_texture = ftl::MakeRefCounted<Texture>(
-      escher()->resource_recycler() color_out, vk::Filter::eNearest,
-      vk::ImageAspectFlagBits::eColor);
+  impl::SsdoSampler::SamplerConfig sampler_config(stage,
+                                                  ssdo_downsample_factor_);
+  if (enable_ssdo_temporal_accumulation_) {
+    // Take fewer samples, and different ones each frame.
+    sampler_config.tap_count = kSsdoTemporalTapCount;
+    sampler_config.noise_offset = static_cast<float>(
+        std::fmod(frame_number() * kSsdoNoiseOffsetPerFrame, 1.0));
+  }
 
-  command_buffer->KeepAlive(depth_texture);
-  command_buffer->KeepAlive(output_texture);
+  if (use_ssdo_sampling_kernel_) {
+    TexturePtr output_texture = ftl::MakeRefCounted<Texture>(
+        escher()->resource_recycler(), color_out, vk::Filter::eNearest,
+        vk::ImageAspectFlagBits::eColor);
+    command_buffer->KeepAlive(output_texture);
+
+    BufferPtr tile_list =
+        GenerateSsdoTileList(accelerator_texture, color_out,
+                             impl::SsdoSampler::kSamplerKernelTileSize);
+    ssdo_->SampleUsingKernel(command_buffer, depth_texture, accelerator_texture,
+                             output_texture, tile_list, &sampler_config);
+  } else {
+    auto fb_out = ftl::MakeRefCounted<Framebuffer>(
+        escher(), color_out->width(), color_out->height(),
+        std::vector<ImagePtr>{color_out}, ssdo_->render_pass());
+    command_buffer->KeepAlive(fb_out);
+
+    ssdo_->Sample(command_buffer, fb_out, depth_texture, accelerator_texture,
+                  &sampler_config);
+  }
+
+  AddTimestamp("finished SSDO sampling");
+}
+
+void PaperRenderer::DrawSsdoFilterPass(const ImagePtr& color_in,
+                                       const ImagePtr& color_out,
+                                       const TexturePtr& accelerator_texture,
+                                       vec2 stride,
+                                       const Stage& stage) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoFilterPass");
+
+  FTL_DCHECK(color_in->width() == color_out->width() &&
+             color_in->height() == color_out->height());
+
+  auto command_buffer = current_frame();
+  command_buffer->KeepAlive(accelerator_texture);
+
+  auto fb_out = ftl::MakeRefCounted<Framebuffer>(
+      escher(), color_out->width(), color_out->height(),
+      std::vector<ImagePtr>{color_out}, ssdo_->render_pass());
   command_buffer->KeepAlive(fb_out);
-  command_buffer->KeepAlive(fb_aux);
 
-  // Prepare to sample from the depth buffer.
-  command_buffer->TransitionImageLayout(
-      depth_in, vk::ImageLayout::eDepthStencilAttachmentOptimal,
-      vk::ImageLayout::eGeneral);
-  command_buffer->TransitionImageLayout(color_out, vk::ImageLayout::eUndefined,
-                                        vk::ImageLayout::eGeneral);
+  auto color_in_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_in, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_in_tex);
 
-  AddTimestamp("finished layout transition before SSDO sampling");
+  impl::SsdoSampler::FilterConfig filter_config;
+  filter_config.stride = stride;
+  filter_config.scene_depth = stage.viewing_volume().depth();
+  filter_config.downsample_factor = ssdo_downsample_factor_;
+  ssdo_->Filter(command_buffer, fb_out, color_in_tex, accelerator_texture,
+                &filter_config);
 
-  impl::SsdoSampler::SamplerConfig sampler_config(stage);
-  ssdo_->SampleUsingKernel(command_buffer, depth_texture, output_texture,
-                           &sampler_config);
-  AddTimestamp("finished SSDO sampling");
+  AddTimestamp("finished SSDO filter pass");
+}
+
+void PaperRenderer::DrawSsdoFilterKernelPass(
+    const ImagePtr& color_in,
+    const ImagePtr& color_aux,
+    const ImagePtr& color_out,
+    const TexturePtr& accelerator_texture,
+    const Stage& stage) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoFilterKernelPass");
+
+  auto command_buffer = current_frame();
+  command_buffer->KeepAlive(accelerator_texture);
+
+  auto color_in_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_in, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_in_tex);
+  auto color_aux_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_aux, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_aux_tex);
+  auto color_out_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_out, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_out_tex);
+
+  BufferPtr tile_list =
+      GenerateSsdoTileList(accelerator_texture, color_out,
+                           impl::SsdoSampler::kFilterKernelTileSize);
+
+  impl::SsdoSampler::FilterConfig filter_config;
+  filter_config.scene_depth = stage.viewing_volume().depth();
+  filter_config.downsample_factor = ssdo_downsample_factor_;
+  ssdo_->FilterUsingKernel(command_buffer, color_in_tex, color_aux_tex,
+                           color_out_tex, accelerator_texture, tile_list,
+                           &filter_config, this);
+}
 
-#else
+BufferPtr PaperRenderer::GenerateSsdoTileList(
+    const TexturePtr& accelerator_texture,
+    const ImagePtr& color_out,
+    uint32_t kernel_tile_size) {
+  // Each cell of the accelerator covers kSsdoAccelDownsampleFactor pixels of
+  // the full-resolution output in each dimension.
+  uint32_t tile_size =
+      kernel_tile_size * ssdo_downsample_factor_ / kSsdoAccelDownsampleFactor;
+  FTL_DCHECK(tile_size * kSsdoAccelDownsampleFactor ==
+             kernel_tile_size * ssdo_downsample_factor_);
+  return ssdo_accelerator_->GenerateTileList(
+      current_frame(), accelerator_texture,
+      color_out->width() * ssdo_downsample_factor_ / kSsdoAccelDownsampleFactor,
+      color_out->height() * ssdo_downsample_factor_ /
+          kSsdoAccelDownsampleFactor,
+      tile_size, this);
+}
+
+void PaperRenderer::DrawSsdoTemporalPass(const ImagePtr& color_in,
+                                         const ImagePtr& history_in,
+                                         const ImagePtr& depth_in,
+                                         const ImagePtr& color_out,
+                                         const mat4& reprojection) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoTemporalPass");
+
+  auto command_buffer = current_frame();
+
+  auto fb_out = ftl::MakeRefCounted<Framebuffer>(
+      escher(), color_out->width(), color_out->height(),
+      std::vector<ImagePtr>{color_out}, ssdo_->render_pass());
+  command_buffer->KeepAlive(fb_out);
+
+  auto color_in_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_in, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_in_tex);
+  // If there is no history, the shader doesn't read it, but something must be
+  // bound in its place.
+  auto history_tex =
+      history_in ? ftl::MakeRefCounted<Texture>(escher()->resource_recycler(),
+                                                history_in,
+                                                vk::Filter::eNearest)
+                 : color_in_tex;
+  command_buffer->KeepAlive(history_tex);
   TexturePtr depth_texture = ftl::MakeRefCounted<Texture>(
       escher()->resource_recycler(), depth_in, vk::Filter::eNearest,
-      vk::ImageAspectFlagBits::eDepth);
+      GetSsdoDepthAspect(depth_in));
   command_buffer->KeepAlive(depth_texture);
 
-  // Prepare to sample from the depth buffer.
-  command_buffer->TransitionImageLayout(
-      depth_in, vk::ImageLayout::eDepthStencilAttachmentOptimal,
-      vk::ImageLayout::eShaderReadOnlyOptimal);
+  impl::SsdoSampler::TemporalConfig temporal_config;
+  temporal_config.reprojection = reprojection;
+  temporal_config.history_weight = history_in ? kSsdoHistoryWeight : 0.f;
+  ssdo_->Accumulate(command_buffer, fb_out, color_in_tex, history_tex,
+                    depth_texture, &temporal_config);
 
-  AddTimestamp("finished layout transition before SSDO sampling");
+  AddTimestamp("finished SSDO temporal accumulation");
+}
 
-  impl::SsdoSampler::SamplerConfig sampler_config(stage);
-  ssdo_->Sample(command_buffer, fb_out, depth_texture, accelerator_texture,
-                &sampler_config);
+void PaperRenderer::DrawSsdoUpsamplePass(const ImagePtr& color_in,
+                                         const ImagePtr& depth_in,
+                                         const ImagePtr& color_out,
+                                         const Stage& stage) {
+  TRACE_DURATION("gfx", "escher::PaperRenderer::DrawSsdoUpsamplePass");
 
-  AddTimestamp("finished SSDO sampling");
+  FTL_DCHECK(depth_in->width() == color_out->width() &&
+             depth_in->height() == color_out->height());
 
-  // Now that we have finished sampling the depth buffer, transition it for
-  // reuse as a depth buffer in the lighting pass.
-  command_buffer->TransitionImageLayout(
-      depth_in, vk::ImageLayout::eShaderReadOnlyOptimal,
-      vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-  AddTimestamp("finished layout transition before SSDO filtering");
-#endif
-
-  // Do two filter passes, one horizontal and one vertical.
-  if (!kSkipFiltering) {
-    {
-      auto color_out_tex = ftl::MakeRefCounted<Texture>(
-          escher()->resource_recycler(), color_out, vk::Filter::eNearest);
-      command_buffer->KeepAlive(color_out_tex);
-
-      impl::SsdoSampler::FilterConfig filter_config;
-      filter_config.stride = vec2(1.f / stage.viewing_volume().width(), 0.f);
-      filter_config.scene_depth = stage.viewing_volume().depth();
-      ssdo_->Filter(command_buffer, fb_aux, color_out_tex, accelerator_texture,
-                    &filter_config);
-
-#if SSDO_SAMPLING_USES_KERNEL
-      command_buffer->TransitionImageLayout(
-          color_out, vk::ImageLayout::eGeneral,
-          vk::ImageLayout::eColorAttachmentOptimal);
-#else
-      command_buffer->TransitionImageLayout(
-          color_out, vk::ImageLayout::eShaderReadOnlyOptimal,
-          vk::ImageLayout::eColorAttachmentOptimal);
-#endif
-
-      AddTimestamp("finished SSDO filter pass 1");
-    }
-    {
-      auto color_aux_tex = ftl::MakeRefCounted<Texture>(
-          escher()->resource_recycler(), color_aux, vk::Filter::eNearest);
-      command_buffer->KeepAlive(color_aux_tex);
-
-      impl::SsdoSampler::FilterConfig filter_config;
-      filter_config.stride = vec2(0.f, 1.f / stage.viewing_volume().height());
-      filter_config.scene_depth = stage.viewing_volume().depth();
-      ssdo_->Filter(command_buffer, fb_out, color_aux_tex, accelerator_texture,
-                    &filter_config);
-
-      command_buffer->TransitionImageLayout(
-          color_aux, vk::ImageLayout::eShaderReadOnlyOptimal,
-          vk::ImageLayout::eColorAttachmentOptimal);
-
-      AddTimestamp("finished SSDO filter pass 2");
-    }
-  }
+  auto command_buffer = current_frame();
+
+  auto fb_out = ftl::MakeRefCounted<Framebuffer>(
+      escher(), color_out->width(), color_out->height(),
+      std::vector<ImagePtr>{color_out}, ssdo_->render_pass());
+  command_buffer->KeepAlive(fb_out);
+
+  auto color_in_tex = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), color_in, vk::Filter::eNearest);
+  command_buffer->KeepAlive(color_in_tex);
+  TexturePtr depth_texture = ftl::MakeRefCounted<Texture>(
+      escher()->resource_recycler(), depth_in, vk::Filter::eNearest,
+      vk::ImageAspectFlagBits::eDepth);
+  command_buffer->KeepAlive(depth_texture);
+
+  impl::SsdoSampler::UpsampleConfig upsample_config;
+  upsample_config.scene_depth = stage.viewing_volume().depth();
+  ssdo_->Upsample(command_buffer, fb_out, color_in_tex, depth_texture,
+                  &upsample_config);
+
+  AddTimestamp("finished SSDO upsample");
 }
 
 void PaperRenderer::UpdateModelRenderer(vk::Format pre_pass_color_format,
@@ -274,7 +399,12 @@ void PaperRenderer::DrawLightingPass(uint32_t sample_count,
 
   auto display_list_flags =
       (sort_by_pipeline_ ? ModelDisplayListFlag::kSortByPipeline
-                         : ModelDisplayListFlag::kNull);
+                         : ModelDisplayListFlag::kNull) |
+      (use_bindless_material_textures_
+           ? ModelDisplayListFlag::kUseBindlessMaterialTextures
+           : ModelDisplayListFlag::kNull) |
+      (use_analytic_shapes_ ? ModelDisplayListFlag::kUseAnalyticShapes
+                            : ModelDisplayListFlag::kNull);
 
   ModelDisplayListPtr display_list = model_renderer_->CreateDisplayList(
       stage, model, camera, display_list_flags, 1.f, sample_count,
@@ -310,81 +440,68 @@ void PaperRenderer::DrawLightingPass(uint32_t sample_count,
   command_buffer->EndRenderPass();
 }
 
-void PaperRenderer::DrawDebugOverlays(const ImagePtr& output,
-                                      const ImagePtr& depth,
-                                      const ImagePtr& illumination,
-                                      const TexturePtr& ssdo_accel,
-                                      const TexturePtr& ssdo_accel_depth) {
-  if (show_debug_info_) {
-    TexturePtr ssdo_accel_depth_as_color = depth_to_color_->Convert(
-        current_frame(), ssdo_accel_depth,
-        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc,
-        this);
-
-    int32_t dst_width = output->width();
-    int32_t dst_height = output->height();
-    int32_t src_width = 0;
-    int32_t src_height = 0;
-
-    vk::ImageBlit blit;
-    blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    blit.srcSubresource.mipLevel = 0;
-    blit.srcSubresource.baseArrayLayer = 0;
-    blit.srcSubresource.layerCount = 1;
-    blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
-    blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    blit.dstSubresource.mipLevel = 0;
-    blit.dstSubresource.baseArrayLayer = 0;
-    blit.dstSubresource.layerCount = 1;
-
-    // Used to visualize both the SSDO acceleration look-up table, as well as
-    // the depth image that was used to generate it.
-    src_width = depth->width() / kSsdoAccelDownsampleFactor;
-    src_height = depth->height() / kSsdoAccelDownsampleFactor;
+void PaperRenderer::DrawDebugOverlays(
+    const ImagePtr& output,
+    const ImagePtr& ssdo_accel_depth_as_color,
+    const ImagePtr& unpacked_ssdo_accel,
+    const ImagePtr& illumination) {
+  int32_t dst_width = output->width();
+  int32_t dst_height = output->height();
+  int32_t src_width = 0;
+  int32_t src_height = 0;
+
+  vk::ImageBlit blit;
+  blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+  blit.srcSubresource.mipLevel = 0;
+  blit.srcSubresource.baseArrayLayer = 0;
+  blit.srcSubresource.layerCount = 1;
+  blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
+  blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+  blit.dstSubresource.mipLevel = 0;
+  blit.dstSubresource.baseArrayLayer = 0;
+  blit.dstSubresource.layerCount = 1;
+
+  // Used to visualize both the SSDO acceleration look-up table, as well as
+  // the depth image that was used to generate it.
+  src_width = dst_width / kSsdoAccelDownsampleFactor;
+  src_height = dst_height / kSsdoAccelDownsampleFactor;
+  blit.srcOffsets[1] = vk::Offset3D{src_width, src_height, 1};
+
+  // Show the depth texture used as input to the SSDO accelerator.
+  blit.dstOffsets[0] = vk::Offset3D{dst_width * 3 / 4, 0, 0};
+  blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height / 4, 1};
+  current_frame()->get().blitImage(ssdo_accel_depth_as_color->get(),
+                                   vk::ImageLayout::eTransferSrcOptimal,
+                                   output->get(),
+                                   vk::ImageLayout::eTransferDstOptimal, 1,
+                                   &blit, vk::Filter::eNearest);
+
+  // Show the lookup table generated by the SSDO accelerator.
+  FTL_DCHECK(unpacked_ssdo_accel->width() == static_cast<uint32_t>(src_width));
+  FTL_DCHECK(unpacked_ssdo_accel->height() ==
+             static_cast<uint32_t>(src_height));
+  blit.dstOffsets[0] = vk::Offset3D{dst_width * 3 / 4, dst_height * 1 / 4, 0};
+  blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height * 1 / 2, 1};
+  current_frame()->get().blitImage(unpacked_ssdo_accel->get(),
+                                   vk::ImageLayout::eTransferSrcOptimal,
+                                   output->get(),
+                                   vk::ImageLayout::eTransferDstOptimal, 1,
+                                   &blit, vk::Filter::eNearest);
+
+  // Show the illumination texture.
+  if (illumination) {
+    src_width = illumination->width();
+    src_height = illumination->height();
     blit.srcOffsets[1] = vk::Offset3D{src_width, src_height, 1};
-    blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-
-    // Show the depth texture used as input to the SSDO accelerator.
-    blit.dstOffsets[0] = vk::Offset3D{dst_width * 3 / 4, 0, 0};
-    blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height / 4, 1};
-    current_frame()->get().blitImage(ssdo_accel_depth_as_color->image()->get(),
-                                     vk::ImageLayout::eShaderReadOnlyOptimal,
-                                     output->get(),
-                                     vk::ImageLayout::eColorAttachmentOptimal,
-                                     1, &blit, vk::Filter::eNearest);
-
-    // Show the lookup table generated by the SSDO accelerator.
-    TexturePtr unpacked_ssdo_accel = ssdo_accelerator_->UnpackLookupTable(
-        current_frame(), ssdo_accel, src_width, src_height, this);
-    FTL_DCHECK(unpacked_ssdo_accel->width() ==
-               static_cast<uint32_t>(src_width));
-    FTL_DCHECK(unpacked_ssdo_accel->height() ==
-               static_cast<uint32_t>(src_height));
-    blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    blit.srcOffsets[1] = vk::Offset3D{src_width, src_height, 1};
-    blit.dstOffsets[0] = vk::Offset3D{dst_width * 3 / 4, dst_height * 1 / 4, 0};
-    blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height * 1 / 2, 1};
-    current_frame()->get().blitImage(unpacked_ssdo_accel->image()->get(),
-                                     vk::ImageLayout::eGeneral, output->get(),
-                                     vk::ImageLayout::eColorAttachmentOptimal,
-                                     1, &blit, vk::Filter::eNearest);
-
-    // Show the illumination texture.
-    if (illumination) {
-      src_width = illumination->width();
-      src_height = illumination->height();
-      blit.srcOffsets[1] = vk::Offset3D{src_width, src_height, 1};
-      blit.dstOffsets[0] =
-          vk::Offset3D{dst_width * 3 / 4, dst_height * 1 / 2, 0};
-      blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height * 3 / 4, 1};
-      current_frame()->get().blitImage(
-          illumination->get(), vk::ImageLayout::eShaderReadOnlyOptimal,
-          output->get(), vk::ImageLayout::eColorAttachmentOptimal, 1, &blit,
-          vk::Filter::eLinear);
-    }
-
-    AddTimestamp("finished blitting debug overlay");
+    blit.dstOffsets[0] = vk::Offset3D{dst_width * 3 / 4, dst_height * 1 / 2, 0};
+    blit.dstOffsets[1] = vk::Offset3D{dst_width, dst_height * 3 / 4, 1};
+    current_frame()->get().blitImage(
+        illumination->get(), vk::ImageLayout::eTransferSrcOptimal,
+        output->get(), vk::ImageLayout::eTransferDstOptimal, 1, &blit,
+        vk::Filter::eLinear);
   }
+
+  AddTimestamp("finished blitting debug overlay");
 }
 
 void PaperRenderer::DrawFrame(const Stage& stage,
@@ -403,97 +520,305 @@ void PaperRenderer::DrawFrame(const Stage& stage,
 
   BeginFrame();
 
+  // Textures that were only used by previous frames no longer need a slot in
+  // the material texture array.
+  if (use_bindless_material_textures_) {
+    model_data_->material_texture_registry()->ReleaseUnusedTextures();
+  }
+
+  // The frame is described as a graph of passes, which derives the barriers
+  // between them, skips those whose results are unused (e.g. the SSDO passes
+  // when lighting is disabled), and allocates the transient images.
+  using Usage = impl::RenderGraph::Usage;
+  impl::RenderGraph graph(image_cache_);
+  // ModelRenderer's lighting render-pass leaves the color-attachment format
+  // as eColorAttachmentOptimal, since it's not clear how it will be used
+  // next.
+  // We could push this flexibility farther by letting our client specify the
+  // desired output format, but for now we'll assume that the image is being
+  // presented immediately.
+  auto output =
+      graph.ImportImage(color_image_out, vk::ImageLayout::ePresentSrcKHR);
+
+  // The SSDO compute passes run on the compute-only queue, if the device has
+  // one, concurrently with the depth pre-pass.  Timestamps are recorded on the
+  // main queue, so they can't time those passes.
+  Timestamper* compute_timestamper = this;
+  auto compute_pool = escher()->compute_command_buffer_pool();
+  if (enable_async_compute_ && compute_pool) {
+    graph.EnableAsyncCompute(compute_pool, context_.queue_family_index,
+                             context_.compute_queue_family_index);
+    compute_timestamper = nullptr;
+  }
+
+  // Textures that are made by one pass and used by later ones.
+  TexturePtr ssdo_accel_depth_texture;
+  TexturePtr ssdo_accel_texture;
+
   // Downsized depth-only prepass for SSDO acceleration.
   FTL_CHECK(width % kSsdoAccelDownsampleFactor == 0);
   FTL_CHECK(height % kSsdoAccelDownsampleFactor == 0);
   uint32_t ssdo_accel_width = width / kSsdoAccelDownsampleFactor;
   uint32_t ssdo_accel_height = height / kSsdoAccelDownsampleFactor;
-  ImagePtr ssdo_accel_depth_image = image_utils::NewDepthImage(
-      image_cache_, depth_format_, ssdo_accel_width, ssdo_accel_height,
-      vk::ImageUsageFlagBits::eSampled);
-  TexturePtr ssdo_accel_depth_texture = ftl::MakeRefCounted<Texture>(
-      escher()->resource_recycler(), ssdo_accel_depth_image,
-      vk::Filter::eNearest, vk::ImageAspectFlagBits::eDepth,
-      // TODO: use a more descriptive enum than true.
-      true);
-  {
-    // TODO: maybe share this with SsdoAccelerator::GenerateLookupTable().
-    // However, this would require refactoring to match the color format
-    // expected by ModelRenderer.
-    ImagePtr ssdo_accel_dummy_color_image = image_cache_->NewImage(
-        {color_image_out->format(), ssdo_accel_width, ssdo_accel_height, 1,
-         vk::ImageUsageFlagBits::eColorAttachment});
-
-    DrawDepthPrePass(ssdo_accel_depth_image, ssdo_accel_dummy_color_image,
-                     stage, model, camera);
-    SubmitPartialFrame();
-
-    AddTimestamp("finished SSDO acceleration depth pre-pass");
-  }
+  auto ssdo_accel_depth = graph.CreateImage(
+      {depth_format_, ssdo_accel_width, ssdo_accel_height, 1,
+       vk::ImageUsageFlagBits::eDepthStencilAttachment |
+           vk::ImageUsageFlagBits::eSampled});
+  // TODO: maybe share this with SsdoAccelerator::GenerateLookupTable().
+  // However, this would require refactoring to match the color format
+  // expected by ModelRenderer.
+  auto ssdo_accel_dummy_color =
+      graph.CreateImage({color_image_out->format(), ssdo_accel_width,
+                         ssdo_accel_height, 1,
+                         vk::ImageUsageFlagBits::eColorAttachment});
+  graph
+      .AddPass("ssdo_accel_depth_pre_pass",
+               [&](impl::CommandBuffer* command_buffer) {
+                 DrawDepthPrePass(graph.GetImage(ssdo_accel_depth),
+                                  graph.GetImage(ssdo_accel_dummy_color),
+                                  stage, model, camera);
+                 SubmitPartialFrame();
+                 AddTimestamp("finished SSDO acceleration depth pre-pass");
+               })
+      .Write(ssdo_accel_depth, Usage::kDepthAttachment)
+      .Write(ssdo_accel_dummy_color, Usage::kColorAttachment);
 
   // Compute SSDO acceleration structure.
-  TexturePtr ssdo_accel_texture = ssdo_accelerator_->GenerateLookupTable(
-      current_frame(), ssdo_accel_depth_texture,
-      vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
-      this);
-  SubmitPartialFrame();
+  auto ssdo_accel = graph.DeclareImage();
+  graph
+      .AddPass("ssdo_accelerator",
+               [&](impl::CommandBuffer* command_buffer) {
+                 ssdo_accel_depth_texture = ftl::MakeRefCounted<Texture>(
+                     escher()->resource_recycler(),
+                     graph.GetImage(ssdo_accel_depth), vk::Filter::eNearest,
+                     vk::ImageAspectFlagBits::eDepth,
+                     // TODO: use a more descriptive enum than true.
+                     true);
+                 ssdo_accel_texture = ssdo_accelerator_->GenerateLookupTable(
+                     command_buffer, ssdo_accel_depth_texture,
+                     vk::ImageUsageFlagBits::eSampled |
+                         vk::ImageUsageFlagBits::eTransferSrc,
+                     compute_timestamper);
+                 graph.SetImage(ssdo_accel, ssdo_accel_texture->image());
+               },
+               impl::RenderGraph::Queue::kAsyncCompute)
+      .Read(ssdo_accel_depth, Usage::kSampled)
+      .Write(ssdo_accel, Usage::kGeneral);
 
   // Depth-only pre-pass.
-  ImagePtr depth_image = image_utils::NewDepthImage(
-      image_cache_, depth_format_, width, height,
-      vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc);
-  {
-    current_frame()->TakeWaitSemaphore(
-        color_image_out, vk::PipelineStageFlagBits::eColorAttachmentOutput);
+  auto depth = graph.CreateImage(
+      {depth_format_, width, height, 1,
+       vk::ImageUsageFlagBits::eDepthStencilAttachment |
+           vk::ImageUsageFlagBits::eSampled |
+           vk::ImageUsageFlagBits::eTransferSrc});
+  graph
+      .AddPass("depth_pre_pass",
+               [&](impl::CommandBuffer* command_buffer) {
+                 DrawDepthPrePass(graph.GetImage(depth), color_image_out,
+                                  stage, model, camera);
+                 SubmitPartialFrame();
+                 AddTimestamp("finished depth pre-pass");
+               })
+      .Write(depth, Usage::kDepthAttachment)
+      .Write(output, Usage::kColorAttachment);
+
+  // Compute the illumination and store the result in an image.  The first
+  // pass samples the depth buffer to generate per-pixel occlusion, and the
+  // next two filter this noisy data, first horizontally and then vertically.
+  // If temporal accumulation is enabled, the noisy data is instead blended
+  // with the previous frame's result.
+  ImageInfo illumination_info = {impl::SsdoSampler::kColorFormat, width,
+                                 height, 1,
+                                 vk::ImageUsageFlagBits::eSampled |
+                                     vk::ImageUsageFlagBits::eColorAttachment |
+                                     vk::ImageUsageFlagBits::eStorage |
+                                     vk::ImageUsageFlagBits::eTransferSrc |
+                                     vk::ImageUsageFlagBits::eTransferDst};
+  auto illumination = graph.CreateImage(illumination_info);
+  if (enable_lighting_) {
+    // If SSDO is downsampled, the sampling and filter passes use a downsampled
+    // copy of the depth buffer, and the filtered result is scaled back up into
+    // |illumination| by a final pass.  The passes run after this scope ends,
+    // so they capture its variables by value.
+    const bool downsample_ssdo = ssdo_downsample_factor_ != 1;
+    const bool accumulate_ssdo = enable_ssdo_temporal_accumulation_;
+    auto ssdo_depth = depth;
+    auto ssdo_illumination = illumination;
+    ImageInfo ssdo_illumination_info = illumination_info;
+    if (downsample_ssdo) {
+      ssdo_illumination_info.width = width / ssdo_downsample_factor_;
+      ssdo_illumination_info.height = height / ssdo_downsample_factor_;
+      ssdo_illumination = graph.CreateImage(ssdo_illumination_info);
+      ssdo_depth = graph.CreateImage(
+          {impl::SsdoSampler::kDownsampledDepthFormat,
+           ssdo_illumination_info.width, ssdo_illumination_info.height, 1,
+           vk::ImageUsageFlagBits::eStorage |
+               vk::ImageUsageFlagBits::eSampled});
+      graph
+          .AddPass("ssdo_depth_downsample",
+                   [&, ssdo_depth](impl::CommandBuffer* command_buffer) {
+                     DrawSsdoDepthDownsamplePass(graph.GetImage(depth),
+                                                 graph.GetImage(ssdo_depth));
+                   })
+          .Read(depth, Usage::kSampled)
+          .Write(ssdo_depth, Usage::kGeneral);
+    }
 
-    DrawDepthPrePass(depth_image, color_image_out, stage, model, camera);
-    SubmitPartialFrame();
+    auto sampling_pass =
+        graph
+            .AddPass("ssdo_sampling",
+                     [&, ssdo_depth, ssdo_illumination,
+                      downsample_ssdo,
+                      accumulate_ssdo](impl::CommandBuffer* command_buffer) {
+                       DrawSsdoSamplingPass(graph.GetImage(ssdo_depth),
+                                            graph.GetImage(ssdo_illumination),
+                                            ssdo_accel_texture, stage);
+                       if (kSkipFiltering && !downsample_ssdo &&
+                           !accumulate_ssdo) {
+                         SubmitPartialFrame();
+                       }
+                     })
+            .Read(ssdo_depth, Usage::kSampled)
+            .Read(ssdo_accel, Usage::kSampled);
+    if (use_ssdo_sampling_kernel_) {
+      sampling_pass.Write(ssdo_illumination, Usage::kGeneral);
+    } else {
+      sampling_pass.Write(ssdo_illumination, Usage::kColorAttachment,
+                          vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
 
-    AddTimestamp("finished depth pre-pass");
-  }
+    // The result of the passes, at the resolution of the sampling pass.
+    auto ssdo_result = ssdo_illumination;
+    if (accumulate_ssdo) {
+      // The history of the previous frame can't be used if the size of the
+      // illumination has changed since then.
+      if (!ssdo_next_history_ ||
+          !(ssdo_next_history_->info() == ssdo_illumination_info)) {
+        ssdo_next_history_ = image_cache_->NewImage(ssdo_illumination_info);
+      }
+      if (ssdo_history_ &&
+          !(ssdo_history_->info() == ssdo_illumination_info)) {
+        ssdo_history_ = nullptr;
+      }
+      const bool has_history = static_cast<bool>(ssdo_history_);
+      const mat4 reprojection =
+          ssdo_history_camera_transform_ *
+          glm::inverse(camera.projection() * camera.transform());
+      const auto history =
+          has_history ? graph.ImportPreservedImage(
+                            ssdo_history_,
+                            vk::ImageLayout::eShaderReadOnlyOptimal)
+                      : ssdo_illumination;
+      const auto next_history = graph.ImportImage(
+          ssdo_next_history_, vk::ImageLayout::eShaderReadOnlyOptimal);
+      auto temporal_pass =
+          graph
+              .AddPass(
+                  "ssdo_temporal_accumulation",
+                  [&, ssdo_depth, ssdo_illumination, has_history, history,
+                   next_history, reprojection,
+                   downsample_ssdo](impl::CommandBuffer* command_buffer) {
+                    DrawSsdoTemporalPass(
+                        graph.GetImage(ssdo_illumination),
+                        has_history ? graph.GetImage(history) : ImagePtr(),
+                        graph.GetImage(ssdo_depth),
+                        graph.GetImage(next_history), reprojection);
+                    if (!downsample_ssdo) {
+                      SubmitPartialFrame();
+                    }
+                  })
+              .Read(ssdo_illumination, Usage::kSampled)
+              .Read(ssdo_depth, Usage::kSampled)
+              .Write(next_history, Usage::kColorAttachment,
+                     vk::ImageLayout::eShaderReadOnlyOptimal);
+      if (has_history) {
+        temporal_pass.Read(history, Usage::kSampled);
+      }
+      ssdo_result = next_history;
+    } else if (!kSkipFiltering && use_ssdo_filter_kernel_) {
+      // Both axes are filtered by a single compute pass, whose result replaces
+      // the unfiltered illumination.
+      auto illumination_aux = graph.CreateImage(ssdo_illumination_info);
+      auto ssdo_filtered = graph.CreateImage(ssdo_illumination_info);
+      graph
+          .AddPass("ssdo_filter_kernel",
+                   [&, ssdo_illumination, illumination_aux, ssdo_filtered,
+                    downsample_ssdo](impl::CommandBuffer* command_buffer) {
+                     DrawSsdoFilterKernelPass(graph.GetImage(ssdo_illumination),
+                                              graph.GetImage(illumination_aux),
+                                              graph.GetImage(ssdo_filtered),
+                                              ssdo_accel_texture, stage);
+                     if (!downsample_ssdo) {
+                       SubmitPartialFrame();
+                     }
+                   })
+          .Read(ssdo_illumination, Usage::kSampled)
+          .Read(ssdo_accel, Usage::kSampled)
+          .Write(illumination_aux, Usage::kGeneral,
+                 vk::ImageLayout::eShaderReadOnlyOptimal)
+          .Write(ssdo_filtered, Usage::kGeneral);
+      ssdo_result = ssdo_filtered;
+    } else if (!kSkipFiltering) {
+      // The filter's stride is one texel of the (possibly downsampled) image.
+      const float texel_width =
+          ssdo_downsample_factor_ / stage.viewing_volume().width();
+      const float texel_height =
+          ssdo_downsample_factor_ / stage.viewing_volume().height();
+      auto illumination_aux = graph.CreateImage(ssdo_illumination_info);
+      graph
+          .AddPass("ssdo_filter_horizontal",
+                   [&, ssdo_illumination, illumination_aux,
+                    texel_width](impl::CommandBuffer* command_buffer) {
+                     DrawSsdoFilterPass(graph.GetImage(ssdo_illumination),
+                                        graph.GetImage(illumination_aux),
+                                        ssdo_accel_texture,
+                                        vec2(texel_width, 0.f), stage);
+                   })
+          .Read(ssdo_illumination, Usage::kSampled)
+          .Read(ssdo_accel, Usage::kSampled)
+          .Write(illumination_aux, Usage::kColorAttachment,
+                 vk::ImageLayout::eShaderReadOnlyOptimal);
+      graph
+          .AddPass("ssdo_filter_vertical",
+                   [&, ssdo_illumination, illumination_aux, texel_height,
+                    downsample_ssdo](impl::CommandBuffer* command_buffer) {
+                     DrawSsdoFilterPass(graph.GetImage(illumination_aux),
+                                        graph.GetImage(ssdo_illumination),
+                                        ssdo_accel_texture,
+                                        vec2(0.f, texel_height), stage);
+                     if (!downsample_ssdo) {
+                       SubmitPartialFrame();
+                     }
+                   })
+          .Read(illumination_aux, Usage::kSampled)
+          .Read(ssdo_accel, Usage::kSampled)
+          .Write(ssdo_illumination, Usage::kColorAttachment,
+                 vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
 
-  // Compute the illumination and store the result in a texture.
-  TexturePtr illumination_texture;
-  if (enable_lighting_) {
-    ImagePtr illum1 = image_cache_->NewImage(
-        {impl::SsdoSampler::kColorFormat, width, height, 1,
-         vk::ImageUsageFlagBits::eSampled |
-             vk::ImageUsageFlagBits::eColorAttachment |
-             vk::ImageUsageFlagBits::eStorage |
-             vk::ImageUsageFlagBits::eTransferSrc});
-
-    ImagePtr illum2 = image_cache_->NewImage(
-        {impl::SsdoSampler::kColorFormat, width, height, 1,
-         vk::ImageUsageFlagBits::eSampled |
-             vk::ImageUsageFlagBits::eColorAttachment |
-             vk::ImageUsageFlagBits::eStorage |
-             vk::ImageUsageFlagBits::eTransferSrc});
-
-    DrawSsdoPasses(depth_image, illum1, illum2, ssdo_accel_texture, stage);
-    SubmitPartialFrame();
-
-    illumination_texture = ftl::MakeRefCounted<Texture>(
-        escher()->resource_recycler(), illum1, vk::Filter::eNearest);
-
-    // Done after previous SubmitPartialFrame(), because this is needed by the
-    // final lighting pass.
-    current_frame()->KeepAlive(illumination_texture);
+    if (downsample_ssdo) {
+      graph
+          .AddPass("ssdo_upsample",
+                   [&, ssdo_result](impl::CommandBuffer* command_buffer) {
+                     DrawSsdoUpsamplePass(graph.GetImage(ssdo_result),
+                                          graph.GetImage(depth),
+                                          graph.GetImage(illumination), stage);
+                     SubmitPartialFrame();
+                   })
+          .Read(ssdo_result, Usage::kSampled)
+          .Read(depth, Usage::kSampled)
+          .Write(illumination, Usage::kColorAttachment,
+                 vk::ImageLayout::eShaderReadOnlyOptimal);
+    } else {
+      // The lighting pass uses the result directly.
+      illumination = ssdo_result;
+    }
   }
 
   // Use multisampling for final lighting pass, or not.
-  if (kLightingPassSampleCount == 1) {
-    FramebufferPtr lighting_fb = ftl::MakeRefCounted<Framebuffer>(
-        escher(), width, height,
-        std::vector<ImagePtr>{color_image_out, depth_image},
-        model_renderer_->lighting_pass());
-
-    current_frame()->KeepAlive(lighting_fb);
-
-    DrawLightingPass(kLightingPassSampleCount, lighting_fb,
-                     illumination_texture, stage, model, camera, overlay_model);
-
-    AddTimestamp("finished lighting pass");
-  } else {
+  auto lighting_color = output;
+  auto lighting_depth = depth;
+  if (kLightingPassSampleCount != 1) {
     ImageInfo info;
     info.width = width;
     info.height = height;
@@ -501,64 +826,134 @@ void PaperRenderer::DrawFrame(const Stage& stage,
     info.format = color_image_out->format();
     info.usage = vk::ImageUsageFlagBits::eColorAttachment |
                  vk::ImageUsageFlagBits::eTransferSrc;
-    ImagePtr color_image_multisampled = image_cache_->NewImage(info);
+    lighting_color = graph.CreateImage(info);
 
     // TODO: use lazily-allocated image: since we don't care about saving the
     // depth buffer, a tile-based GPU doesn't actually need this memory.
     info.format = depth_format_;
     info.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-    ImagePtr depth_image_multisampled = image_cache_->NewImage(info);
-
-    FramebufferPtr multisample_fb = ftl::MakeRefCounted<Framebuffer>(
-        escher(), width, height,
-        std::vector<ImagePtr>{color_image_multisampled,
-                              depth_image_multisampled},
-        model_renderer_->lighting_pass());
-
-    current_frame()->KeepAlive(multisample_fb);
-
-    DrawLightingPass(kLightingPassSampleCount, multisample_fb,
-                     illumination_texture, stage, model, camera, overlay_model);
-
-    AddTimestamp("finished lighting pass");
+    lighting_depth = graph.CreateImage(info);
+  }
+  auto lighting_pass =
+      graph
+          .AddPass("lighting",
+                   [&](impl::CommandBuffer* command_buffer) {
+                     TexturePtr illumination_texture;
+                     if (enable_lighting_) {
+                       illumination_texture = ftl::MakeRefCounted<Texture>(
+                           escher()->resource_recycler(),
+                           graph.GetImage(illumination), vk::Filter::eNearest);
+                       command_buffer->KeepAlive(illumination_texture);
+                     }
+                     FramebufferPtr framebuffer =
+                         ftl::MakeRefCounted<Framebuffer>(
+                             escher(), width, height,
+                             std::vector<ImagePtr>{
+                                 graph.GetImage(lighting_color),
+                                 graph.GetImage(lighting_depth)},
+                             model_renderer_->lighting_pass());
+                     DrawLightingPass(kLightingPassSampleCount, framebuffer,
+                                      illumination_texture, stage, model,
+                                      camera, overlay_model);
+                     AddTimestamp("finished lighting pass");
+                   })
+          .Write(lighting_color, Usage::kColorAttachment)
+          .Write(lighting_depth, Usage::kDepthAttachment);
+  if (enable_lighting_) {
+    lighting_pass.Read(illumination, Usage::kSampled);
+  }
 
+  if (kLightingPassSampleCount != 1) {
     // TODO: do this during lighting sub-pass by adding a resolve attachment.
-    vk::ImageResolve resolve;
-    vk::ImageSubresourceLayers layers;
-    layers.aspectMask = vk::ImageAspectFlagBits::eColor;
-    layers.mipLevel = 0;
-    layers.baseArrayLayer = 0;
-    layers.layerCount = 1;
-    resolve.srcSubresource = layers;
-    resolve.srcOffset = vk::Offset3D{0, 0, 0};
-    resolve.dstSubresource = layers;
-    resolve.dstOffset = vk::Offset3D{0, 0, 0};
-    resolve.extent = vk::Extent3D{width, height, 0};
-    current_frame()->get().resolveImage(
-        color_image_multisampled->get(),
-        vk::ImageLayout::eColorAttachmentOptimal, color_image_out->get(),
-        vk::ImageLayout::eColorAttachmentOptimal, resolve);
-
-    AddTimestamp("finished multisample resolve");
+    graph
+        .AddPass("resolve",
+                 [&](impl::CommandBuffer* command_buffer) {
+                   vk::ImageResolve resolve;
+                   vk::ImageSubresourceLayers layers;
+                   layers.aspectMask = vk::ImageAspectFlagBits::eColor;
+                   layers.mipLevel = 0;
+                   layers.baseArrayLayer = 0;
+                   layers.layerCount = 1;
+                   resolve.srcSubresource = layers;
+                   resolve.srcOffset = vk::Offset3D{0, 0, 0};
+                   resolve.dstSubresource = layers;
+                   resolve.dstOffset = vk::Offset3D{0, 0, 0};
+                   resolve.extent = vk::Extent3D{width, height, 0};
+                   command_buffer->get().resolveImage(
+                       graph.GetImage(lighting_color)->get(),
+                       vk::ImageLayout::eTransferSrcOptimal,
+                       color_image_out->get(),
+                       vk::ImageLayout::eTransferDstOptimal, resolve);
+                   AddTimestamp("finished multisample resolve");
+                 })
+        .Read(lighting_color, Usage::kTransferSrc)
+        .Write(output, Usage::kTransferDst);
   }
 
-  DrawDebugOverlays(
-      color_image_out, depth_image,
-      illumination_texture ? illumination_texture->image() : ImagePtr(),
-      ssdo_accel_texture, ssdo_accel_depth_texture);
+  if (show_debug_info_) {
+    auto ssdo_accel_depth_as_color = graph.DeclareImage();
+    graph
+        .AddPass("debug_ssdo_accel_depth_to_color",
+                 [&](impl::CommandBuffer* command_buffer) {
+                   TexturePtr texture = depth_to_color_->Convert(
+                       command_buffer, ssdo_accel_depth_texture,
+                       vk::ImageUsageFlagBits::eStorage |
+                           vk::ImageUsageFlagBits::eTransferSrc,
+                       compute_timestamper);
+                   graph.SetImage(ssdo_accel_depth_as_color, texture->image());
+                 },
+                 impl::RenderGraph::Queue::kAsyncCompute)
+        .Read(ssdo_accel_depth, Usage::kSampled)
+        .Write(ssdo_accel_depth_as_color, Usage::kGeneral);
+
+    auto unpacked_ssdo_accel = graph.DeclareImage();
+    graph
+        .AddPass("debug_unpack_ssdo_accel",
+                 [&](impl::CommandBuffer* command_buffer) {
+                   TexturePtr texture = ssdo_accelerator_->UnpackLookupTable(
+                       command_buffer, ssdo_accel_texture, ssdo_accel_width,
+                       ssdo_accel_height, compute_timestamper);
+                   graph.SetImage(unpacked_ssdo_accel, texture->image());
+                 },
+                 impl::RenderGraph::Queue::kAsyncCompute)
+        .Read(ssdo_accel, Usage::kGeneral)
+        .Write(unpacked_ssdo_accel, Usage::kGeneral);
+
+    auto overlays_pass =
+        graph
+            .AddPass("debug_overlays",
+                     [&](impl::CommandBuffer* command_buffer) {
+                       DrawDebugOverlays(
+                           color_image_out,
+                           graph.GetImage(ssdo_accel_depth_as_color),
+                           graph.GetImage(unpacked_ssdo_accel),
+                           enable_lighting_ ? graph.GetImage(illumination)
+                                            : ImagePtr());
+                     })
+            .Read(ssdo_accel_depth_as_color, Usage::kTransferSrc)
+            .Read(unpacked_ssdo_accel, Usage::kTransferSrc)
+            .Modify(output, Usage::kTransferDst);
+    if (enable_lighting_) {
+      overlays_pass.Read(illumination, Usage::kTransferSrc);
+    }
+  }
 
-  // ModelRenderer's lighting render-pass leaves the color-attachment format
-  // as eColorAttachmentOptimal, since it's not clear how it will be used
-  // next.
-  // We could push this flexibility farther by letting our client specify the
-  // desired output format, but for now we'll assume that the image is being
-  // presented immediately.
-  current_frame()->TransitionImageLayout(
-      color_image_out, vk::ImageLayout::eColorAttachmentOptimal,
-      vk::ImageLayout::ePresentSrcKHR);
+  graph.Execute(
+      [this] { return current_frame(); },
+      [this](const SemaphorePtr& semaphore) { SubmitPartialFrame(semaphore); });
 
   AddTimestamp("finished transition to presentation layout");
 
+  // Keep the accumulated illumination for the next frame, or release it if
+  // none was accumulated.
+  if (enable_lighting_ && enable_ssdo_temporal_accumulation_) {
+    std::swap(ssdo_history_, ssdo_next_history_);
+    ssdo_history_camera_transform_ = camera.projection() * camera.transform();
+  } else {
+    ssdo_history_ = nullptr;
+    ssdo_next_history_ = nullptr;
+  }
+
   EndFrame(frame_done, frame_retired_callback);
 }
 
@@ -566,4 +961,38 @@ void PaperRenderer::set_enable_ssdo_acceleration(bool b) {
   ssdo_accelerator_->set_enabled(b);
 }
 
+void PaperRenderer::set_use_bindless_material_textures(bool b) {
+  if (b && !model_data_->material_texture_registry()->supported()) {
+    FTL_LOG(WARNING) << "Bindless material textures are not supported by "
+                        "this device.";
+    return;
+  }
+  use_bindless_material_textures_ = b;
+}
+
+void PaperRenderer::set_use_ssdo_sampling_kernel(bool b) {
+  if (b && !escher()->device()->caps().shader_storage_image_extended_formats) {
+    FTL_LOG(WARNING) << "The SSDO sampling kernel is not supported by this "
+                        "device.";
+    return;
+  }
+  use_ssdo_sampling_kernel_ = b;
+}
+
+void PaperRenderer::set_use_ssdo_filter_kernel(bool b) {
+  if (b && !escher()->device()->caps().shader_storage_image_extended_formats) {
+    FTL_LOG(WARNING) << "The SSDO filter kernel is not supported by this "
+                        "device.";
+    return;
+  }
+  use_ssdo_filter_kernel_ = b;
+}
+
+void PaperRenderer::set_ssdo_downsample_factor(uint32_t factor) {
+  FTL_DCHECK(factor > 0 && factor <= impl::SsdoSampler::kMaxDownsampleFactor &&
+             kSsdoAccelDownsampleFactor % factor == 0)
+      << "unsupported SSDO downsample factor: " << factor;
+  ssdo_downsample_factor_ = factor;
+}
+
 }  // namespace escher
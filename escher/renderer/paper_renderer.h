@@ -5,6 +5,7 @@
 #pragma once
 
 #include "escher/forward_declarations.h"
+#include "escher/geometry/types.h"
 #include "escher/renderer/renderer.h"
 
 namespace escher {
@@ -37,6 +38,51 @@ class PaperRenderer : public Renderer {
   // order that they are provided by the caller.
   void set_sort_by_pipeline(bool b) { sort_by_pipeline_ = b; }
 
+  // Set whether material textures are indexed from a single shared texture
+  // array, instead of being bound separately for each object.  This allows
+  // objects with different textures to share pipelines and descriptor sets,
+  // but requires the shaderSampledImageArrayDynamicIndexing device feature;
+  // without it, enabling has no effect.
+  void set_use_bindless_material_textures(bool b);
+
+  // Set whether rects, circles and rounded-rects are drawn as quads whose
+  // fragment shader computes the shape's anti-aliased edges, instead of as
+  // tessellated meshes.
+  void set_use_analytic_shapes(bool b) { use_analytic_shapes_ = b; }
+
+  // Set whether the SSDO compute passes are submitted to the device's
+  // compute-only queue, so that they run concurrently with the graphics
+  // passes.  Has no effect if the device has no such queue.
+  void set_enable_async_compute(bool b) { enable_async_compute_ = b; }
+
+  // Set the factor by which SSDO sampling and filtering are scaled down from
+  // the output in each dimension: 1 (full resolution), 2 or 4.  The result is
+  // scaled back up, guided by the full-resolution depth buffer, before it is
+  // used by the lighting pass.
+  void set_ssdo_downsample_factor(uint32_t factor);
+
+  // Set whether SSDO is accumulated over several frames, instead of being
+  // filtered each frame.  Each frame then takes fewer samples per pixel, and
+  // blends them with the previous frame's result, reprojected by the camera.
+  // Object motion is not taken into account, so this is best suited to
+  // mostly-static scenes.
+  void set_enable_ssdo_temporal_accumulation(bool b) {
+    enable_ssdo_temporal_accumulation_ = b;
+  }
+
+  // Set whether SSDO sampling uses a compute kernel instead of a fragment
+  // shader.  Both produce the same result; the kernel caches depths in shared
+  // memory, but requires the shaderStorageImageExtendedFormats device feature;
+  // if the device doesn't support it, enabling the kernel has no effect.
+  void set_use_ssdo_sampling_kernel(bool b);
+  bool use_ssdo_sampling_kernel() const { return use_ssdo_sampling_kernel_; }
+
+  // Set whether SSDO filtering uses a compute kernel, which filters both axes
+  // in a single pass, instead of two fragment-shader passes.  Has the same
+  // requirements as set_use_ssdo_sampling_kernel().
+  void set_use_ssdo_filter_kernel(bool b);
+  bool use_ssdo_filter_kernel() const { return use_ssdo_filter_kernel_; }
+
   // Cycle through the available SSDO acceleration modes.  This is a temporary
   // API: eventually there will only be one mode (the best one!), but this is
   // useful during development.
@@ -49,26 +95,72 @@ class PaperRenderer : public Renderer {
   static constexpr uint32_t kFramebufferDepthAttachmentIndex = 1;
 
   // Render pass that generates a depth buffer, but no color fragments.  The
-  // resulting depth buffer is used by DrawSsdoPasses() in order to compute
-  // per-pixel occlusion, and by DrawLightingPass().
+  // resulting depth buffer is used by DrawSsdoSamplingPass() in order to
+  // compute per-pixel occlusion.
   void DrawDepthPrePass(const ImagePtr& depth_image,
                         const ImagePtr& dummy_color_image,
                         const Stage& stage,
                         const Model& model,
                         const Camera& camera);
 
-  // Multiple render passes.  The first samples the depth buffer to generate
-  // per-pixel occlusion information, and subsequent passes filter this noisy
-  // data.
-  void DrawSsdoPasses(const ImagePtr& depth_in,
-                      const ImagePtr& color_out,
-                      const ImagePtr& color_aux,
-                      const TexturePtr& accelerator_texture,
-                      const Stage& stage);
+  // Compute pass that scales the depth buffer down by
+  // |ssdo_downsample_factor_|, for use by DrawSsdoSamplingPass().
+  void DrawSsdoDepthDownsamplePass(const ImagePtr& depth_in,
+                                   const ImagePtr& depth_out);
+
+  // Render pass that samples the depth buffer, or the output of
+  // DrawSsdoDepthDownsamplePass(), to generate noisy per-pixel occlusion
+  // information.
+  void DrawSsdoSamplingPass(const ImagePtr& depth_in,
+                            const ImagePtr& color_out,
+                            const TexturePtr& accelerator_texture,
+                            const Stage& stage);
+
+  // Render pass that filters the output of DrawSsdoSamplingPass() along one
+  // axis; |stride| is the distance between texels along that axis, in
+  // texture coordinates.
+  void DrawSsdoFilterPass(const ImagePtr& color_in,
+                          const ImagePtr& color_out,
+                          const TexturePtr& accelerator_texture,
+                          vec2 stride,
+                          const Stage& stage);
+
+  // Compute pass that filters the output of DrawSsdoSamplingPass() along both
+  // axes, using |color_aux| for the intermediate result.
+  void DrawSsdoFilterKernelPass(const ImagePtr& color_in,
+                                const ImagePtr& color_aux,
+                                const ImagePtr& color_out,
+                                const TexturePtr& accelerator_texture,
+                                const Stage& stage);
+
+  // Return a list of the tiles of |kernel_tile_size| x |kernel_tile_size|
+  // pixels of |color_out| in which SSDO sampling or filtering is required,
+  // according to |accelerator_texture|.  Used to dispatch the SSDO kernels.
+  BufferPtr GenerateSsdoTileList(const TexturePtr& accelerator_texture,
+                                 const ImagePtr& color_out,
+                                 uint32_t kernel_tile_size);
+
+  // Render pass that blends the output of DrawSsdoSamplingPass() into
+  // |history_in|, the output of this pass in the previous frame, writing the
+  // result to |color_out|.  |history_in| is null if there is no history.
+  // |reprojection| maps this frame's normalized device coordinates to the
+  // previous frame's.
+  void DrawSsdoTemporalPass(const ImagePtr& color_in,
+                            const ImagePtr& history_in,
+                            const ImagePtr& depth_in,
+                            const ImagePtr& color_out,
+                            const mat4& reprojection);
+
+  // Render pass that scales the filtered output of DrawSsdoFilterPass() back
+  // up to the size of the full-resolution depth buffer |depth_in|.
+  void DrawSsdoUpsamplePass(const ImagePtr& color_in,
+                            const ImagePtr& depth_in,
+                            const ImagePtr& color_out,
+                            const Stage& stage);
 
   // Render pass that renders the fully-lit/shadowed scene.  Uses the depth
-  // buffer from DrawDepthPrePass(), and the illumination texture from
-  // DrawSsdoPasses().
+  // buffer from DrawDepthPrePass(), and the illumination texture from the SSDO
+  // passes.
   // TODO: on GPUs that use tiled rendering, it may be faster simply clear the
   // depth buffer instead of reusing the values from DrawDepthPrePass().  This
   // might save bandwidth at the cost of more per-fragment computation (but
@@ -82,11 +174,12 @@ class PaperRenderer : public Renderer {
                         const Camera& camera,
                         const Model* overlay_model);
 
+  // Blit visualizations of the SSDO acceleration depth image and lookup table,
+  // and of the illumination image if any, into the right edge of |output|.
   void DrawDebugOverlays(const ImagePtr& output,
-                         const ImagePtr& depth,
-                         const ImagePtr& illumination,
-                         const TexturePtr& ssdo_accel,
-                         const TexturePtr& ssdo_accel_depth);
+                         const ImagePtr& ssdo_accel_depth_as_color,
+                         const ImagePtr& unpacked_ssdo_accel,
+                         const ImagePtr& illumination);
 
   // Configure the renderer to use the specified output formats.
   void UpdateModelRenderer(vk::Format pre_pass_color_format,
@@ -104,6 +197,20 @@ class PaperRenderer : public Renderer {
   bool show_debug_info_ = false;
   bool enable_lighting_ = true;
   bool sort_by_pipeline_ = true;
+  bool use_bindless_material_textures_ = false;
+  bool use_analytic_shapes_ = false;
+  bool enable_async_compute_ = true;
+  uint32_t ssdo_downsample_factor_ = 1;
+  bool enable_ssdo_temporal_accumulation_ = false;
+  bool use_ssdo_sampling_kernel_ = false;
+  bool use_ssdo_filter_kernel_ = false;
+  // The illumination accumulated by the previous frame, and the camera
+  // transform that it was rendered with, if temporal accumulation is enabled.
+  // The next frame accumulates into |ssdo_next_history_|, and then swaps the
+  // two.
+  ImagePtr ssdo_history_;
+  ImagePtr ssdo_next_history_;
+  mat4 ssdo_history_camera_transform_;
 
   FRIEND_REF_COUNTED_THREAD_SAFE(PaperRenderer);
   FTL_DISALLOW_COPY_AND_ASSIGN(PaperRenderer);
@@ -52,9 +52,12 @@ void Renderer::BeginFrame() {
   }
 }
 
-void Renderer::SubmitPartialFrame() {
+void Renderer::SubmitPartialFrame(const SemaphorePtr& semaphore) {
   TRACE_DURATION("gfx", "escher::Renderer::SubmitPartialFrame");
   FTL_DCHECK(current_frame_);
+  if (semaphore) {
+    current_frame_->AddSignalSemaphore(semaphore);
+  }
   current_frame_->Submit(context_.queue, nullptr);
   current_frame_ = pool_->GetCommandBuffer();
 }
@@ -41,7 +41,10 @@ class Renderer : public ftl::RefCountedThreadSafe<Renderer>,
 
   // Obtain a CommandBuffer, to record commands for the current frame.
   void BeginFrame();
-  void SubmitPartialFrame();
+  // Submit the commands recorded so far, signaling |semaphore| (if any) when
+  // they have finished, and obtain a new CommandBuffer for the rest of the
+  // frame.
+  void SubmitPartialFrame(const SemaphorePtr& semaphore = SemaphorePtr());
   void EndFrame(const SemaphorePtr& frame_done,
                 FrameRetiredCallback frame_retired_callback);
 
@@ -17,6 +17,16 @@ Object::Object(const mat4& transform, MeshPtr mesh, MaterialPtr material)
 Object::Object(const vec3& position, MeshPtr mesh, MaterialPtr material)
     : Object(glm::translate(position), std::move(mesh), std::move(material)) {}
 
+Object::Object(const mat4& transform,
+               MeshLodPtr mesh_lod,
+               MaterialPtr material)
+    : Object(transform, Shape(std::move(mesh_lod)), std::move(material)) {}
+
+Object::Object(const vec3& position, MeshLodPtr mesh_lod, MaterialPtr material)
+    : Object(glm::translate(position),
+             std::move(mesh_lod),
+             std::move(material)) {}
+
 Object::Object(std::vector<Object> clippers, std::vector<Object> clippees)
     : transform_(mat4(1)),
       shape_(Shape(Shape::Type::kNone)),
@@ -80,6 +90,19 @@ Object Object::NewCircle(const mat4& transform,
                 Shape(Shape::Type::kCircle), std::move(material));
 }
 
+Object Object::NewRoundedRect(const vec3& center_position,
+                              const RoundedRectSpec& spec,
+                              MaterialPtr material) {
+  return NewRoundedRect(glm::translate(center_position), spec,
+                        std::move(material));
+}
+
+Object Object::NewRoundedRect(const mat4& transform,
+                              const RoundedRectSpec& spec,
+                              MaterialPtr material) {
+  return Object(transform, Shape(spec), std::move(material));
+}
+
 BoundingBox Object::bounding_box() const {
   BoundingBox box = shape_.bounding_box();
   for (auto& clipper : clippers_) {
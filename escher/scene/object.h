@@ -22,6 +22,8 @@ class Object {
   Object(const Transform& transform, MeshPtr mesh, MaterialPtr material);
   Object(const mat4& transform, MeshPtr mesh, MaterialPtr material);
   Object(const vec3& position, MeshPtr mesh, MaterialPtr material);
+  Object(const mat4& transform, MeshLodPtr mesh_lod, MaterialPtr material);
+  Object(const vec3& position, MeshLodPtr mesh_lod, MaterialPtr material);
   Object(std::vector<Object> clippers, std::vector<Object> clippees);
   Object(const Object& other) = default;
   Object(Object&& other) = default;
@@ -44,6 +46,13 @@ class Object {
   static Object NewCircle(const mat4& transform,
                           float radius,
                           MaterialPtr material);
+  // The rounded-rect is centered at |center_position|.
+  static Object NewRoundedRect(const vec3& center_position,
+                               const RoundedRectSpec& spec,
+                               MaterialPtr material);
+  static Object NewRoundedRect(const mat4& transform,
+                               const RoundedRectSpec& spec,
+                               MaterialPtr material);
 
   // Return the object's 4x4 transformation matrix.
   const mat4& transform() const { return transform_; }
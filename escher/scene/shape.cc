@@ -10,7 +10,7 @@ namespace escher {
 
 Shape::Shape(Type type, ShapeModifiers modifiers)
     : type_(type), modifiers_(modifiers) {
-  FTL_DCHECK(type != Type::kMesh);
+  FTL_DCHECK(type != Type::kMesh && type != Type::kRoundedRect);
   if (modifiers_ & ShapeModifier::kWobble) {
     FTL_LOG(ERROR) << "ShapeModifier::kWobble only supported for kMesh shapes.";
     FTL_CHECK(false);
@@ -31,6 +31,21 @@ Shape::Shape(MeshPtr mesh, ShapeModifiers modifiers)
   }
 }
 
+Shape::Shape(MeshLodPtr mesh_lod, ShapeModifiers modifiers)
+    : Shape(mesh_lod->finest_mesh(), modifiers) {
+  mesh_lod_ = std::move(mesh_lod);
+}
+
+Shape::Shape(const RoundedRectSpec& rounded_rect, ShapeModifiers modifiers)
+    : type_(Type::kRoundedRect),
+      modifiers_(modifiers),
+      rounded_rect_(rounded_rect) {
+  if (modifiers_ & ShapeModifier::kWobble) {
+    FTL_LOG(ERROR) << "ShapeModifier::kWobble only supported for kMesh shapes.";
+    FTL_CHECK(false);
+  }
+}
+
 Shape::~Shape() {}
 
 BoundingBox Shape::bounding_box() const {
@@ -41,6 +56,10 @@ BoundingBox Shape::bounding_box() const {
       return BoundingBox({-1, -1, 0}, {1, 1, 0});
     case Type::kMesh:
       return mesh_->bounding_box();
+    case Type::kRoundedRect:
+      return BoundingBox(
+          vec3(-0.5f * rounded_rect_.width, -0.5f * rounded_rect_.height, 0),
+          vec3(0.5f * rounded_rect_.width, 0.5f * rounded_rect_.height, 0));
     case Type::kNone:
       return BoundingBox();
   }
@@ -49,6 +68,7 @@ BoundingBox Shape::bounding_box() const {
 void Shape::set_mesh(MeshPtr mesh) {
   FTL_DCHECK(type_ == Type::kMesh);
   mesh_ = std::move(mesh);
+  mesh_lod_ = nullptr;
 }
 
 }  // namespace escher
@@ -6,6 +6,8 @@
 
 #include "escher/geometry/types.h"
 #include "escher/shape/mesh.h"
+#include "escher/shape/mesh_lod.h"
+#include "escher/shape/rounded_rect.h"
 #include "escher/util/debug_print.h"
 #include "escher/scene/shape_modifier.h"
 
@@ -16,14 +18,23 @@ namespace escher {
 // Describes a planar shape primitive to be drawn.
 class Shape {
  public:
-  enum class Type { kRect, kCircle, kMesh, kNone };
+  // kRoundedRect shapes are drawn by deforming a canonical mesh in the vertex
+  // shader, instead of tessellating a mesh per rounded-rect.
+  enum class Type { kRect, kCircle, kMesh, kRoundedRect, kNone };
 
   explicit Shape(Type type, ShapeModifiers modifiers = ShapeModifiers());
   explicit Shape(MeshPtr mesh, ShapeModifiers modifiers = ShapeModifiers());
+  // The shape's mesh is chosen from |mesh_lod| when it is drawn; mesh() and
+  // bounding_box() refer to the finest level of detail.
+  explicit Shape(MeshLodPtr mesh_lod,
+                 ShapeModifiers modifiers = ShapeModifiers());
+  explicit Shape(const RoundedRectSpec& rounded_rect,
+                 ShapeModifiers modifiers = ShapeModifiers());
   ~Shape();
 
   Type type() const { return type_; }
   ShapeModifiers modifiers() const { return modifiers_; }
+  // Also discards the shape's levels of detail, if any.
   void set_mesh(MeshPtr mesh);
   void set_modifiers(ShapeModifiers modifiers) { modifiers_ = modifiers; }
   void remove_modifier(ShapeModifier modifier) { modifiers_ &= ~modifier; }
@@ -33,12 +44,22 @@ class Shape {
     return mesh_;
   }
 
+  const RoundedRectSpec& rounded_rect() const {
+    FTL_DCHECK(type_ == Type::kRoundedRect);
+    return rounded_rect_;
+  }
+
+  // Null unless the shape was created from a MeshLod.
+  const MeshLodPtr& mesh_lod() const { return mesh_lod_; }
+
   BoundingBox bounding_box() const;
 
  private:
   Type type_;
   ShapeModifiers modifiers_;
   MeshPtr mesh_;
+  MeshLodPtr mesh_lod_;
+  RoundedRectSpec rounded_rect_ = RoundedRectSpec(0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
 };
 
 }  // namespace escher
@@ -0,0 +1,272 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/scene/static_batch.h"
+
+#include <memory>
+
+#include <glm/gtx/transform.hpp>
+
+#include "escher/geometry/tessellation.h"
+#include "escher/material/material.h"
+#include "escher/shape/mesh_builder.h"
+#include "escher/shape/mesh_builder_factory.h"
+#include "escher/util/trace_macros.h"
+
+namespace escher {
+
+namespace {
+
+// Must match the circle mesh generated by ModelRenderer::CreateCircle().
+constexpr int kCircleSubdivisions = 4;
+
+// Layout of a vertex in the merged mesh; must match StaticBatch::kMeshSpec.
+struct BatchVertex {
+  vec2 pos;
+  vec2 uv;
+  vec4 color;
+};
+
+// A MeshBuilder that keeps the vertices and indices in CPU memory instead of
+// uploading them to the GPU.  This allows StaticBatch to obtain the same
+// geometry that the tessellation functions generate for ModelRenderer.
+class RecordingMeshBuilder : public MeshBuilder {
+ public:
+  RecordingMeshBuilder(const MeshSpec& spec,
+                       size_t max_vertex_count,
+                       size_t max_index_count,
+                       std::unique_ptr<uint8_t[]> vertices,
+                       std::unique_ptr<uint8_t[]> indices)
+      : MeshBuilder(spec,
+                    max_vertex_count,
+                    max_index_count,
+                    vertices.get(),
+                    indices.get()),
+        vertices_(std::move(vertices)),
+        indices_(std::move(indices)) {}
+
+  // There is no GPU mesh; the data is obtained via the accessors below.
+  MeshPtr Build() override { return MeshPtr(); }
+
+  const uint8_t* vertices() const { return vertices_.get(); }
+  uint32_t index(size_t i) const {
+    if (index_type() == vk::IndexType::eUint16) {
+      return reinterpret_cast<const uint16_t*>(indices_.get())[i];
+    }
+    return reinterpret_cast<const uint32_t*>(indices_.get())[i];
+  }
+  size_t vertex_count() const { return vertex_count_; }
+  size_t index_count() const { return index_count_; }
+
+ private:
+  std::unique_ptr<uint8_t[]> vertices_;
+  std::unique_ptr<uint8_t[]> indices_;
+};
+
+class RecordingMeshBuilderFactory : public MeshBuilderFactory {
+ public:
+  MeshBuilderPtr NewMeshBuilder(const MeshSpec& spec,
+                                size_t max_vertex_count,
+                                size_t max_index_count) override {
+    builder_ = AdoptRef(new RecordingMeshBuilder(
+        spec, max_vertex_count, max_index_count,
+        std::make_unique<uint8_t[]>(max_vertex_count * spec.GetStride()),
+        std::make_unique<uint8_t[]>(
+            max_index_count *
+            MeshSpec::GetIndexSize(MeshSpec::GetIndexType(max_vertex_count)))));
+    return builder_;
+  }
+
+  const RecordingMeshBuilder* builder() const { return builder_.get(); }
+
+ private:
+  ftl::RefPtr<RecordingMeshBuilder> builder_;
+};
+
+// Copy the positions, UV coordinates and indices that were recorded by the
+// most recent builder obtained from |factory|.
+template <typename GeometryT>
+void CopyRecordedGeometry(const RecordingMeshBuilderFactory& factory,
+                          GeometryT* geometry) {
+  const RecordingMeshBuilder* builder = factory.builder();
+  FTL_DCHECK(builder);
+  const MeshSpec& spec = builder->spec();
+  FTL_DCHECK(spec.flags & MeshAttribute::kPosition);
+  FTL_DCHECK(spec.flags & MeshAttribute::kUV);
+  const size_t stride = spec.GetStride();
+  const size_t pos_offset = spec.GetAttributeOffset(MeshAttribute::kPosition);
+  const size_t uv_offset = spec.GetAttributeOffset(MeshAttribute::kUV);
+
+  geometry->positions.resize(builder->vertex_count());
+  geometry->uvs.resize(builder->vertex_count());
+  const uint8_t* vertex = builder->vertices();
+  for (size_t i = 0; i < builder->vertex_count(); ++i, vertex += stride) {
+    geometry->positions[i] =
+        *reinterpret_cast<const vec2*>(vertex + pos_offset);
+    geometry->uvs[i] = *reinterpret_cast<const vec2*>(vertex + uv_offset);
+  }
+  geometry->indices.resize(builder->index_count());
+  for (size_t i = 0; i < builder->index_count(); ++i) {
+    geometry->indices[i] = builder->index(i);
+  }
+}
+
+// Return true if |transform| maps the z = 0 plane to a plane of constant
+// depth, without any perspective.  Only such objects can be flattened into 2D
+// vertices without changing their appearance.
+bool IsPlanarTransform(const mat4& transform) {
+  return transform[0][2] == 0.f && transform[1][2] == 0.f &&
+         transform[0][3] == 0.f && transform[1][3] == 0.f &&
+         transform[3][3] == 1.f;
+}
+
+// Transform |count| positions by the 2D affine part of |transform|, writing
+// the results into consecutive BatchVertices.  The loop has no dependencies
+// between iterations, which allows the compiler to vectorize it.
+void TransformPositions(const mat4& transform,
+                        const vec2* positions,
+                        size_t count,
+                        BatchVertex* vertices_out) {
+  const vec2 x_axis(transform[0][0], transform[0][1]);
+  const vec2 y_axis(transform[1][0], transform[1][1]);
+  const vec2 translation(transform[3][0], transform[3][1]);
+  for (size_t i = 0; i < count; ++i) {
+    vertices_out[i].pos =
+        translation + positions[i].x * x_axis + positions[i].y * y_axis;
+  }
+}
+
+}  // namespace
+
+const MeshSpec StaticBatch::kMeshSpec{
+    MeshAttribute::kPosition | MeshAttribute::kUV | MeshAttribute::kColor};
+
+StaticBatch::StaticBatch(MeshBuilderFactory* factory)
+    : factory_(factory) {
+  FTL_DCHECK(factory_);
+  FTL_DCHECK(kMeshSpec.GetStride() == sizeof(BatchVertex));
+
+  RecordingMeshBuilderFactory recorder;
+  NewSimpleRectangleMesh(&recorder);
+  CopyRecordedGeometry(recorder, &rect_geometry_);
+  MeshSpec circle_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
+  NewCircleMesh(&recorder, circle_spec, kCircleSubdivisions, vec2(0.f, 0.f),
+                1.f);
+  CopyRecordedGeometry(recorder, &circle_geometry_);
+}
+
+StaticBatch::~StaticBatch() = default;
+
+const StaticBatch::Geometry* StaticBatch::GetGeometryForShape(
+    const Shape& shape) const {
+  switch (shape.type()) {
+    case Shape::Type::kRect:
+      return &rect_geometry_;
+    case Shape::Type::kCircle:
+      return &circle_geometry_;
+    case Shape::Type::kMesh:
+    case Shape::Type::kRoundedRect:
+    case Shape::Type::kNone:
+      return nullptr;
+  }
+}
+
+bool StaticBatch::AddObject(const Object& object) {
+  const Geometry* geometry = GetGeometryForShape(object.shape());
+  if (!geometry || !object.material() || !object.clippers().empty() ||
+      !object.clippees().empty() ||
+      object.shape().modifiers() != ShapeModifiers() ||
+      !IsPlanarTransform(object.transform())) {
+    return false;
+  }
+
+  const mat4& transform = object.transform();
+  const TexturePtr& texture = object.material()->texture();
+  if (objects_.empty()) {
+    texture_ = texture;
+    z_ = transform[3][2];
+    is_opaque_ = true;
+  } else if (texture != texture_ || transform[3][2] != z_) {
+    return false;
+  }
+
+  is_opaque_ = is_opaque_ && object.material()->opaque();
+  vertex_count_ += geometry->positions.size();
+  index_count_ += geometry->indices.size();
+  objects_.push_back(object);
+  merged_object_valid_ = false;
+  return true;
+}
+
+void StaticBatch::Clear() {
+  objects_.clear();
+  vertex_count_ = 0;
+  index_count_ = 0;
+  texture_ = nullptr;
+  merged_object_.reset();
+  merged_object_valid_ = false;
+}
+
+const Object& StaticBatch::object() {
+  FTL_DCHECK(!objects_.empty());
+  if (!merged_object_valid_) {
+    BuildMergedObject();
+  }
+  return *merged_object_;
+}
+
+void StaticBatch::AddMergedGeometry(MeshBuilder* builder) const {
+  FTL_DCHECK(builder->spec() == kMeshSpec);
+
+  // Generate all vertices in a CPU-side array, and then copy them into the
+  // builder with a single call per vertex.
+  std::vector<BatchVertex> vertices(vertex_count_);
+
+  size_t base_vertex = 0;
+  for (const Object& object : objects_) {
+    const Geometry* geometry = GetGeometryForShape(object.shape());
+    const size_t count = geometry->positions.size();
+    BatchVertex* out = vertices.data() + base_vertex;
+
+    TransformPositions(object.transform(), geometry->positions.data(), count,
+                       out);
+    const vec4 color = object.material()->color();
+    for (size_t i = 0; i < count; ++i) {
+      out[i].uv = geometry->uvs[i];
+      out[i].color = color;
+    }
+
+    for (uint32_t index : geometry->indices) {
+      builder->AddIndex(static_cast<uint32_t>(base_vertex + index));
+    }
+    base_vertex += count;
+  }
+  FTL_DCHECK(base_vertex == vertex_count_);
+
+  for (const BatchVertex& vertex : vertices) {
+    builder->AddVertex(vertex);
+  }
+}
+
+void StaticBatch::BuildMergedObject() {
+  TRACE_DURATION("gfx", "escher::StaticBatch::BuildMergedObject",
+                 "object_count", objects_.size(), "vertex_count",
+                 vertex_count_);
+
+  auto builder =
+      factory_->NewMeshBuilder(kMeshSpec, vertex_count_, index_count_);
+  AddMergedGeometry(builder.get());
+
+  // The per-vertex color is multiplied by the material color, so the merged
+  // material is white.
+  auto material = Material::New(vec4(1.f, 1.f, 1.f, 1.f), texture_);
+  material->set_opaque(is_opaque_);
+
+  merged_object_ =
+      std::make_unique<Object>(glm::translate(vec3(0.f, 0.f, z_)),
+                               builder->Build(), std::move(material));
+  merged_object_valid_ = true;
+}
+
+}  // namespace escher
@@ -0,0 +1,98 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "escher/forward_declarations.h"
+#include "escher/geometry/types.h"
+#include "escher/scene/object.h"
+#include "escher/shape/mesh_spec.h"
+#include "ftl/macros.h"
+
+namespace escher {
+
+// Merges objects that never move relative to each other into a single Object,
+// so that they can be rendered with a single draw call instead of one per
+// object.  Each object's vertices are transformed on the CPU, and its material
+// color is stored per-vertex (see MeshAttribute::kColor).  The merged Object
+// is cached until the batch is invalidated, e.g. because a source object has
+// changed.
+//
+// Only rects and circles can currently be batched: arbitrary meshes exist only
+// on the GPU, so their vertices are unavailable to be transformed.
+//
+// Not thread-safe.
+class StaticBatch {
+ public:
+  // The MeshSpec of the merged mesh.
+  static const MeshSpec kMeshSpec;
+
+  // |factory| is used to build the merged mesh, e.g. Escher or MeshManager.
+  explicit StaticBatch(MeshBuilderFactory* factory);
+  ~StaticBatch();
+
+  // Add |object| to the batch, and invalidate the merged Object.  Returns false
+  // if the object cannot be batched, either because of its own properties (it
+  // has clippers, clippees or shape modifiers, no material, or a shape other
+  // than a rect or circle), or because it is incompatible with the objects
+  // already in the batch (different texture, or a different z-plane).  The
+  // caller should render such objects individually.
+  bool AddObject(const Object& object);
+
+  // Remove all objects from the batch.
+  void Clear();
+
+  // Discard the merged Object; it will be regenerated by the next call to
+  // object().  Call this if the material color of a batched object changes.
+  void Invalidate() { merged_object_valid_ = false; }
+
+  // Return an Object that draws all objects in the batch.  Must not be called
+  // on an empty batch.
+  const Object& object();
+
+  // Write the merged vertices and indices into |builder|, which must use
+  // kMeshSpec and have room for vertex_count() vertices and index_count()
+  // indices.  This is how object() generates its mesh.
+  void AddMergedGeometry(MeshBuilder* builder) const;
+
+  size_t object_count() const { return objects_.size(); }
+  size_t vertex_count() const { return vertex_count_; }
+  size_t index_count() const { return index_count_; }
+
+ private:
+  // CPU-side copy of the geometry that ModelRenderer uses for a basic shape.
+  struct Geometry {
+    std::vector<vec2> positions;
+    std::vector<vec2> uvs;
+    std::vector<uint32_t> indices;
+  };
+
+  const Geometry* GetGeometryForShape(const Shape& shape) const;
+
+  // Generate the merged mesh and the Object that renders it.
+  void BuildMergedObject();
+
+  MeshBuilderFactory* const factory_;
+  Geometry rect_geometry_;
+  Geometry circle_geometry_;
+
+  std::vector<Object> objects_;
+  size_t vertex_count_ = 0;
+  size_t index_count_ = 0;
+
+  // All objects must share the same texture, and lie in the same z-plane.
+  TexturePtr texture_;
+  float z_ = 0.f;
+  bool is_opaque_ = true;
+
+  std::unique_ptr<Object> merged_object_;
+  bool merged_object_valid_ = false;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StaticBatch);
+};
+
+}  // namespace escher
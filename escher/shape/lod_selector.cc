@@ -0,0 +1,53 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/lod_selector.h"
+
+#include <limits>
+
+#include "ftl/logging.h"
+
+namespace escher {
+
+LodSelector::LodSelector(float hysteresis) : hysteresis_(hysteresis) {
+  FTL_DCHECK(hysteresis_ >= 0.f && hysteresis_ < 1.f);
+}
+
+void LodSelector::AddLevel(float min_screen_size) {
+  FTL_DCHECK(min_screen_sizes_.empty() ? min_screen_size == 0.f
+                                       : min_screen_size >
+                                             min_screen_sizes_.back());
+  min_screen_sizes_.push_back(min_screen_size);
+}
+
+size_t LodSelector::SelectLevel(float screen_size) {
+  FTL_DCHECK(!min_screen_sizes_.empty());
+  const size_t count = min_screen_sizes_.size();
+
+  // Keep the current level unless the size has moved sufficiently far outside
+  // of its range.
+  if (has_selected_level_) {
+    const float lower =
+        min_screen_sizes_[selected_level_] * (1.f - hysteresis_);
+    const float upper =
+        selected_level_ + 1 < count
+            ? min_screen_sizes_[selected_level_ + 1] * (1.f + hysteresis_)
+            : std::numeric_limits<float>::infinity();
+    if (screen_size >= lower && screen_size < upper) {
+      return selected_level_;
+    }
+  }
+
+  // Otherwise, choose the finest level whose minimum size is met.  This level
+  // is within its own range, so selecting again with the same size is stable.
+  size_t level = 0;
+  while (level + 1 < count && screen_size >= min_screen_sizes_[level + 1]) {
+    ++level;
+  }
+  selected_level_ = level;
+  has_selected_level_ = true;
+  return level;
+}
+
+}  // namespace escher
@@ -0,0 +1,44 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace escher {
+
+// Chooses a level of detail from the size of an object on screen.  Levels are
+// numbered from the coarsest (0) to the finest.  To avoid popping when the
+// size fluctuates around a threshold, the selected level only changes once the
+// size moves past the threshold by a fraction of it (the hysteresis).
+//
+// Not thread-safe.
+class LodSelector {
+ public:
+  static constexpr float kDefaultHysteresis = 0.15f;
+
+  explicit LodSelector(float hysteresis = kDefaultHysteresis);
+
+  // Add the next-finer level, which is used when the object is at least
+  // |min_screen_size| pixels across.  The first level's minimum must be zero,
+  // and each subsequent level's minimum must exceed the previous one's.
+  void AddLevel(float min_screen_size);
+
+  // Return the level for an object that is |screen_size| pixels across, taking
+  // the previously-selected level into account.
+  size_t SelectLevel(float screen_size);
+
+  size_t level_count() const { return min_screen_sizes_.size(); }
+  // The level returned by the most recent call to SelectLevel().
+  size_t selected_level() const { return selected_level_; }
+
+ private:
+  const float hysteresis_;
+  std::vector<float> min_screen_sizes_;
+  size_t selected_level_ = 0;
+  bool has_selected_level_ = false;
+};
+
+}  // namespace escher
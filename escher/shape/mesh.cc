@@ -20,8 +20,11 @@ Mesh::Mesh(ResourceRecycler* resource_recycler,
            uint32_t num_indices,
            BufferPtr vertex_buffer,
            BufferPtr index_buffer,
+           vk::IndexType index_type,
            vk::DeviceSize vertex_buffer_offset,
-           vk::DeviceSize index_buffer_offset)
+           vk::DeviceSize index_buffer_offset,
+           vec2 position_scale,
+           vec2 position_bias)
     : WaitableResource(resource_recycler),
       spec_(std::move(spec)),
       bounding_box_(bounding_box),
@@ -31,11 +34,16 @@ Mesh::Mesh(ResourceRecycler* resource_recycler,
       vk_index_buffer_(index_buffer->get()),
       vertex_buffer_(std::move(vertex_buffer)),
       index_buffer_(std::move(index_buffer)),
+      index_type_(index_type),
       vertex_buffer_offset_(vertex_buffer_offset),
-      index_buffer_offset_(index_buffer_offset) {
+      index_buffer_offset_(index_buffer_offset),
+      position_scale_(position_scale),
+      position_bias_(position_bias) {
   FTL_DCHECK(num_vertices_ * spec_.GetStride() + vertex_buffer_offset_ <=
              vertex_buffer_->size());
-  FTL_DCHECK(num_indices_ * sizeof(uint32_t) + index_buffer_offset_ <=
+  FTL_DCHECK(index_type_ == vk::IndexType::eUint32 ||
+             num_vertices_ <= MeshSpec::kMaxVertexCountForUint16Indices);
+  FTL_DCHECK(num_indices_ * index_size() + index_buffer_offset_ <=
              index_buffer_->size());
 }
 
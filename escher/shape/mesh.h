@@ -27,8 +27,11 @@ class Mesh : public WaitableResource {
        uint32_t num_indices,
        BufferPtr vertex_buffer,
        BufferPtr index_buffer,
+       vk::IndexType index_type = vk::IndexType::eUint32,
        vk::DeviceSize vertex_buffer_offset = 0,
-       vk::DeviceSize index_buffer_offset = 0);
+       vk::DeviceSize index_buffer_offset = 0,
+       vec2 position_scale = vec2(1.f, 1.f),
+       vec2 position_bias = vec2(0.f, 0.f));
 
   ~Mesh() override;
 
@@ -40,9 +43,19 @@ class Mesh : public WaitableResource {
   vk::Buffer vk_index_buffer() const { return vk_index_buffer_; }
   const BufferPtr& vertex_buffer() const { return vertex_buffer_; }
   const BufferPtr& index_buffer() const { return index_buffer_; }
+  // Meshes with few enough vertices use 16-bit indices; see
+  // MeshSpec::GetIndexType().
+  vk::IndexType index_type() const { return index_type_; }
+  size_t index_size() const { return MeshSpec::GetIndexSize(index_type_); }
   vk::DeviceSize vertex_buffer_offset() const { return vertex_buffer_offset_; }
   vk::DeviceSize index_buffer_offset() const { return index_buffer_offset_; }
 
+  // If the spec has encoded positions (see MeshSpec::HasEncodedPositions()),
+  // the original positions are "encoded * position_scale + position_bias",
+  // and the original position offsets are "encoded * position_scale".
+  const vec2& position_scale() const { return position_scale_; }
+  const vec2& position_bias() const { return position_bias_; }
+
  private:
   const MeshSpec spec_;
   const BoundingBox bounding_box_;
@@ -52,8 +65,11 @@ class Mesh : public WaitableResource {
   const vk::Buffer vk_index_buffer_;
   const BufferPtr vertex_buffer_;
   const BufferPtr index_buffer_;
+  const vk::IndexType index_type_;
   const vk::DeviceSize vertex_buffer_offset_;
   const vk::DeviceSize index_buffer_offset_;
+  const vec2 position_scale_;
+  const vec2 position_bias_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(Mesh);
 };
@@ -4,21 +4,275 @@
 
 #include "escher/shape/mesh_builder.h"
 
+#include <algorithm>
+#include <vector>
+
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+
 #include "escher/escher.h"
+#include "escher/util/trace_macros.h"
 
 namespace escher {
 
-MeshBuilder::MeshBuilder(size_t max_vertex_count,
+namespace {
+
+// Storage format of a single attribute, as selected by MeshAttributeEncoding.
+enum class AttributeFormat { kFloat32, kHalfFloat, kSnorm16, kUnorm16 };
+
+// Write |v| to |dst| in the specified format.  Packed components are stored in
+// memory in the order expected by the corresponding R16G16 Vulkan formats.
+void EncodeVec2(const vec2& v, AttributeFormat format, uint8_t* dst) {
+  uint32_t packed = 0;
+  switch (format) {
+    case AttributeFormat::kFloat32:
+      memcpy(dst, &v, sizeof(vec2));
+      return;
+    case AttributeFormat::kHalfFloat:
+      packed = glm::packHalf2x16(v);
+      break;
+    case AttributeFormat::kSnorm16:
+      packed = glm::packSnorm2x16(v);
+      break;
+    case AttributeFormat::kUnorm16:
+      packed = glm::packUnorm2x16(v);
+      break;
+  }
+  memcpy(dst, &packed, sizeof(packed));
+}
+
+AttributeFormat GetAttributeFormat(const MeshSpec& spec,
+                                   MeshAttributeEncoding half_float,
+                                   MeshAttributeEncoding snorm16) {
+  if (spec.encodings & half_float) {
+    return AttributeFormat::kHalfFloat;
+  } else if (spec.encodings & snorm16) {
+    return AttributeFormat::kSnorm16;
+  }
+  return AttributeFormat::kFloat32;
+}
+
+}  // namespace
+
+MeshBuilder::MeshBuilder(const MeshSpec& spec,
+                         size_t max_vertex_count,
                          size_t max_index_count,
-                         size_t vertex_stride,
                          uint8_t* vertex_staging_buffer,
-                         uint32_t* index_staging_buffer)
-    : max_vertex_count_(max_vertex_count),
+                         uint8_t* index_staging_buffer)
+    : spec_(spec),
+      max_vertex_count_(max_vertex_count),
       max_index_count_(max_index_count),
-      vertex_stride_(vertex_stride),
+      vertex_stride_(spec.GetDecodedSpec().GetStride()),
       vertex_staging_buffer_(vertex_staging_buffer),
-      index_staging_buffer_(index_staging_buffer) {}
+      index_staging_buffer_(index_staging_buffer),
+      index_type_(MeshSpec::GetIndexType(max_vertex_count)),
+      decoded_vertices_(
+          spec.encodings
+              ? std::make_unique<uint8_t[]>(max_vertex_count * vertex_stride_)
+              : nullptr),
+      vertex_data_(decoded_vertices_ ? decoded_vertices_.get()
+                                     : vertex_staging_buffer_) {}
 
 MeshBuilder::~MeshBuilder() {}
 
+BoundingBox MeshBuilder::ComputeBoundingBox() const {
+  FTL_DCHECK(vertex_count_ > 0);
+  // This method will need adjustments when we support 3D vertices.
+  uint8_t* vertex_ptr = vertex_data_;
+
+  vec2* pos = reinterpret_cast<vec2*>(vertex_ptr);
+  vec3 min(*pos, 0);
+  vec3 max(*pos, 0);
+
+  for (size_t i = 1; i < vertex_count_; ++i) {
+    vertex_ptr += vertex_stride_;
+    pos = reinterpret_cast<vec2*>(vertex_ptr);
+    min = glm::min(min, vec3(*pos, 0));
+    max = glm::max(max, vec3(*pos, 0));
+  }
+
+  return BoundingBox(min, max);
+}
+
+void MeshBuilder::OptimizeVertexOrder(VertexCacheStats* stats) {
+  if (index_count_ < 3 || vertex_count_ == 0) {
+    return;
+  }
+  TRACE_DURATION("gfx", "escher::MeshBuilder::OptimizeVertexOrder",
+                 "vertex_count", vertex_count_, "index_count", index_count_);
+
+  // The optimizer works on 32-bit indices.
+  std::vector<uint32_t> indices(index_count_);
+  if (index_type_ == vk::IndexType::eUint16) {
+    const uint16_t* src =
+        reinterpret_cast<const uint16_t*>(index_staging_buffer_);
+    std::copy(src, src + index_count_, indices.begin());
+  } else {
+    memcpy(indices.data(), index_staging_buffer_,
+           index_count_ * sizeof(uint32_t));
+  }
+
+  const size_t misses_before =
+      CountVertexCacheMisses(indices.data(), index_count_, vertex_count_);
+  OptimizeVertexCacheOrder(indices.data(), index_count_, vertex_count_);
+  OptimizeVertexFetchOrder(vertex_data_, vertex_stride_, vertex_count_,
+                           indices.data(), index_count_);
+  if (stats) {
+    stats->triangle_count += index_count_ / 3;
+    stats->misses_before += misses_before;
+    stats->misses_after +=
+        CountVertexCacheMisses(indices.data(), index_count_, vertex_count_);
+  }
+
+  if (index_type_ == vk::IndexType::eUint16) {
+    uint16_t* dst = reinterpret_cast<uint16_t*>(index_staging_buffer_);
+    std::transform(indices.begin(), indices.end(), dst,
+                   [](uint32_t index) { return static_cast<uint16_t>(index); });
+  } else {
+    memcpy(index_staging_buffer_, indices.data(),
+           index_count_ * sizeof(uint32_t));
+  }
+}
+
+void MeshBuilder::CompactIndices() {
+  if (index_type_ == vk::IndexType::eUint16 ||
+      MeshSpec::GetIndexType(vertex_count_) != vk::IndexType::eUint16) {
+    return;
+  }
+  // Each 16-bit index is written at or before the position of the 32-bit index
+  // that it replaces, so it never overwrites an index that hasn't been read.
+  for (size_t i = 0; i < index_count_; ++i) {
+    uint32_t index;
+    memcpy(&index, index_staging_buffer_ + i * sizeof(uint32_t),
+           sizeof(uint32_t));
+    const uint16_t narrowed = static_cast<uint16_t>(index);
+    memcpy(index_staging_buffer_ + i * sizeof(uint16_t), &narrowed,
+           sizeof(uint16_t));
+  }
+  index_type_ = vk::IndexType::eUint16;
+}
+
+void MeshBuilder::EncodeVertices(vec2* position_scale_out,
+                                 vec2* position_bias_out) {
+  vec2 scale(1.f, 1.f);
+  vec2 bias(0.f, 0.f);
+  if (!spec_.encodings || vertex_count_ == 0) {
+    *position_scale_out = scale;
+    *position_bias_out = bias;
+    return;
+  }
+  TRACE_DURATION("gfx", "escher::MeshBuilder::EncodeVertices", "vertex_count",
+                 vertex_count_);
+
+  const MeshSpec decoded_spec = spec_.GetDecodedSpec();
+  const bool has_position = bool(spec_.flags & MeshAttribute::kPosition);
+  const bool has_position_offset =
+      bool(spec_.flags & MeshAttribute::kPositionOffset);
+  const bool has_uv = bool(spec_.flags & MeshAttribute::kUV);
+  const bool has_perimeter_pos =
+      bool(spec_.flags & MeshAttribute::kPerimeterPos);
+  const bool has_color = bool(spec_.flags & MeshAttribute::kColor);
+
+  // Map the positions to the range [-1, 1]; the normalized encodings require
+  // this, and it maximizes the precision of the half-float encodings.  Offsets
+  // share the scale, so that the scale can be applied after they are added to
+  // the positions.
+  if (spec_.HasEncodedPositions()) {
+    FTL_DCHECK(has_position);
+    BoundingBox box = ComputeBoundingBox();
+    vec2 min(box.min());
+    vec2 max(box.max());
+    bias = (min + max) * 0.5f;
+    scale = (max - min) * 0.5f;
+    if (has_position_offset) {
+      const size_t offset =
+          decoded_spec.GetAttributeOffset(MeshAttribute::kPositionOffset);
+      for (size_t i = 0; i < vertex_count_; ++i) {
+        const vec2& pos_offset = *reinterpret_cast<const vec2*>(
+            vertex_data_ + i * vertex_stride_ + offset);
+        scale = glm::max(scale, glm::abs(pos_offset));
+      }
+    }
+    // Avoid dividing by zero if all positions lie on a horizontal or vertical
+    // line.
+    scale.x = scale.x > 0.f ? scale.x : 1.f;
+    scale.y = scale.y > 0.f ? scale.y : 1.f;
+  }
+  const vec2 inverse_scale = 1.f / scale;
+
+  const AttributeFormat position_format =
+      GetAttributeFormat(spec_, MeshAttributeEncoding::kPositionHalfFloat,
+                         MeshAttributeEncoding::kPositionSnorm16);
+  const AttributeFormat position_offset_format =
+      GetAttributeFormat(spec_, MeshAttributeEncoding::kPositionOffsetHalfFloat,
+                         MeshAttributeEncoding::kPositionOffsetSnorm16);
+  const AttributeFormat uv_format =
+      spec_.encodings & MeshAttributeEncoding::kUVUnorm16
+          ? AttributeFormat::kUnorm16
+          : AttributeFormat::kFloat32;
+  const bool encode_perimeter_pos =
+      bool(spec_.encodings & MeshAttributeEncoding::kPerimeterPosUnorm16);
+
+  // Look up the offsets once, rather than once per vertex.
+  auto src_offset = [&decoded_spec](bool has_attribute, MeshAttribute attr) {
+    return has_attribute ? decoded_spec.GetAttributeOffset(attr) : 0;
+  };
+  auto dst_offset = [this](bool has_attribute, MeshAttribute attr) {
+    return has_attribute ? spec_.GetAttributeOffset(attr) : 0;
+  };
+  const size_t src_position =
+      src_offset(has_position, MeshAttribute::kPosition);
+  const size_t dst_position =
+      dst_offset(has_position, MeshAttribute::kPosition);
+  const size_t src_position_offset =
+      src_offset(has_position_offset, MeshAttribute::kPositionOffset);
+  const size_t dst_position_offset =
+      dst_offset(has_position_offset, MeshAttribute::kPositionOffset);
+  const size_t src_uv = src_offset(has_uv, MeshAttribute::kUV);
+  const size_t dst_uv = dst_offset(has_uv, MeshAttribute::kUV);
+  const size_t src_perimeter_pos =
+      src_offset(has_perimeter_pos, MeshAttribute::kPerimeterPos);
+  const size_t dst_perimeter_pos =
+      dst_offset(has_perimeter_pos, MeshAttribute::kPerimeterPos);
+  const size_t src_color = src_offset(has_color, MeshAttribute::kColor);
+  const size_t dst_color = dst_offset(has_color, MeshAttribute::kColor);
+  const size_t dst_stride = spec_.GetStride();
+
+  for (size_t i = 0; i < vertex_count_; ++i) {
+    const uint8_t* src = vertex_data_ + i * vertex_stride_;
+    uint8_t* dst = vertex_staging_buffer_ + i * dst_stride;
+    if (has_position) {
+      const vec2& pos = *reinterpret_cast<const vec2*>(src + src_position);
+      EncodeVec2((pos - bias) * inverse_scale, position_format,
+                 dst + dst_position);
+    }
+    if (has_position_offset) {
+      const vec2& pos_offset =
+          *reinterpret_cast<const vec2*>(src + src_position_offset);
+      EncodeVec2(pos_offset * inverse_scale, position_offset_format,
+                 dst + dst_position_offset);
+    }
+    if (has_uv) {
+      EncodeVec2(*reinterpret_cast<const vec2*>(src + src_uv), uv_format,
+                 dst + dst_uv);
+    }
+    if (has_perimeter_pos) {
+      const float perimeter_pos =
+          *reinterpret_cast<const float*>(src + src_perimeter_pos);
+      if (encode_perimeter_pos) {
+        uint16_t packed = glm::packUnorm1x16(perimeter_pos);
+        memcpy(dst + dst_perimeter_pos, &packed, sizeof(packed));
+      } else {
+        memcpy(dst + dst_perimeter_pos, &perimeter_pos, sizeof(float));
+      }
+    }
+    if (has_color) {
+      memcpy(dst + dst_color, src + src_color, sizeof(vec4));
+    }
+  }
+
+  *position_scale_out = scale;
+  *position_bias_out = bias;
+}
+
 }  // namespace escher
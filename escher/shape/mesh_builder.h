@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <memory>
+
+#include "escher/geometry/mesh_optimizer.h"
 #include "escher/shape/mesh.h"
 #include "ftl/memory/ref_counted.h"
 
@@ -20,37 +23,85 @@ class MeshBuilder : public ftl::RefCountedThreadSafe<MeshBuilder> {
   virtual MeshPtr Build() = 0;
 
   // Copy the index into the staging buffer, so that it will be uploaded to the
-  // GPU when Build() is called.
+  // GPU when Build() is called.  The index is stored as 16 bits if the builder
+  // uses 16-bit indices; see index_type().
   MeshBuilder& AddIndex(uint32_t index);
 
   // Copy |size| bytes of data to the staging buffer; this data represents a
-  // single vertex.
+  // single vertex.  All attributes are 32-bit floats, even if the MeshSpec
+  // specifies a compact encoding; see MeshSpec::GetDecodedSpec().
   MeshBuilder& AddVertexData(const void* ptr, size_t size);
 
   // Wrap AddVertexData() to automatically obtain the size from the vertex.
   template <typename VertexT>
   MeshBuilder& AddVertex(const VertexT& v);
 
-  // Return the size of a vertex for the given mesh-spec.
+  // Return the size of a vertex passed to AddVertexData(), for the given
+  // mesh-spec.
   size_t vertex_stride() const { return vertex_stride_; }
 
+  const MeshSpec& spec() const { return spec_; }
+
+  // The type of the indices in the staging buffer.  This is initially chosen
+  // from the maximum vertex count, and may be narrowed by CompactIndices().
+  vk::IndexType index_type() const { return index_type_; }
+  size_t index_size() const { return MeshSpec::GetIndexSize(index_type_); }
+
  protected:
-  MeshBuilder(size_t max_vertex_count,
+  // |vertex_staging_buffer| must have room for |max_vertex_count| vertices
+  // with the stride of |spec|, which is smaller than vertex_stride() if |spec|
+  // has compact encodings.  |index_staging_buffer| must have room for
+  // |max_index_count| indices of the type returned by
+  // MeshSpec::GetIndexType(max_vertex_count).
+  MeshBuilder(const MeshSpec& spec,
+              size_t max_vertex_count,
               size_t max_index_count,
-              size_t vertex_stride,
               uint8_t* vertex_staging_buffer,
-              uint32_t* index_staging_buffer);
+              uint8_t* index_staging_buffer);
   FRIEND_REF_COUNTED_THREAD_SAFE(MeshBuilder);
   virtual ~MeshBuilder();
 
+  // Compute the bounding box of the vertices that have been added.  Each
+  // vertex must begin with a vec2 position (see MeshAttribute::kPosition).
+  BoundingBox ComputeBoundingBox() const;
+
+  // Reorder the triangles that have been added for post-transform vertex cache
+  // locality, and then the vertices for fetch locality (see
+  // mesh_optimizer.h).  The resulting Mesh renders identically.  If non-null,
+  // |stats| accumulates the vertex cache miss counts before and after.  Must
+  // be called before EncodeVertices() and CompactIndices().
+  void OptimizeVertexOrder(VertexCacheStats* stats);
+
+  // Must be called by Build() before uploading the staging buffer.  If the
+  // spec has compact encodings, encode the vertices that have been added into
+  // the staging buffer; otherwise, this is a no-op because they were added
+  // there directly.  Return the scale and bias that must be passed to the
+  // Mesh, to decode its positions.
+  void EncodeVertices(vec2* position_scale_out, vec2* position_bias_out);
+
+  // Should be called by Build() before uploading the staging buffer.  If
+  // 32-bit indices were chosen because of a large maximum vertex count, but
+  // few enough vertices were actually added, convert the indices to 16 bits
+  // in place.
+  void CompactIndices();
+
+  const MeshSpec spec_;
   const size_t max_vertex_count_;
   const size_t max_index_count_;
   const size_t vertex_stride_;
   uint8_t* vertex_staging_buffer_;
-  uint32_t* index_staging_buffer_;
+  uint8_t* index_staging_buffer_;
+  vk::IndexType index_type_;
   size_t vertex_count_ = 0;
   size_t index_count_ = 0;
 
+ private:
+  // Vertices are added here instead of to |vertex_staging_buffer_| if they
+  // must be encoded before they are uploaded.
+  std::unique_ptr<uint8_t[]> decoded_vertices_;
+  // Either |vertex_staging_buffer_| or |decoded_vertices_|.
+  uint8_t* vertex_data_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(MeshBuilder);
 };
 
@@ -60,7 +111,13 @@ typedef ftl::RefPtr<MeshBuilder> MeshBuilderPtr;
 
 inline MeshBuilder& MeshBuilder::AddIndex(uint32_t index) {
   FTL_DCHECK(index_count_ < max_index_count_);
-  index_staging_buffer_[index_count_++] = index;
+  FTL_DCHECK(index < max_vertex_count_);
+  if (index_type_ == vk::IndexType::eUint16) {
+    reinterpret_cast<uint16_t*>(index_staging_buffer_)[index_count_++] =
+        static_cast<uint16_t>(index);
+  } else {
+    reinterpret_cast<uint32_t*>(index_staging_buffer_)[index_count_++] = index;
+  }
   return *this;
 }
 
@@ -68,7 +125,7 @@ inline MeshBuilder& MeshBuilder::AddVertexData(const void* ptr, size_t size) {
   FTL_DCHECK(vertex_count_ < max_vertex_count_);
   FTL_DCHECK(size <= vertex_stride_);
   size_t offset = vertex_stride_ * vertex_count_++;
-  memcpy(vertex_staging_buffer_ + offset, ptr, size);
+  memcpy(vertex_data_ + offset, ptr, size);
   return *this;
 }
 
@@ -0,0 +1,35 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/mesh_lod.h"
+
+#include <cmath>
+
+namespace escher {
+
+float GetMaxCircleScreenDiameter(size_t segment_count) {
+  FTL_DCHECK(segment_count >= 3);
+  // The largest deviation occurs at the midpoint of each segment, where it is
+  // r * (1 - cos(pi / segment_count)).
+  const float max_radius =
+      kMaxLodErrorPixels / (1.f - std::cos(float(M_PI) / segment_count));
+  return 2.f * max_radius;
+}
+
+MeshLod::MeshLod(float hysteresis) : selector_(hysteresis) {}
+
+MeshLod::~MeshLod() {}
+
+void MeshLod::AddLevel(MeshPtr mesh, float min_screen_size) {
+  FTL_DCHECK(mesh);
+  FTL_DCHECK(meshes_.empty() || meshes_[0]->spec() == mesh->spec());
+  selector_.AddLevel(min_screen_size);
+  meshes_.push_back(std::move(mesh));
+}
+
+const MeshPtr& MeshLod::SelectMesh(float screen_size) {
+  return meshes_[selector_.SelectLevel(screen_size)];
+}
+
+}  // namespace escher
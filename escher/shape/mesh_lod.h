@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+
+#include "escher/forward_declarations.h"
+#include "escher/shape/lod_selector.h"
+#include "escher/shape/mesh.h"
+#include "ftl/memory/ref_counted.h"
+
+namespace escher {
+
+// Maximum distance in pixels between a tessellated curve and the true curve,
+// used to choose the thresholds of generated levels of detail.
+constexpr float kMaxLodErrorPixels = 0.25f;
+
+// Return the largest on-screen diameter, in pixels, at which a circle
+// approximated by a regular polygon with |segment_count| sides deviates from
+// the true circle by no more than kMaxLodErrorPixels.
+float GetMaxCircleScreenDiameter(size_t segment_count);
+
+// A set of tessellations of the same shape at increasing levels of detail.
+// When an Object's shape refers to a MeshLod, ModelDisplayListBuilder chooses
+// one of the meshes each frame, from the size of the object on screen; see
+// LodSelector.
+//
+// The hysteresis state is stored in the MeshLod, so objects that are drawn at
+// different sizes should each have their own MeshLod, although these may share
+// the same meshes.
+//
+// Not thread-safe.
+class MeshLod : public ftl::RefCountedThreadSafe<MeshLod> {
+ public:
+  explicit MeshLod(float hysteresis = LodSelector::kDefaultHysteresis);
+
+  // Add the next-finer level of detail; see LodSelector::AddLevel().  All
+  // meshes must have the same MeshSpec, and approximately the same bounds.
+  void AddLevel(MeshPtr mesh, float min_screen_size);
+
+  // Return the mesh to use for an object that is |screen_size| pixels across.
+  const MeshPtr& SelectMesh(float screen_size);
+
+  size_t level_count() const { return meshes_.size(); }
+  const MeshPtr& mesh(size_t level) const { return meshes_[level]; }
+  const MeshPtr& finest_mesh() const { return meshes_.back(); }
+  size_t selected_level() const { return selector_.selected_level(); }
+
+ private:
+  FRIEND_REF_COUNTED_THREAD_SAFE(MeshLod);
+  ~MeshLod();
+
+  std::vector<MeshPtr> meshes_;
+  LodSelector selector_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MeshLod);
+};
+
+typedef ftl::RefPtr<MeshLod> MeshLodPtr;
+
+}  // namespace escher
@@ -5,6 +5,7 @@
 #include "escher/shape/mesh_spec.h"
 
 #include "escher/geometry/types.h"
+#include "escher/util/align.h"
 #include "lib/ftl/logging.h"
 
 namespace escher {
@@ -19,38 +20,66 @@ size_t GetMeshAttributeSize(MeshAttribute attr) {
       return sizeof(vec2);
     case MeshAttribute::kPerimeterPos:
       return sizeof(float);
+    case MeshAttribute::kColor:
+      return sizeof(vec4);
     case MeshAttribute::kStride:
       FTL_CHECK(false);
       return 0;
   }
 }
 
+size_t MeshSpec::GetAttributeSize(MeshAttribute flag) const {
+  FTL_DCHECK(flags & flag);
+  switch (flag) {
+    case MeshAttribute::kPosition:
+      FTL_DCHECK(!(encodings & MeshAttributeEncoding::kPositionHalfFloat) ||
+                 !(encodings & MeshAttributeEncoding::kPositionSnorm16));
+      if (encodings & (MeshAttributeEncoding::kPositionHalfFloat |
+                       MeshAttributeEncoding::kPositionSnorm16)) {
+        return 2 * sizeof(uint16_t);
+      }
+      break;
+    case MeshAttribute::kPositionOffset:
+      FTL_DCHECK(
+          !(encodings & MeshAttributeEncoding::kPositionOffsetHalfFloat) ||
+          !(encodings & MeshAttributeEncoding::kPositionOffsetSnorm16));
+      if (encodings & (MeshAttributeEncoding::kPositionOffsetHalfFloat |
+                       MeshAttributeEncoding::kPositionOffsetSnorm16)) {
+        return 2 * sizeof(uint16_t);
+      }
+      break;
+    case MeshAttribute::kUV:
+      if (encodings & MeshAttributeEncoding::kUVUnorm16) {
+        return 2 * sizeof(uint16_t);
+      }
+      break;
+    case MeshAttribute::kPerimeterPos:
+      if (encodings & MeshAttributeEncoding::kPerimeterPosUnorm16) {
+        return sizeof(uint16_t);
+      }
+      break;
+    case MeshAttribute::kColor:
+    case MeshAttribute::kStride:
+      break;
+  }
+  return GetMeshAttributeSize(flag);
+}
+
 size_t MeshSpec::GetAttributeOffset(MeshAttribute flag) const {
   FTL_DCHECK(flags & flag || flag == MeshAttribute::kStride);
   size_t offset = 0;
 
-  if (flag == MeshAttribute::kPosition) {
-    return offset;
-  } else if (flags & MeshAttribute::kPosition) {
-    offset += sizeof(vec2);
-  }
-
-  if (flag == MeshAttribute::kPositionOffset) {
-    return offset;
-  } else if (flags & MeshAttribute::kPositionOffset) {
-    offset += sizeof(vec2);
-  }
-
-  if (flag == MeshAttribute::kUV) {
-    return offset;
-  } else if (flags & MeshAttribute::kUV) {
-    offset += sizeof(vec2);
-  }
-
-  if (flag == MeshAttribute::kPerimeterPos) {
-    return offset;
-  } else if (flags & MeshAttribute::kPerimeterPos) {
-    offset += sizeof(float);
+  // Attributes are listed in the order that they appear within a vertex.
+  const MeshAttribute kAttributes[] = {
+      MeshAttribute::kPosition, MeshAttribute::kPositionOffset,
+      MeshAttribute::kUV, MeshAttribute::kPerimeterPos, MeshAttribute::kColor};
+  for (MeshAttribute attribute : kAttributes) {
+    if (flag == attribute) {
+      return offset;
+    } else if (flags & attribute) {
+      // Only kPerimeterPos may have a size that is not a multiple of 4.
+      offset = AlignedToNext(offset + GetAttributeSize(attribute), 4);
+    }
   }
 
   FTL_DCHECK(flag == MeshAttribute::kStride);
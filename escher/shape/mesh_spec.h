@@ -26,6 +26,9 @@ enum class MeshAttribute {
   kPerimeterPos = 1 << 3,
   // Pseudo-attribute, used to obtain the vertex stride for the mesh.
   kStride = 1 << 4,
+  // vec4.  Per-vertex color, which is multiplied with the material color.  Used
+  // by meshes that merge objects with different materials (see StaticBatch).
+  kColor = 1 << 5,
 };
 
 using MeshAttributes = vk::Flags<MeshAttribute, uint32_t>;
@@ -38,31 +41,96 @@ inline MeshAttributes operator|(MeshAttribute bit0, MeshAttribute bit1) {
 // (e.g. kPosition == sizeof(vec2)).
 size_t GetMeshAttributeSize(MeshAttribute attr);
 
+// Compact encodings that a MeshSpec may select for some of its attributes, in
+// order to reduce vertex bandwidth.  Attributes without an encoding are stored
+// as 32-bit floats, as documented above.  Regardless of the encoding, vertices
+// are always passed to MeshBuilder with 32-bit float attributes; the builder
+// encodes them before uploading them to the GPU.
+enum class MeshAttributeEncoding {
+  // kPosition as R16G16_SFLOAT, relative to the mesh's position scale and bias.
+  kPositionHalfFloat = 1,
+  // kPosition as R16G16_SNORM, relative to the mesh's position scale and bias.
+  kPositionSnorm16 = 1 << 1,
+  // kPositionOffset as R16G16_SFLOAT, relative to the mesh's position scale.
+  kPositionOffsetHalfFloat = 1 << 2,
+  // kPositionOffset as R16G16_SNORM, relative to the mesh's position scale.
+  kPositionOffsetSnorm16 = 1 << 3,
+  // kUV as R16G16_UNORM.  Coordinates are clamped to the range 0 - 1.
+  kUVUnorm16 = 1 << 4,
+  // kPerimeterPos as R16_UNORM.
+  kPerimeterPosUnorm16 = 1 << 5,
+};
+
+using MeshAttributeEncodings = vk::Flags<MeshAttributeEncoding, uint32_t>;
+
+inline MeshAttributeEncodings operator|(MeshAttributeEncoding bit0,
+                                        MeshAttributeEncoding bit1) {
+  return MeshAttributeEncodings(bit0) | bit1;
+}
+
 struct MeshSpec {
   MeshAttributes flags;
+  MeshAttributeEncodings encodings;
 
   struct Hash {
     std::size_t operator()(const MeshSpec& spec) const {
-      return static_cast<std::uint32_t>(spec.flags);
+      return static_cast<std::uint32_t>(spec.flags) |
+             (static_cast<std::uint32_t>(spec.encodings) << 16);
     }
   };
 
+  // Return the size of the attribute within a vertex, taking its encoding into
+  // account.
+  size_t GetAttributeSize(MeshAttribute flag) const;
+
+  // Offsets and stride take the encodings into account.  Each attribute is
+  // aligned to 4 bytes.
   size_t GetAttributeOffset(MeshAttribute flag) const;
   size_t GetStride() const {
     return GetAttributeOffset(MeshAttribute::kStride);
   }
 
-  static constexpr size_t kIndexSize = sizeof(uint32_t);
+  // Return a spec with the same attributes, but no encodings.  This describes
+  // the layout of the vertices that are passed to MeshBuilder.
+  MeshSpec GetDecodedSpec() const { return MeshSpec{flags}; }
+
+  // Return true if the positions and/or position offsets must be transformed
+  // by the mesh's position scale and bias (see Mesh::position_scale()).
+  bool HasEncodedPositions() const {
+    return bool(encodings &
+                (MeshAttributeEncoding::kPositionHalfFloat |
+                 MeshAttributeEncoding::kPositionSnorm16 |
+                 MeshAttributeEncoding::kPositionOffsetHalfFloat |
+                 MeshAttributeEncoding::kPositionOffsetSnorm16));
+  }
+
+  // Meshes with at most this many vertices use 16-bit indices.
+  static constexpr size_t kMaxVertexCountForUint16Indices = 1 << 16;
+
+  // Return the smallest index type that can address |vertex_count| vertices.
+  static vk::IndexType GetIndexType(size_t vertex_count) {
+    return vertex_count <= kMaxVertexCountForUint16Indices
+               ? vk::IndexType::eUint16
+               : vk::IndexType::eUint32;
+  }
+
+  // Return the size in bytes of a single index of the specified type.
+  static size_t GetIndexSize(vk::IndexType index_type) {
+    return index_type == vk::IndexType::eUint16 ? sizeof(uint16_t)
+                                                : sizeof(uint32_t);
+  }
 };
 
 // Inline function definitions.
 
 inline bool operator==(const MeshSpec& spec1, const MeshSpec& spec2) {
-  return spec1.flags == spec2.flags;
+  return spec1.flags == spec2.flags && spec1.encodings == spec2.encodings;
 }
 
 // Debugging.
 std::ostream& operator<<(std::ostream& str, const MeshAttribute& attr);
+std::ostream& operator<<(std::ostream& str,
+                         const MeshAttributeEncoding& encoding);
 std::ostream& operator<<(std::ostream& str, const MeshSpec& spec);
 
 }  // namespace escher
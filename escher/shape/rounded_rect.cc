@@ -4,7 +4,12 @@
 
 #include "escher/shape/rounded_rect.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "escher/geometry/types.h"
+#include "escher/shape/mesh_lod.h"
 #include "escher/shape/mesh_spec.h"
 #include "ftl/logging.h"
 
@@ -12,22 +17,20 @@ namespace escher {
 
 namespace {
 
-// Number of times that the quarter-circle that makes up each corner is
-// sub-divided.  For example, if this is zero, then the corner consists of
-// a single right-angled triangle.
-constexpr uint32_t kCornerDivisions = 8;
-
 // The central "square" consists of 4 vertices connected to their neighbors, and
 // to a central vertex.  The 4 arms of the "cross" each share 2 vertices with
-// the central square, and add 2 more.  Each corner adds kCornerDivisions more.
-constexpr uint32_t kVertexCount = 1 + 4 + (4 * 2) + 4 * kCornerDivisions;
+// the central square, and add 2 more.  Each corner adds |corner_divisions|
+// more.
+uint32_t GetVertexCount(uint32_t corner_divisions) {
+  return 1 + 4 + (4 * 2) + 4 * corner_divisions;
+}
 
 // The central "square" consists of 4 triangles, and the 4 arms of the "cross"
-// each have 2.
-constexpr uint32_t kTriangleCount = 4 + (4 * 2) + 4 * (kCornerDivisions + 1);
-
-// Triangles have 3 indices.
-constexpr uint32_t kIndexCount = kTriangleCount * 3;
+// each have 2.  Triangles have 3 indices.
+uint32_t GetIndexCount(uint32_t corner_divisions) {
+  const uint32_t triangle_count = 4 + (4 * 2) + 4 * (corner_divisions + 1);
+  return triangle_count * 3;
+}
 
 // Vertex format used when tessellating a RoundedRectSpec (for now, only a
 // single format is supported).
@@ -36,6 +39,78 @@ struct PosUvVertex {
   vec2 uv;
 };
 
+// Vertex format of the canonical rounded-rect mesh; see
+// DeformUnitRoundedRectVertex().
+struct UnitVertex {
+  vec2 corner_sign;
+  vec2 corner_direction;
+};
+
+constexpr float kPI = 3.14159265f;
+
+// Corner arcs with up to this many divisions are tabulated by GetCornerArc().
+constexpr uint32_t kMaxTabulatedCornerDivisions = 16;
+
+// Return the directions from the corner center to the interior vertices of
+// the bottom-right corner's arc, which sweeps clockwise from (1,0) to (0,1).
+// The other corners' arcs are rotations of this one.
+std::vector<vec2> ComputeCornerArc(uint32_t corner_divisions) {
+  std::vector<vec2> arc(corner_divisions);
+  const float angle_step = kPI / 2 / (corner_divisions + 1);
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    const float angle = (i + 1) * angle_step;
+    arc[i] = vec2(std::cos(angle), std::sin(angle));
+  }
+  return arc;
+}
+
+// Sine/cosine tables for every corner division count that is likely to be
+// used, so that tessellating a rounded-rect requires no trigonometry.
+class CornerArcTables {
+ public:
+  CornerArcTables() {
+    for (uint32_t i = 0; i <= kMaxTabulatedCornerDivisions; ++i) {
+      arcs_[i] = ComputeCornerArc(i);
+    }
+  }
+
+  const vec2* Get(uint32_t corner_divisions) const {
+    return arcs_[corner_divisions].data();
+  }
+
+ private:
+  std::vector<vec2> arcs_[kMaxTabulatedCornerDivisions + 1];
+};
+
+// Return the arc computed by ComputeCornerArc().  The result is usually
+// tabulated; otherwise it is computed into |storage|, which must outlive the
+// returned pointer.
+const vec2* GetCornerArc(uint32_t corner_divisions,
+                         std::vector<vec2>* storage) {
+  if (corner_divisions <= kMaxTabulatedCornerDivisions) {
+    static const CornerArcTables tables;
+    return tables.Get(corner_divisions);
+  }
+  *storage = ComputeCornerArc(corner_divisions);
+  return storage->data();
+}
+
+// Radii are in clockwise order, starting from top-left.
+float GetCornerRadius(const RoundedRectSpec& spec, vec2 corner_sign) {
+  if (corner_sign.y < 0.f) {
+    return corner_sign.x < 0.f ? spec.top_left_radius : spec.top_right_radius;
+  } else {
+    return corner_sign.x > 0.f ? spec.bottom_right_radius
+                               : spec.bottom_left_radius;
+  }
+}
+
+vec2 GetCornerCenter(const RoundedRectSpec& spec, vec2 corner_sign) {
+  const float radius = GetCornerRadius(spec, corner_sign);
+  return corner_sign *
+         (0.5f * vec2(spec.width, spec.height) - vec2(radius, radius));
+}
+
 }  // anonymous namespace
 
 RoundedRectSpec::RoundedRectSpec(float width,
@@ -51,20 +126,38 @@ RoundedRectSpec::RoundedRectSpec(float width,
       bottom_right_radius(bottom_right_radius),
       bottom_left_radius(bottom_left_radius) {}
 
+size_t GetRoundedRectCornerDivisionTier(float radius_pixels) {
+  // Each corner is a quarter of a regular polygon with 4 * (divisions + 1)
+  // sides.
+  size_t tier = 0;
+  while (tier + 1 < kRoundedRectCornerDivisionTierCount &&
+         2.f * radius_pixels >
+             GetMaxCircleScreenDiameter(
+                 4 * (kRoundedRectCornerDivisionTiers[tier] + 1))) {
+    ++tier;
+  }
+  return tier;
+}
+
 // Return the number of vertices and indices that are required to tessellate the
 // specified rounded-rect.
 std::pair<uint32_t, uint32_t> GetRoundedRectMeshVertexAndIndexCounts(
-    const RoundedRectSpec& spec) {
-  return std::make_pair(kVertexCount, kIndexCount);
+    const RoundedRectSpec& spec,
+    uint32_t corner_divisions) {
+  // Indices are 16-bit.
+  FTL_DCHECK(GetVertexCount(corner_divisions) <=
+             MeshSpec::kMaxVertexCountForUint16Indices);
+  return std::make_pair(GetVertexCount(corner_divisions),
+                        GetIndexCount(corner_divisions));
 }
 
 // See escher/shape/doc/RoundedRectTessellation.JPG.
-void GenerateRoundedRectIndices(const RoundedRectSpec& spec,
-                                const MeshSpec& mesh_spec,
-                                void* indices_out,
-                                uint32_t max_bytes) {
-  FTL_DCHECK(max_bytes == kIndexCount * sizeof(uint32_t));
-  uint32_t* indices = static_cast<uint32_t*>(indices_out);
+void GenerateRoundedRectIndices(void* indices_out,
+                                uint32_t max_bytes,
+                                uint32_t corner_divisions) {
+  const uint32_t index_count = GetIndexCount(corner_divisions);
+  FTL_DCHECK(max_bytes == index_count * sizeof(uint16_t));
+  uint16_t* indices = static_cast<uint16_t*>(indices_out);
 
   // Central square triangles.
   indices[0] = 0;
@@ -113,7 +206,7 @@ void GenerateRoundedRectIndices(const RoundedRectSpec& spec,
   indices[35] = 5;
 
   // WARNING: here's where it gets confusing; the number of indices generated is
-  // dependent on kCornerDivisions.
+  // dependent on |corner_divisions|.
 
   // We've already generated output indices for the "cross triangles".
   constexpr uint32_t kCrossTriangles = 12;
@@ -124,7 +217,7 @@ void GenerateRoundedRectIndices(const RoundedRectSpec& spec,
   uint32_t highest_index = 12;
 
   // These are the indices of the 4 triangles that would be output if
-  // kCornerDivisions were zero.
+  // |corner_divisions| were zero.
   const uint32_t corner_tris[] = {1, 6, 5, 2, 8, 7, 3, 10, 9, 4, 12, 11};
 
   // For each corner, generate wedges in clockwise order.
@@ -135,119 +228,189 @@ void GenerateRoundedRectIndices(const RoundedRectSpec& spec,
     // previous perimeter vertex.
     uint32_t prev = corner_tris[corner * 3 + 2];
 
-    for (uint32_t i = 0; i < kCornerDivisions; ++i) {
+    for (uint32_t i = 0; i < corner_divisions; ++i) {
       indices[out++] = center;
       indices[out++] = prev;
       indices[out++] = prev = ++highest_index;
     }
-    // One last triangle (or the only one, if kCornerDivisions == 0).
+    // One last triangle (or the only one, if |corner_divisions| == 0).
     indices[out++] = center;
     indices[out++] = prev;
     indices[out++] = corner_tris[corner * 3 + 1];
   }
 
-  FTL_DCHECK(out == kIndexCount);
+  FTL_DCHECK(out == index_count);
 }
 
 void GenerateRoundedRectVertices(const RoundedRectSpec& spec,
                                  const MeshSpec& mesh_spec,
                                  void* vertices_out,
-                                 uint32_t max_bytes) {
+                                 uint32_t max_bytes,
+                                 uint32_t corner_divisions) {
+  const uint32_t vertex_count = GetVertexCount(corner_divisions);
   const float width = spec.width;
   const float height = spec.height;
   FTL_DCHECK(width >= spec.top_left_radius + spec.top_right_radius);
   FTL_DCHECK(width >= spec.bottom_left_radius + spec.bottom_right_radius);
   FTL_DCHECK(height >= spec.top_left_radius + spec.bottom_left_radius);
   FTL_DCHECK(height >= spec.top_right_radius + spec.bottom_right_radius);
-  FTL_DCHECK(max_bytes == kVertexCount * mesh_spec.GetStride());
+  FTL_DCHECK(max_bytes == vertex_count * mesh_spec.GetStride());
   FTL_DCHECK(mesh_spec.flags ==
              (MeshAttribute::kPosition | MeshAttribute::kUV));
+  FTL_DCHECK(!mesh_spec.encodings);
   FTL_DCHECK(0U == mesh_spec.GetAttributeOffset(MeshAttribute::kPosition));
   FTL_DCHECK(sizeof(vec2) == mesh_spec.GetAttributeOffset(MeshAttribute::kUV));
   FTL_DCHECK(sizeof(PosUvVertex) == mesh_spec.GetStride());
 
-  // NOTE: for clarity, we first generate the UV-coordinates for each vertex,
-  // then make a second pass where we use these UV-coords to generate the vertex
-  // positions.
-
-  // Output vertices are writen here.
-  PosUvVertex* const verts = static_cast<PosUvVertex*>(vertices_out);
+  // Each vertex is computed in registers and written exactly once, in order,
+  // because |vertices_out| is typically write-combined memory mapped by the
+  // GpuUploader; reading it back, or scattering writes, is very slow.
+  PosUvVertex* out = static_cast<PosUvVertex*>(vertices_out);
+  const vec2 extent(width, height);
+  const vec2 offset = -0.5f * extent;
+  auto write_vertex = [&out, extent, offset](vec2 uv) {
+    *out++ = {uv * extent + offset, uv};
+  };
 
-  // First compute UV coordinates of the four "corner centers".
-  verts[1].uv =
+  // UV coordinates of the four "corner centers".
+  const vec2 top_left =
       vec2(spec.top_left_radius / width, spec.top_left_radius / height);
-  verts[2].uv =
+  const vec2 top_right =
       vec2(1.f - spec.top_right_radius / width, spec.top_right_radius / height);
-  verts[3].uv = vec2(1.f - spec.bottom_right_radius / width,
-                     1.f - spec.bottom_right_radius / height);
-  verts[4].uv = vec2(spec.bottom_left_radius / width,
-                     1.f - spec.bottom_left_radius / height);
+  const vec2 bottom_right = vec2(1.f - spec.bottom_right_radius / width,
+                                 1.f - spec.bottom_right_radius / height);
+  const vec2 bottom_left = vec2(spec.bottom_left_radius / width,
+                                1.f - spec.bottom_left_radius / height);
 
   // The "center" vertex is the average of the four "corner centers".
-  verts[0].uv =
-      0.25f * ((verts[1].uv + verts[2].uv + verts[3].uv + verts[4].uv));
-
-  // Next, compute UV coords for the 8 vertices where the rounded corners meet
-  // the straight side sections.
-  verts[6].uv = vec2(verts[1].uv.x, 0.f);
-  verts[7].uv = vec2(verts[2].uv.x, 0.f);
-  verts[8].uv = vec2(1.f, verts[2].uv.y);
-  verts[9].uv = vec2(1.f, verts[3].uv.y);
-  verts[10].uv = vec2(verts[3].uv.x, 1.f);
-  verts[11].uv = vec2(verts[4].uv.x, 1.f);
-  verts[12].uv = vec2(0.f, verts[4].uv.y);
-  verts[5].uv = vec2(0.f, verts[1].uv.y);
-
-  // Next, compute UV coords for the vertices that make up the rounded corners.
-  // We start at index 13; indices 0-12 were computed above.
-  uint32_t out = 13;
-
-  constexpr float kPI = 3.14159265f;
-  constexpr float kAngleStep = kPI / 2 / (kCornerDivisions + 1);
-
-  // Generate UV coordinates for top-left corner.
-  float angle = kPI + kAngleStep;
-  vec2 scale =
+  write_vertex(0.25f * (top_left + top_right + bottom_right + bottom_left));
+  write_vertex(top_left);
+  write_vertex(top_right);
+  write_vertex(bottom_right);
+  write_vertex(bottom_left);
+
+  // The 8 vertices where the rounded corners meet the straight side sections.
+  write_vertex(vec2(0.f, top_left.y));
+  write_vertex(vec2(top_left.x, 0.f));
+  write_vertex(vec2(top_right.x, 0.f));
+  write_vertex(vec2(1.f, top_right.y));
+  write_vertex(vec2(1.f, bottom_right.y));
+  write_vertex(vec2(bottom_right.x, 1.f));
+  write_vertex(vec2(bottom_left.x, 1.f));
+  write_vertex(vec2(0.f, bottom_left.y));
+
+  // The vertices that make up the rounded corners.  Each corner is the
+  // tabulated arc, rotated into place and scaled by the corner radius.
+  std::vector<vec2> arc_storage;
+  const vec2* arc = GetCornerArc(corner_divisions, &arc_storage);
+  const vec2 top_left_scale =
       vec2(spec.top_left_radius / width, spec.top_left_radius / height);
-  for (size_t i = 0; i < kCornerDivisions; ++i) {
-    verts[out++].uv = verts[1].uv + vec2(cos(angle), sin(angle)) * scale;
-    angle += kAngleStep;
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    write_vertex(top_left + vec2(-arc[i].x, -arc[i].y) * top_left_scale);
   }
-
-  // Generate UV coordinates for top-right corner.
-  angle = 1.5f * kPI + kAngleStep;
-  scale = vec2(spec.top_right_radius / width, spec.top_right_radius / height);
-  for (size_t i = 0; i < kCornerDivisions; ++i) {
-    verts[out++].uv = verts[2].uv + vec2(cos(angle), sin(angle)) * scale;
-    angle += kAngleStep;
+  const vec2 top_right_scale =
+      vec2(spec.top_right_radius / width, spec.top_right_radius / height);
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    write_vertex(top_right + vec2(arc[i].y, -arc[i].x) * top_right_scale);
   }
-
-  // Generate UV coordinates for bottom-right corner.
-  angle = kAngleStep;
-  scale =
+  const vec2 bottom_right_scale =
       vec2(spec.bottom_right_radius / width, spec.bottom_right_radius / height);
-  for (size_t i = 0; i < kCornerDivisions; ++i) {
-    verts[out++].uv = verts[3].uv + vec2(cos(angle), sin(angle)) * scale;
-    angle += kAngleStep;
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    write_vertex(bottom_right + arc[i] * bottom_right_scale);
   }
-
-  // Generate UV coordinates for bottom-right corner.
-  angle = 0.5f * kPI + kAngleStep;
-  scale =
+  const vec2 bottom_left_scale =
       vec2(spec.bottom_left_radius / width, spec.bottom_left_radius / height);
-  for (size_t i = 0; i < kCornerDivisions; ++i) {
-    verts[out++].uv = verts[4].uv + vec2(cos(angle), sin(angle)) * scale;
-    angle += kAngleStep;
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    write_vertex(bottom_left + vec2(-arc[i].y, arc[i].x) * bottom_left_scale);
   }
 
-  // The hard part is finished!  Make one final pass to generate the vertex
-  // positions from the UV-coordinates.
-  FTL_DCHECK(out == kVertexCount);
-  const vec2 extent(width, height);
-  const vec2 offset = -0.5f * extent;
-  for (size_t i = 0; i < kVertexCount; ++i) {
-    verts[i].pos = verts[i].uv * extent + offset;
+  FTL_DCHECK(out == static_cast<PosUvVertex*>(vertices_out) + vertex_count);
+}
+
+void GenerateUnitRoundedRectVertices(const MeshSpec& mesh_spec,
+                                     void* vertices_out,
+                                     uint32_t max_bytes,
+                                     uint32_t corner_divisions) {
+  const uint32_t vertex_count = GetVertexCount(corner_divisions);
+  FTL_DCHECK(max_bytes == vertex_count * mesh_spec.GetStride());
+  FTL_DCHECK(mesh_spec.flags ==
+             (MeshAttribute::kPosition | MeshAttribute::kPositionOffset));
+  FTL_DCHECK(!mesh_spec.encodings);
+  FTL_DCHECK(sizeof(UnitVertex) == mesh_spec.GetStride());
+
+  // The vertices are in the same order as GenerateRoundedRectVertices().
+  UnitVertex* const verts = static_cast<UnitVertex*>(vertices_out);
+  const vec2 top_left(-1.f, -1.f);
+  const vec2 top_right(1.f, -1.f);
+  const vec2 bottom_right(1.f, 1.f);
+  const vec2 bottom_left(-1.f, 1.f);
+
+  // The central vertex.
+  verts[0] = {vec2(0.f, 0.f), vec2(0.f, 0.f)};
+
+  // The four "corner centers".
+  verts[1] = {top_left, vec2(0.f, 0.f)};
+  verts[2] = {top_right, vec2(0.f, 0.f)};
+  verts[3] = {bottom_right, vec2(0.f, 0.f)};
+  verts[4] = {bottom_left, vec2(0.f, 0.f)};
+
+  // The 8 vertices where the rounded corners meet the straight side sections.
+  verts[5] = {top_left, vec2(-1.f, 0.f)};
+  verts[6] = {top_left, vec2(0.f, -1.f)};
+  verts[7] = {top_right, vec2(0.f, -1.f)};
+  verts[8] = {top_right, vec2(1.f, 0.f)};
+  verts[9] = {bottom_right, vec2(1.f, 0.f)};
+  verts[10] = {bottom_right, vec2(0.f, 1.f)};
+  verts[11] = {bottom_left, vec2(0.f, 1.f)};
+  verts[12] = {bottom_left, vec2(-1.f, 0.f)};
+
+  // The vertices that make up the rounded corners, starting at index 13.
+  uint32_t out = 13;
+  std::vector<vec2> arc_storage;
+  const vec2* arc = GetCornerArc(corner_divisions, &arc_storage);
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    verts[out++] = {top_left, vec2(-arc[i].x, -arc[i].y)};
+  }
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    verts[out++] = {top_right, vec2(arc[i].y, -arc[i].x)};
+  }
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    verts[out++] = {bottom_right, arc[i]};
   }
+  for (uint32_t i = 0; i < corner_divisions; ++i) {
+    verts[out++] = {bottom_left, vec2(-arc[i].y, arc[i].x)};
+  }
+  FTL_DCHECK(out == vertex_count);
+}
+
+vec2 DeformUnitRoundedRectVertex(const RoundedRectSpec& spec,
+                                 vec2 corner_sign,
+                                 vec2 corner_direction) {
+  if (corner_sign == vec2(0.f, 0.f)) {
+    // The central vertex is the average of the four "corner centers".
+    return 0.25f * (GetCornerCenter(spec, vec2(-1.f, -1.f)) +
+                    GetCornerCenter(spec, vec2(1.f, -1.f)) +
+                    GetCornerCenter(spec, vec2(1.f, 1.f)) +
+                    GetCornerCenter(spec, vec2(-1.f, 1.f)));
+  }
+  return GetCornerCenter(spec, corner_sign) +
+         GetCornerRadius(spec, corner_sign) * corner_direction;
+}
+
+float RoundedRectSpec::SignedDistance(vec2 point) const {
+  // Use the radius of the corner in the same quadrant as |point|, and compute
+  // the distance as if all four corners had this radius.  This is exact as
+  // long as no radius exceeds half of the width or height.
+  const float radius =
+      point.y < 0.f
+          ? (point.x < 0.f ? top_left_radius : top_right_radius)
+          : (point.x < 0.f ? bottom_left_radius : bottom_right_radius);
+  // Offset from the corner center, folded into the positive quadrant.
+  const vec2 offset(std::abs(point.x) - 0.5f * width + radius,
+                    std::abs(point.y) - 0.5f * height + radius);
+  const vec2 outside(std::max(offset.x, 0.f), std::max(offset.y, 0.f));
+  return std::min(std::max(offset.x, offset.y), 0.f) +
+         std::sqrt(outside.x * outside.x + outside.y * outside.y) - radius;
 }
 
 bool RoundedRectSpec::ContainsPoint(vec2 point) const {
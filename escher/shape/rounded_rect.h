@@ -31,22 +31,72 @@ struct RoundedRectSpec {
   float bottom_left_radius;
 
   bool ContainsPoint(vec2 point) const;
+
+  // Return the distance from |point| to the boundary of the rounded-rect;
+  // negative if the point is inside.  Must match the signed-distance function
+  // used to draw analytic shapes; see ModelPipelineCache.
+  float SignedDistance(vec2 point) const;
 };
 
+// Number of times that the quarter-circle that makes up each corner is
+// sub-divided.  For example, if this is zero, then the corner consists of a
+// single right-angled triangle.
+constexpr uint32_t kDefaultRoundedRectCornerDivisions = 8;
+
+// Corner divisions used for rounded-rect levels of detail, from coarsest to
+// finest.
+constexpr uint32_t kRoundedRectCornerDivisionTiers[] = {
+    0, 1, 3, kDefaultRoundedRectCornerDivisions};
+constexpr size_t kRoundedRectCornerDivisionTierCount =
+    sizeof(kRoundedRectCornerDivisionTiers) / sizeof(uint32_t);
+
+// Return the index of the coarsest tier in kRoundedRectCornerDivisionTiers
+// that accurately approximates a corner whose radius is |radius_pixels| on
+// screen (see kMaxLodErrorPixels).
+size_t GetRoundedRectCornerDivisionTier(float radius_pixels);
+
 // Return the number of vertices and indices that are required to tessellate the
 // specified rounded-rect.  The first element of the pair is the vertex count,
 // and the second element is the index count.
 std::pair<uint32_t, uint32_t> GetRoundedRectMeshVertexAndIndexCounts(
-    const RoundedRectSpec& spec);
+    const RoundedRectSpec& spec,
+    uint32_t corner_divisions = kDefaultRoundedRectCornerDivisions);
 
-void GenerateRoundedRectIndices(const RoundedRectSpec& spec,
-                                const MeshSpec& mesh_spec,
-                                void* indices_out,
-                                uint32_t max_bytes);
+// Indices are 16-bit; see MeshSpec::GetIndexType().
+// The indices depend only on |corner_divisions|, so the same index buffer
+// serves every rounded-rect tessellated with that many divisions.
+void GenerateRoundedRectIndices(void* indices_out,
+                                uint32_t max_bytes,
+                                uint32_t corner_divisions =
+                                    kDefaultRoundedRectCornerDivisions);
 
 void GenerateRoundedRectVertices(const RoundedRectSpec& spec,
                                  const MeshSpec& mesh_spec,
                                  void* vertices_out,
-                                 uint32_t max_bytes);
+                                 uint32_t max_bytes,
+                                 uint32_t corner_divisions =
+                                     kDefaultRoundedRectCornerDivisions);
+
+// Generate the vertices of a canonical rounded-rect mesh, which can be deformed
+// into any RoundedRectSpec by DeformUnitRoundedRectVertex(); the indices are
+// the same as those from GenerateRoundedRectIndices().  |mesh_spec| must have
+// only kPosition and kPositionOffset, which hold the |corner_sign| and
+// |corner_direction| described below.
+void GenerateUnitRoundedRectVertices(const MeshSpec& mesh_spec,
+                                     void* vertices_out,
+                                     uint32_t max_bytes,
+                                     uint32_t corner_divisions =
+                                         kDefaultRoundedRectCornerDivisions);
+
+// Return the position of a vertex of the canonical rounded-rect mesh, when
+// deformed into the rounded-rect described by |spec|.  |corner_sign| selects
+// the corner that the vertex belongs to (e.g. (-1,-1) for top-left), and the
+// vertex is offset from the center of that corner's arc by the corner radius
+// in |corner_direction|.  The central vertex has a |corner_sign| of (0,0).
+//
+// Must match the rounded-rect vertex shader in ModelPipelineCache.
+vec2 DeformUnitRoundedRectVertex(const RoundedRectSpec& spec,
+                                 vec2 corner_sign,
+                                 vec2 corner_direction);
 
 }  // namespace escher
@@ -4,9 +4,12 @@
 
 #include "escher/shape/rounded_rect_factory.h"
 
+#include <algorithm>
+
 #include "escher/escher.h"
 #include "escher/impl/gpu_uploader.h"
 #include "escher/shape/mesh.h"
+#include "escher/shape/mesh_lod.h"
 #include "escher/shape/mesh_spec.h"
 #include "escher/vk/buffer_factory.h"
 
@@ -20,10 +23,11 @@ RoundedRectFactory::RoundedRectFactory(Escher* escher)
 RoundedRectFactory::~RoundedRectFactory() {}
 
 MeshPtr RoundedRectFactory::NewRoundedRect(const RoundedRectSpec& spec,
-                                           const MeshSpec& mesh_spec) {
-  auto index_buffer = GetIndexBuffer(spec, mesh_spec);
+                                           const MeshSpec& mesh_spec,
+                                           uint32_t corner_divisions) {
+  auto index_buffer = GetIndexBuffer(spec, corner_divisions);
 
-  auto counts = GetRoundedRectMeshVertexAndIndexCounts(spec);
+  auto counts = GetRoundedRectMeshVertexAndIndexCounts(spec, corner_divisions);
   uint32_t vertex_count = counts.first;
   uint32_t index_count = counts.second;
   size_t vertex_buffer_size = vertex_count * mesh_spec.GetStride();
@@ -35,7 +39,8 @@ MeshPtr RoundedRectFactory::NewRoundedRect(const RoundedRectSpec& spec,
                                  vk::MemoryPropertyFlagBits::eDeviceLocal);
 
   impl::GpuUploader::Writer writer = uploader_->GetWriter(vertex_buffer_size);
-  GenerateRoundedRectVertices(spec, mesh_spec, writer.ptr(), writer.size());
+  GenerateRoundedRectVertices(spec, mesh_spec, writer.ptr(), writer.size(),
+                              corner_divisions);
   writer.WriteBuffer(vertex_buffer, {0, 0, vertex_buffer->size()},
                      Semaphore::New(device()));
   writer.Submit();
@@ -44,31 +49,66 @@ MeshPtr RoundedRectFactory::NewRoundedRect(const RoundedRectSpec& spec,
                            0.5f * vec3(spec.width, spec.height, 0));
   return ftl::MakeRefCounted<Mesh>(
       static_cast<ResourceRecycler*>(this), mesh_spec, bounding_box,
-      vertex_count, index_count, vertex_buffer, std::move(index_buffer));
+      vertex_count, index_count, vertex_buffer, std::move(index_buffer),
+      vk::IndexType::eUint16);
+}
+
+MeshLodPtr RoundedRectFactory::NewRoundedRectLod(const RoundedRectSpec& spec,
+                                                 const MeshSpec& mesh_spec) {
+  const float max_radius =
+      std::max(std::max(spec.top_left_radius, spec.top_right_radius),
+               std::max(spec.bottom_right_radius, spec.bottom_left_radius));
+  const float max_extent = std::max(spec.width, spec.height);
+
+  auto lod = ftl::MakeRefCounted<MeshLod>();
+  lod->AddLevel(
+      NewRoundedRect(spec, mesh_spec, kRoundedRectCornerDivisionTiers[0]),
+      0.f);
+  if (max_radius <= 0.f) {
+    // Square corners look the same at any level of detail.
+    return lod;
+  }
+  for (size_t i = 1; i < kRoundedRectCornerDivisionTierCount; ++i) {
+    // Each corner of the previous level is a quarter of a regular polygon with
+    // 4 * (divisions + 1) sides.  Switch to this level once the largest corner
+    // is too big on screen for that polygon to be accurate.
+    const uint32_t prev_segment_count =
+        4 * (kRoundedRectCornerDivisionTiers[i - 1] + 1);
+    const float min_screen_size =
+        GetMaxCircleScreenDiameter(prev_segment_count) * max_extent /
+        (2.f * max_radius);
+    lod->AddLevel(
+        NewRoundedRect(spec, mesh_spec, kRoundedRectCornerDivisionTiers[i]),
+        min_screen_size);
+  }
+  return lod;
 }
 
 BufferPtr RoundedRectFactory::GetIndexBuffer(const RoundedRectSpec& spec,
-                                             const MeshSpec& mesh_spec) {
+                                             uint32_t corner_divisions) {
   // Lazily create index buffer.  Since the rounded-rect tessellation functions
   // don't currently take |RoundedRectSpec.zoom| into account, we can always
-  // return the same index buffer.
-  if (!index_buffer_) {
-    uint32_t index_count = GetRoundedRectMeshVertexAndIndexCounts(spec).second;
-    size_t index_buffer_size = index_count * MeshSpec::kIndexSize;
+  // return the same index buffer for a given number of corner divisions.
+  BufferPtr& index_buffer = index_buffers_[corner_divisions];
+  if (!index_buffer) {
+    uint32_t index_count =
+        GetRoundedRectMeshVertexAndIndexCounts(spec, corner_divisions).second;
+    size_t index_buffer_size =
+        index_count * MeshSpec::GetIndexSize(vk::IndexType::eUint16);
 
-    index_buffer_ =
+    index_buffer =
         buffer_factory_->NewBuffer(index_buffer_size,
                                    vk::BufferUsageFlagBits::eIndexBuffer |
                                        vk::BufferUsageFlagBits::eTransferDst,
                                    vk::MemoryPropertyFlagBits::eDeviceLocal);
 
     impl::GpuUploader::Writer writer = uploader_->GetWriter(index_buffer_size);
-    GenerateRoundedRectIndices(spec, mesh_spec, writer.ptr(), writer.size());
-    writer.WriteBuffer(index_buffer_, {0, 0, index_buffer_->size()},
+    GenerateRoundedRectIndices(writer.ptr(), writer.size(), corner_divisions);
+    writer.WriteBuffer(index_buffer, {0, 0, index_buffer->size()},
                        SemaphorePtr());
     writer.Submit();
   }
-  return index_buffer_;
+  return index_buffer;
 }
 
 }  // namespace escher
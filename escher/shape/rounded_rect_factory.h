@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <map>
+
 #include "escher/resources/resource_recycler.h"
 #include "escher/shape/rounded_rect.h"
 
@@ -16,17 +18,27 @@ class RoundedRectFactory : private ResourceRecycler {
   explicit RoundedRectFactory(Escher* escher);
   ~RoundedRectFactory() override;
 
-  MeshPtr NewRoundedRect(const RoundedRectSpec& spec,
-                         const MeshSpec& mesh_spec);
+  MeshPtr NewRoundedRect(
+      const RoundedRectSpec& spec,
+      const MeshSpec& mesh_spec,
+      uint32_t corner_divisions = kDefaultRoundedRectCornerDivisions);
+
+  // Return levels of detail for the specified rounded-rect, from a single
+  // triangle per corner up to kDefaultRoundedRectCornerDivisions.  The
+  // thresholds are chosen from the largest corner radius, relative to the size
+  // of the rounded-rect.
+  MeshLodPtr NewRoundedRectLod(const RoundedRectSpec& spec,
+                               const MeshSpec& mesh_spec);
 
  private:
   BufferPtr GetIndexBuffer(const RoundedRectSpec& spec,
-                           const MeshSpec& mesh_spec);
+                           uint32_t corner_divisions);
 
   std::unique_ptr<BufferFactory> buffer_factory_;
   impl::GpuUploader* const uploader_;
 
-  BufferPtr index_buffer_;
+  // Keyed by the number of corner divisions.
+  std::map<uint32_t, BufferPtr> index_buffers_;
 };
 
 }  // namespace escher
@@ -0,0 +1,118 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/shape_cache.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "escher/escher.h"
+#include "escher/geometry/tessellation.h"
+#include "escher/shape/mesh.h"
+#include "ftl/logging.h"
+
+namespace escher {
+
+ShapeCacheKey::ShapeCacheKey(Type type, const MeshSpec& mesh_spec)
+    : type(type),
+      mesh_attributes(static_cast<uint32_t>(mesh_spec.flags)),
+      mesh_encodings(static_cast<uint32_t>(mesh_spec.encodings)) {}
+
+float ShapeCacheKey::AddParam(float value, float quantum) {
+  FTL_DCHECK(quantum > 0.f);
+  const int32_t quantized = static_cast<int32_t>(std::lround(value / quantum));
+  AddParam(quantized);
+  return quantized * quantum;
+}
+
+void ShapeCacheKey::AddParam(int32_t value) {
+  FTL_DCHECK(param_count < kMaxParamCount);
+  params[param_count++] = value;
+}
+
+bool ShapeCacheKey::operator==(const ShapeCacheKey& other) const {
+  return 0 == std::memcmp(this, &other, sizeof(ShapeCacheKey));
+}
+
+ShapeCache::ShapeCache(Escher* escher, float quantum)
+    : escher_(escher), quantum_(quantum), rounded_rect_factory_(escher) {
+  FTL_DCHECK(quantum_ > 0.f);
+}
+
+ShapeCache::~ShapeCache() {}
+
+MeshPtr ShapeCache::GetRoundedRect(const RoundedRectSpec& spec,
+                                   const MeshSpec& mesh_spec) {
+  ShapeCacheKey key(ShapeCacheKey::Type::kRoundedRect, mesh_spec);
+  RoundedRectSpec quantized = spec;
+  quantized.width = key.AddParam(spec.width, quantum_);
+  quantized.height = key.AddParam(spec.height, quantum_);
+  quantized.top_left_radius = key.AddParam(spec.top_left_radius, quantum_);
+  quantized.top_right_radius = key.AddParam(spec.top_right_radius, quantum_);
+  quantized.bottom_right_radius =
+      key.AddParam(spec.bottom_right_radius, quantum_);
+  quantized.bottom_left_radius =
+      key.AddParam(spec.bottom_left_radius, quantum_);
+  if (MeshPtr mesh = meshes_.Find(key)) {
+    return mesh;
+  }
+
+  MeshPtr mesh = rounded_rect_factory_.NewRoundedRect(quantized, mesh_spec);
+  // The factory shares a single index buffer between all rounded-rects, so
+  // only the vertices are uploaded per-mesh.
+  meshes_.Insert(key, mesh, mesh->num_vertices() * mesh_spec.GetStride());
+  return mesh;
+}
+
+MeshPtr ShapeCache::GetCircle(const MeshSpec& spec,
+                              int subdivisions,
+                              float radius,
+                              float offset_magnitude) {
+  ShapeCacheKey key(ShapeCacheKey::Type::kCircle, spec);
+  key.AddParam(subdivisions);
+  radius = key.AddParam(radius, quantum_);
+  offset_magnitude = key.AddParam(offset_magnitude, quantum_);
+  if (MeshPtr mesh = meshes_.Find(key)) {
+    return mesh;
+  }
+
+  MeshPtr mesh = NewCircleMesh(escher_, spec, subdivisions, vec2(0.f, 0.f),
+                               radius, offset_magnitude);
+  meshes_.Insert(key, mesh,
+                 mesh->num_vertices() * spec.GetStride() +
+                     mesh->num_indices() * mesh->index_size());
+  return mesh;
+}
+
+MeshPtr ShapeCache::GetRing(const MeshSpec& spec,
+                            int subdivisions,
+                            float outer_radius,
+                            float inner_radius,
+                            float outer_offset_magnitude,
+                            float inner_offset_magnitude) {
+  ShapeCacheKey key(ShapeCacheKey::Type::kRing, spec);
+  key.AddParam(subdivisions);
+  outer_radius = key.AddParam(outer_radius, quantum_);
+  inner_radius = key.AddParam(inner_radius, quantum_);
+  outer_offset_magnitude = key.AddParam(outer_offset_magnitude, quantum_);
+  inner_offset_magnitude = key.AddParam(inner_offset_magnitude, quantum_);
+  if (MeshPtr mesh = meshes_.Find(key)) {
+    return mesh;
+  }
+
+  MeshPtr mesh =
+      NewRingMesh(escher_, spec, subdivisions, vec2(0.f, 0.f), outer_radius,
+                  inner_radius, outer_offset_magnitude, inner_offset_magnitude);
+  meshes_.Insert(key, mesh,
+                 mesh->num_vertices() * spec.GetStride() +
+                     mesh->num_indices() * mesh->index_size());
+  return mesh;
+}
+
+void ShapeCache::EvictUnusedMeshes() {
+  // Dropping the last reference hands each mesh to its ResourceRecycler.
+  meshes_.EvictUnused();
+}
+
+}  // namespace escher
@@ -0,0 +1,185 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "escher/forward_declarations.h"
+#include "escher/geometry/types.h"
+#include "escher/shape/mesh_spec.h"
+#include "escher/shape/rounded_rect_factory.h"
+#include "escher/util/debug_print.h"
+#include "escher/util/hash.h"
+#include "ftl/logging.h"
+#include "ftl/macros.h"
+#include "ftl/memory/ref_ptr.h"
+
+namespace escher {
+
+// Identifies a tessellated shape in a ShapeCache.  Floating-point parameters
+// are quantized, so that shapes which differ only slightly share a mesh.
+struct ShapeCacheKey {
+  enum class Type : uint32_t { kRoundedRect, kCircle, kRing };
+  static constexpr uint32_t kMaxParamCount = 8;
+
+  ShapeCacheKey(Type type, const MeshSpec& mesh_spec);
+
+  // Append |value|, rounded to the nearest multiple of |quantum|, and return
+  // the rounded value.
+  float AddParam(float value, float quantum);
+  void AddParam(int32_t value);
+
+  bool operator==(const ShapeCacheKey& other) const;
+
+  Type type;
+  uint32_t mesh_attributes;
+  uint32_t mesh_encodings;
+  uint32_t param_count = 0;
+  int32_t params[kMaxParamCount] = {};
+};
+
+struct ShapeCacheStats {
+  size_t hit_count = 0;
+  size_t miss_count = 0;
+  size_t eviction_count = 0;
+  // Bytes of vertex and index data uploaded to create cached meshes.
+  size_t bytes_uploaded = 0;
+  // Bytes that would have been uploaded had every request created a mesh.
+  size_t bytes_saved = 0;
+
+  float hit_rate() const {
+    const size_t count = hit_count + miss_count;
+    return count ? float(hit_count) / count : 0.f;
+  }
+};
+
+ESCHER_DEBUG_PRINTABLE(ShapeCacheStats);
+
+// Maps ShapeCacheKeys to shared objects, and records how often they are
+// reused.  This is separate from ShapeCache, so that it can be tested without
+// a Vulkan device.
+template <typename T>
+class ShapeCacheTable {
+ public:
+  typedef ftl::RefPtr<T> ObjectPtr;
+
+  ShapeCacheTable() = default;
+
+  // Return the object for |key|, or null if there is none.  Counts as a hit or
+  // a miss, respectively.
+  ObjectPtr Find(const ShapeCacheKey& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      ++stats_.miss_count;
+      return ObjectPtr();
+    }
+    ++stats_.hit_count;
+    stats_.bytes_saved += it->second.upload_bytes;
+    return it->second.object;
+  }
+
+  // |upload_bytes| is the number of bytes that were uploaded to create
+  // |object|, and that are saved by each subsequent hit.
+  void Insert(const ShapeCacheKey& key, ObjectPtr object, size_t upload_bytes) {
+    FTL_DCHECK(object);
+    FTL_DCHECK(entries_.find(key) == entries_.end());
+    entries_.emplace(key, Entry{std::move(object), upload_bytes});
+    stats_.bytes_uploaded += upload_bytes;
+  }
+
+  // Release all objects that are referenced only by the table, and return the
+  // number that were released.
+  size_t EvictUnused() {
+    size_t count = 0;
+    auto it = entries_.begin();
+    while (it != entries_.end()) {
+      if (it->second.object->ref_count() == 1) {
+        it = entries_.erase(it);
+        ++count;
+      } else {
+        ++it;
+      }
+    }
+    stats_.eviction_count += count;
+    return count;
+  }
+
+  size_t size() const { return entries_.size(); }
+  const ShapeCacheStats& stats() const { return stats_; }
+  void ResetStats() { stats_ = ShapeCacheStats(); }
+
+ private:
+  struct Entry {
+    ObjectPtr object;
+    size_t upload_bytes;
+  };
+
+  std::unordered_map<ShapeCacheKey, Entry, Hash<ShapeCacheKey>> entries_;
+  ShapeCacheStats stats_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ShapeCacheTable);
+};
+
+// Returns shared meshes for rounded-rects, circles and rings, so that shapes
+// with the same (quantized) parameters and MeshSpec are tessellated and
+// uploaded only once.  The returned meshes are immutable, and may be used by
+// any number of objects.  Circles and rings are centered at the origin; use the
+// Object's transform to position them.
+//
+// Meshes are retained by the cache until EvictUnusedMeshes() finds that they
+// are referenced by nothing else; they are then released to the
+// ResourceRecycler that created them, which destroys them once no pending
+// command buffer uses them.
+//
+// Not thread-safe.
+class ShapeCache {
+ public:
+  // Parameters are rounded to the nearest multiple of |quantum|, which is in
+  // the same units as the shapes (typically pixels).
+  static constexpr float kDefaultQuantum = 1.f / 16.f;
+
+  explicit ShapeCache(Escher* escher, float quantum = kDefaultQuantum);
+  ~ShapeCache();
+
+  // See RoundedRectFactory::NewRoundedRect().
+  MeshPtr GetRoundedRect(const RoundedRectSpec& spec,
+                         const MeshSpec& mesh_spec);
+
+  // See NewCircleMesh().  The circle is centered at the origin.
+  MeshPtr GetCircle(const MeshSpec& spec,
+                    int subdivisions,
+                    float radius,
+                    float offset_magnitude = 0.f);
+
+  // See NewRingMesh().  The ring is centered at the origin.
+  MeshPtr GetRing(const MeshSpec& spec,
+                  int subdivisions,
+                  float outer_radius,
+                  float inner_radius,
+                  float outer_offset_magnitude = 0.f,
+                  float inner_offset_magnitude = 0.f);
+
+  // Release all meshes that are referenced only by the cache.  Typically
+  // called once per frame, after the frame's objects have been created, so
+  // that meshes used by the previous frame but not by this one are released.
+  void EvictUnusedMeshes();
+
+  size_t size() const { return meshes_.size(); }
+  const ShapeCacheStats& stats() const { return meshes_.stats(); }
+  void ResetStats() { meshes_.ResetStats(); }
+
+ private:
+  Escher* const escher_;
+  const float quantum_;
+  RoundedRectFactory rounded_rect_factory_;
+  // Declared after |rounded_rect_factory_|, so that the cached rounded-rects
+  // are released before the factory that owns them is destroyed.
+  ShapeCacheTable<Mesh> meshes_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ShapeCache);
+};
+
+}  // namespace escher
@@ -74,7 +74,9 @@ TexturePtr DepthToColor::Convert(impl::CommandBuffer* command_buffer,
   kernel_->Dispatch({depth_texture, tmp_texture}, {}, command_buffer,
                     work_groups_x, work_groups_y, 1, nullptr);
 
-  timestamper->AddTimestamp("converted depth image to color image");
+  if (timestamper) {
+    timestamper->AddTimestamp("converted depth image to color image");
+  }
   return tmp_texture;
 }
 
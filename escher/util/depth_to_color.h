@@ -17,6 +17,7 @@ class DepthToColor {
  public:
   DepthToColor(Escher* escher, ImageFactory* image_factory);
 
+  // |timestamper| may be null.
   TexturePtr Convert(impl::CommandBuffer* command_buffer,
                      const TexturePtr& depth_texture,
                      vk::ImageUsageFlags image_flags,
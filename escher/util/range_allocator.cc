@@ -0,0 +1,82 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/util/range_allocator.h"
+
+#include <iterator>
+
+#include "escher/util/align.h"
+#include "ftl/logging.h"
+
+namespace escher {
+
+RangeAllocator::RangeAllocator(size_t size) : size_(size) {
+  if (size_ > 0) {
+    free_ranges_[0] = size_;
+  }
+}
+
+RangeAllocator::~RangeAllocator() {}
+
+bool RangeAllocator::Allocate(size_t size,
+                              size_t alignment,
+                              size_t* offset_out) {
+  FTL_DCHECK(offset_out);
+  if (size == 0) {
+    return false;
+  }
+
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it) {
+    const size_t range_offset = it->first;
+    const size_t range_end = range_offset + it->second;
+    const size_t offset = AlignedToNext(range_offset, alignment);
+    if (offset + size > range_end) {
+      continue;
+    }
+
+    // Split the free range into the (possibly empty) padding before the
+    // allocation, and the (possibly empty) remainder after it.
+    free_ranges_.erase(it);
+    if (offset > range_offset) {
+      free_ranges_[range_offset] = offset - range_offset;
+    }
+    if (offset + size < range_end) {
+      free_ranges_[offset + size] = range_end - (offset + size);
+    }
+
+    bytes_allocated_ += size;
+    *offset_out = offset;
+    return true;
+  }
+  return false;
+}
+
+void RangeAllocator::Free(size_t offset, size_t size) {
+  FTL_DCHECK(size > 0);
+  FTL_DCHECK(offset + size <= size_);
+  FTL_DCHECK(bytes_allocated_ >= size);
+  bytes_allocated_ -= size;
+
+  auto next = free_ranges_.lower_bound(offset);
+  FTL_DCHECK(next == free_ranges_.end() || next->first >= offset + size);
+
+  // Coalesce with the following free range, if adjacent.
+  if (next != free_ranges_.end() && next->first == offset + size) {
+    size += next->second;
+    next = free_ranges_.erase(next);
+  }
+
+  // Coalesce with the preceding free range, if adjacent.
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    FTL_DCHECK(prev->first + prev->second <= offset);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  free_ranges_.emplace_hint(next, offset, size);
+}
+
+}  // namespace escher
@@ -0,0 +1,47 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+#include "ftl/macros.h"
+
+namespace escher {
+
+// Manages sub-ranges of a contiguous range of the specified size, for example
+// a large Buffer that is shared by many Meshes.  Uses a first-fit strategy;
+// adjacent free ranges are coalesced when a range is freed.
+//
+// Not thread-safe.
+class RangeAllocator {
+ public:
+  explicit RangeAllocator(size_t size);
+  ~RangeAllocator();
+
+  // Find a free range of |size| bytes whose offset is a multiple of
+  // |alignment|.  Return false if there is no such range; otherwise, return
+  // true and write the offset of the allocated range to |offset_out|.
+  bool Allocate(size_t size, size_t alignment, size_t* offset_out);
+
+  // Return a range previously obtained from Allocate() to the free list.
+  void Free(size_t offset, size_t size);
+
+  size_t size() const { return size_; }
+  size_t bytes_allocated() const { return bytes_allocated_; }
+  bool empty() const { return bytes_allocated_ == 0; }
+  // Number of disjoint free ranges; useful to measure fragmentation.
+  size_t free_range_count() const { return free_ranges_.size(); }
+
+ private:
+  const size_t size_;
+  size_t bytes_allocated_ = 0;
+  // Maps the offset of each free range to its size.
+  std::map<size_t, size_t> free_ranges_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(RangeAllocator);
+};
+
+}  // namespace escher
@@ -0,0 +1,89 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ftl/logging.h"
+#include "ftl/macros.h"
+#include "ftl/memory/ref_ptr.h"
+
+namespace escher {
+
+// Assigns each inserted object a stable slot in a fixed-size table, and
+// retains the object for as long as it occupies the slot.  The first
+// |reserved_count| slots are never handed out.  Objects that are retained only
+// by the table are evicted by ReleaseUnused(), after which their slots may be
+// reused.  T must provide ref_count(), as escher::Reffable does.
+template <typename T>
+class RefPtrSlotTable {
+ public:
+  RefPtrSlotTable(uint32_t capacity, uint32_t reserved_count)
+      : slots_(capacity) {
+    FTL_DCHECK(reserved_count <= capacity);
+    free_slots_.reserve(capacity - reserved_count);
+    // Push in reverse order, so that lower slots are handed out first.
+    for (uint32_t i = capacity; i > reserved_count; --i) {
+      free_slots_.push_back(i - 1);
+    }
+  }
+
+  // Set |slot| to the slot occupied by |object|, inserting it if necessary.
+  // Return false if |object| is not already present and the table is full.
+  bool Insert(const ftl::RefPtr<T>& object, uint32_t* slot) {
+    FTL_DCHECK(object);
+    auto it = slot_indices_.find(object.get());
+    if (it != slot_indices_.end()) {
+      *slot = it->second;
+      return true;
+    }
+    if (free_slots_.empty()) {
+      return false;
+    }
+    *slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[*slot] = object;
+    slot_indices_[object.get()] = *slot;
+    return true;
+  }
+
+  // Evict all objects that are retained only by the table, and return the
+  // number of slots that were freed.
+  uint32_t ReleaseUnused() {
+    uint32_t released_count = 0;
+    for (uint32_t i = 0; i < capacity(); ++i) {
+      auto& object = slots_[i];
+      if (object && object->ref_count() == 1) {
+        slot_indices_.erase(object.get());
+        object = nullptr;
+        free_slots_.push_back(i);
+        ++released_count;
+      }
+    }
+    return released_count;
+  }
+
+  // Return the object in |slot|, or null if the slot is empty.
+  const ftl::RefPtr<T>& at(uint32_t slot) const {
+    FTL_DCHECK(slot < capacity());
+    return slots_[slot];
+  }
+
+  uint32_t capacity() const { return static_cast<uint32_t>(slots_.size()); }
+
+  // Number of occupied slots.
+  uint32_t size() const { return static_cast<uint32_t>(slot_indices_.size()); }
+
+ private:
+  std::vector<ftl::RefPtr<T>> slots_;
+  std::unordered_map<T*, uint32_t> slot_indices_;
+  std::vector<uint32_t> free_slots_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(RefPtrSlotTable);
+};
+
+}  // namespace escher
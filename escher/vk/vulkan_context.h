@@ -20,6 +20,10 @@ struct VulkanContext {
   // Optional transfer-only queue that is used for fast GPU uploads/downloads.
   const vk::Queue transfer_queue;
   const uint32_t transfer_queue_family_index;
+  // Optional compute-only queue, used to run compute work asynchronously with
+  // the graphics work on |queue|.  Null if the device has none.
+  const vk::Queue compute_queue;
+  const uint32_t compute_queue_family_index;
 
   VulkanContext(vk::Instance instance,
                 vk::PhysicalDevice physical_device,
@@ -27,18 +31,23 @@ struct VulkanContext {
                 vk::Queue queue,
                 uint32_t queue_family_index,
                 vk::Queue transfer_queue,
-                uint32_t transfer_queue_family_index)
+                uint32_t transfer_queue_family_index,
+                vk::Queue compute_queue,
+                uint32_t compute_queue_family_index)
       : instance(instance),
         physical_device(physical_device),
         device(device),
         queue(queue),
         queue_family_index(queue_family_index),
         transfer_queue(transfer_queue),
-        transfer_queue_family_index(transfer_queue_family_index) {}
+        transfer_queue_family_index(transfer_queue_family_index),
+        compute_queue(compute_queue),
+        compute_queue_family_index(compute_queue_family_index) {}
 
   VulkanContext()
       : queue_family_index(UINT32_MAX),
-        transfer_queue_family_index(UINT32_MAX) {}
+        transfer_queue_family_index(UINT32_MAX),
+        compute_queue_family_index(UINT32_MAX) {}
 };
 
 }  // namespace escher
@@ -5,6 +5,7 @@
 #include "escher/vk/vulkan_device_queues.h"
 
 #include <set>
+#include <vector>
 
 #include "escher/impl/vulkan_utils.h"
 #include "ftl/logging.h"
@@ -21,9 +22,18 @@ static FuncT GetDeviceProcAddr(vk::Device device, const char* func_name) {
 #define GET_DEVICE_PROC_ADDR(XXX) \
   XXX = GetDeviceProcAddr<PFN_vk##XXX>(device, "vk" #XXX)
 
-VulkanDeviceQueues::Caps::Caps(vk::PhysicalDeviceProperties props)
+VulkanDeviceQueues::Caps::Caps(vk::PhysicalDeviceProperties props,
+                               vk::PhysicalDeviceFeatures enabled_features)
     : max_image_width(props.limits.maxImageDimension2D),
-      max_image_height(props.limits.maxImageDimension2D) {}
+      max_image_height(props.limits.maxImageDimension2D),
+      max_per_stage_descriptor_samplers(
+          props.limits.maxPerStageDescriptorSamplers),
+      max_per_stage_descriptor_sampled_images(
+          props.limits.maxPerStageDescriptorSampledImages),
+      shader_sampled_image_array_dynamic_indexing(
+          enabled_features.shaderSampledImageArrayDynamicIndexing),
+      shader_storage_image_extended_formats(
+          enabled_features.shaderStorageImageExtendedFormats) {}
 
 VulkanDeviceQueues::ProcAddrs::ProcAddrs(
     vk::Device device,
@@ -48,6 +58,8 @@ struct SuitablePhysicalDeviceAndQueueFamilies {
   vk::PhysicalDevice physical_device;
   uint32_t main_queue_family;
   uint32_t transfer_queue_family;
+  // UINT32_MAX if there is no compute-only queue family.
+  uint32_t compute_queue_family;
 };
 
 SuitablePhysicalDeviceAndQueueFamilies
@@ -67,6 +79,12 @@ FindSuitablePhysicalDeviceAndQueueFamilies(
                                    vk::QueueFlagBits::eGraphics |
                                    vk::QueueFlagBits::eCompute;
 
+  // A compute-only queue can run compute work concurrently with the graphics
+  // work on the main queue.  Software implementations typically expose a
+  // single queue family, in which case there is none.
+  const auto kComputeQueueFlags =
+      vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute;
+
   for (auto& physical_device : physical_devices) {
     // Look for a physical device that has all required extensions.
     if (!VulkanDeviceQueues::ValidateExtensions(physical_device,
@@ -102,6 +120,7 @@ FindSuitablePhysicalDeviceAndQueueFamilies(
         result.physical_device = physical_device;
         result.main_queue_family = i;
         result.transfer_queue_family = i;
+        result.compute_queue_family = UINT32_MAX;
         for (size_t j = 0; j < queues.size(); ++j) {
           if ((queues[i].queueFlags & kTransferQueueFlags) ==
               vk::QueueFlagBits::eTransfer) {
@@ -111,11 +130,31 @@ FindSuitablePhysicalDeviceAndQueueFamilies(
             break;
           }
         }
+        for (size_t j = 0; j < queues.size(); ++j) {
+          if ((queues[j].queueFlags & kComputeQueueFlags) ==
+              vk::QueueFlagBits::eCompute) {
+            result.compute_queue_family = j;
+            break;
+          }
+        }
         return result;
       }
     }
   }
-  return {vk::PhysicalDevice(), 0, 0};
+  return {vk::PhysicalDevice(), 0, 0, UINT32_MAX};
+}
+
+// Return the optional features that Escher can use, and that
+// |physical_device| supports.
+vk::PhysicalDeviceFeatures GetOptionalFeatures(
+    vk::PhysicalDevice physical_device) {
+  vk::PhysicalDeviceFeatures supported = physical_device.getFeatures();
+  vk::PhysicalDeviceFeatures enabled;
+  enabled.shaderSampledImageArrayDynamicIndexing =
+      supported.shaderSampledImageArrayDynamicIndexing;
+  enabled.shaderStorageImageExtendedFormats =
+      supported.shaderStorageImageExtendedFormats;
+  return enabled;
 }
 
 }  // namespace
@@ -132,6 +171,7 @@ ftl::RefPtr<VulkanDeviceQueues> VulkanDeviceQueues::New(
   vk::PhysicalDevice physical_device;
   uint32_t main_queue_family;
   uint32_t transfer_queue_family;
+  uint32_t compute_queue_family;
   {
     SuitablePhysicalDeviceAndQueueFamilies result =
         FindSuitablePhysicalDeviceAndQueueFamilies(instance, params);
@@ -140,49 +180,44 @@ ftl::RefPtr<VulkanDeviceQueues> VulkanDeviceQueues::New(
     physical_device = result.physical_device;
     main_queue_family = result.main_queue_family;
     transfer_queue_family = result.transfer_queue_family;
+    compute_queue_family = result.compute_queue_family;
   }
 
-  // Prepare to create the Device and Queues.
-  vk::DeviceQueueCreateInfo queue_info[2];
-  const float kQueuePriorities[2] = {0, 0};
-  queue_info[0] = vk::DeviceQueueCreateInfo();
-  queue_info[0].queueFamilyIndex = main_queue_family;
-  queue_info[0].queueCount = 1;
-  queue_info[0].pQueuePriorities = kQueuePriorities;
-  queue_info[1] = vk::DeviceQueueCreateInfo();
-  queue_info[1].queueFamilyIndex = transfer_queue_family;
-  queue_info[1].queueCount = 1;
-  queue_info[1].pQueuePriorities = kQueuePriorities;
+  // Prepare to create the Device and Queues.  Create one queue in each
+  // distinct family; it's possible that the main queue and transfer queue are
+  // in the same queue family, in which case they share a single queue.
+  // TODO: it may be worthwhile to create multiple queues in the same family.
+  // However, we would need to look at VkQueueFamilyProperties.queueCount to
+  // make sure that we can create multiple queues for that family.
+  std::vector<uint32_t> queue_families = {main_queue_family};
+  if (transfer_queue_family != main_queue_family) {
+    queue_families.push_back(transfer_queue_family);
+  }
+  if (compute_queue_family != UINT32_MAX) {
+    queue_families.push_back(compute_queue_family);
+  }
+  std::vector<vk::DeviceQueueCreateInfo> queue_info(queue_families.size());
+  const float kQueuePriorities[1] = {0};
+  for (size_t i = 0; i < queue_families.size(); ++i) {
+    queue_info[i].queueFamilyIndex = queue_families[i];
+    queue_info[i].queueCount = 1;
+    queue_info[i].pQueuePriorities = kQueuePriorities;
+  }
 
   std::vector<const char*> extension_names;
   for (auto& extension : params.extension_names) {
     extension_names.push_back(extension.c_str());
   }
 
+  vk::PhysicalDeviceFeatures enabled_features =
+      GetOptionalFeatures(physical_device);
+
   vk::DeviceCreateInfo device_info;
-  device_info.queueCreateInfoCount = 2;
-  device_info.pQueueCreateInfos = queue_info;
+  device_info.queueCreateInfoCount = static_cast<uint32_t>(queue_info.size());
+  device_info.pQueueCreateInfos = queue_info.data();
   device_info.enabledExtensionCount = extension_names.size();
   device_info.ppEnabledExtensionNames = extension_names.data();
-
-  // It's possible that the main queue and transfer queue are in the same
-  // queue family.  Adjust the device-creation parameters to account for this.
-  uint32_t main_queue_index = 0;
-  uint32_t transfer_queue_index = 0;
-  if (main_queue_family == transfer_queue_family) {
-#if 0
-    // TODO: it may be worthwhile to create multiple queues in the same family.
-    // However, we would need to look at VkQueueFamilyProperties.queueCount to
-    // make sure that we can create multiple queues for that family.  For now,
-    // it is easier to share a single queue when the main/transfer queues are in
-    // the same family.
-    queue_info[0].queueCount = 2;
-    device_info.queueCreateInfoCount = 1;
-    transfer_queue_index = 1;
-#else
-    device_info.queueCreateInfoCount = 1;
-#endif
-  }
+  device_info.pEnabledFeatures = &enabled_features;
 
   // Create the device.
   auto result = physical_device.createDevice(device_info);
@@ -193,32 +228,42 @@ ftl::RefPtr<VulkanDeviceQueues> VulkanDeviceQueues::New(
   vk::Device device = result.value;
 
   // Obtain the queues that we requested to be created with the device.
-  vk::Queue main_queue = device.getQueue(main_queue_family, main_queue_index);
-  vk::Queue transfer_queue =
-      device.getQueue(transfer_queue_family, transfer_queue_index);
+  vk::Queue main_queue = device.getQueue(main_queue_family, 0);
+  vk::Queue transfer_queue = device.getQueue(transfer_queue_family, 0);
+  vk::Queue compute_queue;
+  if (compute_queue_family != UINT32_MAX) {
+    compute_queue = device.getQueue(compute_queue_family, 0);
+  }
 
   return ftl::AdoptRef(new VulkanDeviceQueues(
       device, physical_device, main_queue, main_queue_family, transfer_queue,
-      transfer_queue_family, std::move(instance), std::move(params)));
+      transfer_queue_family, compute_queue, compute_queue_family,
+      enabled_features, std::move(instance), std::move(params)));
 }
 
-VulkanDeviceQueues::VulkanDeviceQueues(vk::Device device,
-                                       vk::PhysicalDevice physical_device,
-                                       vk::Queue main_queue,
-                                       uint32_t main_queue_family,
-                                       vk::Queue transfer_queue,
-                                       uint32_t transfer_queue_family,
-                                       VulkanInstancePtr instance,
-                                       Params params)
+VulkanDeviceQueues::VulkanDeviceQueues(
+    vk::Device device,
+    vk::PhysicalDevice physical_device,
+    vk::Queue main_queue,
+    uint32_t main_queue_family,
+    vk::Queue transfer_queue,
+    uint32_t transfer_queue_family,
+    vk::Queue compute_queue,
+    uint32_t compute_queue_family,
+    vk::PhysicalDeviceFeatures enabled_features,
+    VulkanInstancePtr instance,
+    Params params)
     : device_(device),
       physical_device_(physical_device),
       main_queue_(main_queue),
       main_queue_family_(main_queue_family),
       transfer_queue_(transfer_queue),
       transfer_queue_family_(transfer_queue_family),
+      compute_queue_(compute_queue),
+      compute_queue_family_(compute_queue_family),
       instance_(std::move(instance)),
       params_(std::move(params)),
-      caps_(physical_device.getProperties()),
+      caps_(physical_device.getProperties(), enabled_features),
       proc_addrs_(device_, params_.extension_names) {}
 
 VulkanDeviceQueues::~VulkanDeviceQueues() {
@@ -249,7 +294,8 @@ VulkanContext VulkanDeviceQueues::GetVulkanContext() const {
   return escher::VulkanContext(instance_->vk_instance(), vk_physical_device(),
                                vk_device(), vk_main_queue(),
                                vk_main_queue_family(), vk_transfer_queue(),
-                               vk_transfer_queue_family());
+                               vk_transfer_queue_family(), vk_compute_queue(),
+                               vk_compute_queue_family());
 }
 
 }  // namespace escher
@@ -32,8 +32,16 @@ class VulkanDeviceQueues
   struct Caps {
     uint32_t max_image_width = 0;
     uint32_t max_image_height = 0;
+    uint32_t max_per_stage_descriptor_samplers = 0;
+    uint32_t max_per_stage_descriptor_sampled_images = 0;
 
-    Caps(vk::PhysicalDeviceProperties props);
+    // Optional features that Escher can use.  Each is enabled when the device
+    // is created if the physical device supports it.
+    bool shader_sampled_image_array_dynamic_indexing = false;
+    bool shader_storage_image_extended_formats = false;
+
+    Caps(vk::PhysicalDeviceProperties props,
+         vk::PhysicalDeviceFeatures enabled_features);
   };
 
   // Contains dynamically-obtained addresses of device-specific functions.
@@ -67,6 +75,10 @@ class VulkanDeviceQueues
   uint32_t vk_main_queue_family() const { return main_queue_family_; }
   vk::Queue vk_transfer_queue() const { return transfer_queue_; }
   uint32_t vk_transfer_queue_family() const { return transfer_queue_family_; }
+  // Null if the device has no compute-only queue family, in which case all
+  // compute work is submitted to the main queue.
+  vk::Queue vk_compute_queue() const { return compute_queue_; }
+  uint32_t vk_compute_queue_family() const { return compute_queue_family_; }
   vk::SurfaceKHR vk_surface() const { return params_.surface; }
 
   // Return the parameters that were used to create this device and queues.
@@ -90,6 +102,9 @@ class VulkanDeviceQueues
                      uint32_t main_queue_family,
                      vk::Queue transfer_queue,
                      uint32_t transfer_queue_family,
+                     vk::Queue compute_queue,
+                     uint32_t compute_queue_family,
+                     vk::PhysicalDeviceFeatures enabled_features,
                      VulkanInstancePtr instance,
                      Params params);
 
@@ -99,6 +114,8 @@ class VulkanDeviceQueues
   uint32_t main_queue_family_;
   vk::Queue transfer_queue_;
   uint32_t transfer_queue_family_;
+  vk::Queue compute_queue_;
+  uint32_t compute_queue_family_;
   vk::SurfaceKHR surface_;
   VulkanInstancePtr instance_;
   Params params_;
@@ -4,6 +4,9 @@
 
 #include "sketchy/cubic_bezier.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "ftl/logging.h"
 
 namespace sketchy {
@@ -52,42 +55,80 @@ std::pair<CubicBezier<VecT>, CubicBezier<VecT>> CubicBezier<VecT>::Split(
   return result;
 }
 
-// Compute the cumulative arc length of the curve, using the approach
-// described in "Adaptive subdivision and the length of Bezier curves" by Jens
-// Gravsen. The insight is that the length is bounded below by the length of
-// the line segment (pt0, pt3), and bounded above by the sum of the line
-// segments (pt0, pt1), (pt1, pt2), (pt2, pt3).
+namespace {
+
+inline float Magnitude(float v) {
+  return std::abs(v);
+}
+
+inline float Magnitude(vec2 v) {
+  return length(v);
+}
+
+// The derivative of a cubic Bezier curve is the quadratic Bezier curve with
+// these control points.
 template <typename VecT>
-float CubicBezier<VecT>::ArcLength(uint8_t debug_depth) const {
-  constexpr float kMaxErrorRate = 0.01f;
-  constexpr float kEpsilon = 0.000005f;
-  FTL_DCHECK(debug_depth < 100);
-
-  float upper_bound = distance(pts[0], pts[1]) + distance(pts[1], pts[2]) +
-                      distance(pts[2], pts[3]);
-  float lower_bound = distance(pts[0], pts[3]);
-
-  if (!(upper_bound > 0.f)) {
-    // Catch zero and NaN before they become a problem.
-    return 0.f;
-  } else if ((upper_bound - lower_bound) / upper_bound <= kMaxErrorRate * 2.f) {
-    // Returning the mean of the two bounds guarantees that the result is within
-    // the error tolerance.
-    return 0.5 * (upper_bound + lower_bound);
-  } else if (upper_bound < kEpsilon) {
-    // In some cases, floating point precision will result in non-convergence;
-    // when this is detected, we explicitly terminate recursion.
-    // TODO: Is a constant threshold the right approach?  Is this the right
-    // threshold ?
-    return 0.5 * (upper_bound + lower_bound);
-  } else {
-    // This curve is not flat enough.  Split into two curves, and recursively
-    // evaluate the length of each one.
-    auto pair = Split(0.5);
-    float length_1 = pair.first.ArcLength(debug_depth + 1);
-    float length_2 = pair.second.ArcLength(debug_depth + 1);
-    return length_1 + length_2;
+struct BezierDerivative {
+  explicit BezierDerivative(const CubicBezier<VecT>& bez)
+      : d0((bez.pts[1] - bez.pts[0]) * 3.f),
+        d1((bez.pts[2] - bez.pts[1]) * 3.f),
+        d2((bez.pts[3] - bez.pts[2]) * 3.f) {}
+
+  float Speed(float t) const {
+    const float omt = 1.f - t;
+    return Magnitude(d0 * (omt * omt) + d1 * (2.f * omt * t) + d2 * (t * t));
   }
+
+  // 5-point Gauss-Legendre quadrature of the speed over [t0, t1].  This is
+  // exact for polynomials of degree 9, so it is very accurate wherever the
+  // speed is smooth.
+  float IntegrateSpeed(float t0, float t1) const {
+    constexpr float kNodes[] = {0.f, 0.5384693101056831f, 0.9061798459386640f};
+    constexpr float kWeights[] = {0.5688888888888889f, 0.4786286704993665f,
+                                  0.2369268850561891f};
+    const float half_width = 0.5f * (t1 - t0);
+    const float center = 0.5f * (t0 + t1);
+    float sum = kWeights[0] * Speed(center);
+    for (int i = 1; i < 3; ++i) {
+      const float offset = half_width * kNodes[i];
+      sum += kWeights[i] * (Speed(center - offset) + Speed(center + offset));
+    }
+    return sum * half_width;
+  }
+
+  // Refine |estimate|, the integral over [t0, t1], by splitting the interval
+  // until the halves agree with the whole, or |max_depth| is reached.  The
+  // speed is not smooth near a cusp, which is where subdivision is needed.
+  float IntegrateSpeed(float t0,
+                       float t1,
+                       float estimate,
+                       int max_depth) const {
+    constexpr float kMaxRelativeError = 0.0001f;
+    const float mid = 0.5f * (t0 + t1);
+    const float left = IntegrateSpeed(t0, mid);
+    const float right = IntegrateSpeed(mid, t1);
+    const float refined = left + right;
+    if (max_depth == 0 ||
+        std::abs(refined - estimate) <= kMaxRelativeError * refined) {
+      return refined;
+    }
+    return IntegrateSpeed(t0, mid, left, max_depth - 1) +
+           IntegrateSpeed(mid, t1, right, max_depth - 1);
+  }
+
+  VecT d0, d1, d2;
+};
+
+}  // namespace
+
+template <typename VecT>
+float CubicBezier<VecT>::ArcLength(float t0, float t1) const {
+  // Bounds the cost at 2^(kMaxDepth + 2) - 1 quadratures.
+  constexpr int kMaxDepth = 4;
+  FTL_DCHECK(t0 <= t1);
+  BezierDerivative<VecT> derivative(*this);
+  return derivative.IntegrateSpeed(t0, t1, derivative.IntegrateSpeed(t0, t1),
+                                   kMaxDepth);
 }
 
 // Uses a simplified version of "Approximate Arc Length Parameterization" by
@@ -97,18 +138,52 @@ float CubicBezier<VecT>::ArcLength(uint8_t debug_depth) const {
 template <typename VecT>
 std::pair<CubicBezier1f, float> CubicBezier<VecT>::ArcLengthParameterization()
     const {
-  const float full_length = ArcLength();
-  const float one_third_length = Split(1.f / 3.f).first.ArcLength();
-  const float two_thirds_length = Split(2.f / 3.f).first.ArcLength();
+  const float one_third_length = ArcLength(0.f, 1.f / 3.f);
+  const float two_thirds_length =
+      one_third_length + ArcLength(1.f / 3.f, 2.f / 3.f);
+  const float full_length = two_thirds_length + ArcLength(2.f / 3.f, 1.f);
+
+  CubicBezier1f bez;
+  if (!(full_length > 0.f)) {
+    // A degenerate curve; use the identity parameterization.
+    bez.pts[0] = 0.f;
+    bez.pts[1] = 1.f / 3.f;
+    bez.pts[2] = 2.f / 3.f;
+    bez.pts[3] = 1.f;
+    return std::make_pair(bez, 0.f);
+  }
+
   const float normalizer = 1.f / full_length;
   const float s0 = one_third_length * normalizer;
   const float s1 = two_thirds_length * normalizer;
 
-  CubicBezier1f bez;
+  // The reparameterization maps normalized arc length to the curve parameter,
+  // so it must pass through (s0, 1/3) and (s1, 2/3).  Solve for the two inner
+  // control points that make it do so.
+  const float a00 = 3.f * s0 * (1.f - s0) * (1.f - s0);
+  const float a01 = 3.f * s0 * s0 * (1.f - s0);
+  const float a10 = 3.f * s1 * (1.f - s1) * (1.f - s1);
+  const float a11 = 3.f * s1 * s1 * (1.f - s1);
+  const float b0 = 1.f / 3.f - s0 * s0 * s0;
+  const float b1 = 2.f / 3.f - s1 * s1 * s1;
+  const float det = a00 * a11 - a01 * a10;
+
   bez.pts[0] = 0.f;
-  bez.pts[1] = (18.f * s0 - 9.f * s1 + 2.0) / 6.0;
-  bez.pts[2] = (-9.f * s0 + 18.f * s1 - 5.0) / 6.0;
   bez.pts[3] = 1.f;
+  if (std::abs(det) < 1e-6f) {
+    // The thirds of the curve have wildly different lengths; fall back to the
+    // identity parameterization rather than producing a wild curve.
+    bez.pts[1] = 1.f / 3.f;
+    bez.pts[2] = 2.f / 3.f;
+  } else {
+    // Constrain the control points so that the reparameterization is monotonic
+    // and stays within [0, 1]; curves with loops or cusps would otherwise
+    // overshoot.
+    const float p1 = std::min(std::max((b0 * a11 - b1 * a01) / det, 0.f), 1.f);
+    const float p2 = std::min(std::max((a00 * b1 - a10 * b0) / det, 0.f), 1.f);
+    bez.pts[1] = std::min(p1, 0.5f * (p1 + p2));
+    bez.pts[2] = std::max(p2, 0.5f * (p1 + p2));
+  }
 
   return std::make_pair(bez, full_length);
 }
@@ -174,6 +249,10 @@ CubicBezier<VecT> FitCubicBezier(const VecT* pts,
   return fit;
 }
 
+// Specialization of FitCubicBezier() for 2D.  The dot products with the
+// endpoint tangents are factored out of the loop: for example, the sum of
+// dot(a0, a0) is |endpoint_tangent_0|^2 times the sum of b1^2.  This leaves
+// a short, branch-free loop over the points that the compiler can vectorize.
 CubicBezier2f FitCubicBezier2f(const vec2* pts,
                                int count,
                                const float* params,
@@ -181,100 +260,47 @@ CubicBezier2f FitCubicBezier2f(const vec2* pts,
                                float param_scale,
                                vec2 endpoint_tangent_0,
                                vec2 endpoint_tangent_1) {
-// TODO: consider using vectorized version
-#if 1
-  return FitCubicBezier<vec2>(pts, count, params, param_shift, param_scale,
-                              endpoint_tangent_0, endpoint_tangent_1);
-#else
-  float c00, c01, c10, c11;
-  c00 = c01 = c10 = c11 = 0.0f;
-  vec2 x;
-
-#if 1
-  // Non-vectorized version
+  const vec2 first = pts[0];
+  const vec2 last = pts[count - 1];
+
+  float sum_b1_b1 = 0.f;
+  float sum_b1_b2 = 0.f;
+  float sum_b2_b2 = 0.f;
+  float sum_b1_x = 0.f;
+  float sum_b1_y = 0.f;
+  float sum_b2_x = 0.f;
+  float sum_b2_y = 0.f;
   for (int i = 0; i < count; ++i) {
-    float t = (params[i] + param_shift) * param_scale;
-    float omt = 1.0 - t;
-    float b0 = omt * omt * omt;
-    float b1 = 3.0 * t * omt * omt;
-    float b2 = 3.0 * t * t * omt;
-    float b3 = t * t * t;
-    vec2 a0 = endpoint_tangent_0 * b1;
-    vec2 a1 = endpoint_tangent_1 * b2;
-    c00 += dot(a0, a0);
-    c01 += dot(a0, a1);
-    // c10 == dot(a1, a0) == c01, so don't compute here,
-    // but instead set it just after the loop.
-    c11 += dot(a1, a1);
-    vec2 tmp = pts[i] - (pts[0] * (b0 + b1) + pts[count - 1] * (b2 + b3));
-    x[0] += dot(a0, tmp);
-    x[1] += dot(a1, tmp);
+    const float t = (params[i] + param_shift) * param_scale;
+    const float omt = 1.f - t;
+    const float b0 = omt * omt * omt;
+    const float b1 = 3.f * t * omt * omt;
+    const float b2 = 3.f * t * t * omt;
+    const float b3 = t * t * t;
+    const float b0b1 = b0 + b1;
+    const float b2b3 = b2 + b3;
+    const float tmp_x = pts[i].x - (first.x * b0b1 + last.x * b2b3);
+    const float tmp_y = pts[i].y - (first.y * b0b1 + last.y * b2b3);
+    sum_b1_b1 += b1 * b1;
+    sum_b1_b2 += b1 * b2;
+    sum_b2_b2 += b2 * b2;
+    sum_b1_x += b1 * tmp_x;
+    sum_b1_y += b1 * tmp_y;
+    sum_b2_x += b2 * tmp_x;
+    sum_b2_y += b2 * tmp_y;
   }
-#else  // VECTORIZE
-
-  // Requires -ffast-math.  TODO: experiment with fp_contract pragma (maybe
-  // globally enabling -ffast-math isn't necessary).
 
-  float first_valx = pts[0].x;
-  float first_valy = pts[0].y;
-  float last_valx = pts[count - 1].x;
-  float last_valy = pts[count - 1].y;
+  const float c00 = dot(endpoint_tangent_0, endpoint_tangent_0) * sum_b1_b1;
+  const float c01 = dot(endpoint_tangent_0, endpoint_tangent_1) * sum_b1_b2;
+  const float c11 = dot(endpoint_tangent_1, endpoint_tangent_1) * sum_b2_b2;
+  const float x0 = dot(endpoint_tangent_0, vec2(sum_b1_x, sum_b1_y));
+  const float x1 = dot(endpoint_tangent_1, vec2(sum_b2_x, sum_b2_y));
 
-  float et0x = endpoint_tangent_0[0];
-  float et0y = endpoint_tangent_0[1];
-  float et1x = endpoint_tangent_1[0];
-  float et1y = endpoint_tangent_1[1];
+  float det_c0_c1 = c00 * c11 - c01 * c01;
+  const float det_c0_x = c00 * x1 - c01 * x0;
+  const float det_x_c1 = x0 * c11 - x1 * c01;
 
-  float c00[2000];
-  float c01[2000];
-  float c11[2000];
-  float x0[2000];
-  float x1[2000];
-
-#pragma clang loop vectorize(enable) interleave(enable)
-  for (int i = 0; i < count; i++) {
-    float t = (params[i] + param_shift) * param_scale;
-    float omt = 1.0 - t;
-    float b0 = omt * omt * omt;
-    float b1 = 3.0 * t * omt * omt;
-    float b2 = 3.0 * t * t * omt;
-    float b3 = t * t * t;
-    float b0b1 = b0 + b1;
-    float b2b3 = b2 + b3;
-
-    float a0x = et0x * b1;
-    float a0y = et0y * b1;
-    float a1x = et1x * b2;
-    float a1y = et1y * b2;
-
-    c00[i] = a0x * a0x + a0y * a0y;  // dot(a0, a0);
-    c01[i] = a0x * a1x + a0y * a1y;  // dot(a0, a1);
-    c11[i] = a1x * a1x + a1y * a1y;  // dot(a1, a1);
-    float tmpx = pts[i * 2] - first_valx * b0b1 - last_valx * b2b3;
-    float tmpy = pts[i * 2 + 1] - first_valy * b0b1 - last_valy * b2b3;
-    x0[i] = a0x * tmpx + a0y * tmpy;  // dot(a0, tmp);
-    x1[i] = a1x * tmpx + a1y * tmpy;  // dot(a1, tmp);
-  }
-
-// Accumulate sums.  If we try to do this in the loop above, the vectorizer
-// fails.
-#pragma clang loop vectorize(enable) interleave(enable)
-  for (int i = 0; i < count; i++) {
-    c00 += c00[i];
-    c01 += c01[i];
-    c11 += c11[i];
-    x[0] += x0[i];
-    x[1] += x1[i];
-  }
-#endif  // VECTORIZE
-
-  c10 = c01;
-
-  float det_c0_c1 = c00 * c11 - c10 * c01;
-  float det_c0_x = c00 * x[1] - c01 * x[0];
-  float det_x_c1 = x[0] * c11 - x[1] * c01;
-
-  if (det_c0_c1 == 0.0)
+  if (det_c0_c1 == 0.f)
     det_c0_c1 = c00 * c11 * 10e-12;
 
   // Compute alpha values used to determine the distance along the left/right
@@ -286,17 +312,16 @@ CubicBezier2f FitCubicBezier2f(const vec2* pts,
     // Alpha was negative, so use Wu/Barsky heuristic to place points.
     // TODO: if only one alpha value is negative, should only that one be
     // adjusted?
-    alpha_l = alpha_r = distance(pts[0], pts[count - 1]);
+    alpha_l = alpha_r = distance(first, last);
   }
 
   // Set all 4 control points and return the curve.
   CubicBezier2f fit;
-  fit.pts[0] = pts[0];
-  fit.pts[1] = pts[0] + endpoint_tangent_0 * alpha_l;
-  fit.pts[2] = pts[count - 1] + endpoint_tangent_1 * alpha_r;
-  fit.pts[3] = pts[count - 1];
+  fit.pts[0] = first;
+  fit.pts[1] = first + endpoint_tangent_0 * alpha_l;
+  fit.pts[2] = last + endpoint_tangent_1 * alpha_r;
+  fit.pts[3] = last;
   return fit;
-#endif
 }
 
 std::pair<vec2, vec2> EvaluatePointAndNormal(const CubicBezier<vec2>& bez,
@@ -310,8 +335,44 @@ std::pair<vec2, vec2> EvaluatePointAndNormal(const CubicBezier<vec2>& bez,
   return std::make_pair(pt, vec2{-tangent.y, tangent.x});
 }
 
+void EvaluatePointsAndNormals(const CubicBezier<vec2>& bez,
+                              const float* params,
+                              size_t count,
+                              vec2* points_out,
+                              vec2* normals_out) {
+  // Power-basis coefficients: B(t) = c0 + t * (c1 + t * (c2 + t * c3)).
+  const vec2 c0 = bez.pts[0];
+  const vec2 c1 = (bez.pts[1] - bez.pts[0]) * 3.f;
+  const vec2 c2 = (bez.pts[0] - bez.pts[1] * 2.f + bez.pts[2]) * 3.f;
+  const vec2 c3 = bez.pts[3] - bez.pts[0] + (bez.pts[1] - bez.pts[2]) * 3.f;
+  // The derivative, B'(t) = d0 + t * (d1 + t * d2), gives the tangent.
+  const vec2 d1 = c2 * 2.f;
+  const vec2 d2 = c3 * 3.f;
+
+  for (size_t i = 0; i < count; ++i) {
+    const float t = params[i];
+    const float x = c0.x + t * (c1.x + t * (c2.x + t * c3.x));
+    const float y = c0.y + t * (c1.y + t * (c2.y + t * c3.y));
+    const float tangent_x = c1.x + t * (d1.x + t * d2.x);
+    const float tangent_y = c1.y + t * (d1.y + t * d2.y);
+    const float inverse_length =
+        1.f / std::sqrt(tangent_x * tangent_x + tangent_y * tangent_y);
+    points_out[i] = vec2(x, y);
+    // Rotate tangent clockwise by 90 degrees, as in EvaluatePointAndNormal().
+    normals_out[i] =
+        vec2(-tangent_y * inverse_length, tangent_x * inverse_length);
+  }
+}
+
 // Force instantiation.
 template struct CubicBezier<float>;
 template struct CubicBezier<vec2>;
+template CubicBezier2f FitCubicBezier<vec2>(const vec2* pts,
+                                            int count,
+                                            const float* params,
+                                            float param_shift,
+                                            float param_scale,
+                                            vec2 endpoint_tangent_0,
+                                            vec2 endpoint_tangent_1);
 
 }  // namespace sketchy
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <utility>
 
 #include "sketchy/types.h"
@@ -31,9 +32,13 @@ struct CubicBezier {
   std::pair<CubicBezier<VecT>, CubicBezier<VecT>> Split(float t) const;
 
   // Compute the cumulative arc length of the curve.
-  // TODO: some inputs trigger an infinite recursion; |debug_depth| is used
-  // to detect these conditions.
-  float ArcLength(uint8_t debug_depth = 0) const;
+  float ArcLength() const { return ArcLength(0.f, 1.f); }
+
+  // Compute the arc length of the part of the curve between parameters |t0|
+  // and |t1|, by adaptive Gauss-Legendre quadrature of the magnitude of the
+  // curve's derivative.  The number of subdivisions is bounded, so the cost is
+  // too, even for curves with cusps.
+  float ArcLength(float t0, float t1) const;
 
   // Compute an arc-length parameterization of this curve.  In other words,
   // the following code:
@@ -71,4 +76,14 @@ CubicBezier2f FitCubicBezier2f(const vec2* pts,
 std::pair<vec2, vec2> EvaluatePointAndNormal(const CubicBezier<vec2>& bez,
                                              float t);
 
+// Evaluate the point and normal of |bez| at each of the |count| parameters in
+// |params|; equivalent to EvaluatePointAndNormal() for each parameter, up to
+// rounding.  The curve is converted to polynomial form once, and the loop over
+// the parameters is branch-free so that the compiler can vectorize it.
+void EvaluatePointsAndNormals(const CubicBezier<vec2>& bez,
+                              const float* params,
+                              size_t count,
+                              vec2* points_out,
+                              vec2* normals_out);
+
 }  // namespace sketchy
@@ -5,7 +5,10 @@
 #include "sketchy/page.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <utility>
 
+#include "escher/impl/command_buffer_pool.h"
 #include "escher/material/color_utils.h"
 #include "escher/scene/model.h"
 #include "escher/scene/object.h"
@@ -16,10 +19,13 @@
 namespace sketchy {
 
 Page::Page(escher::Escher* escher)
-    : escher_(escher),
+    : mesh_arena_(escher),
+      stroke_index_buffer_(escher),
+      escher_(escher),
       page_material_(ftl::MakeRefCounted<escher::Material>()),
       wobble_absorber_(
-          std::make_unique<escher::impl::WobbleModifierAbsorber>(escher)) {
+          std::make_unique<escher::impl::WobbleModifierAbsorber>(escher)),
+      worker_pool_(WorkerPool::GetDefaultThreadCount()) {
   page_material_->set_color(vec3(0.6f, 0.6f, 0.6f));
 
   constexpr float h_step = 360.0 / kStrokeColorCount;
@@ -30,10 +36,19 @@ Page::Page(escher::Escher* escher)
   }
 }
 
-Page::~Page() {}
+Page::~Page() {
+  // The meshes of the strokes are kept alive by pending CommandBuffers, and
+  // must be returned to |mesh_arena_| before it is destroyed.
+  escher_->vk_device().waitIdle();
+  escher_->command_buffer_pool()->Cleanup();
+  if (auto pool = escher_->transfer_command_buffer_pool()) {
+    pool->Cleanup();
+  }
+}
 
 Stroke* Page::NewStroke(StrokeId id) {
-  FTL_DCHECK(strokes_.find(id) == strokes_.end());
+  FTL_DCHECK(strokes_.find(id) == strokes_.end() &&
+             FindUnloadedStroke(id) == SIZE_MAX);
   auto stroke = new Stroke(this, id);
   strokes_[id] = std::unique_ptr<Stroke>(stroke);
   return stroke;
@@ -50,39 +65,206 @@ Stroke* Page::GetStroke(StrokeId id) {
 void Page::DeleteStroke(StrokeId id) {
   auto it = strokes_.find(id);
   if (it != strokes_.end()) {
-    dirty_strokes_.erase(it->second.get());
     strokes_.erase(it);
+    stroke_index_.Remove(id);
+    DiscardTessellationRequests(id);
+    loading_strokes_.erase(id);
+  } else {
+    const size_t file_index = FindUnloadedStroke(id);
+    if (file_index != SIZE_MAX) {
+      MarkStrokeLoaded(file_index);
+    }
   }
+  ReleasePageFileIfDone();
+}
+
+void Page::DiscardTessellationRequests(StrokeId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  latest_generations_.erase(id);
+  completed_tessellations_.erase(id);
+  latest_tessellations_.erase(id);
 }
 
-std::vector<size_t> Page::ComputeVertexCounts(const StrokePath& path) {
+size_t Page::EraseStrokesNearPoint(vec2 point, float radius) {
+  return EraseFinalizedStrokes(stroke_index_.FindNearPoint(point, radius));
+}
+
+size_t Page::EraseStrokesInLasso(const std::vector<vec2>& lasso) {
+  return EraseFinalizedStrokes(stroke_index_.FindInLasso(lasso));
+}
+
+size_t Page::EraseFinalizedStrokes(const std::vector<StrokeId>& ids) {
+  size_t count = 0;
+  for (StrokeId id : ids) {
+    // Strokes that are still being drawn are referenced by their fitters.
+    Stroke* stroke = GetStroke(id);
+    if (stroke && stroke->finalized()) {
+      DeleteStroke(id);
+      ++count;
+    }
+  }
+  return count;
+}
+
+std::vector<size_t> Page::ComputeVertexCounts(const StrokePath& path) const {
   std::vector<size_t> counts;
   counts.reserve(path.size());
   for (auto& seg : path) {
     constexpr float kPixelsPerDivision = 4;
     size_t divisions = static_cast<size_t>(seg.length() / kPixelsPerDivision);
     // Each "division" of the stroke consists of two vertices, and we need at
-    // least 2 divisions or else Stroke::Tessellate() might barf when computing
-    // the "param_incr".
+    // least 2 divisions or else TessellateStrokePath() might barf when
+    // computing the "param_incr".
     counts.push_back(std::max(divisions * 2, 4UL));
   }
   return counts;
 }
 
-// TODO: perhaps put all strokes into one shared Buffer.
-void Page::FinalizeStroke(StrokeId id) {}
+void Page::FinalizeStroke(StrokeId id) {
+  // If the stroke's latest tessellation has already been uploaded, move it
+  // into |mesh_arena_| now.  Otherwise, this happens once it arrives.
+  Stroke* stroke = GetStroke(id);
+  if (!stroke || !stroke->tessellation_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = latest_generations_.find(id);
+    if (it != latest_generations_.end() &&
+        it->second != stroke->generation_) {
+      return;
+    }
+  }
+  stroke->SetTessellation(stroke->tessellation_);
+}
+
+void Page::RequestTessellation(StrokeId id,
+                               std::function<StrokePath()> make_path) {
+  const uint64_t generation = next_generation_++;
+  const uint64_t request_microseconds = clock_.GetElapsedMicroseconds();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_generations_[id] = generation;
+  }
+  worker_pool_.PostTask([
+    this, id, generation, request_microseconds,
+    make_path{std::move(make_path)}
+  ] {
+    RunTessellationRequest(id, generation, request_microseconds, make_path);
+  });
+}
+
+void Page::RunTessellationRequest(
+    StrokeId id,
+    uint64_t generation,
+    uint64_t request_microseconds,
+    const std::function<StrokePath()>& make_path) {
+  std::shared_ptr<const StrokeTessellation> base;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = latest_generations_.find(id);
+    if (it == latest_generations_.end() || it->second != generation) {
+      // The stroke was deleted, or a newer request will be run instead.
+      ++stats_.discarded_count;
+      return;
+    }
+    auto base_it = latest_tessellations_.find(id);
+    if (base_it != latest_tessellations_.end()) {
+      base = base_it->second.tessellation;
+    }
+  }
+
+  escher::Stopwatch fit_stopwatch;
+  StrokePath path = make_path();
+  fit_stopwatch.Stop();
+  if (path.empty()) {
+    FTL_LOG(INFO) << "Page::RunTessellationRequest() PATH IS EMPTY";
+    return;
+  }
+
+  escher::Stopwatch tessellate_stopwatch;
+  std::vector<size_t> vertex_counts = ComputeVertexCounts(path);
+  std::shared_ptr<const StrokeTessellation> tessellation =
+      std::make_shared<StrokeTessellation>(
+          TessellateStrokePath(std::move(path), vertex_counts, base.get()));
+  tessellate_stopwatch.Stop();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.fit.Add(fit_stopwatch.GetElapsedMicroseconds());
+  stats_.tessellate.Add(tessellate_stopwatch.GetElapsedMicroseconds());
+  if (latest_generations_.find(id) == latest_generations_.end()) {
+    // The stroke was deleted.
+    return;
+  }
+  // Requests may complete out of order; keep only the newest result, both for
+  // display and as the base of subsequent requests.  Every completed result
+  // is also in |latest_tessellations_|, so checking it suffices, even once
+  // the newer result has been taken from |completed_tessellations_|.
+  auto latest_it = latest_tessellations_.find(id);
+  if (latest_it != latest_tessellations_.end() &&
+      latest_it->second.generation > generation) {
+    ++stats_.discarded_count;
+    return;
+  }
+  CompletedTessellation completed{generation, request_microseconds,
+                                  std::move(tessellation)};
+  latest_tessellations_[id] = completed;
+  auto it = completed_tessellations_.find(id);
+  if (it != completed_tessellations_.end()) {
+    // The previous result was superseded before it was uploaded.
+    ++stats_.discarded_count;
+    it->second = std::move(completed);
+  } else {
+    completed_tessellations_.emplace(id, std::move(completed));
+  }
+}
+
+PageStats Page::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void Page::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_ = PageStats();
+}
+
+void PageStats::Timing::Add(uint64_t microseconds) {
+  ++count;
+  total_microseconds += microseconds;
+  max_microseconds = std::max(max_microseconds, microseconds);
+}
 
 escher::Model* Page::GetModel(const escher::Stopwatch& stopwatch,
                               const escher::Stage* stage) {
   const float current_time_sec = stopwatch.GetElapsedSeconds();
 
-  if (!dirty_strokes_.empty()) {
-    escher::Stopwatch stopwatch;
-    for (auto stroke : dirty_strokes_) {
-      stroke->Tessellate();
+  // Upload the meshes that have been tessellated since the last frame.
+  std::unordered_map<StrokeId, CompletedTessellation> completed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed.swap(completed_tessellations_);
+  }
+  const uint64_t now_microseconds = clock_.GetElapsedMicroseconds();
+  for (auto& pair : completed) {
+    auto it = strokes_.find(pair.first);
+    CompletedTessellation& result = pair.second;
+    if (it == strokes_.end() || it->second->generation_ > result.generation) {
+      continue;
     }
-    dirty_strokes_.clear();
+    Stroke* stroke = it->second.get();
+    const vk::DeviceSize bytes_uploaded = stroke->stroke_mesh_.bytes_uploaded();
+    stroke->generation_ = result.generation;
+    stroke->SetTessellation(std::move(result.tessellation));
+    stroke_index_.Update(pair.first, stroke->tessellation_);
+    loading_strokes_.erase(pair.first);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.latency.Add(now_microseconds - result.request_microseconds);
+    stats_.uploaded_bytes +=
+        stroke->stroke_mesh_.bytes_uploaded() - bytes_uploaded;
   }
+  ReleasePageFileIfDone();
 
   std::vector<escher::Object> objects;
 
@@ -91,26 +273,50 @@ escher::Model* Page::GetModel(const escher::Stopwatch& stopwatch,
       vec2(stage->viewing_volume().width(), stage->viewing_volume().height()),
       0.f, page_material_));
 
-  if (!strokes_.empty()) {
+  // Cull the strokes that are outside the viewing volume.  The margin allows
+  // for the wobble modifier displacing the vertices.
+  const vec2 margin(Stroke::kStrokeWidth, Stroke::kStrokeWidth);
+  const vec2 visible_min = -margin;
+  const vec2 visible_max =
+      vec2(stage->viewing_volume().width(), stage->viewing_volume().height()) +
+      margin;
+  const std::vector<StrokeId> visible_ids =
+      stroke_index_.FindInBox(visible_min, visible_max);
+
+  // Load the saved strokes that have become visible; they are drawn once they
+  // have been tessellated.  The file's bounds don't include the stroke width.
+  if (page_file_) {
+    const vec2 half_width(Stroke::kStrokeWidth * 0.5f,
+                          Stroke::kStrokeWidth * 0.5f);
+    for (size_t file_index : page_file_->FindStrokesInBox(
+             visible_min - half_width, visible_max + half_width)) {
+      if (!page_file_strokes_loaded_[file_index]) {
+        LoadStroke(file_index);
+      }
+    }
+  }
+
+  if (!visible_ids.empty()) {
     const float depth_range = stage->viewing_volume().depth();
-    const float depth_increment = depth_range / (strokes_.size() + 1);
+    const float depth_increment = depth_range / (visible_ids.size() + 1);
     float height = depth_increment;
 
-    size_t material_index =
+    // Derive each stroke's material from its ID, so that it keeps its color
+    // as other strokes are culled.
+    const size_t material_index =
         fabs(fmod(current_time_sec, kStrokeColorCount)) * 40.f;
-    size_t material_step = 10;
-    for (auto& pair : strokes_) {
-      auto& stroke = pair.second;
+    const size_t material_step = 10;
+    for (StrokeId id : visible_ids) {
+      auto& stroke = strokes_.find(id)->second;
       if (auto& mesh = stroke->mesh()) {
-        material_index = (material_index + material_step) % kStrokeColorCount;
-        objects.emplace_back(vec3(0, 0, height), mesh,
-                             stroke_materials_[material_index]);
-
+        objects.emplace_back(
+            vec3(0, 0, height), mesh,
+            stroke_materials_[(material_index + id * material_step) %
+                              kStrokeColorCount]);
         constexpr float PI = 3.14159265359f;
         constexpr float TWO_PI = PI * 2.f;
-        // TODO: the freq-mod should probably be baked into the stroke's
-        // "kPerimeterPos".
-        const float freq_mod = stroke->length() / 100.f;
+        // "kPerimeterPos" is the distance along the stroke in pixels.
+        constexpr float freq_mod = 1.f / 100.f;
         escher::ModifierWobble wobble_data{
             {{-1.1f * TWO_PI, 0.08f, 7.f * freq_mod},
              {-0.2f * TWO_PI, 0.1f, 23.f * freq_mod},
@@ -132,13 +338,115 @@ void Page::Clear() {
   auto it = strokes_.begin();
   while (it != strokes_.end()) {
     if (it->second->finalized()) {
-      // Remove stroke from both strokes_ and dirty_strokes_.
-      dirty_strokes_.erase(it->second.get());
+      DiscardTessellationRequests(it->first);
+      stroke_index_.Remove(it->first);
       it = strokes_.erase(it);
     } else {
       ++it;
     }
   }
+  loading_strokes_.clear();
+  page_file_strokes_loaded_.clear();
+  unloaded_stroke_count_ = 0;
+  page_file_.reset();
+}
+
+bool Page::Save(const std::string& path) const {
+  PageFileWriter writer;
+  for (auto& pair : strokes_) {
+    const Stroke* stroke = pair.second.get();
+    if (!stroke->finalized()) {
+      continue;
+    }
+    auto it = loading_strokes_.find(pair.first);
+    if (it != loading_strokes_.end()) {
+      writer.AddStroke(*page_file_, it->second);
+    } else if (!stroke->path().empty() &&
+               !writer.AddStroke(pair.first, stroke->path())) {
+      FTL_LOG(WARNING) << "Not saving stroke " << pair.first
+                       << ", whose path is not finite";
+    }
+  }
+  for (size_t i = 0; i < page_file_strokes_loaded_.size(); ++i) {
+    if (!page_file_strokes_loaded_[i]) {
+      writer.AddStroke(*page_file_, i);
+    }
+  }
+  return writer.Write(path);
+}
+
+bool Page::Open(const std::string& path) {
+  std::unique_ptr<PageFile> file = PageFile::Open(path);
+  if (!file) {
+    return false;
+  }
+  Clear();
+
+  // Nothing else is read from the file until its strokes become visible.
+  page_file_ = std::move(file);
+  page_file_strokes_loaded_.assign(page_file_->stroke_count(), false);
+  unloaded_stroke_count_ = page_file_->stroke_count();
+  // Strokes that are still being drawn keep their IDs.
+  for (auto& pair : strokes_) {
+    const size_t file_index = page_file_->FindStroke(pair.first);
+    if (file_index != page_file_->stroke_count()) {
+      FTL_LOG(WARNING) << "Page::Open() skipping stroke " << pair.first
+                       << ", which is being drawn";
+      MarkStrokeLoaded(file_index);
+    }
+  }
+  ReleasePageFileIfDone();
+  return true;
+}
+
+StrokeId Page::GetMaxStrokeId() const {
+  StrokeId max_id = strokes_.empty() ? 0 : strokes_.rbegin()->first;
+  if (unloaded_stroke_count_ > 0) {
+    // Strokes are sorted by ID; the last may have been loaded or deleted, but
+    // this is only an upper bound.
+    max_id = std::max(
+        max_id, page_file_->stroke(page_file_->stroke_count() - 1).id);
+  }
+  return max_id;
+}
+
+size_t Page::FindUnloadedStroke(StrokeId id) const {
+  if (unloaded_stroke_count_ == 0) {
+    return SIZE_MAX;
+  }
+  const size_t file_index = page_file_->FindStroke(id);
+  return file_index != page_file_->stroke_count() &&
+                 !page_file_strokes_loaded_[file_index]
+             ? file_index
+             : SIZE_MAX;
+}
+
+void Page::LoadStroke(size_t file_index) {
+  const StrokeId id = page_file_->stroke(file_index).id;
+  MarkStrokeLoaded(file_index);
+  StrokePath path;
+  if (!page_file_->GetPath(file_index, &path)) {
+    // The stroke is dropped, and is not written when the page is next saved.
+    FTL_LOG(WARNING) << "Page::LoadStroke() skipping corrupt stroke " << id;
+    return;
+  }
+  loading_strokes_[id] = file_index;
+  Stroke* stroke = NewStroke(id);
+  stroke->SetPath(std::move(path));
+  stroke->Finalize();
+}
+
+void Page::MarkStrokeLoaded(size_t file_index) {
+  FTL_DCHECK(!page_file_strokes_loaded_[file_index]);
+  page_file_strokes_loaded_[file_index] = true;
+  --unloaded_stroke_count_;
+}
+
+void Page::ReleasePageFileIfDone() {
+  if (page_file_ && unloaded_stroke_count_ == 0 && loading_strokes_.empty()) {
+    page_file_.reset();
+    page_file_strokes_loaded_.clear();
+  }
 }
 
 }  // namespace sketchy
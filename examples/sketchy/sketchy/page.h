@@ -4,16 +4,49 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
-#include <unordered_set>
+#include <mutex>
+#include <unordered_map>
 
 #include "escher/escher.h"
+#include "escher/impl/mesh_arena.h"
 #include "escher/impl/wobble_modifier_absorber.h"
 #include "escher/util/stopwatch.h"
+#include "sketchy/page_file.h"
 #include "sketchy/stroke.h"
+#include "sketchy/stroke_index.h"
+#include "sketchy/stroke_mesh.h"
+#include "sketchy/worker_pool.h"
 
 namespace sketchy {
 
+// Timing of the work done to fit and tessellate strokes; see Page::stats().
+struct PageStats {
+  struct Timing {
+    size_t count = 0;
+    uint64_t total_microseconds = 0;
+    uint64_t max_microseconds = 0;
+
+    void Add(uint64_t microseconds);
+    uint64_t average_microseconds() const {
+      return count ? total_microseconds / count : 0;
+    }
+  };
+
+  // Time spent by worker threads fitting a path to sampled points.
+  Timing fit;
+  // Time spent by worker threads generating vertices for a path.
+  Timing tessellate;
+  // Time from a request until its mesh is picked up by Page::GetModel().
+  Timing latency;
+  // Number of requests that were superseded by a newer request for the same
+  // stroke, and therefore never displayed.
+  size_t discarded_count = 0;
+  // Bytes of vertex data uploaded to stroke meshes; see StrokeMesh.
+  uint64_t uploaded_bytes = 0;
+};
+
 // A |Page| contains a number of drawn |Strokes|.
 class Page {
  public:
@@ -23,29 +56,119 @@ class Page {
   // Instantiate a new |Stroke| with the specified ID; this ID must not
   // correspond to an existing stroke in the page.
   Stroke* NewStroke(StrokeId id);
-  // Get the |Stroke| with the specified ID, or nullptr if none exists.
+  // Get the |Stroke| with the specified ID, or nullptr if none exists.  Also
+  // nullptr for strokes that were loaded by Open() but have not yet been
+  // visible.
   Stroke* GetStroke(StrokeId id);
 
   // Delete the |Stroke| with the specified ID.  No-op if no such stroke exists.
   void DeleteStroke(StrokeId id);
 
+  // Delete the finalized strokes that pass within |radius| of |point|, and
+  // return the number deleted.  Strokes that are still being drawn are kept.
+  size_t EraseStrokesNearPoint(vec2 point, float radius);
+
+  // Delete the finalized strokes that are at least partly inside |lasso|, and
+  // return the number deleted; see StrokeIndex::FindInLasso().
+  size_t EraseStrokesInLasso(const std::vector<vec2>& lasso);
+
+  // Indexes the displayed path of each stroke, for hit-testing.
+  const StrokeIndex& stroke_index() const { return stroke_index_; }
+
   // Compute the number of vertices required to tessellate each segment of the
-  // stroke path.
-  std::vector<size_t> ComputeVertexCounts(const StrokePath& path);
+  // stroke path.  Thread-safe.
+  std::vector<size_t> ComputeVertexCounts(const StrokePath& path) const;
 
-  // Allows the page to be rendered by an escher::Renderer.
+  // Allows the page to be rendered by an escher::Renderer.  Each stroke is
+  // drawn with the most recent mesh that has finished tessellation; this never
+  // waits for tessellation to complete.  Strokes outside the stage's viewing
+  // volume are culled.
   escher::Model* GetModel(const escher::Stopwatch& stopwatch,
                           const escher::Stage* stage);
 
   // Clear all strokes, except those that are still being drawn.
   void Clear();
 
+  // Save the finalized strokes to the file at |path|; see PageFile.  Return
+  // false on failure.
+  bool Save(const std::string& path) const;
+
+  // Replace the finalized strokes with those saved in the file at |path|.  The
+  // file is mapped into memory, and each stroke is only loaded and tessellated
+  // once it becomes visible.  Strokes that are still being drawn are kept, as
+  // are their IDs.  Return false on failure, leaving the page unchanged.
+  bool Open(const std::string& path);
+
+  // The largest ID of any stroke in the page, including those that have not
+  // yet been loaded; 0 if there are none.
+  StrokeId GetMaxStrokeId() const;
+
+  PageStats stats() const;
+  void ResetStats();
+
  private:
   friend class Stroke;
+  friend class StrokeFitter;
+  // Called by Stroke::Finalize(); see StrokeMesh.
   void FinalizeStroke(StrokeId id);
 
+  // Delete those of |ids| that are finalized, and return the number deleted.
+  size_t EraseFinalizedStrokes(const std::vector<StrokeId>& ids);
+
+  // Return the index in |page_file_| of the stroke with the specified ID, if
+  // it has not yet been loaded, or SIZE_MAX otherwise.
+  size_t FindUnloadedStroke(StrokeId id) const;
+  // Create the stroke at |file_index| in |page_file_|, and request its
+  // tessellation.
+  void LoadStroke(size_t file_index);
+  // Record that the stroke at |file_index| in |page_file_| has been loaded or
+  // deleted.
+  void MarkStrokeLoaded(size_t file_index);
+  // Release |page_file_| once it is no longer needed.
+  void ReleasePageFileIfDone();
+
+  // Discard pending and completed tessellation requests for the stroke.
+  void DiscardTessellationRequests(StrokeId id);
+
+  // Asynchronously call |make_path| on a worker thread, and tessellate the
+  // resulting path; the stroke's mesh is updated by a subsequent GetModel().
+  // Requests that have not started by the time that a newer request is made
+  // for the same stroke are skipped, as are results that arrive after a newer
+  // one.  |make_path| must be thread-safe.
+  void RequestTessellation(StrokeId id, std::function<StrokePath()> make_path);
+
+  // Called on a worker thread to run a request made by RequestTessellation().
+  void RunTessellationRequest(StrokeId id,
+                              uint64_t generation,
+                              uint64_t request_microseconds,
+                              const std::function<StrokePath()>& make_path);
+
+  // A tessellation that has completed, but not yet been uploaded.
+  struct CompletedTessellation {
+    uint64_t generation;
+    uint64_t request_microseconds;
+    std::shared_ptr<const StrokeTessellation> tessellation;
+  };
+
+  // Shared by the meshes of all strokes.  Declared first so that they outlive
+  // the strokes in |strokes_|.  Finalized strokes are sub-allocated from
+  // |mesh_arena_|; the others use |stroke_index_buffer_|.
+  escher::impl::MeshArena mesh_arena_;
+  StrokeIndexBuffer stroke_index_buffer_;
+
   std::map<StrokeId, std::unique_ptr<Stroke>> strokes_;
-  std::unordered_set<Stroke*> dirty_strokes_;
+  // Updated whenever a stroke's displayed path changes.
+  StrokeIndex stroke_index_;
+  // The file opened by Open(), while any of its strokes remain to be loaded or
+  // tessellated.  Strokes that have not been loaded are in neither |strokes_|
+  // nor |stroke_index_|; the file's own grid is used to find them instead.
+  std::unique_ptr<PageFile> page_file_;
+  // Whether each stroke in |page_file_| has been loaded (or deleted).
+  std::vector<bool> page_file_strokes_loaded_;
+  size_t unloaded_stroke_count_ = 0;
+  // The index in |page_file_| of each stroke that has been loaded but not yet
+  // tessellated, and therefore has no path of its own to save.
+  std::unordered_map<StrokeId, size_t> loading_strokes_;
 
   static constexpr size_t kStrokeColorCount = 1000;
 
@@ -55,6 +178,29 @@ class Page {
 
   std::unique_ptr<escher::Model> model_;
   std::unique_ptr<escher::impl::WobbleModifierAbsorber> wobble_absorber_;
+
+  // Measures request latency.  Only read once constructed, so it is safe to
+  // use from any thread.
+  const escher::Stopwatch clock_;
+  // Used to order the requests made by RequestTessellation().
+  uint64_t next_generation_ = 1;
+
+  // Guards the members below, which are shared with the worker threads.
+  mutable std::mutex mutex_;
+  // The most recent request for each stroke.
+  std::unordered_map<StrokeId, uint64_t> latest_generations_;
+  // At most one per stroke: the most recent to complete.
+  std::unordered_map<StrokeId, CompletedTessellation> completed_tessellations_;
+  // The tessellation of each stroke from the most recent request to complete,
+  // whether or not it has been uploaded.  Subsequent requests reuse its
+  // unchanged vertices.  Results of older requests that complete later are
+  // discarded.
+  std::unordered_map<StrokeId, CompletedTessellation> latest_tessellations_;
+  PageStats stats_;
+
+  // Declared last, so that the worker threads are joined before the members
+  // that they use are destroyed.
+  WorkerPool worker_pool_;
 };
 
 }  // namespace sketchy
@@ -0,0 +1,423 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/page_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+#include <utility>
+
+namespace sketchy {
+
+namespace {
+
+// The arrays are used in place, so their elements must be plain data.
+static_assert(std::is_trivially_copyable<PageFileHeader>::value,
+              "PageFileHeader must be trivially copyable");
+static_assert(std::is_trivially_copyable<PageFileStroke>::value,
+              "PageFileStroke must be trivially copyable");
+static_assert(std::is_trivially_copyable<PageFileSegment>::value,
+              "PageFileSegment must be trivially copyable");
+static_assert(std::is_trivially_copyable<PageFileCell>::value,
+              "PageFileCell must be trivially copyable");
+
+// Return the grid cell coordinate that contains |coordinate|, clamped so that
+// wild geometry cannot overflow.  |coordinate| must not be NaN.
+int32_t ToCellCoordinate(float coordinate, float cell_size) {
+  FTL_DCHECK(!std::isnan(coordinate));
+  constexpr float kLimit = 1 << 30;
+  return static_cast<int32_t>(std::floor(
+      std::min(std::max(coordinate / cell_size, -kLimit), kLimit)));
+}
+
+// Return the number of cells in the range of cell coordinates from |min| to
+// |max|, inclusive.  The range can be 2^31 cells long, so this is 64-bit.
+uint64_t CellSpan(int32_t min, int32_t max) {
+  return max < min ? 0 : uint64_t(int64_t(max) - int64_t(min) + 1);
+}
+
+bool IsFinite(vec2 v) {
+  return std::isfinite(v.x) && std::isfinite(v.y);
+}
+
+bool CellLess(const PageFileCell& a, const PageFileCell& b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+bool Overlaps(const PageFileStroke& stroke, vec2 min, vec2 max) {
+  return stroke.bounds_min.x <= max.x && min.x <= stroke.bounds_max.x &&
+         stroke.bounds_min.y <= max.y && min.y <= stroke.bounds_max.y;
+}
+
+// Return true if the array of |count| elements of type T at |offset| lies
+// within a file of |file_size| bytes, and is suitably aligned.
+template <typename T>
+bool IsValidArray(uint64_t offset, uint64_t count, size_t file_size) {
+  return offset % alignof(T) == 0 && offset <= file_size &&
+         count <= (file_size - offset) / sizeof(T);
+}
+
+// Write all of |size| bytes to |fd|.  Return false on failure.
+bool WriteAll(int fd, const void* data, size_t size) {
+  const char* ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = write(fd, ptr, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    ptr += written;
+    size -= written;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<PageFile> PageFile::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    FTL_LOG(WARNING) << "Failed to open page file: " << path;
+    return nullptr;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 ||
+      static_cast<size_t>(stat_buf.st_size) < sizeof(PageFileHeader)) {
+    FTL_LOG(WARNING) << "Invalid page file: " << path;
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = stat_buf.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping remains valid once the file is closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    FTL_LOG(WARNING) << "Failed to map page file: " << path;
+    return nullptr;
+  }
+
+  std::unique_ptr<PageFile> file(new PageFile(data, size));
+  if (!file->Validate()) {
+    FTL_LOG(WARNING) << "Invalid page file: " << path;
+    return nullptr;
+  }
+  return file;
+}
+
+PageFile::PageFile(void* data, size_t size)
+    : data_(data),
+      size_(size),
+      header_(static_cast<const PageFileHeader*>(data)) {}
+
+PageFile::~PageFile() {
+  munmap(data_, size_);
+}
+
+bool PageFile::Validate() {
+  if (header_->magic != PageFileHeader::kMagic ||
+      header_->version != PageFileHeader::kVersion ||
+      !(header_->cell_size > 0.f) ||
+      !IsValidArray<PageFileStroke>(header_->strokes_offset,
+                                    header_->stroke_count, size_) ||
+      !IsValidArray<PageFileSegment>(header_->segments_offset,
+                                     header_->segment_count, size_) ||
+      !IsValidArray<PageFileCell>(header_->cells_offset, header_->cell_count,
+                                  size_) ||
+      !IsValidArray<uint32_t>(header_->cell_entries_offset,
+                              header_->cell_entry_count, size_) ||
+      !IsValidArray<uint32_t>(header_->overflow_offset, header_->overflow_count,
+                              size_)) {
+    return false;
+  }
+  const char* data = static_cast<const char*>(data_);
+  strokes_ = reinterpret_cast<const PageFileStroke*>(data +
+                                                     header_->strokes_offset);
+  segments_ = reinterpret_cast<const PageFileSegment*>(
+      data + header_->segments_offset);
+  cells_ = reinterpret_cast<const PageFileCell*>(data + header_->cells_offset);
+  cell_entries_ =
+      reinterpret_cast<const uint32_t*>(data + header_->cell_entries_offset);
+  overflow_ =
+      reinterpret_cast<const uint32_t*>(data + header_->overflow_offset);
+
+  // Check every reference between the arrays now, so that they can later be
+  // followed without checking them.  This doesn't read the segments.
+  for (uint64_t i = 0; i < header_->stroke_count; ++i) {
+    const PageFileStroke& stroke = strokes_[i];
+    if (stroke.segment_count == 0 ||
+        stroke.first_segment > header_->segment_count ||
+        stroke.segment_count > header_->segment_count - stroke.first_segment ||
+        !IsFinite(stroke.bounds_min) || !IsFinite(stroke.bounds_max) ||
+        (i > 0 && strokes_[i - 1].id >= stroke.id)) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < header_->cell_count; ++i) {
+    const PageFileCell& cell = cells_[i];
+    if (cell.first_entry > header_->cell_entry_count ||
+        cell.entry_count > header_->cell_entry_count - cell.first_entry ||
+        (i > 0 && !CellLess(cells_[i - 1], cell))) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < header_->cell_entry_count; ++i) {
+    if (cell_entries_[i] >= header_->stroke_count) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < header_->overflow_count; ++i) {
+    if (overflow_[i] >= header_->stroke_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t PageFile::FindStroke(StrokeId id) const {
+  const PageFileStroke* end = strokes_ + stroke_count();
+  const PageFileStroke* it = std::lower_bound(
+      strokes_, end, id,
+      [](const PageFileStroke& stroke, StrokeId id) { return stroke.id < id; });
+  return it != end && it->id == id ? it - strokes_ : stroke_count();
+}
+
+std::vector<size_t> PageFile::FindStrokesInBox(vec2 min, vec2 max) const {
+  // This is also false if any coordinate is NaN.
+  if (!(min.x <= max.x && min.y <= max.y)) {
+    return std::vector<size_t>();
+  }
+  const float cell_size = header_->cell_size;
+  const int32_t min_x = ToCellCoordinate(min.x, cell_size);
+  const int32_t min_y = ToCellCoordinate(min.y, cell_size);
+  const int32_t max_x = ToCellCoordinate(max.x, cell_size);
+  const int32_t max_y = ToCellCoordinate(max.y, cell_size);
+
+  std::vector<size_t> result;
+  auto add_overlapping = [this, min, max, &result](const PageFileCell& cell) {
+    for (uint32_t i = 0; i < cell.entry_count; ++i) {
+      const uint32_t index = cell_entries_[cell.first_entry + i];
+      if (Overlaps(strokes_[index], min, max)) {
+        result.push_back(index);
+      }
+    }
+  };
+
+  for (uint64_t i = 0; i < header_->overflow_count; ++i) {
+    if (Overlaps(strokes_[overflow_[i]], min, max)) {
+      result.push_back(overflow_[i]);
+    }
+  }
+
+  // Neither span exceeds 2^31, so their product cannot overflow.
+  const PageFileCell* cells_end = cells_ + header_->cell_count;
+  if (CellSpan(min_x, max_x) * CellSpan(min_y, max_y) > header_->cell_count) {
+    // The box covers more cells than are occupied; visit the occupied ones.
+    for (const PageFileCell* cell = cells_; cell != cells_end; ++cell) {
+      if (cell->x >= min_x && cell->x <= max_x && cell->y >= min_y &&
+          cell->y <= max_y) {
+        add_overlapping(*cell);
+      }
+    }
+  } else {
+    // Cells are sorted by x, then y, so each column of the box is a range.
+    for (int32_t x = min_x; x <= max_x; ++x) {
+      const PageFileCell* cell = std::lower_bound(
+          cells_, cells_end, PageFileCell{x, min_y, 0, 0}, CellLess);
+      for (; cell != cells_end && cell->x == x && cell->y <= max_y; ++cell) {
+        add_overlapping(*cell);
+      }
+    }
+  }
+
+  // Strokes that span several cells are found once for each.
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+bool PageFile::GetPath(size_t index, StrokePath* path_out) const {
+  const PageFileStroke& file_stroke = stroke(index);
+  StrokePath path;
+  path.reserve(file_stroke.segment_count);
+  const PageFileSegment* segment = segments_ + file_stroke.first_segment;
+  for (uint32_t i = 0; i < file_stroke.segment_count; ++i, ++segment) {
+    // The grid and culling trust the stroke's bounds, so the geometry must
+    // agree with them.  The bounds are finite, so this also rejects NaNs and
+    // infinities.
+    for (auto& pt : segment->curve.pts) {
+      if (!(pt.x >= file_stroke.bounds_min.x &&
+            pt.y >= file_stroke.bounds_min.y &&
+            pt.x <= file_stroke.bounds_max.x &&
+            pt.y <= file_stroke.bounds_max.y)) {
+        return false;
+      }
+    }
+    if (!std::isfinite(segment->length)) {
+      return false;
+    }
+    path.push_back(StrokeSegment(
+        segment->curve, segment->arc_length_parameterization, segment->length));
+  }
+  *path_out = std::move(path);
+  return true;
+}
+
+PageFileWriter::PageFileWriter(float cell_size) : cell_size_(cell_size) {
+  FTL_DCHECK(cell_size_ > 0.f);
+}
+
+PageFileWriter::~PageFileWriter() {}
+
+bool PageFileWriter::AddStroke(StrokeId id, const StrokePath& path) {
+  FTL_DCHECK(!path.empty());
+  for (auto& seg : path) {
+    for (auto& pt : seg.curve().pts) {
+      if (!IsFinite(pt)) {
+        return false;
+      }
+    }
+  }
+
+  PageFileStroke stroke;
+  stroke.id = id;
+  stroke.first_segment = segments_.size();
+  stroke.segment_count = path.size();
+  stroke.length = 0.f;
+  stroke.bounds_min = path[0].curve().pts[0];
+  stroke.bounds_max = stroke.bounds_min;
+  for (auto& seg : path) {
+    PageFileSegment segment;
+    segment.curve = seg.curve();
+    segment.arc_length_parameterization = seg.arc_length_parameterization();
+    segment.length = seg.length();
+    segments_.push_back(segment);
+
+    stroke.length += seg.length();
+    for (auto& pt : seg.curve().pts) {
+      stroke.bounds_min = glm::min(stroke.bounds_min, pt);
+      stroke.bounds_max = glm::max(stroke.bounds_max, pt);
+    }
+  }
+  strokes_.push_back(stroke);
+  return true;
+}
+
+void PageFileWriter::AddStroke(const PageFile& file, size_t index) {
+  PageFileStroke stroke = file.stroke(index);
+  const PageFileSegment* segments = file.segments_ + stroke.first_segment;
+  stroke.first_segment = segments_.size();
+  segments_.insert(segments_.end(), segments, segments + stroke.segment_count);
+  strokes_.push_back(stroke);
+}
+
+bool PageFileWriter::Write(const std::string& path) const {
+  std::vector<PageFileStroke> strokes(strokes_);
+  std::sort(strokes.begin(), strokes.end(),
+            [](const PageFileStroke& a, const PageFileStroke& b) {
+              return a.id < b.id;
+            });
+
+  // Build the grid by sorting a (cell, stroke) pair for each cell that each
+  // stroke overlaps.  Strokes that span too many cells go in the overflow
+  // list instead.
+  std::vector<std::pair<PageFileCell, uint32_t>> pairs;
+  std::vector<uint32_t> overflow;
+  for (uint32_t i = 0; i < strokes.size(); ++i) {
+    FTL_DCHECK(i == 0 || strokes[i - 1].id != strokes[i].id);
+    const PageFileStroke& stroke = strokes[i];
+    FTL_DCHECK(IsFinite(stroke.bounds_min) && IsFinite(stroke.bounds_max));
+    const int32_t min_x = ToCellCoordinate(stroke.bounds_min.x, cell_size_);
+    const int32_t min_y = ToCellCoordinate(stroke.bounds_min.y, cell_size_);
+    const int32_t max_x = ToCellCoordinate(stroke.bounds_max.x, cell_size_);
+    const int32_t max_y = ToCellCoordinate(stroke.bounds_max.y, cell_size_);
+    if (CellSpan(min_x, max_x) * CellSpan(min_y, max_y) >
+        PageFileHeader::kMaxCellsPerStroke) {
+      overflow.push_back(i);
+      continue;
+    }
+    for (int32_t x = min_x; x <= max_x; ++x) {
+      for (int32_t y = min_y; y <= max_y; ++y) {
+        pairs.push_back(std::make_pair(PageFileCell{x, y, 0, 0}, i));
+      }
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(),
+            [](const std::pair<PageFileCell, uint32_t>& a,
+               const std::pair<PageFileCell, uint32_t>& b) {
+              return CellLess(a.first, b.first) ||
+                     (!CellLess(b.first, a.first) && a.second < b.second);
+            });
+  std::vector<PageFileCell> cells;
+  std::vector<uint32_t> cell_entries;
+  cell_entries.reserve(pairs.size());
+  for (auto& pair : pairs) {
+    if (cells.empty() || CellLess(cells.back(), pair.first)) {
+      cells.push_back(PageFileCell{pair.first.x, pair.first.y,
+                                   static_cast<uint32_t>(cell_entries.size()),
+                                   0});
+    }
+    ++cells.back().entry_count;
+    cell_entries.push_back(pair.second);
+  }
+
+  // Each array's size is a multiple of the alignment of the next.
+  static_assert(sizeof(PageFileHeader) % alignof(PageFileStroke) == 0 &&
+                    sizeof(PageFileStroke) % alignof(PageFileSegment) == 0 &&
+                    sizeof(PageFileSegment) % alignof(PageFileCell) == 0 &&
+                    sizeof(PageFileCell) % alignof(uint32_t) == 0,
+                "page file arrays would be misaligned");
+  PageFileHeader header = {};
+  header.magic = PageFileHeader::kMagic;
+  header.version = PageFileHeader::kVersion;
+  header.stroke_count = strokes.size();
+  header.segment_count = segments_.size();
+  header.cell_count = cells.size();
+  header.cell_entry_count = cell_entries.size();
+  header.overflow_count = overflow.size();
+  header.strokes_offset = sizeof(PageFileHeader);
+  header.segments_offset =
+      header.strokes_offset + strokes.size() * sizeof(PageFileStroke);
+  header.cells_offset =
+      header.segments_offset + segments_.size() * sizeof(PageFileSegment);
+  header.cell_entries_offset =
+      header.cells_offset + cells.size() * sizeof(PageFileCell);
+  header.overflow_offset =
+      header.cell_entries_offset + cell_entries.size() * sizeof(uint32_t);
+  header.cell_size = cell_size_;
+
+  const std::string temp_path = path + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    FTL_LOG(WARNING) << "Failed to create page file: " << temp_path;
+    return false;
+  }
+  bool success =
+      WriteAll(fd, &header, sizeof(header)) &&
+      WriteAll(fd, strokes.data(), strokes.size() * sizeof(PageFileStroke)) &&
+      WriteAll(fd, segments_.data(),
+               segments_.size() * sizeof(PageFileSegment)) &&
+      WriteAll(fd, cells.data(), cells.size() * sizeof(PageFileCell)) &&
+      WriteAll(fd, cell_entries.data(),
+               cell_entries.size() * sizeof(uint32_t)) &&
+      WriteAll(fd, overflow.data(), overflow.size() * sizeof(uint32_t));
+  success = close(fd) == 0 && success;
+  if (!success || rename(temp_path.c_str(), path.c_str()) != 0) {
+    FTL_LOG(WARNING) << "Failed to write page file: " << path;
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace sketchy
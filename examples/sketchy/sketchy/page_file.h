@@ -0,0 +1,162 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ftl/logging.h"
+#include "ftl/macros.h"
+#include "sketchy/stroke.h"
+#include "sketchy/stroke_tessellation.h"
+
+namespace sketchy {
+
+// A saved page consists of a PageFileHeader followed by these contiguous
+// arrays, at the offsets given by the header:
+//   - One PageFileStroke per stroke, sorted by ID.
+//   - The PageFileSegments of every stroke.  Each stroke refers to its
+//     segments by their index in this array.
+//   - A uniform grid over the strokes' bounds: the occupied PageFileCells,
+//     sorted by position, each referring to a range of the next array.
+//   - The index in the stroke array of each stroke that overlaps each cell.
+//   - The index in the stroke array of each stroke whose bounds span more than
+//     kMaxCellsPerStroke cells.  These strokes are not in the grid, and are
+//     tested against every query instead.
+// Values are stored in native byte order; a file written on a machine of the
+// other endianness is rejected, because its magic number doesn't match.
+//
+// Everything that is needed to find and draw a stroke is precomputed, so that
+// a page can be used in place once it is mapped into memory.
+struct PageFileHeader {
+  static constexpr uint32_t kMagic = 0x47504b53;  // "SKPG"
+  static constexpr uint32_t kVersion = 2;
+  // Strokes that span more cells than this are kept out of the grid, so that
+  // a huge stroke cannot bloat the file.
+  static constexpr uint64_t kMaxCellsPerStroke = 1024;
+
+  uint32_t magic;
+  uint32_t version;
+  uint64_t stroke_count;
+  uint64_t segment_count;
+  uint64_t cell_count;
+  uint64_t cell_entry_count;
+  uint64_t overflow_count;
+  // Offsets from the start of the file.
+  uint64_t strokes_offset;
+  uint64_t segments_offset;
+  uint64_t cells_offset;
+  uint64_t cell_entries_offset;
+  uint64_t overflow_offset;
+  // The size of each grid cell, in pixels.
+  float cell_size;
+  uint32_t padding;
+};
+
+struct PageFileStroke {
+  uint64_t id;
+  uint64_t first_segment;
+  uint32_t segment_count;
+  float length;
+  // The bounds of the control points of the stroke's segments; the stroke's
+  // center line lies within them.  They are always finite.
+  vec2 bounds_min;
+  vec2 bounds_max;
+};
+
+struct PageFileSegment {
+  CubicBezier2f curve;
+  CubicBezier1f arc_length_parameterization;
+  float length;
+};
+
+struct PageFileCell {
+  int32_t x;
+  int32_t y;
+  uint32_t first_entry;
+  uint32_t entry_count;
+};
+
+// A saved page, mapped read-only into memory.  Only the parts of the file that
+// are used are read from disk, so opening even a very large page is cheap.
+class PageFile {
+ public:
+  // Map and validate the file at |path|.  Return null if the file cannot be
+  // read, or is not a valid page.
+  static std::unique_ptr<PageFile> Open(const std::string& path);
+  ~PageFile();
+
+  size_t stroke_count() const { return header_->stroke_count; }
+  const PageFileStroke& stroke(size_t index) const {
+    FTL_DCHECK(index < stroke_count());
+    return strokes_[index];
+  }
+
+  // Return the index of the stroke with the specified ID, or stroke_count()
+  // if there is none.
+  size_t FindStroke(StrokeId id) const;
+
+  // Return the indices of the strokes whose bounds overlap the box from |min|
+  // to |max|, sorted.  The bounds are those of the strokes' center lines, so
+  // the box should allow for the width of the strokes.  A box with a NaN
+  // coordinate, or whose |min| exceeds its |max|, contains no strokes.
+  std::vector<size_t> FindStrokesInBox(vec2 min, vec2 max) const;
+
+  // Set |path_out| to the path of the stroke at |index|.  The arc-length
+  // parameterizations are copied rather than recomputed.  Segments are not
+  // checked until they are read, so return false if any has a non-finite
+  // control point or length, or a control point outside the stroke's bounds.
+  bool GetPath(size_t index, StrokePath* path_out) const;
+
+ private:
+  friend class PageFileWriter;
+  PageFile(void* data, size_t size);
+
+  // Return true if the mapped data is a valid page.  If so, set the pointers
+  // to the arrays.
+  bool Validate();
+
+  void* const data_;
+  const size_t size_;
+  const PageFileHeader* const header_;
+  const PageFileStroke* strokes_ = nullptr;
+  const PageFileSegment* segments_ = nullptr;
+  const PageFileCell* cells_ = nullptr;
+  const uint32_t* cell_entries_ = nullptr;
+  const uint32_t* overflow_ = nullptr;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageFile);
+};
+
+// Accumulates strokes, and writes them to a page file.
+class PageFileWriter {
+ public:
+  static constexpr float kDefaultCellSize = 256.f;  // pixels
+
+  explicit PageFileWriter(float cell_size = kDefaultCellSize);
+  ~PageFileWriter();
+
+  // Return false, and don't add the stroke, if its control points are not all
+  // finite.
+  bool AddStroke(StrokeId id, const StrokePath& path);
+  // Copy the stroke at |index| in |file|, without building its path.
+  void AddStroke(const PageFile& file, size_t index);
+
+  // Write the strokes to |path|.  The file is written under a temporary name
+  // and then renamed, so that a PageFile that maps the previous version of the
+  // file remains valid.  Return false on failure.
+  bool Write(const std::string& path) const;
+
+ private:
+  const float cell_size_;
+  std::vector<PageFileStroke> strokes_;
+  std::vector<PageFileSegment> segments_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageFileWriter);
+};
+
+}  // namespace sketchy
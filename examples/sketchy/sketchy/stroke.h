@@ -4,17 +4,19 @@
 
 #pragma once
 
-#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 #include "escher/shape/mesh.h"
-#include "sketchy/stroke_segment.h"
+#include "sketchy/stroke_mesh.h"
+#include "sketchy/stroke_tessellation.h"
 
 namespace sketchy {
 
 class Page;
 
 typedef uint64_t StrokeId;
-typedef std::vector<StrokeSegment> StrokePath;
 
 // Represents a stroke drawn on a |Page|.  The path of the stroke is represented
 // as a piecewise cubic Bezier curve.  The renderable representation of the
@@ -25,27 +27,34 @@ class Stroke {
   static constexpr float kStrokeWidth = 60.f;  // pixels
 
   void Finalize();
+  // The path is tessellated asynchronously by the Page.  Until the new mesh is
+  // available, path(), mesh() and length() continue to describe the previous
+  // path.
   void SetPath(StrokePath path);
 
   StrokeId id() const { return id_; }
-  const StrokePath& path() const { return path_; }
+  const StrokePath& path() const;
   const escher::MeshPtr& mesh() const { return mesh_; }
-  float length() const { return length_; }
+  float length() const { return tessellation_ ? tessellation_->length : 0.f; }
   bool finalized() const { return finalized_; }
 
  private:
   friend class Page;
   Stroke(Page* page, StrokeId id);
 
-  void Tessellate();
+  // Replace the stroke's mesh with one that draws |tessellation|.  Called by
+  // the Page on the render thread.
+  void SetTessellation(std::shared_ptr<const StrokeTessellation> tessellation);
 
   Page* const page_;
   const StrokeId id_;
-  StrokePath path_;
+  // The tessellation drawn by |mesh_|, if any.
+  std::shared_ptr<const StrokeTessellation> tessellation_;
+  StrokeMesh stroke_mesh_;
   escher::MeshPtr mesh_;
-  int vertex_count_ = 0;
-  int offset_ = 0;
-  float length_ = 0.f;
+  // Identifies the Page request that produced |mesh_|; see
+  // Page::RequestTessellation().
+  uint64_t generation_ = 0;
   std::atomic_bool finalized_;
 };
 
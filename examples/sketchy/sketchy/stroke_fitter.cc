@@ -3,6 +3,10 @@
 // found in the LICENSE file.
 
 #include "sketchy/stroke_fitter.h"
+
+#include <atomic>
+#include <mutex>
+
 #include "sketchy/debug_print.h"
 
 namespace sketchy {
@@ -10,11 +14,189 @@ namespace sketchy {
 // TODO: make configurable.
 static constexpr float kErrorThreshold = 10;
 
+namespace {
+
+void FitSampleRange(const std::vector<vec2>& points,
+                    const std::vector<float>& params,
+                    float error_threshold,
+                    int start_index,
+                    int end_index,
+                    vec2 left_tangent,
+                    vec2 right_tangent,
+                    StrokePath* path,
+                    std::vector<int>* end_indices) {
+  FTL_DCHECK(glm::length(left_tangent) > 0 && glm::length(right_tangent))
+      << "  left: " << left_tangent << "  right: " << right_tangent;
+  FTL_DCHECK(end_index > start_index);
+  if (end_index - start_index == 1) {
+    // Only two points... use a heuristic.
+    // TODO: Double-check this heuristic (perhaps normalization needed?)
+    // TODO: Perhaps this segment can be omitted entirely, e.g. by blending
+    //       endpoints of the adjacent segments.
+    CubicBezier2f line;
+    line.pts[0] = points[start_index];
+    line.pts[3] = points[end_index];
+    line.pts[1] = line.pts[0] + (left_tangent * 0.25f);
+    line.pts[2] = line.pts[3] + (right_tangent * 0.25f);
+    FTL_DCHECK(!std::isnan(line.pts[0].x));
+    FTL_DCHECK(!std::isnan(line.pts[0].y));
+    FTL_DCHECK(!std::isnan(line.pts[1].x));
+    FTL_DCHECK(!std::isnan(line.pts[1].y));
+    FTL_DCHECK(!std::isnan(line.pts[2].x));
+    FTL_DCHECK(!std::isnan(line.pts[2].y));
+    FTL_DCHECK(!std::isnan(line.pts[3].x));
+    FTL_DCHECK(!std::isnan(line.pts[3].y));
+    path->push_back(line);
+    end_indices->push_back(end_index);
+    return;
+  }
+
+  // Normalize cumulative length between 0.0 and 1.0.
+  float param_shift = -params[start_index];
+  float param_scale = 1.0 / (params[end_index] + param_shift);
+
+  CubicBezier2f bez =
+      FitCubicBezier2f(&(points[start_index]), end_index - start_index + 1,
+                       &(params[start_index]), param_shift, param_scale,
+                       left_tangent, right_tangent);
+
+  int split_index = (end_index + start_index + 1) / 2;
+  float max_error = 0.0;
+  for (int i = start_index; i <= end_index; ++i) {
+    float t = (params[i] + param_shift) * param_scale;
+    vec2 diff = points[i] - bez.Evaluate(t);
+    float error = dot(diff, diff);
+    if (error > max_error) {
+      max_error = error;
+      split_index = i;
+    }
+  }
+
+  // The current fit is good enough... add it to the path and stop recursion.
+  if (max_error < error_threshold) {
+    FTL_DCHECK(!std::isnan(bez.pts[0].x));
+    FTL_DCHECK(!std::isnan(bez.pts[0].y));
+    FTL_DCHECK(!std::isnan(bez.pts[1].x));
+    FTL_DCHECK(!std::isnan(bez.pts[1].y));
+    FTL_DCHECK(!std::isnan(bez.pts[2].x));
+    FTL_DCHECK(!std::isnan(bez.pts[2].y));
+    FTL_DCHECK(!std::isnan(bez.pts[3].x));
+    FTL_DCHECK(!std::isnan(bez.pts[3].y));
+    path->push_back(bez);
+    end_indices->push_back(end_index);
+    return;
+  }
+
+  // Error is too large... split into two ranges and fit each.
+  FTL_DCHECK(split_index > start_index && split_index < end_index);
+  // Compute the tangent on each side of the split point.
+  // TODO: some filtering may be desirable here.
+  vec2 right_middle_tangent = points[split_index + 1] - points[split_index];
+  if (glm::length(right_middle_tangent) == 0.f) {
+    // The two points on either side of the split point are identical: the
+    // user's path doubled back upon itself.  Instead, compute the tangent using
+    // the point at the split-index.
+    right_middle_tangent = points[split_index + 1] - points[split_index];
+  }
+  vec2 left_middle_tangent = right_middle_tangent * -1.f;
+  FitSampleRange(points, params, error_threshold, start_index, split_index,
+                 left_tangent, left_middle_tangent, path, end_indices);
+  FitSampleRange(points, params, error_threshold, split_index, end_index,
+                 right_middle_tangent, right_tangent, path, end_indices);
+}
+
+}  // namespace
+
+// Segments near the start of the stroke are "frozen" once they end this far
+// (in pixels) behind the most recent sampled point; they are then never refit.
+static constexpr float kFreezeDistance = 2.f * Stroke::kStrokeWidth;
+
+// The frozen prefix of the stroke's path.  Shared between the StrokeFitter and
+// the fitting tasks that it posts to the Page's worker threads.
+struct StrokeFitter::FitState {
+  std::mutex mutex;
+  StrokePath frozen_path;
+  // Index of the sampled point at which |frozen_path| ends.  Only increases;
+  // atomic so that the StrokeFitter can read it without waiting for a task.
+  std::atomic<size_t> frozen_point_index{0};
+  // Tangent at the end of |frozen_path|, used as the left tangent of the
+  // unfrozen tail so that the path remains smooth.
+  vec2 frozen_tangent;
+};
+
+StrokePath StrokeFitter::FitTail(FitState* state,
+                                 size_t first_point_index,
+                                 const std::vector<vec2>& points,
+                                 const std::vector<float>& params,
+                                 size_t sampled_point_count,
+                                 float error_threshold) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+
+  // |points| begins at |first_point_index|, which was frozen when the task
+  // was posted.  Another task may since have frozen more points, possibly
+  // including some that are missing from this (older) request; its result
+  // will be discarded anyway.
+  FTL_DCHECK(state->frozen_point_index >= first_point_index);
+  const size_t start_index = state->frozen_point_index - first_point_index;
+  const size_t end_index = points.size() - 1;
+  if (end_index <= start_index) {
+    return state->frozen_path;
+  }
+
+  // Fit only the tail of the stroke, after the frozen segments.
+  StrokePath tail;
+  std::vector<int> end_indices;
+  vec2 left_tangent = state->frozen_path.empty() ? points[1] - points[0]
+                                                 : state->frozen_tangent;
+  vec2 right_tangent = points[end_index - 1] - points[end_index];
+  FitSampleRange(points, params, error_threshold, start_index, end_index,
+                 left_tangent, right_tangent, &tail, &end_indices);
+
+  // Freeze tail segments that end far enough behind the last sampled point.
+  // Segments that depend on predicted points are never frozen.
+  FTL_DCHECK(sampled_point_count > 0 && sampled_point_count <= points.size());
+  const size_t last_sampled_index = sampled_point_count - 1;
+  size_t frozen_count = 0;
+  while (frozen_count < tail.size()) {
+    const size_t segment_end = end_indices[frozen_count];
+    if (segment_end >= last_sampled_index ||
+        params[last_sampled_index] - params[segment_end] < kFreezeDistance) {
+      break;
+    }
+    ++frozen_count;
+  }
+  if (frozen_count > 0) {
+    auto& curve = tail[frozen_count - 1].curve();
+    const size_t segment_end = end_indices[frozen_count - 1];
+    state->frozen_tangent = curve.pts[3] - curve.pts[2];
+    if (glm::length(state->frozen_tangent) == 0.f) {
+      state->frozen_tangent = points[segment_end + 1] - points[segment_end];
+    }
+    state->frozen_point_index = first_point_index + segment_end;
+  }
+
+  // The result is the frozen prefix followed by the refit tail; only the
+  // latter differs from the previous result.
+  for (size_t i = 0; i < frozen_count; ++i) {
+    state->frozen_path.push_back(tail[i]);
+  }
+  StrokePath path;
+  path.reserve(state->frozen_path.size() + tail.size() - frozen_count);
+  for (auto& seg : state->frozen_path) {
+    path.push_back(seg);
+  }
+  for (size_t i = frozen_count; i < tail.size(); ++i) {
+    path.push_back(tail[i]);
+  }
+  return path;
+}
+
 StrokeFitter::StrokeFitter(Page* page, StrokeId id)
     : page_(page),
       stroke_(page_->NewStroke(id)),
       stroke_id_(id),
-      error_threshold_(kErrorThreshold) {}
+      error_threshold_(kErrorThreshold),
+      fit_state_(std::make_shared<FitState>()) {}
 
 StrokeFitter::~StrokeFitter() {
   FTL_DCHECK(finished_);
@@ -64,32 +246,36 @@ void StrokeFitter::ContinueStroke(std::vector<vec2> sampled_points,
     return;
   }
 
-  // Recursively compute a list of cubic Bezier segments.
-  // TODO: don't recompute stable path segments near the beginning of the
-  // stroke.
-  size_t end_index = points_.size() - 1;
-  vec2 left_tangent = points_[1] - points_[0];
-  vec2 right_tangent = points_[end_index - 1] - points_[end_index];
-  FitSampleRange(0, end_index, left_tangent, right_tangent);
-
-  // TODO: remove... this is just basic sanity-check for Split() given that
-  // I don't have unit tests running.
-  StrokePath split_path;
-  for (auto seg : path_) {
-    auto split = seg.curve().Split(0.5);
-    split_path.push_back(StrokeSegment(split.first));
-    split_path.push_back(StrokeSegment(split.second));
+  if (points_.size() < 2) {
+    return;
   }
-  path_ = std::move(split_path);
 
-  // For each of the segments computed above, compute the total segment length
+  // Refit the unfrozen tail of the stroke on a worker thread, so that the cost
+  // of each update is bounded regardless of the length of the stroke.
+  //
+  // For each of the segments, the Page then computes the total segment length
   // and a arc-length parameterization.  This parameterization is a 1-D cubic
   // Bezier such that an input parameter t in the range [0,1] results in a
   // new parameter t' (also in [0,1]) such that evaluating the original
   // curve-segment at t' returns the point on the segment where the cumulative
   // arc-length to that point is t * total_segment_length.
-  FTL_DCHECK(!path_.empty());
-  stroke_->SetPath(std::move(path_));
+  FTL_DCHECK(!stroke_->finalized());
+  // Only the points after the frozen prefix are copied for the task.
+  const size_t first_point_index = fit_state_->frozen_point_index;
+  const size_t sampled_point_count = points_.size() - predicted_point_count_;
+  FTL_DCHECK(sampled_point_count > first_point_index);
+  page_->RequestTessellation(stroke_id_, [
+    state = fit_state_, first_point_index,
+    points = std::vector<vec2>(points_.begin() + first_point_index,
+                               points_.end()),
+    params = std::vector<float>(params_.begin() + first_point_index,
+                                params_.end()),
+    sampled_point_count = sampled_point_count - first_point_index,
+    threshold = error_threshold_
+  ] {
+    return FitTail(state.get(), first_point_index, points, params,
+                   sampled_point_count, threshold);
+  });
 }
 
 void StrokeFitter::FinishStroke() {
@@ -108,84 +294,4 @@ void StrokeFitter::CancelStroke() {
   finished_ = true;
 }
 
-void StrokeFitter::FitSampleRange(int start_index,
-                                  int end_index,
-                                  vec2 left_tangent,
-                                  vec2 right_tangent) {
-  FTL_DCHECK(glm::length(left_tangent) > 0 && glm::length(right_tangent))
-      << "  left: " << left_tangent << "  right: " << right_tangent;
-  FTL_DCHECK(end_index > start_index);
-  if (end_index - start_index == 1) {
-    // Only two points... use a heuristic.
-    // TODO: Double-check this heuristic (perhaps normalization needed?)
-    // TODO: Perhaps this segment can be omitted entirely, e.g. by blending
-    //       endpoints of the adjacent segments.
-    CubicBezier2f line;
-    line.pts[0] = points_[start_index];
-    line.pts[3] = points_[end_index];
-    line.pts[1] = line.pts[0] + (left_tangent * 0.25f);
-    line.pts[2] = line.pts[3] + (right_tangent * 0.25f);
-    FTL_DCHECK(!std::isnan(line.pts[0].x));
-    FTL_DCHECK(!std::isnan(line.pts[0].y));
-    FTL_DCHECK(!std::isnan(line.pts[1].x));
-    FTL_DCHECK(!std::isnan(line.pts[1].y));
-    FTL_DCHECK(!std::isnan(line.pts[2].x));
-    FTL_DCHECK(!std::isnan(line.pts[2].y));
-    FTL_DCHECK(!std::isnan(line.pts[3].x));
-    FTL_DCHECK(!std::isnan(line.pts[3].y));
-    path_.push_back(line);
-    return;
-  }
-
-  // Normalize cumulative length between 0.0 and 1.0.
-  float param_shift = -params_[start_index];
-  float param_scale = 1.0 / (params_[end_index] + param_shift);
-
-  CubicBezier2f bez =
-      FitCubicBezier2f(&(points_[start_index]), end_index - start_index + 1,
-                       &(params_[start_index]), param_shift, param_scale,
-                       left_tangent, right_tangent);
-
-  int split_index = (end_index + start_index + 1) / 2;
-  float max_error = 0.0;
-  for (int i = start_index; i <= end_index; ++i) {
-    float t = (params_[i] + param_shift) * param_scale;
-    vec2 diff = points_[i] - bez.Evaluate(t);
-    float error = dot(diff, diff);
-    if (error > max_error) {
-      max_error = error;
-      split_index = i;
-    }
-  }
-
-  // The current fit is good enough... add it to the path and stop recursion.
-  if (max_error < error_threshold_) {
-    FTL_DCHECK(!std::isnan(bez.pts[0].x));
-    FTL_DCHECK(!std::isnan(bez.pts[0].y));
-    FTL_DCHECK(!std::isnan(bez.pts[1].x));
-    FTL_DCHECK(!std::isnan(bez.pts[1].y));
-    FTL_DCHECK(!std::isnan(bez.pts[2].x));
-    FTL_DCHECK(!std::isnan(bez.pts[2].y));
-    FTL_DCHECK(!std::isnan(bez.pts[3].x));
-    FTL_DCHECK(!std::isnan(bez.pts[3].y));
-    path_.push_back(bez);
-    return;
-  }
-
-  // Error is too large... split into two ranges and fit each.
-  FTL_DCHECK(split_index > start_index && split_index < end_index);
-  // Compute the tangent on each side of the split point.
-  // TODO: some filtering may be desirable here.
-  vec2 right_middle_tangent = points_[split_index + 1] - points_[split_index];
-  if (glm::length(right_middle_tangent) == 0.f) {
-    // The two points on either side of the split point are identical: the
-    // user's path doubled back upon itself.  Instead, compute the tangent using
-    // the point at the split-index.
-    right_middle_tangent = points_[split_index + 1] - points_[split_index];
-  }
-  vec2 left_middle_tangent = right_middle_tangent * -1.f;
-  FitSampleRange(start_index, split_index, left_tangent, left_middle_tangent);
-  FitSampleRange(split_index, end_index, right_middle_tangent, right_tangent);
-}
-
 }  // namespace sketchy
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "escher/escher.h"
@@ -14,7 +15,12 @@ namespace sketchy {
 
 // Iteratively fits a piecewise cubic Bezier curve to the sampled input points.
 // Generates a |Stroke| in the target |Page|, and notifies them when the stroke
-// must be re-tessellated.
+// must be re-tessellated.  The fitting itself runs on one of the |Page|'s
+// worker threads; see Page::RequestTessellation().
+//
+// Fitting is incremental: once a segment ends far enough behind the pen it is
+// frozen, and only the points after the frozen segments are refit.  The cost
+// of each update therefore does not grow with the length of the stroke.
 class StrokeFitter {
  public:
   StrokeFitter(Page* page, StrokeId id);
@@ -30,10 +36,19 @@ class StrokeFitter {
   void CancelStroke();
 
  private:
-  void FitSampleRange(int start_index,
-                      int end_index,
-                      vec2 left_tangent,
-                      vec2 right_tangent);
+  struct FitState;
+
+  // Refit the points after the frozen prefix of |state|, freeze any segments
+  // that are now far enough behind the last sampled point, and return the
+  // entire path.  |points| and |params| begin at |first_point_index|, and
+  // their first |sampled_point_count| entries are sampled rather than
+  // predicted.  Called on a worker thread.
+  static StrokePath FitTail(FitState* state,
+                            size_t first_point_index,
+                            const std::vector<vec2>& points,
+                            const std::vector<float>& params,
+                            size_t sampled_point_count,
+                            float error_threshold);
 
   Page* const page_;
   Stroke* const stroke_;
@@ -42,7 +57,7 @@ class StrokeFitter {
   std::vector<vec2> points_;
   std::vector<float> params_;
   float error_threshold_;
-  StrokePath path_;
+  std::shared_ptr<FitState> fit_state_;
   size_t predicted_point_count_ = 0;
   bool finished_ = false;
 };
@@ -0,0 +1,308 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/stroke_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ftl/logging.h"
+
+namespace sketchy {
+
+namespace {
+
+// Return the distance from |point| to the line segment from |a| to |b|.
+float DistanceToLineSegment(vec2 point, vec2 a, vec2 b) {
+  const vec2 ab = b - a;
+  const float length_squared = dot(ab, ab);
+  float t = length_squared > 0.f ? dot(point - a, ab) / length_squared : 0.f;
+  t = std::min(std::max(t, 0.f), 1.f);
+  return distance(point, a + ab * t);
+}
+
+// Return true if |point| is inside |polygon|, using the even-odd rule.
+bool IsInsidePolygon(vec2 point, const std::vector<vec2>& polygon) {
+  bool inside = false;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const vec2& a = polygon[i];
+    const vec2& b = polygon[j];
+    if ((a.y > point.y) != (b.y > point.y) &&
+        point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+// Convert a cell coordinate to an integer, clamping it so that wild geometry
+// cannot overflow.  |coordinate| must not be NaN.
+int32_t ToCellCoordinate(float coordinate) {
+  FTL_DCHECK(!std::isnan(coordinate));
+  constexpr float kLimit = 1 << 30;
+  return static_cast<int32_t>(
+      std::floor(std::min(std::max(coordinate, -kLimit), kLimit)));
+}
+
+}  // namespace
+
+StrokeIndex::StrokeIndex(float cell_size) : cell_size_(cell_size) {
+  FTL_DCHECK(cell_size_ > 0.f);
+}
+
+StrokeIndex::~StrokeIndex() {}
+
+void StrokeIndex::Update(
+    StrokeId id,
+    std::shared_ptr<const StrokeTessellation> tessellation) {
+  StrokeEntry& entry = strokes_[id];
+  const StrokePath& path = tessellation->path;
+  const size_t old_count = entry.segment_boxes.size();
+  const size_t new_count = path.size();
+
+  std::vector<Box> boxes;
+  boxes.reserve(new_count);
+  for (size_t i = 0; i < std::max(old_count, new_count); ++i) {
+    const Segment segment{id, static_cast<uint32_t>(i)};
+    if (i >= new_count) {
+      RemoveSegment(segment, entry.segment_boxes[i]);
+      continue;
+    }
+    boxes.push_back(ComputeSegmentBox(path[i]));
+    if (i < old_count) {
+      if (entry.segment_boxes[i] == boxes.back()) {
+        // Typically all segments but the last few of a growing stroke.
+        continue;
+      }
+      RemoveSegment(segment, entry.segment_boxes[i]);
+    }
+    InsertSegment(segment, boxes.back());
+  }
+  entry.segment_boxes = std::move(boxes);
+  entry.tessellation = std::move(tessellation);
+}
+
+void StrokeIndex::Remove(StrokeId id) {
+  auto it = strokes_.find(id);
+  if (it == strokes_.end()) {
+    return;
+  }
+  auto& boxes = it->second.segment_boxes;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    RemoveSegment(Segment{id, static_cast<uint32_t>(i)}, boxes[i]);
+  }
+  strokes_.erase(it);
+}
+
+void StrokeIndex::Clear() {
+  strokes_.clear();
+  cells_.clear();
+  overflow_segments_.clear();
+}
+
+std::vector<StrokeId> StrokeIndex::FindInBox(vec2 min, vec2 max) const {
+  std::vector<StrokeId> result;
+  for (auto& segment : FindSegments(Box{min, max})) {
+    if (result.empty() || result.back() != segment.id) {
+      result.push_back(segment.id);
+    }
+  }
+  return result;
+}
+
+std::vector<StrokeId> StrokeIndex::FindNearPoint(vec2 point,
+                                                 float radius) const {
+  constexpr float kHalfWidth = Stroke::kStrokeWidth * 0.5f;
+  const float max_distance = radius + kHalfWidth;
+  const vec2 extent(radius, radius);
+
+  std::vector<StrokeId> result;
+  for (auto& segment : FindSegments(Box{point - extent, point + extent})) {
+    if (!result.empty() && result.back() == segment.id) {
+      continue;
+    }
+    std::vector<vec2> line = GetCenterLine(segment);
+    bool is_near = line.size() == 1 && distance(point, line[0]) <= max_distance;
+    for (size_t i = 1; i < line.size() && !is_near; ++i) {
+      is_near = DistanceToLineSegment(point, line[i - 1], line[i]) <=
+                max_distance;
+    }
+    if (is_near) {
+      result.push_back(segment.id);
+    }
+  }
+  return result;
+}
+
+std::vector<StrokeId> StrokeIndex::FindInLasso(
+    const std::vector<vec2>& lasso) const {
+  std::vector<StrokeId> result;
+  if (lasso.size() < 3) {
+    return result;
+  }
+  Box bounds{lasso[0], lasso[0]};
+  for (auto& pt : lasso) {
+    bounds.min = glm::min(bounds.min, pt);
+    bounds.max = glm::max(bounds.max, pt);
+  }
+
+  for (auto& segment : FindSegments(bounds)) {
+    if (!result.empty() && result.back() == segment.id) {
+      continue;
+    }
+    for (auto& pt : GetCenterLine(segment)) {
+      if (IsInsidePolygon(pt, lasso)) {
+        result.push_back(segment.id);
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+StrokeIndex::Box StrokeIndex::ComputeSegmentBox(const StrokeSegment& segment) {
+  // A Bezier curve lies within the convex hull of its control points.
+  constexpr float kHalfWidth = Stroke::kStrokeWidth * 0.5f;
+  const CubicBezier2f& curve = segment.curve();
+  Box box{curve.pts[0], curve.pts[0]};
+  for (auto& pt : curve.pts) {
+    box.min = glm::min(box.min, pt);
+    box.max = glm::max(box.max, pt);
+  }
+  box.min -= vec2(kHalfWidth, kHalfWidth);
+  box.max += vec2(kHalfWidth, kHalfWidth);
+  return box;
+}
+
+bool StrokeIndex::Box::IsFinite() const {
+  return std::isfinite(min.x) && std::isfinite(min.y) &&
+         std::isfinite(max.x) && std::isfinite(max.y);
+}
+
+StrokeIndex::CellRange StrokeIndex::GetCellRange(const Box& box) const {
+  const float scale = 1.f / cell_size_;
+  return CellRange{
+      ToCellCoordinate(box.min.x * scale), ToCellCoordinate(box.min.y * scale),
+      ToCellCoordinate(box.max.x * scale), ToCellCoordinate(box.max.y * scale)};
+}
+
+uint64_t StrokeIndex::GetCellKey(int32_t x, int32_t y) {
+  return (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+}
+
+bool StrokeIndex::IsInGrid(const Box& box) const {
+  return GetCellRange(box).cell_count() <= kMaxCellsPerSegment;
+}
+
+void StrokeIndex::InsertSegment(const Segment& segment, const Box& box) {
+  if (!box.IsFinite()) {
+    // The segment cannot be found by any query.
+    return;
+  }
+  if (!IsInGrid(box)) {
+    overflow_segments_.push_back(segment);
+    return;
+  }
+  const CellRange range = GetCellRange(box);
+  for (int32_t x = range.min_x; x <= range.max_x; ++x) {
+    for (int32_t y = range.min_y; y <= range.max_y; ++y) {
+      cells_[GetCellKey(x, y)].push_back(segment);
+    }
+  }
+}
+
+void StrokeIndex::RemoveSegment(const Segment& segment, const Box& box) {
+  if (!box.IsFinite()) {
+    return;
+  }
+  if (!IsInGrid(box)) {
+    auto it = std::find(overflow_segments_.begin(), overflow_segments_.end(),
+                        segment);
+    FTL_DCHECK(it != overflow_segments_.end());
+    *it = overflow_segments_.back();
+    overflow_segments_.pop_back();
+    return;
+  }
+  const CellRange range = GetCellRange(box);
+  for (int32_t x = range.min_x; x <= range.max_x; ++x) {
+    for (int32_t y = range.min_y; y <= range.max_y; ++y) {
+      auto cell_it = cells_.find(GetCellKey(x, y));
+      FTL_DCHECK(cell_it != cells_.end());
+      auto& segments = cell_it->second;
+      auto it = std::find(segments.begin(), segments.end(), segment);
+      FTL_DCHECK(it != segments.end());
+      // The order of segments within a cell is unimportant.
+      *it = segments.back();
+      segments.pop_back();
+      if (segments.empty()) {
+        cells_.erase(cell_it);
+      }
+    }
+  }
+}
+
+std::vector<StrokeIndex::Segment> StrokeIndex::FindSegments(
+    const Box& box) const {
+  std::vector<Segment> result;
+  // This is also false if any coordinate is NaN.
+  if (!(box.min.x <= box.max.x && box.min.y <= box.max.y)) {
+    return result;
+  }
+  auto add_overlapping = [this, &box, &result](
+      const std::vector<Segment>& segments) {
+    for (auto& segment : segments) {
+      auto& entry = strokes_.find(segment.id)->second;
+      if (entry.segment_boxes[segment.index].Overlaps(box)) {
+        result.push_back(segment);
+      }
+    }
+  };
+
+  add_overlapping(overflow_segments_);
+
+  // A large box, such as the viewport of a zoomed-out page, may cover many
+  // more cells than are occupied; visit only the occupied ones.
+  const CellRange range = GetCellRange(box);
+  if (range.cell_count() > cells_.size()) {
+    for (auto& pair : cells_) {
+      add_overlapping(pair.second);
+    }
+  } else {
+    for (int32_t x = range.min_x; x <= range.max_x; ++x) {
+      for (int32_t y = range.min_y; y <= range.max_y; ++y) {
+        auto it = cells_.find(GetCellKey(x, y));
+        if (it != cells_.end()) {
+          add_overlapping(it->second);
+        }
+      }
+    }
+  }
+
+  // Segments that span several cells are found once for each.
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+std::vector<vec2> StrokeIndex::GetCenterLine(const Segment& segment) const {
+  const StrokeTessellation& tessellation =
+      *strokes_.find(segment.id)->second.tessellation;
+  const auto& vertices = tessellation.vertices;
+  const size_t begin = tessellation.segment_first_vertices[segment.index];
+  // Include the first vertex of the next segment, so that there are no gaps
+  // between the center lines of consecutive segments.
+  const size_t end =
+      std::min(tessellation.segment_first_vertices[segment.index + 1] + 2,
+               vertices.size());
+
+  // Vertices come in pairs, offset to either side of the center line.
+  std::vector<vec2> line;
+  line.reserve((end - begin) / 2);
+  for (size_t i = begin; i < end; i += 2) {
+    line.push_back(vertices[i].pos - vertices[i].pos_offset);
+  }
+  return line;
+}
+
+}  // namespace sketchy
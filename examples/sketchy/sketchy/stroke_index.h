@@ -0,0 +1,145 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "ftl/macros.h"
+#include "sketchy/stroke.h"
+#include "sketchy/stroke_tessellation.h"
+#include "sketchy/types.h"
+
+namespace sketchy {
+
+// A uniform grid over the strokes of a Page, used to find the strokes near a
+// point or within a region without visiting every stroke.  Each segment of a
+// stroke's path is entered into the cells overlapped by its bounding box, so
+// that a long stroke occupies only the cells that it passes through.
+//
+// Segments whose bounding boxes span more than kMaxCellsPerSegment cells are
+// kept in an overflow list instead, which every query scans, so that a huge
+// segment cannot make updates and queries visit billions of cells.  Segments
+// whose bounding boxes are not finite are not indexed at all.
+//
+// Strokes are indexed by their tessellation, which describes the path that is
+// currently displayed.  Queries that need more precision than the segments'
+// bounding boxes use the tessellation's vertices, which are at most a few
+// pixels apart along the stroke.
+//
+// Not thread-safe.
+class StrokeIndex {
+ public:
+  static constexpr float kDefaultCellSize = 256.f;  // pixels
+  static constexpr uint64_t kMaxCellsPerSegment = 1024;
+
+  explicit StrokeIndex(float cell_size = kDefaultCellSize);
+  ~StrokeIndex();
+
+  // Add the stroke to the index, or update it to match |tessellation|.  Only
+  // the segments whose bounding boxes have changed are moved between cells,
+  // so extending a stroke costs time proportional to the new segments.
+  void Update(StrokeId id,
+              std::shared_ptr<const StrokeTessellation> tessellation);
+  // Remove the stroke from the index.  No-op if it is not in the index.
+  void Remove(StrokeId id);
+  void Clear();
+
+  // Return the strokes that may overlap the box from |min| to |max|; some may
+  // not, but none that do are missed.  Sorted by ID.  A box with a NaN
+  // coordinate, or whose |min| exceeds its |max|, contains no strokes.
+  std::vector<StrokeId> FindInBox(vec2 min, vec2 max) const;
+
+  // Return the strokes that pass within |radius| of |point|, taking the width
+  // of the strokes into account.  Sorted by ID.
+  std::vector<StrokeId> FindNearPoint(vec2 point, float radius) const;
+
+  // Return the strokes that are at least partly inside the polygon |lasso|,
+  // whose last point is implicitly joined to its first.  Sorted by ID.
+  std::vector<StrokeId> FindInLasso(const std::vector<vec2>& lasso) const;
+
+  size_t size() const { return strokes_.size(); }
+
+ private:
+  struct Box {
+    vec2 min;
+    vec2 max;
+
+    bool operator==(const Box& other) const {
+      return min == other.min && max == other.max;
+    }
+    bool IsFinite() const;
+    bool Overlaps(const Box& other) const {
+      return min.x <= other.max.x && other.min.x <= max.x &&
+             min.y <= other.max.y && other.min.y <= max.y;
+    }
+  };
+
+  struct StrokeEntry {
+    std::shared_ptr<const StrokeTessellation> tessellation;
+    // The bounds of each segment of the tessellation's path, including the
+    // width of the stroke.
+    std::vector<Box> segment_boxes;
+  };
+
+  // A reference to a segment of a stroke, stored in each cell that the
+  // segment's bounding box overlaps.
+  struct Segment {
+    StrokeId id;
+    uint32_t index;
+
+    bool operator==(const Segment& other) const {
+      return id == other.id && index == other.index;
+    }
+    bool operator<(const Segment& other) const {
+      return id < other.id || (id == other.id && index < other.index);
+    }
+  };
+
+  // The range of cells overlapped by a Box, inclusive.
+  struct CellRange {
+    int32_t min_x;
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+
+    // Each dimension may span 2^31 cells, so this is computed in 64 bits.
+    uint64_t cell_count() const {
+      return uint64_t(int64_t(max_x) - min_x + 1) *
+             uint64_t(int64_t(max_y) - min_y + 1);
+    }
+  };
+
+  static Box ComputeSegmentBox(const StrokeSegment& segment);
+  CellRange GetCellRange(const Box& box) const;
+  static uint64_t GetCellKey(int32_t x, int32_t y);
+
+  void InsertSegment(const Segment& segment, const Box& box);
+  void RemoveSegment(const Segment& segment, const Box& box);
+
+  // Return true if a segment with the finite bounding box |box| is entered into
+  // the grid's cells, rather than into |overflow_segments_|.
+  bool IsInGrid(const Box& box) const;
+
+  // Return the segments whose bounding boxes overlap |box|, sorted and without
+  // duplicates.
+  std::vector<Segment> FindSegments(const Box& box) const;
+
+  // Return the center-line points of the tessellation of |segment|, from its
+  // start to the start of the following segment.
+  std::vector<vec2> GetCenterLine(const Segment& segment) const;
+
+  const float cell_size_;
+  std::unordered_map<StrokeId, StrokeEntry> strokes_;
+  std::unordered_map<uint64_t, std::vector<Segment>> cells_;
+  // Segments whose boxes span more than kMaxCellsPerSegment cells.
+  std::vector<Segment> overflow_segments_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StrokeIndex);
+};
+
+}  // namespace sketchy
@@ -0,0 +1,222 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/stroke_mesh.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "escher/impl/command_buffer_sequencer.h"
+#include "escher/impl/gpu_uploader.h"
+#include "escher/renderer/semaphore_wait.h"
+
+namespace sketchy {
+
+namespace {
+
+const escher::MeshSpec kStrokeMeshSpec{
+    escher::MeshAttribute::kPosition | escher::MeshAttribute::kPositionOffset |
+    escher::MeshAttribute::kUV | escher::MeshAttribute::kPerimeterPos};
+
+// Minimum number of vertices that a vertex buffer has room for.
+constexpr size_t kMinVertexCapacity = 1024;
+
+// Each stroke needs one buffer for the GPU to read and one for the CPU to
+// write; a third covers the case where the GPU is a frame behind.
+constexpr size_t kMaxVertexBufferCount = 3;
+
+// Write the indices for |vertex_count| vertices; two triangles per pair of
+// vertices after the first.
+template <typename IndexT>
+void WriteIndices(size_t vertex_count, IndexT* indices) {
+  for (IndexT i = 0; i + 2u < vertex_count; i += 2) {
+    *indices++ = i;
+    *indices++ = i + 1;
+    *indices++ = i + 3;
+    *indices++ = i;
+    *indices++ = i + 3;
+    *indices++ = i + 2;
+  }
+}
+
+}  // namespace
+
+StrokeIndexBuffer::StrokeIndexBuffer(escher::Escher* escher)
+    : escher_(escher) {}
+
+uint32_t StrokeIndexBuffer::GetIndexCount(size_t vertex_count) {
+  FTL_DCHECK(vertex_count >= 4 && vertex_count % 2 == 0);
+  return (vertex_count - 2) * 3;
+}
+
+const escher::BufferPtr& StrokeIndexBuffer::GetBuffer(size_t vertex_count) {
+  if (vertex_count <= vertex_capacity_) {
+    return buffer_;
+  }
+
+  // Double the capacity, so that growing strokes rarely need a new buffer.
+  vertex_capacity_ = std::max(
+      vertex_count, std::max(2 * vertex_capacity_, kMinVertexCapacity));
+  vertex_capacity_ += vertex_capacity_ % 2;
+  index_type_ = escher::MeshSpec::GetIndexType(vertex_capacity_);
+  const uint32_t index_count = GetIndexCount(vertex_capacity_);
+
+  // The buffer is host-visible and never modified once written, so it needs
+  // neither an upload nor a semaphore.  WobbleModifierAbsorber copies from it.
+  buffer_ = escher::Buffer::New(
+      escher_->resource_recycler(), escher_->gpu_allocator(),
+      index_count * escher::MeshSpec::GetIndexSize(index_type_),
+      vk::BufferUsageFlagBits::eIndexBuffer |
+          vk::BufferUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent);
+  if (index_type_ == vk::IndexType::eUint16) {
+    WriteIndices(vertex_capacity_, reinterpret_cast<uint16_t*>(buffer_->ptr()));
+  } else {
+    WriteIndices(vertex_capacity_, reinterpret_cast<uint32_t*>(buffer_->ptr()));
+  }
+  return buffer_;
+}
+
+void StrokeIndexBuffer::AddIndices(size_t vertex_count,
+                                   escher::MeshBuilder* builder) {
+  for (uint32_t i = 0; i + 2 < vertex_count; i += 2) {
+    builder->AddIndex(i)
+        .AddIndex(i + 1)
+        .AddIndex(i + 3)
+        .AddIndex(i)
+        .AddIndex(i + 3)
+        .AddIndex(i + 2);
+  }
+}
+
+StrokeMesh::StrokeMesh(escher::Escher* escher,
+                       StrokeIndexBuffer* index_buffer,
+                       escher::impl::MeshArena* mesh_arena)
+    : escher_(escher), index_buffer_(index_buffer), mesh_arena_(mesh_arena) {
+  FTL_DCHECK(kStrokeMeshSpec.GetStride() ==
+             sizeof(StrokeTessellation::Vertex));
+  // ChooseBuffer() returns pointers into |buffers_|.
+  buffers_.reserve(kMaxVertexBufferCount);
+}
+
+StrokeMesh::~StrokeMesh() {}
+
+escher::MeshPtr StrokeMesh::Update(
+    std::shared_ptr<const StrokeTessellation> tessellation,
+    bool finalized) {
+  if (finalized) {
+    // Pending CommandBuffers keep the released buffers alive.
+    buffers_.clear();
+    return BuildArenaMesh(*tessellation);
+  }
+
+  const size_t vertex_count = tessellation->vertices.size();
+  size_t unchanged_count;
+  VertexBuffer* buffer = ChooseBuffer(*tessellation, &unchanged_count);
+
+  // Upload only the vertices that differ from those in the buffer.
+  if (unchanged_count < vertex_count) {
+    constexpr size_t kStride = sizeof(StrokeTessellation::Vertex);
+    const vk::DeviceSize upload_size =
+        (vertex_count - unchanged_count) * kStride;
+    auto writer = escher_->gpu_uploader()->GetWriter(upload_size);
+    memcpy(writer.ptr(), &tessellation->vertices[unchanged_count], upload_size);
+    writer.WriteBuffer(buffer->buffer,
+                       {0, unchanged_count * kStride, upload_size},
+                       escher::Semaphore::New(escher_->vk_device()));
+    writer.Submit();
+    bytes_uploaded_ += upload_size;
+  }
+
+  const escher::BufferPtr& index_buffer =
+      index_buffer_->GetBuffer(vertex_count);
+  buffer->mesh = ftl::MakeRefCounted<escher::Mesh>(
+      escher_->resource_recycler(), kStrokeMeshSpec,
+      tessellation->bounding_box, vertex_count,
+      StrokeIndexBuffer::GetIndexCount(vertex_count), buffer->buffer,
+      index_buffer, index_buffer_->index_type());
+  // Null if nothing was uploaded.
+  buffer->mesh->SetWaitSemaphore(buffer->buffer->TakeWaitSemaphore());
+  buffer->contents = std::move(tessellation);
+  return buffer->mesh;
+}
+
+escher::MeshPtr StrokeMesh::BuildArenaMesh(
+    const StrokeTessellation& tessellation) {
+  const size_t vertex_count = tessellation.vertices.size();
+  auto builder = mesh_arena_->NewMeshBuilder(
+      kStrokeMeshSpec, vertex_count,
+      StrokeIndexBuffer::GetIndexCount(vertex_count));
+  for (auto& vertex : tessellation.vertices) {
+    builder->AddVertex(vertex);
+  }
+  StrokeIndexBuffer::AddIndices(vertex_count, builder.get());
+  bytes_uploaded_ += vertex_count * sizeof(StrokeTessellation::Vertex);
+  return builder->Build();
+}
+
+bool StrokeMesh::IsIdle(const VertexBuffer& buffer) const {
+  // Meshes are kept alive by the CommandBuffers that draw them, and the buffer
+  // itself by those that upload into it or copy from it.
+  const uint64_t last_finished_sequence_number =
+      escher_->command_buffer_sequencer()->last_finished_sequence_number();
+  return buffer.buffer->sequence_number() <= last_finished_sequence_number &&
+         (!buffer.mesh ||
+          buffer.mesh->sequence_number() <= last_finished_sequence_number);
+}
+
+StrokeMesh::VertexBuffer* StrokeMesh::ChooseBuffer(
+    const StrokeTessellation& tessellation,
+    size_t* unchanged_vertex_count) {
+  constexpr size_t kStride = sizeof(StrokeTessellation::Vertex);
+  const vk::DeviceSize required_size = tessellation.vertices.size() * kStride;
+
+  VertexBuffer* best = nullptr;
+  size_t best_unchanged_count = 0;
+  for (auto& buffer : buffers_) {
+    if (buffer.buffer->size() < required_size || !IsIdle(buffer)) {
+      continue;
+    }
+    const size_t unchanged_count =
+        buffer.contents ? CountUnchangedVertices(*buffer.contents, tessellation)
+                        : 0;
+    if (!best || unchanged_count > best_unchanged_count) {
+      best = &buffer;
+      best_unchanged_count = unchanged_count;
+    }
+  }
+  *unchanged_vertex_count = best_unchanged_count;
+  if (best) {
+    return best;
+  }
+
+  // Allocate a buffer with room for the stroke to double in length.  If there
+  // are already enough buffers, replace one that is busy or too small; the
+  // CommandBuffers that use it keep it alive.
+  VertexBuffer new_buffer;
+  new_buffer.buffer = escher::Buffer::New(
+      escher_->resource_recycler(), escher_->gpu_allocator(),
+      std::max(2 * required_size, kMinVertexCapacity * kStride),
+      vk::BufferUsageFlagBits::eVertexBuffer |
+          vk::BufferUsageFlagBits::eTransferSrc |
+          vk::BufferUsageFlagBits::eTransferDst,
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+  if (buffers_.size() < kMaxVertexBufferCount) {
+    buffers_.push_back(std::move(new_buffer));
+    return &buffers_.back();
+  }
+  // Prefer to replace a buffer that is too small, since it can't be reused.
+  auto it = std::find_if(buffers_.begin(), buffers_.end(),
+                         [required_size](const VertexBuffer& buffer) {
+                           return buffer.buffer->size() < required_size;
+                         });
+  if (it == buffers_.end()) {
+    it = buffers_.begin();
+  }
+  *it = std::move(new_buffer);
+  return &*it;
+}
+
+}  // namespace sketchy
@@ -0,0 +1,112 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "escher/escher.h"
+#include "escher/impl/mesh_arena.h"
+#include "escher/shape/mesh.h"
+#include "escher/vk/buffer.h"
+#include "sketchy/stroke_tessellation.h"
+
+namespace sketchy {
+
+// The triangle indices of a stroke tessellated by TessellateStrokePath().
+// Every stroke uses the same pattern, so a single host-visible buffer is
+// shared by all of them.  The buffer is replaced by a larger one when a
+// stroke outgrows it; meshes that use the old buffer keep it alive.  Indices
+// are 16-bit until the buffer must index more vertices than that allows.
+class StrokeIndexBuffer {
+ public:
+  explicit StrokeIndexBuffer(escher::Escher* escher);
+
+  // Return a buffer with the indices for at least |vertex_count| vertices.
+  const escher::BufferPtr& GetBuffer(size_t vertex_count);
+
+  // The type of the indices in the buffer most recently returned by
+  // GetBuffer().
+  vk::IndexType index_type() const { return index_type_; }
+
+  // Number of indices required to draw |vertex_count| stroke vertices.
+  static uint32_t GetIndexCount(size_t vertex_count);
+
+  // Add the indices for |vertex_count| vertices to |builder|.
+  static void AddIndices(size_t vertex_count, escher::MeshBuilder* builder);
+
+ private:
+  escher::Escher* const escher_;
+  escher::BufferPtr buffer_;
+  vk::IndexType index_type_ = vk::IndexType::eUint16;
+  size_t vertex_capacity_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StrokeIndexBuffer);
+};
+
+// The GPU vertex data of a single Stroke.  While the stroke is being drawn,
+// its vertices live in a few device-local buffers that have room for the
+// stroke to grow.  An update uploads only the vertices that differ from those
+// already in the buffer that it writes, which is typically just the tail of
+// the stroke.
+//
+// A buffer is only written once the GPU has finished every CommandBuffer that
+// used it.  While the buffer written by the previous update is still in use,
+// another buffer is written instead; each buffer remembers which tessellation
+// it holds, so that it too only receives the vertices that differ.
+//
+// Once the stroke is finalized it no longer changes, so its mesh is
+// sub-allocated from a MeshArena that is shared by all strokes, and the
+// dedicated buffers are released.
+//
+// Not thread-safe.
+class StrokeMesh {
+ public:
+  StrokeMesh(escher::Escher* escher,
+             StrokeIndexBuffer* index_buffer,
+             escher::impl::MeshArena* mesh_arena);
+  ~StrokeMesh();
+
+  // Upload the vertices of |tessellation| and return a Mesh that draws them.
+  // If |finalized|, the stroke will not be updated again, except to replace a
+  // stale tessellation.
+  escher::MeshPtr Update(std::shared_ptr<const StrokeTessellation> tessellation,
+                         bool finalized);
+
+  // Total number of vertex bytes uploaded by Update().
+  vk::DeviceSize bytes_uploaded() const { return bytes_uploaded_; }
+
+ private:
+  struct VertexBuffer {
+    escher::BufferPtr buffer;
+    // The tessellation whose vertices were last written into |buffer|.
+    std::shared_ptr<const StrokeTessellation> contents;
+    // The most recent Mesh that reads from |buffer|.
+    escher::MeshPtr mesh;
+  };
+
+  // Return true if no pending CommandBuffer uses |buffer|.
+  bool IsIdle(const VertexBuffer& buffer) const;
+
+  // Choose an idle buffer with room for |tessellation|, preferring the one
+  // that needs the smallest upload.  Allocate a new buffer if there is none.
+  // Return the number of leading vertices that the buffer already holds in
+  // |unchanged_vertex_count|.
+  VertexBuffer* ChooseBuffer(const StrokeTessellation& tessellation,
+                             size_t* unchanged_vertex_count);
+
+  // Upload the vertices and indices of |tessellation| to |mesh_arena_|.
+  escher::MeshPtr BuildArenaMesh(const StrokeTessellation& tessellation);
+
+  escher::Escher* const escher_;
+  StrokeIndexBuffer* const index_buffer_;
+  escher::impl::MeshArena* const mesh_arena_;
+  std::vector<VertexBuffer> buffers_;
+  vk::DeviceSize bytes_uploaded_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StrokeMesh);
+};
+
+}  // namespace sketchy
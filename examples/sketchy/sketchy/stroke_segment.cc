@@ -30,4 +30,11 @@ StrokeSegment::StrokeSegment(CubicBezier2f curve) : curve_(curve) {
   FTL_DCHECK(!std::isnan(length_));
 }
 
+StrokeSegment::StrokeSegment(CubicBezier2f curve,
+                             CubicBezier1f arc_length_parameterization,
+                             float length)
+    : curve_(curve),
+      arc_length_parameterization_(arc_length_parameterization),
+      length_(length) {}
+
 }  // namespace sketchy
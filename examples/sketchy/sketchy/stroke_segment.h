@@ -13,6 +13,11 @@ namespace sketchy {
 class StrokeSegment {
  public:
   StrokeSegment(CubicBezier2f curve);
+  // Use a previously-computed arc-length parameterization and length, e.g.
+  // when loading a saved page; see PageFile.
+  StrokeSegment(CubicBezier2f curve,
+                CubicBezier1f arc_length_parameterization,
+                float length);
 
   const CubicBezier2f& curve() const { return curve_; }
   const CubicBezier1f& arc_length_parameterization() const {
@@ -0,0 +1,146 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/stroke_tessellation.h"
+
+#include <algorithm>
+
+#include "ftl/logging.h"
+#include "sketchy/stroke.h"
+
+namespace sketchy {
+
+namespace {
+
+// Return the number of leading segments whose vertices are identical in |a|
+// and |b|.
+size_t CountUnchangedSegments(const StrokePath& a, const StrokePath& b) {
+  if (a.empty() || b.empty()) {
+    return 0;
+  }
+  // The last segment is tessellated differently from the others.
+  const size_t max_count = std::min(a.size(), b.size()) - 1;
+  size_t count = 0;
+  while (count < max_count && a[count] == b[count]) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+// TODO: Tessellate stroke on GPU.
+StrokeTessellation TessellateStrokePath(
+    StrokePath path,
+    const std::vector<size_t>& vertex_counts,
+    const StrokeTessellation* base) {
+  FTL_DCHECK(!path.empty());
+  FTL_DCHECK(vertex_counts.size() == path.size());
+
+  StrokeTessellation tessellation;
+  size_t total_vertex_count = 0;
+  for (size_t count : vertex_counts) {
+    FTL_DCHECK(count % 2 == 0);
+    total_vertex_count += count;
+  }
+  tessellation.vertices.reserve(total_vertex_count);
+  tessellation.segment_first_vertices.reserve(path.size() + 1);
+
+  // Copy the vertices of the segments that are unchanged since |base|.
+  const size_t unchanged_segment_count =
+      base ? CountUnchangedSegments(base->path, path) : 0;
+  float segment_start_length = 0.f;
+  for (size_t ii = 0; ii < unchanged_segment_count; ++ii) {
+    FTL_DCHECK(base->segment_first_vertices[ii + 1] -
+                   base->segment_first_vertices[ii] ==
+               vertex_counts[ii]);
+    tessellation.segment_first_vertices.push_back(
+        base->segment_first_vertices[ii]);
+    segment_start_length += path[ii].length();
+  }
+  if (unchanged_segment_count > 0) {
+    tessellation.vertices.insert(
+        tessellation.vertices.end(), base->vertices.begin(),
+        base->vertices.begin() +
+            base->segment_first_vertices[unchanged_segment_count]);
+  }
+
+  constexpr float kHalfWidth = Stroke::kStrokeWidth * 0.5f;
+
+  // Scratch space for evaluating each segment's points in a single batch.
+  std::vector<float> params;
+  std::vector<vec2> points;
+  std::vector<vec2> normals;
+
+  // Use CPU to generate vertices for each remaining Path segment.
+  for (size_t ii = unchanged_segment_count; ii < path.size(); ++ii) {
+    auto& seg = path[ii];
+    auto& reparam = seg.arc_length_parameterization();
+
+    const int seg_vert_count = vertex_counts[ii];
+    const int seg_point_count = seg_vert_count / 2;
+    tessellation.segment_first_vertices.push_back(
+        tessellation.vertices.size());
+
+    // On all segments but the last, we don't want the Bezier parameter to
+    // reach 1.0, because this would evaluate to the same thing as a parameter
+    // of 0.0 on the next segment.
+    const float param_incr = (ii == path.size() - 1)
+                                 ? 1.0 / (seg_point_count - 1)
+                                 : 1.0 / seg_point_count;
+
+    // Use arc-length reparameterization before evaluating the segment's
+    // curve.  On the last segment, the last point has "i * param_incr == 1.0".
+    params.resize(seg_point_count);
+    for (int i = 0; i < seg_point_count; ++i) {
+      params[i] = reparam.Evaluate(i * param_incr);
+    }
+    points.resize(seg_point_count);
+    normals.resize(seg_point_count);
+    EvaluatePointsAndNormals(seg.curve(), params.data(), seg_point_count,
+                             points.data(), normals.data());
+
+    for (int i = 0; i < seg_point_count; ++i) {
+      const float cumulative_length =
+          segment_start_length + (i * param_incr * seg.length());
+
+      StrokeTessellation::Vertex vertex;
+      vertex.pos_offset = normals[i] * kHalfWidth;
+      vertex.pos = points[i] + vertex.pos_offset;
+      vertex.perimeter_pos = cumulative_length;
+      vertex.uv = vec2(vertex.perimeter_pos, 1.f);
+      tessellation.vertices.push_back(vertex);
+
+      vertex.pos_offset *= -1.f;
+      vertex.pos = points[i] + vertex.pos_offset;
+      vertex.uv = vec2(vertex.perimeter_pos, 0.f);
+      tessellation.vertices.push_back(vertex);
+    }
+
+    // Prepare for next segment.
+    segment_start_length += seg.length();
+  }
+  tessellation.segment_first_vertices.push_back(tessellation.vertices.size());
+  tessellation.length = segment_start_length;
+
+  vec2 min = tessellation.vertices[0].pos;
+  vec2 max = min;
+  for (auto& vertex : tessellation.vertices) {
+    min = glm::min(min, vertex.pos);
+    max = glm::max(max, vertex.pos);
+  }
+  tessellation.bounding_box =
+      escher::BoundingBox(vec3(min, 0.f), vec3(max, 0.f));
+
+  tessellation.path = std::move(path);
+  return tessellation;
+}
+
+size_t CountUnchangedVertices(const StrokeTessellation& a,
+                              const StrokeTessellation& b) {
+  const size_t segment_count = CountUnchangedSegments(a.path, b.path);
+  return segment_count ? a.segment_first_vertices[segment_count] : 0;
+}
+
+}  // namespace sketchy
@@ -0,0 +1,54 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+
+#include "escher/geometry/bounding_box.h"
+#include "sketchy/stroke_segment.h"
+
+namespace sketchy {
+
+typedef std::vector<StrokeSegment> StrokePath;
+
+// The vertices of a tessellated StrokePath.  These are generated on worker
+// threads, and later uploaded into a Stroke's mesh by its Page; the indices
+// are the same for every stroke (see StrokeIndexBuffer).
+struct StrokeTessellation {
+  struct Vertex {
+    vec2 pos;
+    vec2 pos_offset;
+    // |uv.x| and |perimeter_pos| are the distance along the stroke, in pixels.
+    // They are not normalized by the length of the stroke, so that appending
+    // to the stroke leaves the existing vertices unchanged.
+    vec2 uv;
+    float perimeter_pos;
+  };
+
+  StrokePath path;
+  float length = 0.f;
+  std::vector<Vertex> vertices;
+  // The index of the first vertex of each segment of |path|, followed by the
+  // total number of vertices.
+  std::vector<size_t> segment_first_vertices;
+  escher::BoundingBox bounding_box;
+};
+
+// Tessellate |path|, using the number of vertices per segment given by
+// |vertex_counts|; see Page::ComputeVertexCounts().  If |base| is not null,
+// the vertices of the segments that |path| shares with it are copied instead
+// of being regenerated.  Thread-safe.
+StrokeTessellation TessellateStrokePath(
+    StrokePath path,
+    const std::vector<size_t>& vertex_counts,
+    const StrokeTessellation* base = nullptr);
+
+// Return the number of leading vertices that are identical in |a| and |b|.
+// The vertices of the last segment depend on it being last, so they are never
+// considered identical.
+size_t CountUnchangedVertices(const StrokeTessellation& a,
+                              const StrokeTessellation& b);
+
+}  // namespace sketchy
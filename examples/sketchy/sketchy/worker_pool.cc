@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/worker_pool.h"
+
+#include <algorithm>
+
+#include "ftl/logging.h"
+
+namespace sketchy {
+
+WorkerPool::WorkerPool(size_t thread_count) {
+  FTL_DCHECK(thread_count > 0);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this] { RunTasks(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+    tasks_.clear();
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::PostTask(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FTL_DCHECK(!shutting_down_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+size_t WorkerPool::GetDefaultThreadCount() {
+  constexpr size_t kMaxThreadCount = 4;
+  // hardware_concurrency() returns zero if the count is unknown.
+  const size_t hardware_threads = std::thread::hardware_concurrency();
+  if (hardware_threads <= 2) {
+    return 1;
+  }
+  return std::min(hardware_threads - 1, kMaxThreadCount);
+}
+
+void WorkerPool::RunTasks() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock,
+                      [this] { return shutting_down_ || !tasks_.empty(); });
+      if (shutting_down_) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace sketchy
@@ -0,0 +1,46 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ftl/macros.h"
+
+namespace sketchy {
+
+// A fixed set of threads that run posted tasks in the order that they were
+// posted.  Tasks may run concurrently with each other, so any state that they
+// share must be synchronized.
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t thread_count);
+  // Discards tasks that have not yet started, and waits for running tasks to
+  // finish.
+  ~WorkerPool();
+
+  void PostTask(std::function<void()> task);
+
+  // Return a thread count that leaves one hardware thread for rendering, up to
+  // a small maximum.
+  static size_t GetDefaultThreadCount();
+
+ private:
+  void RunTasks();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> tasks_;
+  bool shutting_down_ = false;
+  std::vector<std::thread> threads_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace sketchy
@@ -4,6 +4,10 @@
 
 #include "escher/examples/sketchy/sketchy_demo.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "escher/renderer/paper_renderer.h"
 #include "escher/scene/camera.h"
 
@@ -11,6 +15,9 @@
 static constexpr float kNear = 24.f;
 static constexpr float kFar = 0.f;
 
+// Strokes within this distance of the eraser are erased.
+static constexpr float kEraserRadius = 20.f;
+
 SketchyDemo::SketchyDemo(DemoHarness* harness, int argc, char** argv)
     : Demo(harness),
       page_(escher()),
@@ -19,6 +26,16 @@ SketchyDemo::SketchyDemo(DemoHarness* harness, int argc, char** argv)
                         escher()->vulkan_context().device,
                         escher()->vulkan_context().queue) {
   InitializeEscherStage();
+
+  // Use --page=<path> to choose the file that the page is saved to.  If the
+  // file exists, the page is opened from it.
+  constexpr char kPageFlag[] = "--page=";
+  for (int i = 1; i < argc; ++i) {
+    if (!strncmp(kPageFlag, argv[i], strlen(kPageFlag))) {
+      page_path_ = argv[i] + strlen(kPageFlag);
+      OpenPage();
+    }
+  }
 }
 
 SketchyDemo::~SketchyDemo() {}
@@ -42,47 +59,130 @@ bool SketchyDemo::HandleKeyPress(std::string key) {
   if (key == "c" || key == "C") {
     page_.Clear();
     return true;
+  } else if (key == "s" || key == "S") {
+    // Log and reset the stroke fitting/tessellation stats.
+    const sketchy::PageStats stats = page_.stats();
+    FTL_LOG(INFO) << "Sketchy stats (microseconds, avg/max):"
+                  << "\n\tfit: " << stats.fit.average_microseconds() << "/"
+                  << stats.fit.max_microseconds
+                  << "\n\ttessellate: "
+                  << stats.tessellate.average_microseconds() << "/"
+                  << stats.tessellate.max_microseconds
+                  << "\n\tlatency: " << stats.latency.average_microseconds()
+                  << "/" << stats.latency.max_microseconds
+                  << "\n\tcompleted: " << stats.latency.count
+                  << "  discarded: " << stats.discarded_count
+                  << "\n\tuploaded bytes: " << stats.uploaded_bytes;
+    page_.ResetStats();
+    return true;
+  } else if (key == "w" || key == "W") {
+    if (page_.Save(page_path_)) {
+      FTL_LOG(INFO) << "Saved page to " << page_path_;
+    }
+    return true;
+  } else if (key == "o" || key == "O") {
+    OpenPage();
+    return true;
+  } else if (key == "e" || key == "E") {
+    ToggleTool(Tool::kEraser);
+    return true;
+  } else if (key == "l" || key == "L") {
+    ToggleTool(Tool::kLasso);
+    return true;
   } else {
     return Demo::HandleKeyPress(key);
   }
 }
 
+void SketchyDemo::OpenPage() {
+  escher::Stopwatch stopwatch;
+  if (page_.Open(page_path_)) {
+    FTL_LOG(INFO) << "Opened page " << page_path_ << " in "
+                  << stopwatch.GetElapsedMicroseconds() << " microseconds";
+    next_stroke_id_ = std::max(next_stroke_id_, page_.GetMaxStrokeId() + 1);
+  }
+}
+
+void SketchyDemo::ToggleTool(Tool tool) {
+  tool_ = tool_ == tool ? Tool::kPen : tool;
+  lassos_.clear();
+  FTL_LOG(INFO) << "Sketchy tool: "
+                << (tool_ == Tool::kEraser
+                        ? "eraser"
+                        : tool_ == Tool::kLasso ? "lasso" : "pen");
+}
+
 void SketchyDemo::BeginTouch(uint64_t touch_id,
                              double x_position,
                              double y_position) {
+  const sketchy::vec2 position(static_cast<float>(x_position),
+                               static_cast<float>(y_position));
+  if (tool_ == Tool::kEraser) {
+    page_.EraseStrokesNearPoint(position, kEraserRadius);
+    return;
+  } else if (tool_ == Tool::kLasso) {
+    lassos_[touch_id] = {position};
+    return;
+  }
   FTL_DCHECK(stroke_fitters_.find(touch_id) == stroke_fitters_.end());
   auto& fitter =
       (stroke_fitters_[touch_id] =
            std::make_unique<sketchy::StrokeFitter>(&page_, next_stroke_id_++));
-  fitter->StartStroke(sketchy::vec2(static_cast<float>(x_position),
-                                    static_cast<float>(y_position)));
+  fitter->StartStroke(position);
 }
 
 void SketchyDemo::ContinueTouch(uint64_t touch_id,
                                 const double* x_positions,
                                 const double* y_positions,
                                 size_t position_count) {
-  auto it = stroke_fitters_.find(touch_id);
-  FTL_CHECK(it != stroke_fitters_.end());
-  auto& fitter = it->second;
   std::vector<sketchy::vec2> positions;
   positions.reserve(position_count);
   for (size_t i = 0; i < position_count; ++i) {
     positions.emplace_back(static_cast<float>(x_positions[i]),
                            static_cast<float>(y_positions[i]));
   }
-  fitter->ContinueStroke(std::move(positions), {});
+
+  auto lasso_it = lassos_.find(touch_id);
+  if (lasso_it != lassos_.end()) {
+    lasso_it->second.insert(lasso_it->second.end(), positions.begin(),
+                            positions.end());
+    return;
+  }
+  auto it = stroke_fitters_.find(touch_id);
+  if (it == stroke_fitters_.end()) {
+    // The touch began with the eraser, or with a tool that has since been
+    // deselected.
+    if (tool_ == Tool::kEraser) {
+      for (auto& position : positions) {
+        page_.EraseStrokesNearPoint(position, kEraserRadius);
+      }
+    }
+    return;
+  }
+  it->second->ContinueStroke(std::move(positions), {});
 }
 
 void SketchyDemo::EndTouch(uint64_t touch_id,
                            double x_position,
                            double y_position) {
+  const sketchy::vec2 position(static_cast<float>(x_position),
+                               static_cast<float>(y_position));
+  auto lasso_it = lassos_.find(touch_id);
+  if (lasso_it != lassos_.end()) {
+    lasso_it->second.push_back(position);
+    page_.EraseStrokesInLasso(lasso_it->second);
+    lassos_.erase(lasso_it);
+    return;
+  }
   auto it = stroke_fitters_.find(touch_id);
-  FTL_CHECK(it != stroke_fitters_.end());
+  if (it == stroke_fitters_.end()) {
+    if (tool_ == Tool::kEraser) {
+      page_.EraseStrokesNearPoint(position, kEraserRadius);
+    }
+    return;
+  }
   auto& fitter = it->second;
-  fitter->ContinueStroke({sketchy::vec2(static_cast<float>(x_position),
-                                        static_cast<float>(y_position))},
-                         {});
+  fitter->ContinueStroke({position}, {});
   fitter->FinishStroke();
   stroke_fitters_.erase(it);
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "escher/examples/common/demo.h"
 #include "escher/scene/stage.h"
@@ -39,7 +40,28 @@ class SketchyDemo : public Demo {
  private:
   void InitializeEscherStage();
 
+  // What touches do.  Erasing only affects strokes that have been finished.
+  enum class Tool {
+    // Draw a new stroke.
+    kPen,
+    // Erase the strokes that the touch passes over.
+    kEraser,
+    // Erase the strokes inside the path traced by the touch.
+    kLasso,
+  };
+
+  // Replace the page with the one saved in |page_path_|, if any.
+  void OpenPage();
+
+  // Select |tool|, or the pen if |tool| is already selected.
+  void ToggleTool(Tool tool);
+
   sketchy::Page page_;
+  // Where the page is saved and opened from; see --page.
+  std::string page_path_ = "/tmp/sketchy.page";
+  Tool tool_ = Tool::kPen;
+  // The path traced by each touch, while the lasso is selected.
+  std::map<uint64_t, std::vector<sketchy::vec2>> lassos_;
   sketchy::StrokeId next_stroke_id_ = 1;
   std::map<uint64_t, std::unique_ptr<sketchy::StrokeFitter>> stroke_fitters_;
   escher::PaperRendererPtr renderer_;
@@ -17,6 +17,7 @@
 
 using escher::vec2;
 using escher::vec3;
+using escher::vec4;
 using escher::MeshAttribute;
 using escher::MeshSpec;
 using escher::Object;
@@ -33,6 +34,26 @@ void DemoScene::Init(escher::Stage* stage) {
   purple_ = ftl::MakeRefCounted<escher::Material>();
   purple_->SetTexture(checkerboard);
   purple_->set_color(vec3(0.588f, 0.239f, 0.729f));
+
+  // A grid of alternating squares and circles behind the rectangle.
+  constexpr int kGridSize = 16;
+  constexpr float kTileSize = 100.f;
+  constexpr float kBackgroundZ = 2.f;
+  background_ = std::make_unique<escher::StaticBatch>(escher());
+  auto light_gray = escher::Material::New(vec4(0.6f, 0.6f, 0.6f, 1.f));
+  auto dark_gray = escher::Material::New(vec4(0.3f, 0.3f, 0.3f, 1.f));
+  for (int x = 0; x < kGridSize; ++x) {
+    for (int y = 0; y < kGridSize; ++y) {
+      vec2 top_left(x * kTileSize, y * kTileSize);
+      Object tile =
+          (x + y) % 2
+              ? Object::NewRect(top_left, vec2(kTileSize, kTileSize),
+                                kBackgroundZ, light_gray)
+              : Object::NewCircle(top_left + 0.5f * kTileSize,
+                                  0.4f * kTileSize, kBackgroundZ, dark_gray);
+      FTL_CHECK(background_->AddObject(tile));
+    }
+  }
 }
 
 DemoScene::~DemoScene() {}
@@ -47,7 +68,7 @@ escher::Model* DemoScene::Update(const escher::Stopwatch& stopwatch,
   Transform transform(vec3(112.f + 100 * t, 112.f, 8.f), rect_scale,
                       current_time_sec * 0.5, vec3(0, 0, 1), vec3(0.5, 0.5, 0));
   Object rectangle(Object::NewRect(transform, purple_));
-  std::vector<Object> objects{rectangle};
+  std::vector<Object> objects{background_->object(), rectangle};
   model_ = std::unique_ptr<escher::Model>(new escher::Model(objects));
   model_->set_time(stopwatch.GetElapsedSeconds());
 
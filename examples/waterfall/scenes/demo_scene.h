@@ -5,6 +5,7 @@
 #pragma once
 
 #include "escher/escher.h"
+#include "escher/scene/static_batch.h"
 
 #include "examples/waterfall/scenes/scene.h"
 
@@ -24,5 +25,8 @@ class DemoScene : public Scene {
 
   escher::MaterialPtr purple_;
 
+  // Background grid of tiles that never move, drawn with a single draw call.
+  std::unique_ptr<escher::StaticBatch> background_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(DemoScene);
 };
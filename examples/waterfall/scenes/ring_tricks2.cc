@@ -4,6 +4,8 @@
 
 #include "examples/waterfall/scenes/ring_tricks2.h"
 
+#include <cmath>
+
 #include "escher/geometry/tessellation.h"
 #include "escher/geometry/types.h"
 #include "escher/material/material.h"
@@ -23,7 +25,10 @@ using escher::Object;
 using escher::RoundedRectSpec;
 using escher::ShapeModifier;
 
-RingTricks2::RingTricks2(Demo* demo) : Scene(demo), factory_(demo->escher()) {}
+RingTricks2::RingTricks2(Demo* demo)
+    : Scene(demo),
+      factory_(demo->escher()),
+      shape_cache_(demo->escher()) {}
 
 void RingTricks2::Init(escher::Stage* stage) {
   red_ = ftl::MakeRefCounted<escher::Material>();
@@ -40,23 +45,21 @@ void RingTricks2::Init(escher::Stage* stage) {
       escher()->NewGradientImage(128, 128), vk::Filter::eLinear));
   gradient_->set_color(vec3(0.98f, 0.15f, 0.15f));
 
-  // Create meshes for fancy wobble effect.
-  {
-    MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPositionOffset |
-                  MeshAttribute::kPerimeterPos | MeshAttribute::kUV};
-    ring_mesh1_ = escher::NewRingMesh(escher(), spec, 8, vec2(0.f, 0.f), 285.f,
-                                      265.f, 18.f, -15.f);
-  }
-
   // Create rounded rectangles.
   {
     MeshSpec mesh_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
-    rounded_rect1_ = factory_.NewRoundedRect(
+    rounded_rect1_ = factory_.NewRoundedRectLod(
         RoundedRectSpec(200, 400, 90, 20, 20, 50), mesh_spec);
   }
 }
 
-RingTricks2::~RingTricks2() {}
+RingTricks2::~RingTricks2() {
+  auto& stats = shape_cache_.stats();
+  FTL_LOG(INFO) << "RingTricks2 shape cache: " << stats.hit_count << " hits, "
+                << stats.miss_count << " misses, " << stats.eviction_count
+                << " evictions, " << stats.bytes_saved
+                << " bytes of mesh uploads saved";
+}
 
 escher::Model* RingTricks2::Update(const escher::Stopwatch& stopwatch,
                                    uint64_t frame_count,
@@ -94,12 +97,24 @@ escher::Model* RingTricks2::Update(const escher::Stopwatch& stopwatch,
   Object circle2(Object::NewCircle(circle2_pos, 30.f, color1_));
   objects.push_back(circle2);
 
-  // Create the ring that will do the fancy trick
+  // Create the ring that will do the fancy trick.  The ring meshes are
+  // requested every frame; the cache tessellates each distinct ring only once.
+  MeshSpec ring_spec{MeshAttribute::kPosition | MeshAttribute::kPositionOffset |
+                     MeshAttribute::kPerimeterPos | MeshAttribute::kUV};
   vec3 inner_ring_pos(screen_width * 0.5f, screen_height * 0.5f, mid_elevation);
-  Object inner_ring(inner_ring_pos, ring_mesh1_, color2_);
+  Object inner_ring(
+      inner_ring_pos,
+      shape_cache_.GetRing(ring_spec, 8, 285.f, 265.f, 18.f, -15.f), color2_);
   inner_ring.set_shape_modifiers(ShapeModifier::kWobble);
   objects.push_back(inner_ring);
 
+  // A ring around the stacked circles, whose width steps between a few values.
+  float pulse_width = 15.f + 5.f * std::round(2.f * sin(current_time_sec));
+  Object pulse_ring(
+      vec3(100.f, 100.f, 2.f),
+      shape_cache_.GetRing(ring_spec, 4, 100.f + pulse_width, 100.f), red_);
+  objects.push_back(pulse_ring);
+
   // Create our background plane
   Object bg_plane(
       Object::NewRect(vec3(0, 0, 0), vec2(screen_width, screen_height), bg_));
@@ -131,5 +146,8 @@ escher::Model* RingTricks2::Update(const escher::Stopwatch& stopwatch,
   model_ = std::unique_ptr<escher::Model>(new escher::Model(objects));
   model_->set_time(current_time_sec);
 
+  // Release the rings that were used by the previous frame, but not this one.
+  shape_cache_.EvictUnusedMeshes();
+
   return model_.get();
 }
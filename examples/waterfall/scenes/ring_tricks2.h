@@ -6,6 +6,7 @@
 
 #include "escher/escher.h"
 #include "escher/shape/rounded_rect_factory.h"
+#include "escher/shape/shape_cache.h"
 
 #include "examples/waterfall/scenes/scene.h"
 
@@ -22,6 +23,7 @@ class RingTricks2 : public Scene {
 
  private:
   escher::RoundedRectFactory factory_;
+  escher::ShapeCache shape_cache_;
 
   std::unique_ptr<escher::Model> model_;
 
@@ -33,9 +35,7 @@ class RingTricks2 : public Scene {
 
   escher::MaterialPtr gradient_;
 
-  escher::MeshPtr ring_mesh1_;
-
-  escher::MeshPtr rounded_rect1_;
+  escher::MeshLodPtr rounded_rect1_;
   escher::MeshPtr rounded_rect2_;
   escher::MeshPtr rounded_rect3_;
 
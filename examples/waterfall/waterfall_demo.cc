@@ -40,6 +40,14 @@ WaterfallDemo::~WaterfallDemo() {
   FTL_LOG(INFO) << "Average frame rate: " << fps;
   FTL_LOG(INFO) << "First frame took: " << first_frame_microseconds_ / 1000.0
                 << " milliseconds";
+
+  auto& cache_stats = escher()->mesh_vertex_cache_stats();
+  if (cache_stats.triangle_count > 0) {
+    FTL_LOG(INFO) << "Mesh vertex cache ACMR: " << cache_stats.acmr_before()
+                  << " before optimization, " << cache_stats.acmr_after()
+                  << " after (" << cache_stats.triangle_count
+                  << " triangles)";
+  }
 }
 
 void WaterfallDemo::ProcessCommandLineArgs(int argc, char** argv) {
@@ -62,6 +70,8 @@ void WaterfallDemo::ProcessCommandLineArgs(int argc, char** argv) {
       show_debug_info_ = false;
     } else if (!strcmp("--toggle-lighting", argv[i])) {
       auto_toggle_lighting_ = true;
+    } else if (!strcmp("--optimize-meshes", argv[i])) {
+      escher()->set_optimize_meshes(true);
     }
   }
 }
@@ -139,9 +149,40 @@ bool WaterfallDemo::HandleKeyPress(std::string key) {
       case 'D':
         show_debug_info_ = !show_debug_info_;
         return true;
+      case 'F':
+        use_analytic_shapes_ = !use_analytic_shapes_;
+        FTL_LOG(INFO) << "Use analytic shapes: "
+                      << (use_analytic_shapes_ ? "true" : "false");
+        return true;
+      case 'G':
+        use_ssdo_filter_kernel_ = !use_ssdo_filter_kernel_;
+        FTL_LOG(INFO) << "Use SSDO filter kernel: "
+                      << (use_ssdo_filter_kernel_ ? "true" : "false");
+        return true;
+      case 'H':
+        enable_ssdo_temporal_accumulation_ =
+            !enable_ssdo_temporal_accumulation_;
+        FTL_LOG(INFO) << "Enable SSDO temporal accumulation: "
+                      << (enable_ssdo_temporal_accumulation_ ? "true"
+                                                             : "false");
+        return true;
+      case 'J':
+        run_ssdo_sampling_benchmark_ = true;
+        return true;
+      case 'K':
+        use_ssdo_sampling_kernel_ = !use_ssdo_sampling_kernel_;
+        FTL_LOG(INFO) << "Use SSDO sampling kernel: "
+                      << (use_ssdo_sampling_kernel_ ? "true" : "false");
+        return true;
       case 'P':
         profile_one_frame_ = true;
         return true;
+      case 'R':
+        ssdo_downsample_factor_ = ssdo_downsample_factor_ == 4
+                                      ? 1
+                                      : ssdo_downsample_factor_ * 2;
+        FTL_LOG(INFO) << "SSDO downsample factor: " << ssdo_downsample_factor_;
+        return true;
       case 'S':
         sort_by_pipeline_ = !sort_by_pipeline_;
         FTL_LOG(INFO) << "Sort object by pipeline: "
@@ -221,27 +262,58 @@ void WaterfallDemo::DrawFrame() {
   renderer_->set_show_debug_info(show_debug_info_);
   renderer_->set_enable_lighting(enable_lighting_);
   renderer_->set_sort_by_pipeline(sort_by_pipeline_);
+  renderer_->set_use_analytic_shapes(use_analytic_shapes_);
   renderer_->set_enable_profiling(profile_one_frame_);
   renderer_->set_enable_ssdo_acceleration(enable_ssdo_acceleration_);
+  renderer_->set_ssdo_downsample_factor(ssdo_downsample_factor_);
+  renderer_->set_enable_ssdo_temporal_accumulation(
+      enable_ssdo_temporal_accumulation_);
+  // The renderer ignores requests for kernels that the device doesn't
+  // support; don't ask again every frame.
+  renderer_->set_use_ssdo_sampling_kernel(use_ssdo_sampling_kernel_);
+  use_ssdo_sampling_kernel_ = renderer_->use_ssdo_sampling_kernel();
+  renderer_->set_use_ssdo_filter_kernel(use_ssdo_filter_kernel_);
+  use_ssdo_filter_kernel_ = renderer_->use_ssdo_filter_kernel();
   profile_one_frame_ = false;
 
   escher::Camera camera =
       GenerateCamera(camera_projection_mode_, stage_.viewing_volume());
 
-  if (run_offscreen_benchmark_) {
-    run_offscreen_benchmark_ = false;
+  if (run_offscreen_benchmark_ || run_ssdo_sampling_benchmark_) {
     stopwatch_.Stop();
     renderer_->set_show_debug_info(false);
 
-    renderer_->RunOffscreenBenchmark(
-        kDemoWidth, kDemoHeight, swapchain_helper_.swapchain().format,
-        kOffscreenBenchmarkFrameCount,
-        [this, model, &camera, overlay_model](
-            const escher::ImagePtr& color_image_out,
-            const escher::SemaphorePtr& frame_done_semaphore) {
-          renderer_->DrawFrame(stage_, *model, camera, color_image_out,
-                               overlay_model, frame_done_semaphore, nullptr);
-        });
+    auto run_benchmark = [this, model, &camera, overlay_model]() {
+      renderer_->RunOffscreenBenchmark(
+          kDemoWidth, kDemoHeight, swapchain_helper_.swapchain().format,
+          kOffscreenBenchmarkFrameCount,
+          [this, model, &camera, overlay_model](
+              const escher::ImagePtr& color_image_out,
+              const escher::SemaphorePtr& frame_done_semaphore) {
+            renderer_->DrawFrame(stage_, *model, camera, color_image_out,
+                                 overlay_model, frame_done_semaphore, nullptr);
+          });
+    };
+    if (run_offscreen_benchmark_) {
+      run_benchmark();
+    }
+    if (run_ssdo_sampling_benchmark_) {
+      // Compare the two SSDO sampling methods on the same scene.
+      for (bool use_kernel : {false, true}) {
+        renderer_->set_use_ssdo_sampling_kernel(use_kernel);
+        if (renderer_->use_ssdo_sampling_kernel() != use_kernel) {
+          // The device doesn't support the kernel.
+          continue;
+        }
+        FTL_LOG(INFO) << "SSDO sampling benchmark: using "
+                      << (use_kernel ? "compute kernel" : "fragment shader");
+        run_benchmark();
+      }
+      renderer_->set_use_ssdo_sampling_kernel(use_ssdo_sampling_kernel_);
+    }
+    run_offscreen_benchmark_ = false;
+    run_ssdo_sampling_benchmark_ = false;
+
     renderer_->set_show_debug_info(show_debug_info_);
     if (!stop_time_) {
       stopwatch_.Start();
@@ -47,6 +47,20 @@ class WaterfallDemo : public Demo {
   bool sort_by_pipeline_ = true;
   // True if SSDO should be accelerated by generating a lookup table each frame.
   bool enable_ssdo_acceleration_ = true;
+  // Factor by which SSDO is scaled down in each dimension: 1, 2 or 4.
+  uint32_t ssdo_downsample_factor_ = 1;
+  // True if SSDO should be accumulated over several frames, rather than being
+  // filtered each frame.
+  bool enable_ssdo_temporal_accumulation_ = false;
+  // True if SSDO sampling should use a compute kernel instead of a fragment
+  // shader.
+  bool use_ssdo_sampling_kernel_ = false;
+  // True if SSDO filtering should use a compute kernel instead of fragment
+  // shaders.
+  bool use_ssdo_filter_kernel_ = false;
+  // True if rects, circles and rounded-rects should be drawn as analytic
+  // shapes, rather than as tessellated meshes.
+  bool use_analytic_shapes_ = false;
   bool stop_time_ = false;
   // True if lighting should be periodically toggled on and off.
   bool auto_toggle_lighting_ = false;
@@ -55,6 +69,8 @@ class WaterfallDemo : public Demo {
   bool profile_one_frame_ = false;
   // Run an offscreen benchmark.
   bool run_offscreen_benchmark_ = false;
+  // Run the offscreen benchmark twice, once with each SSDO sampling method.
+  bool run_ssdo_sampling_benchmark_ = false;
 
   // 3 camera projection modes:
   // - orthogonal full-screen
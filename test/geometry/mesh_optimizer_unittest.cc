@@ -0,0 +1,133 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/geometry/mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace escher;
+
+using Triangle = std::array<uint32_t, 3>;
+
+// Same index order as NewRingMesh(): a strip of quads between the outer and
+// inner vertices.
+std::vector<uint32_t> RingIndices(size_t outer_vertex_count) {
+  const uint32_t vertex_count = outer_vertex_count * 2;
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 2; i < vertex_count; i += 2) {
+    indices.insert(indices.end(), {i - 2, i - 1, i, i, i - 1, i + 1});
+  }
+  indices.insert(indices.end(), {vertex_count - 2, vertex_count - 1, 0, 0,
+                                 vertex_count - 1, 1});
+  return indices;
+}
+
+// A regular grid of quads, with its triangles in random order.
+std::vector<uint32_t> ShuffledGridIndices(uint32_t width, uint32_t height) {
+  std::vector<Triangle> triangles;
+  for (uint32_t y = 0; y + 1 < height; ++y) {
+    for (uint32_t x = 0; x + 1 < width; ++x) {
+      uint32_t i = y * width + x;
+      triangles.push_back({{i, i + 1, i + width}});
+      triangles.push_back({{i + 1, i + width + 1, i + width}});
+    }
+  }
+  std::mt19937 generator(1);
+  std::shuffle(triangles.begin(), triangles.end(), generator);
+
+  std::vector<uint32_t> indices;
+  for (auto& triangle : triangles) {
+    indices.insert(indices.end(), triangle.begin(), triangle.end());
+  }
+  return indices;
+}
+
+// Return the triangles, rotated so that the smallest index comes first (which
+// preserves their winding), in sorted order.
+std::vector<Triangle> CanonicalTriangles(const std::vector<uint32_t>& indices) {
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    Triangle t{{indices[i], indices[i + 1], indices[i + 2]}};
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    triangles.push_back(t);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+TEST(MeshOptimizer, CountVertexCacheMisses) {
+  // Two triangles that share an edge.
+  const uint32_t quad[] = {0, 1, 2, 2, 1, 3};
+  EXPECT_EQ(4U, CountVertexCacheMisses(quad, 6, 4));
+  // With a cache of 3 entries, vertex 0 is evicted by vertex 3 before it is
+  // used again.
+  const uint32_t quad2[] = {0, 1, 2, 2, 3, 0};
+  EXPECT_EQ(4U, CountVertexCacheMisses(quad2, 6, 4, 4));
+  EXPECT_EQ(5U, CountVertexCacheMisses(quad2, 6, 4, 3));
+}
+
+TEST(MeshOptimizer, ImprovesShuffledGrid) {
+  constexpr uint32_t kWidth = 32;
+  constexpr uint32_t kHeight = 32;
+  constexpr uint32_t kVertexCount = kWidth * kHeight;
+  auto indices = ShuffledGridIndices(kWidth, kHeight);
+  const size_t triangle_count = indices.size() / 3;
+  auto original = indices;
+
+  const size_t misses_before =
+      CountVertexCacheMisses(indices.data(), indices.size(), kVertexCount);
+  OptimizeVertexCacheOrder(indices.data(), indices.size(), kVertexCount);
+  const size_t misses_after =
+      CountVertexCacheMisses(indices.data(), indices.size(), kVertexCount);
+
+  EXPECT_EQ(CanonicalTriangles(original), CanonicalTriangles(indices));
+  EXPECT_GT(float(misses_before) / triangle_count, 2.f);
+  EXPECT_LT(float(misses_after) / triangle_count, 1.f);
+}
+
+TEST(MeshOptimizer, HighSubdivisionRing) {
+  // A ring with 8 subdivisions, as used by the waterfall demo.
+  constexpr size_t kOuterVertexCount = 4 << 8;
+  constexpr size_t kVertexCount = kOuterVertexCount * 2;
+  auto indices = RingIndices(kOuterVertexCount);
+  auto original = indices;
+
+  const size_t misses_before =
+      CountVertexCacheMisses(indices.data(), indices.size(), kVertexCount);
+  OptimizeVertexCacheOrder(indices.data(), indices.size(), kVertexCount);
+  const size_t misses_after =
+      CountVertexCacheMisses(indices.data(), indices.size(), kVertexCount);
+
+  // The procedural order is already close to optimal for a strip; the
+  // optimizer must not make it worse.
+  EXPECT_EQ(CanonicalTriangles(original), CanonicalTriangles(indices));
+  EXPECT_LE(misses_after, misses_before);
+}
+
+TEST(MeshOptimizer, OptimizeVertexFetchOrder) {
+  // Vertex 1 is unreferenced; the others are referenced in reverse order.
+  std::vector<uint32_t> vertices = {10, 11, 12, 13};
+  std::vector<uint32_t> indices = {3, 2, 0, 0, 2, 3};
+  const auto original_vertices = vertices;
+  const auto original_indices = indices;
+
+  OptimizeVertexFetchOrder(reinterpret_cast<uint8_t*>(vertices.data()),
+                           sizeof(uint32_t), vertices.size(), indices.data(),
+                           indices.size());
+
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 2, 2, 1, 0}), indices);
+  EXPECT_EQ((std::vector<uint32_t>{13, 12, 10, 11}), vertices);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    EXPECT_EQ(original_vertices[original_indices[i]], vertices[indices[i]]);
+  }
+}
+
+}  // namespace
@@ -4,6 +4,7 @@
 
 #include "escher/util/hash.h"
 #include "escher/impl/model_pipeline_spec.h"
+#include "escher/shape/shape_cache.h"
 
 #include "gtest/gtest.h"
 
@@ -58,6 +59,11 @@ TEST(Hash, AllHashedTypes) {
             ShapeModifier::kWobble);
 
   TestHashForValue(model_pipeline_spec);
+
+  ShapeCacheKey shape_cache_key(ShapeCacheKey::Type::kRing, mesh_spec);
+  shape_cache_key.AddParam(3);
+  shape_cache_key.AddParam(1.5f, 0.25f);
+  TestHashForValue(shape_cache_key);
 }
 
 }  // namespace
@@ -0,0 +1,104 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/mesh_range_allocator.h"
+
+#include "escher/vk/buffer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+using escher::impl::MeshRangeAllocator;
+
+// The allocator never touches the buffers, so they can be null.
+std::unique_ptr<MeshRangeAllocator::Block> NewBlock(
+    vk::DeviceSize vertex_capacity,
+    vk::DeviceSize index_capacity) {
+  return std::make_unique<MeshRangeAllocator::Block>(
+      BufferPtr(), BufferPtr(), vertex_capacity, index_capacity);
+}
+
+// Vertices are 8 bytes.
+const MeshSpec kSpec{MeshAttribute::kPosition};
+
+TEST(MeshRangeAllocator, AllocateFromBlocksOfSameSpec) {
+  MeshRangeAllocator allocator;
+  MeshRangeAllocator::Allocation allocation;
+  EXPECT_FALSE(allocator.Allocate(kSpec, 32, 12, 4, &allocation));
+
+  allocator.AddBlock(kSpec, NewBlock(80, 40));
+  ASSERT_TRUE(allocator.Allocate(kSpec, 32, 12, 4, &allocation));
+  EXPECT_EQ(0U, allocation.vertex_offset);
+  EXPECT_EQ(0U, allocation.index_offset);
+  ASSERT_TRUE(allocator.Allocate(kSpec, 40, 12, 4, &allocation));
+  EXPECT_EQ(32U, allocation.vertex_offset);
+  EXPECT_EQ(12U, allocation.index_offset);
+  EXPECT_EQ(96U, allocator.bytes_allocated());
+
+  // Only 8 vertex bytes remain.
+  EXPECT_FALSE(allocator.Allocate(kSpec, 16, 4, 4, &allocation));
+  // Meshes with a different spec can't use the block.
+  const MeshSpec other_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
+  EXPECT_FALSE(allocator.Allocate(other_spec, 16, 4, 4, &allocation));
+  EXPECT_EQ(1U, allocator.block_count());
+}
+
+TEST(MeshRangeAllocator, FailedIndexAllocationFreesVertexRange) {
+  MeshRangeAllocator allocator;
+  MeshRangeAllocator::Allocation allocation;
+  allocator.AddBlock(kSpec, NewBlock(80, 8));
+  ASSERT_TRUE(allocator.Allocate(kSpec, 16, 8, 4, &allocation));
+
+  // There is room for the vertices, but not the indices.
+  EXPECT_FALSE(allocator.Allocate(kSpec, 16, 4, 4, &allocation));
+  EXPECT_EQ(24U, allocator.bytes_allocated());
+}
+
+TEST(MeshRangeAllocator, FreeIsDeferredUntilUploadFinishes) {
+  MeshRangeAllocator allocator;
+  MeshRangeAllocator::Allocation allocation;
+  allocator.AddBlock(kSpec, NewBlock(32, 16));
+  ASSERT_TRUE(allocator.Allocate(kSpec, 32, 16, 4, &allocation));
+  allocation.upload_sequence_number = 5;
+
+  allocator.Free(allocation, 3);
+  EXPECT_EQ(1U, allocator.pending_allocation_count());
+  EXPECT_EQ(48U, allocator.bytes_allocated());
+  allocator.FreeFinishedAllocations(4);
+  EXPECT_EQ(1U, allocator.pending_allocation_count());
+  EXPECT_FALSE(allocator.Allocate(kSpec, 8, 4, 4, &allocation));
+
+  allocator.FreeFinishedAllocations(5);
+  EXPECT_EQ(0U, allocator.pending_allocation_count());
+  EXPECT_EQ(0U, allocator.bytes_allocated());
+
+  // The freed ranges are reused.
+  ASSERT_TRUE(allocator.Allocate(kSpec, 32, 16, 4, &allocation));
+  EXPECT_EQ(0U, allocation.vertex_offset);
+  EXPECT_EQ(0U, allocation.index_offset);
+}
+
+TEST(MeshRangeAllocator, EmptyBlocksAreReleasedExceptTheFirst) {
+  MeshRangeAllocator allocator;
+  MeshRangeAllocator::Allocation first, second;
+  allocator.AddBlock(kSpec, NewBlock(16, 8));
+  allocator.AddBlock(kSpec, NewBlock(16, 8));
+  ASSERT_TRUE(allocator.Allocate(kSpec, 16, 8, 4, &first));
+  ASSERT_TRUE(allocator.Allocate(kSpec, 16, 8, 4, &second));
+  EXPECT_NE(first.block, second.block);
+  EXPECT_EQ(2U, allocator.block_count());
+
+  allocator.Free(second, 0);
+  EXPECT_EQ(1U, allocator.block_count());
+  allocator.Free(first, 0);
+  EXPECT_EQ(1U, allocator.block_count());
+  EXPECT_EQ(0U, allocator.bytes_allocated());
+
+  // The first block is still available.
+  ASSERT_TRUE(allocator.Allocate(kSpec, 16, 8, 4, &first));
+  EXPECT_EQ(1U, allocator.block_count());
+}
+
+}  // namespace
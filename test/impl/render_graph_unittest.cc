@@ -0,0 +1,332 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/impl/render_graph.h"
+
+#include "gtest/gtest.h"
+
+namespace escher {
+namespace impl {
+namespace {
+
+using Usage = RenderGraph::Usage;
+
+ImageInfo NewColorInfo(uint32_t width, uint32_t height) {
+  ImageInfo info;
+  info.format = vk::Format::eB8G8R8A8Unorm;
+  info.width = width;
+  info.height = height;
+  info.usage = vk::ImageUsageFlagBits::eColorAttachment |
+               vk::ImageUsageFlagBits::eSampled;
+  return info;
+}
+
+void NoOp(CommandBuffer*) {}
+
+TEST(RenderGraph, CullsPassesWhoseOutputsAreUnused) {
+  RenderGraph graph(nullptr);
+  auto output = graph.ImportImage(ImagePtr());
+  auto a = graph.CreateImage(NewColorInfo(64, 64));
+  auto b = graph.CreateImage(NewColorInfo(64, 64));
+  auto c = graph.CreateImage(NewColorInfo(64, 64));
+
+  auto make_a = graph.AddPass("make_a", NoOp)
+                    .Write(a, Usage::kColorAttachment)
+                    .id();
+  // Only read by a pass that is culled.
+  auto make_b = graph.AddPass("make_b", NoOp)
+                    .Write(b, Usage::kColorAttachment)
+                    .id();
+  auto make_c = graph.AddPass("make_c", NoOp)
+                    .Read(b, Usage::kSampled)
+                    .Write(c, Usage::kColorAttachment)
+                    .id();
+  auto draw = graph.AddPass("draw", NoOp)
+                  .Read(a, Usage::kSampled)
+                  .Write(output, Usage::kColorAttachment)
+                  .id();
+  auto overlay = graph.AddPass("overlay", NoOp)
+                     .Modify(output, Usage::kTransferDst)
+                     .id();
+  graph.Compile();
+
+  EXPECT_FALSE(graph.is_culled(make_a));
+  EXPECT_TRUE(graph.is_culled(make_b));
+  EXPECT_TRUE(graph.is_culled(make_c));
+  EXPECT_FALSE(graph.is_culled(draw));
+  EXPECT_FALSE(graph.is_culled(overlay));
+  EXPECT_EQ(1U, graph.transient_image_count());
+}
+
+TEST(RenderGraph, CullsOverwrittenWrites) {
+  RenderGraph graph(nullptr);
+  auto output = graph.ImportImage(ImagePtr());
+  auto depth = graph.CreateImage(NewColorInfo(64, 64));
+
+  // The output is overwritten before anything reads it, and so is only kept
+  // if the depth image is needed.
+  auto pre_pass = graph.AddPass("pre_pass", NoOp)
+                      .Write(output, Usage::kColorAttachment)
+                      .Write(depth, Usage::kDepthAttachment)
+                      .id();
+  auto draw = graph.AddPass("draw", NoOp)
+                  .Write(output, Usage::kColorAttachment)
+                  .id();
+  graph.Compile();
+  EXPECT_TRUE(graph.is_culled(pre_pass));
+  EXPECT_FALSE(graph.is_culled(draw));
+  EXPECT_EQ(0U, graph.transient_image_count());
+}
+
+TEST(RenderGraph, DerivesBarriers) {
+  RenderGraph graph(nullptr);
+  auto output =
+      graph.ImportImage(ImagePtr(), vk::ImageLayout::ePresentSrcKHR);
+  auto illum = graph.CreateImage(NewColorInfo(64, 64));
+
+  // The render pass transitions |illum| from eUndefined itself.
+  auto sample = graph.AddPass("sample", NoOp)
+                    .Write(illum, Usage::kColorAttachment,
+                           vk::ImageLayout::eShaderReadOnlyOptimal)
+                    .id();
+  auto light = graph.AddPass("light", NoOp)
+                   .Read(illum, Usage::kSampled)
+                   .Write(output, Usage::kColorAttachment)
+                   .id();
+  // A second read in the same layout needs no barrier.
+  auto reread = graph.AddPass("reread", NoOp)
+                    .Read(illum, Usage::kSampled)
+                    .Modify(output, Usage::kColorAttachment)
+                    .id();
+  auto blit = graph.AddPass("blit", NoOp)
+                  .Read(illum, Usage::kTransferSrc)
+                  .Modify(output, Usage::kTransferDst)
+                  .id();
+  graph.Compile();
+
+  EXPECT_TRUE(graph.barriers(sample).empty());
+
+  // The render pass left |illum| in eShaderReadOnlyOptimal, but its writes
+  // must still be made visible.
+  ASSERT_EQ(1U, graph.barriers(light).size());
+  const auto& b = graph.barriers(light)[0];
+  EXPECT_EQ(illum, b.image);
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal, b.old_layout);
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal, b.new_layout);
+  EXPECT_EQ(vk::PipelineStageFlags(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput),
+            b.src_stages);
+  EXPECT_EQ(vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentRead |
+                            vk::AccessFlagBits::eColorAttachmentWrite),
+            b.src_access);
+  EXPECT_EQ(vk::AccessFlags(vk::AccessFlagBits::eShaderRead), b.dst_access);
+
+  // Only |output| needs a barrier, since it is written again.
+  ASSERT_EQ(1U, graph.barriers(reread).size());
+  EXPECT_EQ(output, graph.barriers(reread)[0].image);
+  EXPECT_EQ(vk::ImageLayout::eColorAttachmentOptimal,
+            graph.barriers(reread)[0].old_layout);
+
+  ASSERT_EQ(2U, graph.barriers(blit).size());
+  EXPECT_EQ(vk::ImageLayout::eTransferSrcOptimal,
+            graph.barriers(blit)[0].new_layout);
+  // The shader reads must finish before the layout changes.
+  EXPECT_EQ(vk::PipelineStageFlags(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                vk::PipelineStageFlagBits::eFragmentShader |
+                vk::PipelineStageFlagBits::eComputeShader),
+            graph.barriers(blit)[0].src_stages);
+  EXPECT_EQ(vk::ImageLayout::eTransferDstOptimal,
+            graph.barriers(blit)[1].new_layout);
+
+  ASSERT_EQ(1U, graph.final_barriers().size());
+  EXPECT_EQ(output, graph.final_barriers()[0].image);
+  EXPECT_EQ(vk::ImageLayout::eTransferDstOptimal,
+            graph.final_barriers()[0].old_layout);
+  EXPECT_EQ(vk::ImageLayout::ePresentSrcKHR,
+            graph.final_barriers()[0].new_layout);
+}
+
+TEST(RenderGraph, ReusesTransientImages) {
+  RenderGraph graph(nullptr);
+  auto output = graph.ImportImage(ImagePtr());
+  auto a = graph.CreateImage(NewColorInfo(64, 64));
+  auto b = graph.CreateImage(NewColorInfo(64, 64));
+  auto c = graph.CreateImage(NewColorInfo(32, 32));
+  auto d = graph.CreateImage(NewColorInfo(64, 64));
+
+  graph.AddPass("make_a", NoOp).Write(a, Usage::kColorAttachment);
+  graph.AddPass("make_b", NoOp)
+      .Read(a, Usage::kSampled)
+      .Write(b, Usage::kColorAttachment);
+  // |a| is no longer needed, so |c| could reuse its image, except that it
+  // differs in size.  |d| can.
+  graph.AddPass("make_c", NoOp)
+      .Read(b, Usage::kSampled)
+      .Write(c, Usage::kColorAttachment);
+  auto make_d = graph.AddPass("make_d", NoOp)
+                    .Read(c, Usage::kSampled)
+                    .Write(d, Usage::kColorAttachment)
+                    .id();
+  graph.AddPass("draw", NoOp)
+      .Read(d, Usage::kSampled)
+      .Write(output, Usage::kColorAttachment);
+  graph.Compile();
+
+  EXPECT_EQ(3U, graph.transient_image_count());
+  // |d| reuses the image of |a|, so it must wait for the passes that used |a|
+  // to finish, but its previous contents are discarded.
+  ASSERT_EQ(2U, graph.barriers(make_d).size());
+  const auto& b_d = graph.barriers(make_d)[1];
+  EXPECT_EQ(d, b_d.image);
+  EXPECT_EQ(vk::ImageLayout::eUndefined, b_d.old_layout);
+  EXPECT_EQ(vk::ImageLayout::eColorAttachmentOptimal, b_d.new_layout);
+  EXPECT_EQ(vk::PipelineStageFlags(
+                vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                vk::PipelineStageFlagBits::eFragmentShader |
+                vk::PipelineStageFlagBits::eComputeShader),
+            b_d.src_stages);
+}
+
+TEST(RenderGraph, DeclaredImages) {
+  RenderGraph graph(nullptr);
+  auto output = graph.ImportImage(ImagePtr());
+  auto table = graph.DeclareImage();
+
+  // The pass that creates the image leaves it in eGeneral.
+  auto generate = graph.AddPass("generate", NoOp)
+                      .Write(table, Usage::kGeneral)
+                      .id();
+  auto use = graph.AddPass("use", NoOp)
+                 .Read(table, Usage::kSampled)
+                 .Write(output, Usage::kColorAttachment)
+                 .id();
+  graph.Compile();
+
+  EXPECT_TRUE(graph.barriers(generate).empty());
+  ASSERT_EQ(1U, graph.barriers(use).size());
+  EXPECT_EQ(vk::ImageLayout::eGeneral, graph.barriers(use)[0].old_layout);
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal,
+            graph.barriers(use)[0].new_layout);
+  EXPECT_EQ(vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader |
+                                   vk::PipelineStageFlagBits::eComputeShader),
+            graph.barriers(use)[0].src_stages);
+  EXPECT_EQ(0U, graph.transient_image_count());
+}
+
+TEST(RenderGraph, PreservedImages) {
+  RenderGraph graph(nullptr);
+  auto history = graph.ImportPreservedImage(
+      ImagePtr(), vk::ImageLayout::eShaderReadOnlyOptimal);
+  auto next_history =
+      graph.ImportImage(ImagePtr(), vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  // The previous contents of |history| are kept, but the pass must wait for
+  // the earlier work that wrote them.
+  auto accumulate = graph.AddPass("accumulate", NoOp)
+                        .Read(history, Usage::kSampled)
+                        .Write(next_history, Usage::kColorAttachment,
+                               vk::ImageLayout::eShaderReadOnlyOptimal)
+                        .id();
+  graph.Compile();
+
+  ASSERT_EQ(1U, graph.barriers(accumulate).size());
+  const auto& barrier = graph.barriers(accumulate)[0];
+  EXPECT_EQ(history, barrier.image);
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal, barrier.old_layout);
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal, barrier.new_layout);
+  EXPECT_EQ(vk::PipelineStageFlags(vk::PipelineStageFlagBits::eAllCommands),
+            barrier.src_stages);
+  EXPECT_EQ(vk::AccessFlags(vk::AccessFlagBits::eMemoryWrite),
+            barrier.src_access);
+  EXPECT_TRUE(graph.final_barriers().empty());
+}
+
+TEST(RenderGraph, SynchronizesAsyncComputePasses) {
+  constexpr uint32_t kGraphicsFamily = 0;
+  constexpr uint32_t kComputeFamily = 1;
+  RenderGraph graph(nullptr);
+  graph.EnableAsyncCompute(nullptr, kGraphicsFamily, kComputeFamily);
+  auto output = graph.ImportImage(ImagePtr());
+  auto depth = graph.CreateImage(NewColorInfo(64, 64));
+  auto table = graph.DeclareImage();
+
+  auto pre_pass = graph.AddPass("pre_pass", NoOp)
+                      .Write(depth, Usage::kDepthAttachment,
+                             vk::ImageLayout::eShaderReadOnlyOptimal)
+                      .id();
+  auto generate = graph.AddPass("generate", NoOp,
+                                RenderGraph::Queue::kAsyncCompute)
+                      .Read(depth, Usage::kSampled)
+                      .Write(table, Usage::kGeneral)
+                      .id();
+  auto draw = graph.AddPass("draw", NoOp)
+                  .Read(table, Usage::kSampled)
+                  .Write(output, Usage::kColorAttachment)
+                  .id();
+  graph.Compile();
+
+  EXPECT_EQ(RenderGraph::Queue::kAsyncCompute, graph.queue(generate));
+  EXPECT_FALSE(graph.waits_for_other_queue(pre_pass));
+
+  // The graphics queue releases the depth image, which the compute pass
+  // acquires without changing its layout.
+  EXPECT_TRUE(graph.waits_for_other_queue(generate));
+  ASSERT_EQ(1U, graph.release_barriers(generate).size());
+  const auto& release = graph.release_barriers(generate)[0];
+  EXPECT_EQ(depth, release.image);
+  EXPECT_EQ(kGraphicsFamily, release.src_queue_family);
+  EXPECT_EQ(kComputeFamily, release.dst_queue_family);
+  EXPECT_EQ(vk::PipelineStageFlags(
+                vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests),
+            release.src_stages);
+  ASSERT_EQ(1U, graph.barriers(generate).size());
+  const auto& acquire = graph.barriers(generate)[0];
+  EXPECT_EQ(release.old_layout, acquire.old_layout);
+  EXPECT_EQ(release.new_layout, acquire.new_layout);
+  EXPECT_EQ(kGraphicsFamily, acquire.src_queue_family);
+  EXPECT_EQ(kComputeFamily, acquire.dst_queue_family);
+  // Only stages that the compute queue supports.
+  EXPECT_EQ(vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader),
+            acquire.dst_stages);
+
+  // The table is created on the compute queue, and handed back.
+  EXPECT_TRUE(graph.waits_for_other_queue(draw));
+  ASSERT_EQ(1U, graph.release_barriers(draw).size());
+  EXPECT_EQ(table, graph.release_barriers(draw)[0].image);
+  EXPECT_EQ(vk::ImageLayout::eGeneral,
+            graph.release_barriers(draw)[0].old_layout);
+  EXPECT_EQ(kComputeFamily, graph.release_barriers(draw)[0].src_queue_family);
+  ASSERT_EQ(1U, graph.barriers(draw).size());
+  EXPECT_EQ(vk::ImageLayout::eShaderReadOnlyOptimal,
+            graph.barriers(draw)[0].new_layout);
+  EXPECT_EQ(kGraphicsFamily, graph.barriers(draw)[0].dst_queue_family);
+}
+
+TEST(RenderGraph, RunsAsyncComputePassesOnGraphicsQueueUnlessEnabled) {
+  RenderGraph graph(nullptr);
+  auto output = graph.ImportImage(ImagePtr());
+  auto table = graph.DeclareImage();
+
+  auto generate = graph.AddPass("generate", NoOp,
+                                RenderGraph::Queue::kAsyncCompute)
+                      .Write(table, Usage::kGeneral)
+                      .id();
+  auto draw = graph.AddPass("draw", NoOp)
+                  .Read(table, Usage::kSampled)
+                  .Write(output, Usage::kColorAttachment)
+                  .id();
+  graph.Compile();
+
+  EXPECT_EQ(RenderGraph::Queue::kGraphics, graph.queue(generate));
+  EXPECT_FALSE(graph.waits_for_other_queue(draw));
+  EXPECT_TRUE(graph.release_barriers(draw).empty());
+  ASSERT_EQ(1U, graph.barriers(draw).size());
+  EXPECT_EQ(VK_QUEUE_FAMILY_IGNORED, graph.barriers(draw)[0].src_queue_family);
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace escher
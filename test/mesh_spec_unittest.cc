@@ -38,6 +38,12 @@ TEST(MeshSpec, SingleAttributeOffsetAndStride) {
     EXPECT_EQ(0U, spec.GetAttributeOffset(MeshAttribute::kPerimeterPos));
     EXPECT_EQ(sizeof(float), spec.GetStride());
   }
+
+  {
+    MeshSpec spec{MeshAttribute::kColor};
+    EXPECT_EQ(0U, spec.GetAttributeOffset(MeshAttribute::kColor));
+    EXPECT_EQ(sizeof(vec4), spec.GetStride());
+  }
 }
 
 TEST(MeshSpec, MultiAttributeOffsetAndStride) {
@@ -74,6 +80,68 @@ TEST(MeshSpec, MultiAttributeOffsetAndStride) {
     expected_offset += sizeof(float);
     EXPECT_EQ(expected_offset, spec.GetStride());
   }
+
+  // Color comes after all other attributes.
+  {
+    MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kUV |
+                  MeshAttribute::kColor};
+    size_t expected_offset = 0;
+    EXPECT_EQ(0U, spec.GetAttributeOffset(MeshAttribute::kPosition));
+    expected_offset += sizeof(vec2);
+    EXPECT_EQ(expected_offset, spec.GetAttributeOffset(MeshAttribute::kUV));
+    expected_offset += sizeof(vec2);
+    EXPECT_EQ(expected_offset, spec.GetAttributeOffset(MeshAttribute::kColor));
+    expected_offset += sizeof(vec4);
+    EXPECT_EQ(expected_offset, spec.GetStride());
+  }
+}
+
+TEST(MeshSpec, EncodedAttributeOffsetAndStride) {
+  // All compact encodings.  kPerimeterPos is padded to 4 bytes.
+  {
+    MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPositionOffset |
+                      MeshAttribute::kUV | MeshAttribute::kPerimeterPos,
+                  MeshAttributeEncoding::kPositionSnorm16 |
+                      MeshAttributeEncoding::kPositionOffsetSnorm16 |
+                      MeshAttributeEncoding::kUVUnorm16 |
+                      MeshAttributeEncoding::kPerimeterPosUnorm16};
+    EXPECT_EQ(0U, spec.GetAttributeOffset(MeshAttribute::kPosition));
+    EXPECT_EQ(4U, spec.GetAttributeOffset(MeshAttribute::kPositionOffset));
+    EXPECT_EQ(4U, spec.GetAttributeSize(MeshAttribute::kPositionOffset));
+    EXPECT_EQ(8U, spec.GetAttributeOffset(MeshAttribute::kUV));
+    EXPECT_EQ(12U, spec.GetAttributeOffset(MeshAttribute::kPerimeterPos));
+    EXPECT_EQ(2U, spec.GetAttributeSize(MeshAttribute::kPerimeterPos));
+    EXPECT_EQ(16U, spec.GetStride());
+
+    // Vertices are passed to MeshBuilder without encodings.
+    EXPECT_EQ(3 * sizeof(vec2) + sizeof(float),
+              spec.GetDecodedSpec().GetStride());
+  }
+
+  // Only some attributes are encoded.
+  {
+    MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPerimeterPos |
+                      MeshAttribute::kColor,
+                  MeshAttributeEncoding::kPositionHalfFloat |
+                      MeshAttributeEncoding::kPerimeterPosUnorm16};
+    EXPECT_EQ(0U, spec.GetAttributeOffset(MeshAttribute::kPosition));
+    EXPECT_EQ(4U, spec.GetAttributeOffset(MeshAttribute::kPerimeterPos));
+    EXPECT_EQ(8U, spec.GetAttributeOffset(MeshAttribute::kColor));
+    EXPECT_EQ(8U + sizeof(vec4), spec.GetStride());
+  }
+}
+
+TEST(MeshSpec, EncodingsDistinguishSpecs) {
+  MeshSpec spec1{MeshAttribute::kPosition | MeshAttribute::kUV};
+  MeshSpec spec2{MeshAttribute::kPosition | MeshAttribute::kUV,
+                 MeshAttributeEncoding::kUVUnorm16};
+  EXPECT_FALSE(spec1 == spec2);
+  EXPECT_NE(MeshSpec::Hash()(spec1), MeshSpec::Hash()(spec2));
+  EXPECT_TRUE(spec1 == spec2.GetDecodedSpec());
+
+  EXPECT_FALSE(spec2.HasEncodedPositions());
+  spec2.encodings |= MeshAttributeEncoding::kPositionHalfFloat;
+  EXPECT_TRUE(spec2.HasEncodedPositions());
 }
 
 }  // namespace
@@ -0,0 +1,87 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/util/range_allocator.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+TEST(RangeAllocator, AllocateUntilFull) {
+  RangeAllocator allocator(100);
+  size_t offset = 1000;
+
+  EXPECT_TRUE(allocator.Allocate(40, 1, &offset));
+  EXPECT_EQ(0U, offset);
+  EXPECT_TRUE(allocator.Allocate(60, 1, &offset));
+  EXPECT_EQ(40U, offset);
+  EXPECT_EQ(100U, allocator.bytes_allocated());
+  EXPECT_EQ(0U, allocator.free_range_count());
+
+  EXPECT_FALSE(allocator.Allocate(1, 1, &offset));
+  EXPECT_EQ(40U, offset);
+  EXPECT_FALSE(allocator.Allocate(0, 1, &offset));
+}
+
+TEST(RangeAllocator, Alignment) {
+  RangeAllocator allocator(64);
+  size_t offset;
+
+  EXPECT_TRUE(allocator.Allocate(3, 1, &offset));
+  EXPECT_EQ(0U, offset);
+  EXPECT_TRUE(allocator.Allocate(8, 16, &offset));
+  EXPECT_EQ(16U, offset);
+  // The padding between the two allocations remains available.
+  EXPECT_EQ(2U, allocator.free_range_count());
+  EXPECT_TRUE(allocator.Allocate(4, 4, &offset));
+  EXPECT_EQ(4U, offset);
+
+  // Not enough room for an aligned allocation, even though there are 40
+  // contiguous free bytes.
+  EXPECT_FALSE(allocator.Allocate(40, 32, &offset));
+  EXPECT_TRUE(allocator.Allocate(32, 8, &offset));
+  EXPECT_EQ(24U, offset);
+}
+
+TEST(RangeAllocator, FreeCoalescesAdjacentRanges) {
+  RangeAllocator allocator(90);
+  size_t a, b, c;
+  ASSERT_TRUE(allocator.Allocate(30, 1, &a));
+  ASSERT_TRUE(allocator.Allocate(30, 1, &b));
+  ASSERT_TRUE(allocator.Allocate(30, 1, &c));
+
+  allocator.Free(a, 30);
+  allocator.Free(c, 30);
+  EXPECT_EQ(2U, allocator.free_range_count());
+  EXPECT_EQ(30U, allocator.bytes_allocated());
+
+  // A 60-byte allocation won't fit until the middle range is freed.
+  size_t offset;
+  EXPECT_FALSE(allocator.Allocate(60, 1, &offset));
+  allocator.Free(b, 30);
+  EXPECT_EQ(1U, allocator.free_range_count());
+  EXPECT_TRUE(allocator.empty());
+  EXPECT_TRUE(allocator.Allocate(90, 1, &offset));
+  EXPECT_EQ(0U, offset);
+}
+
+TEST(RangeAllocator, ReuseFreedRange) {
+  RangeAllocator allocator(100);
+  size_t a, b, offset;
+  ASSERT_TRUE(allocator.Allocate(20, 1, &a));
+  ASSERT_TRUE(allocator.Allocate(20, 1, &b));
+  allocator.Free(a, 20);
+
+  // First fit: the freed range at the start is reused.
+  EXPECT_TRUE(allocator.Allocate(10, 1, &offset));
+  EXPECT_EQ(0U, offset);
+  EXPECT_TRUE(allocator.Allocate(20, 1, &offset));
+  EXPECT_EQ(40U, offset);
+  EXPECT_TRUE(allocator.Allocate(10, 1, &offset));
+  EXPECT_EQ(10U, offset);
+  EXPECT_EQ(60U, allocator.bytes_allocated());
+}
+
+}  // namespace
@@ -0,0 +1,82 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/util/ref_ptr_slot_table.h"
+
+#include "escher/base/reffable.h"
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+class Thing : public Reffable {};
+typedef ftl::RefPtr<Thing> ThingPtr;
+
+ThingPtr NewThing() {
+  return ftl::AdoptRef(new Thing());
+}
+
+TEST(RefPtrSlotTable, ReservedSlotsAreNeverUsed) {
+  RefPtrSlotTable<Thing> table(3, 1);
+  ThingPtr a = NewThing();
+  ThingPtr b = NewThing();
+  ThingPtr c = NewThing();
+  uint32_t slot = 0;
+
+  EXPECT_TRUE(table.Insert(a, &slot));
+  EXPECT_EQ(1U, slot);
+  EXPECT_TRUE(table.Insert(b, &slot));
+  EXPECT_EQ(2U, slot);
+  EXPECT_FALSE(table.Insert(c, &slot));
+  EXPECT_EQ(2U, table.size());
+  EXPECT_EQ(nullptr, table.at(0));
+}
+
+TEST(RefPtrSlotTable, SlotsAreStable) {
+  RefPtrSlotTable<Thing> table(4, 1);
+  ThingPtr a = NewThing();
+  ThingPtr b = NewThing();
+  uint32_t slot_a, slot_b, slot;
+  ASSERT_TRUE(table.Insert(a, &slot_a));
+  ASSERT_TRUE(table.Insert(b, &slot_b));
+  EXPECT_NE(slot_a, slot_b);
+
+  // Re-inserting returns the same slot, without consuming a new one.
+  EXPECT_TRUE(table.Insert(a, &slot));
+  EXPECT_EQ(slot_a, slot);
+  EXPECT_EQ(2U, table.size());
+
+  // Objects that are retained elsewhere are not released.
+  EXPECT_EQ(0U, table.ReleaseUnused());
+  EXPECT_EQ(a, table.at(slot_a));
+  EXPECT_EQ(b, table.at(slot_b));
+  EXPECT_TRUE(table.Insert(b, &slot));
+  EXPECT_EQ(slot_b, slot);
+}
+
+TEST(RefPtrSlotTable, UnusedSlotsAreRecycled) {
+  RefPtrSlotTable<Thing> table(3, 1);
+  ThingPtr a = NewThing();
+  ThingPtr b = NewThing();
+  uint32_t slot_a, slot_b, slot;
+  ASSERT_TRUE(table.Insert(a, &slot_a));
+  ASSERT_TRUE(table.Insert(b, &slot_b));
+
+  // The table is full until |a| is released by both its owner and the table.
+  ThingPtr c = NewThing();
+  EXPECT_FALSE(table.Insert(c, &slot));
+  a = nullptr;
+  EXPECT_FALSE(table.Insert(c, &slot));
+  EXPECT_EQ(1U, table.ReleaseUnused());
+  EXPECT_EQ(nullptr, table.at(slot_a));
+  EXPECT_EQ(1U, table.size());
+
+  // |c| reuses the freed slot; |b| keeps its own.
+  EXPECT_TRUE(table.Insert(c, &slot));
+  EXPECT_EQ(slot_a, slot);
+  EXPECT_EQ(b, table.at(slot_b));
+  EXPECT_EQ(2U, table.size());
+}
+
+}  // namespace
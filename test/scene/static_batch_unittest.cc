@@ -0,0 +1,186 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/scene/static_batch.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "escher/material/material.h"
+#include "escher/scene/object.h"
+#include "escher/shape/mesh_builder.h"
+#include "escher/shape/mesh_builder_factory.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+// Layout of a vertex in StaticBatch::kMeshSpec.
+struct BatchVertex {
+  vec2 pos;
+  vec2 uv;
+  vec4 color;
+};
+
+// Keeps the vertices and indices in CPU memory, so that they can be inspected.
+class TestMeshBuilder : public MeshBuilder {
+ public:
+  TestMeshBuilder(const MeshSpec& spec,
+                  size_t max_vertex_count,
+                  size_t max_index_count,
+                  std::unique_ptr<uint8_t[]> vertices,
+                  std::unique_ptr<uint8_t[]> indices)
+      : MeshBuilder(spec,
+                    max_vertex_count,
+                    max_index_count,
+                    vertices.get(),
+                    indices.get()),
+        vertices_(std::move(vertices)),
+        indices_(std::move(indices)) {}
+
+  MeshPtr Build() override { return MeshPtr(); }
+
+  const BatchVertex& vertex(size_t i) const {
+    return reinterpret_cast<const BatchVertex*>(vertices_.get())[i];
+  }
+  uint32_t index(size_t i) const {
+    if (index_type() == vk::IndexType::eUint16) {
+      return reinterpret_cast<const uint16_t*>(indices_.get())[i];
+    }
+    return reinterpret_cast<const uint32_t*>(indices_.get())[i];
+  }
+  size_t vertex_count() const { return vertex_count_; }
+  size_t index_count() const { return index_count_; }
+
+ private:
+  std::unique_ptr<uint8_t[]> vertices_;
+  std::unique_ptr<uint8_t[]> indices_;
+};
+
+class TestMeshBuilderFactory : public MeshBuilderFactory {
+ public:
+  MeshBuilderPtr NewMeshBuilder(const MeshSpec& spec,
+                                size_t max_vertex_count,
+                                size_t max_index_count) override {
+    return NewTestMeshBuilder(spec, max_vertex_count, max_index_count);
+  }
+
+  ftl::RefPtr<TestMeshBuilder> NewTestMeshBuilder(const MeshSpec& spec,
+                                                  size_t max_vertex_count,
+                                                  size_t max_index_count) {
+    return AdoptRef(new TestMeshBuilder(
+        spec, max_vertex_count, max_index_count,
+        std::make_unique<uint8_t[]>(max_vertex_count * spec.GetStride()),
+        std::make_unique<uint8_t[]>(max_index_count * sizeof(uint32_t))));
+  }
+};
+
+ftl::RefPtr<TestMeshBuilder> BuildMergedGeometry(
+    TestMeshBuilderFactory* factory,
+    const StaticBatch& batch) {
+  auto builder = factory->NewTestMeshBuilder(
+      StaticBatch::kMeshSpec, batch.vertex_count(), batch.index_count());
+  batch.AddMergedGeometry(builder.get());
+  EXPECT_EQ(batch.vertex_count(), builder->vertex_count());
+  EXPECT_EQ(batch.index_count(), builder->index_count());
+  return builder;
+}
+
+TEST(StaticBatch, IndicesAreOffsetByPrecedingVertices) {
+  TestMeshBuilderFactory factory;
+  StaticBatch batch(&factory);
+  auto material = Material::New(vec4(1.f, 0.f, 0.f, 1.f));
+  ASSERT_TRUE(batch.AddObject(
+      Object::NewRect(vec2(0.f, 0.f), vec2(1.f, 1.f), 2.f, material)));
+  ASSERT_TRUE(batch.AddObject(
+      Object::NewCircle(vec2(5.f, 5.f), 1.f, 2.f, material)));
+  ASSERT_TRUE(batch.AddObject(
+      Object::NewRect(vec2(9.f, 0.f), vec2(1.f, 1.f), 2.f, material)));
+  EXPECT_EQ(3U, batch.object_count());
+
+  auto builder = BuildMergedGeometry(&factory, batch);
+  const size_t rect_vertex_count = 4;
+  const size_t rect_index_count = 6;
+  const size_t circle_vertex_count =
+      batch.vertex_count() - 2 * rect_vertex_count;
+  const size_t circle_index_count =
+      batch.index_count() - 2 * rect_index_count;
+  ASSERT_GT(circle_vertex_count, 0U);
+
+  // The last rect's indices match the first's, offset by the vertices of the
+  // rect and circle that precede it.
+  const size_t last_rect_first_index = rect_index_count + circle_index_count;
+  const size_t last_rect_base_vertex = rect_vertex_count + circle_vertex_count;
+  for (size_t i = 0; i < rect_index_count; ++i) {
+    EXPECT_EQ(builder->index(i) + last_rect_base_vertex,
+              builder->index(last_rect_first_index + i));
+  }
+  // The circle's indices refer only to its own vertices.
+  for (size_t i = rect_index_count; i < last_rect_first_index; ++i) {
+    EXPECT_GE(builder->index(i), rect_vertex_count);
+    EXPECT_LT(builder->index(i), last_rect_base_vertex);
+  }
+}
+
+TEST(StaticBatch, VerticesAreTransformed) {
+  TestMeshBuilderFactory factory;
+  StaticBatch batch(&factory);
+  const vec4 red(1.f, 0.f, 0.f, 1.f);
+  const vec4 blue(0.f, 0.f, 1.f, 1.f);
+  ASSERT_TRUE(batch.AddObject(Object::NewRect(vec2(10.f, 20.f),
+                                              vec2(30.f, 40.f), 5.f,
+                                              Material::New(red))));
+  ASSERT_TRUE(batch.AddObject(
+      Object::NewCircle(vec2(100.f, 50.f), 10.f, 5.f, Material::New(blue))));
+
+  auto builder = BuildMergedGeometry(&factory, batch);
+
+  // The unit rect's corners are scaled by its size and offset by its
+  // top-left; the UVs are untransformed.
+  EXPECT_EQ(vec2(10.f, 20.f), builder->vertex(0).pos);
+  EXPECT_EQ(vec2(40.f, 20.f), builder->vertex(1).pos);
+  EXPECT_EQ(vec2(40.f, 60.f), builder->vertex(2).pos);
+  EXPECT_EQ(vec2(10.f, 60.f), builder->vertex(3).pos);
+  EXPECT_EQ(vec2(1.f, 1.f), builder->vertex(2).uv);
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(red, builder->vertex(i).color);
+  }
+
+  // The unit circle is scaled by its radius, and centered on its position.
+  float max_distance = 0.f;
+  for (size_t i = 4; i < builder->vertex_count(); ++i) {
+    const BatchVertex& vertex = builder->vertex(i);
+    max_distance =
+        std::max(max_distance, glm::length(vertex.pos - vec2(100.f, 50.f)));
+    EXPECT_EQ(blue, vertex.color);
+  }
+  EXPECT_NEAR(10.f, max_distance, 1e-4f);
+}
+
+TEST(StaticBatch, RejectsIncompatibleObjects) {
+  TestMeshBuilderFactory factory;
+  StaticBatch batch(&factory);
+  auto material = Material::New(vec4(1.f, 1.f, 1.f, 1.f));
+  ASSERT_TRUE(batch.AddObject(
+      Object::NewRect(vec2(0.f, 0.f), vec2(1.f, 1.f), 2.f, material)));
+
+  // Different z-plane.
+  EXPECT_FALSE(batch.AddObject(
+      Object::NewRect(vec2(0.f, 0.f), vec2(1.f, 1.f), 3.f, material)));
+  // No material.
+  EXPECT_FALSE(batch.AddObject(
+      Object::NewRect(vec2(0.f, 0.f), vec2(1.f, 1.f), 2.f, MaterialPtr())));
+  EXPECT_EQ(1U, batch.object_count());
+  EXPECT_EQ(4U, batch.vertex_count());
+  EXPECT_EQ(6U, batch.index_count());
+
+  batch.Clear();
+  EXPECT_EQ(0U, batch.object_count());
+  EXPECT_EQ(0U, batch.vertex_count());
+  EXPECT_TRUE(batch.AddObject(
+      Object::NewRect(vec2(0.f, 0.f), vec2(1.f, 1.f), 3.f, material)));
+}
+
+}  // namespace
@@ -0,0 +1,62 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/lod_selector.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+LodSelector NewSelector(float hysteresis) {
+  LodSelector selector(hysteresis);
+  selector.AddLevel(0.f);
+  selector.AddLevel(100.f);
+  selector.AddLevel(400.f);
+  return selector;
+}
+
+TEST(LodSelector, InitialSelection) {
+  EXPECT_EQ(0U, NewSelector(0.1f).SelectLevel(0.f));
+  EXPECT_EQ(0U, NewSelector(0.1f).SelectLevel(99.f));
+  EXPECT_EQ(1U, NewSelector(0.1f).SelectLevel(100.f));
+  EXPECT_EQ(1U, NewSelector(0.1f).SelectLevel(399.f));
+  EXPECT_EQ(2U, NewSelector(0.1f).SelectLevel(400.f));
+  EXPECT_EQ(2U, NewSelector(0.1f).SelectLevel(100000.f));
+}
+
+TEST(LodSelector, Hysteresis) {
+  LodSelector selector = NewSelector(0.1f);
+  EXPECT_EQ(1U, selector.SelectLevel(200.f));
+
+  // Crossing a threshold by less than 10% keeps the current level.
+  EXPECT_EQ(1U, selector.SelectLevel(91.f));
+  EXPECT_EQ(1U, selector.SelectLevel(439.f));
+
+  // Crossing it by more than that switches to the appropriate level...
+  EXPECT_EQ(2U, selector.SelectLevel(441.f));
+  EXPECT_EQ(2U, selector.selected_level());
+  // ... which is then kept until the size moves 10% beyond its range.
+  EXPECT_EQ(2U, selector.SelectLevel(361.f));
+  EXPECT_EQ(0U, selector.SelectLevel(50.f));
+  EXPECT_EQ(0U, selector.SelectLevel(109.f));
+  EXPECT_EQ(1U, selector.SelectLevel(111.f));
+}
+
+TEST(LodSelector, NoHysteresis) {
+  LodSelector selector = NewSelector(0.f);
+  EXPECT_EQ(1U, selector.SelectLevel(100.f));
+  EXPECT_EQ(0U, selector.SelectLevel(99.9f));
+  EXPECT_EQ(1U, selector.SelectLevel(100.f));
+}
+
+TEST(LodSelector, SingleLevel) {
+  LodSelector selector;
+  selector.AddLevel(0.f);
+  EXPECT_EQ(1U, selector.level_count());
+  EXPECT_EQ(0U, selector.SelectLevel(0.f));
+  EXPECT_EQ(0U, selector.SelectLevel(1000.f));
+}
+
+}  // namespace
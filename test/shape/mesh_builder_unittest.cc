@@ -0,0 +1,278 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/mesh_builder.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "escher/shape/mesh_spec.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+// Keeps the encoded vertices and the indices in CPU memory, so that they can
+// be inspected.
+class TestMeshBuilder : public MeshBuilder {
+ public:
+  TestMeshBuilder(const MeshSpec& spec,
+                  size_t max_vertex_count,
+                  size_t max_index_count,
+                  std::unique_ptr<uint8_t[]> vertices,
+                  std::unique_ptr<uint8_t[]> indices)
+      : MeshBuilder(spec,
+                    max_vertex_count,
+                    max_index_count,
+                    vertices.get(),
+                    indices.get()),
+        vertices_(std::move(vertices)),
+        indices_(std::move(indices)) {}
+
+  MeshPtr Build() override { return MeshPtr(); }
+
+  void Encode() { EncodeVertices(&position_scale_, &position_bias_); }
+  void Compact() { CompactIndices(); }
+  void Optimize(VertexCacheStats* stats) { OptimizeVertexOrder(stats); }
+
+  // Return a pointer to the specified attribute of the i-th encoded vertex.
+  template <typename T>
+  const T* GetEncoded(size_t i, MeshAttribute attr) const {
+    return reinterpret_cast<const T*>(vertices_.get() +
+                                      i * spec_.GetStride() +
+                                      spec_.GetAttributeOffset(attr));
+  }
+
+  template <typename IndexT>
+  const IndexT* GetIndices() const {
+    EXPECT_EQ(sizeof(IndexT), index_size());
+    return reinterpret_cast<const IndexT*>(indices_.get());
+  }
+
+  const vec2& position_scale() const { return position_scale_; }
+  const vec2& position_bias() const { return position_bias_; }
+
+ private:
+  std::unique_ptr<uint8_t[]> vertices_;
+  std::unique_ptr<uint8_t[]> indices_;
+  vec2 position_scale_;
+  vec2 position_bias_;
+};
+
+ftl::RefPtr<TestMeshBuilder> NewTestMeshBuilder(const MeshSpec& spec,
+                                                size_t max_vertex_count,
+                                                size_t max_index_count = 0) {
+  return AdoptRef(new TestMeshBuilder(
+      spec, max_vertex_count, max_index_count,
+      std::make_unique<uint8_t[]>(max_vertex_count * spec.GetStride()),
+      std::make_unique<uint8_t[]>(max_index_count * sizeof(uint32_t))));
+}
+
+vec2 DecodeSnorm16(const int16_t* encoded) {
+  return vec2(encoded[0], encoded[1]) / 32767.f;
+}
+
+TEST(MeshBuilder, EncodeSnormPositionsAndUnormPerimeter) {
+  MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPerimeterPos,
+                MeshAttributeEncoding::kPositionSnorm16 |
+                    MeshAttributeEncoding::kPerimeterPosUnorm16};
+  struct Vertex {
+    vec2 pos;
+    float perimeter_pos;
+  };
+  ASSERT_EQ(sizeof(Vertex), spec.GetDecodedSpec().GetStride());
+  ASSERT_EQ(8U, spec.GetStride());
+
+  const Vertex vertices[] = {
+      {vec2(10.f, 20.f), 0.f}, {vec2(30.f, 60.f), 1.f}, {vec2(25.f, 50.f), 0.5f}};
+  auto builder = NewTestMeshBuilder(spec, 3);
+  EXPECT_EQ(sizeof(Vertex), builder->vertex_stride());
+  for (auto& vertex : vertices) {
+    builder->AddVertex(vertex);
+  }
+  builder->Encode();
+
+  // Positions are mapped to [-1, 1].
+  EXPECT_EQ(vec2(10.f, 20.f), builder->position_scale());
+  EXPECT_EQ(vec2(20.f, 40.f), builder->position_bias());
+
+  for (size_t i = 0; i < 3; ++i) {
+    vec2 encoded =
+        DecodeSnorm16(builder->GetEncoded<int16_t>(i, MeshAttribute::kPosition));
+    vec2 decoded =
+        encoded * builder->position_scale() + builder->position_bias();
+    EXPECT_NEAR(vertices[i].pos.x, decoded.x, 0.001f);
+    EXPECT_NEAR(vertices[i].pos.y, decoded.y, 0.001f);
+
+    float perimeter_pos =
+        *builder->GetEncoded<uint16_t>(i, MeshAttribute::kPerimeterPos) /
+        65535.f;
+    EXPECT_NEAR(vertices[i].perimeter_pos, perimeter_pos, 0.0001f);
+  }
+  EXPECT_EQ(0U,
+            *builder->GetEncoded<uint16_t>(0, MeshAttribute::kPerimeterPos));
+  EXPECT_EQ(65535U,
+            *builder->GetEncoded<uint16_t>(1, MeshAttribute::kPerimeterPos));
+}
+
+TEST(MeshBuilder, PositionScaleCoversOffsets) {
+  MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kPositionOffset,
+                MeshAttributeEncoding::kPositionHalfFloat |
+                    MeshAttributeEncoding::kPositionOffsetSnorm16};
+  struct Vertex {
+    vec2 pos;
+    vec2 pos_offset;
+  };
+  const Vertex vertices[] = {{vec2(0.f, 0.f), vec2(5.f, 0.f)},
+                             {vec2(2.f, 2.f), vec2(0.f, -1.f)}};
+  auto builder = NewTestMeshBuilder(spec, 2);
+  for (auto& vertex : vertices) {
+    builder->AddVertex(vertex);
+  }
+  builder->Encode();
+
+  // The offsets are larger than the extent of the positions.
+  EXPECT_EQ(vec2(5.f, 1.f), builder->position_scale());
+  EXPECT_EQ(vec2(1.f, 1.f), builder->position_bias());
+
+  EXPECT_EQ(vec2(1.f, 0.f),
+            DecodeSnorm16(builder->GetEncoded<int16_t>(
+                0, MeshAttribute::kPositionOffset)));
+  EXPECT_EQ(vec2(0.f, -1.f),
+            DecodeSnorm16(builder->GetEncoded<int16_t>(
+                1, MeshAttribute::kPositionOffset)));
+}
+
+TEST(MeshBuilder, NoEncodings) {
+  MeshSpec spec{MeshAttribute::kPosition | MeshAttribute::kUV};
+  struct Vertex {
+    vec2 pos;
+    vec2 uv;
+  };
+  auto builder = NewTestMeshBuilder(spec, 1);
+  builder->AddVertex(Vertex{vec2(3.f, 4.f), vec2(0.5f, 0.5f)});
+  builder->Encode();
+
+  // Vertices are written directly into the staging buffer.
+  EXPECT_EQ(vec2(1.f, 1.f), builder->position_scale());
+  EXPECT_EQ(vec2(0.f, 0.f), builder->position_bias());
+  EXPECT_EQ(vec2(3.f, 4.f),
+            *builder->GetEncoded<vec2>(0, MeshAttribute::kPosition));
+  EXPECT_EQ(vec2(0.5f, 0.5f),
+            *builder->GetEncoded<vec2>(0, MeshAttribute::kUV));
+}
+
+TEST(MeshBuilder, SmallMeshesUse16BitIndices) {
+  MeshSpec spec{MeshAttribute::kPosition};
+  auto builder = NewTestMeshBuilder(spec, 3, 3);
+  EXPECT_EQ(vk::IndexType::eUint16, builder->index_type());
+  builder->AddVertex(vec2(0.f, 0.f))
+      .AddVertex(vec2(1.f, 0.f))
+      .AddVertex(vec2(0.f, 1.f));
+  builder->AddIndex(0).AddIndex(2).AddIndex(1);
+
+  const uint16_t* indices = builder->GetIndices<uint16_t>();
+  EXPECT_EQ(0U, indices[0]);
+  EXPECT_EQ(2U, indices[1]);
+  EXPECT_EQ(1U, indices[2]);
+}
+
+TEST(MeshBuilder, CompactIndices) {
+  MeshSpec spec{MeshAttribute::kPosition};
+  const size_t kMaxVertexCount = MeshSpec::kMaxVertexCountForUint16Indices + 1;
+
+  // Few vertices were added, so the indices can be narrowed to 16 bits.
+  {
+    auto builder = NewTestMeshBuilder(spec, kMaxVertexCount, 4);
+    EXPECT_EQ(vk::IndexType::eUint32, builder->index_type());
+    builder->AddVertex(vec2(0.f, 0.f))
+        .AddVertex(vec2(1.f, 0.f))
+        .AddVertex(vec2(0.f, 1.f));
+    builder->AddIndex(2).AddIndex(0).AddIndex(1).AddIndex(2);
+    builder->Compact();
+    EXPECT_EQ(vk::IndexType::eUint16, builder->index_type());
+
+    const uint16_t* indices = builder->GetIndices<uint16_t>();
+    EXPECT_EQ(2U, indices[0]);
+    EXPECT_EQ(0U, indices[1]);
+    EXPECT_EQ(1U, indices[2]);
+    EXPECT_EQ(2U, indices[3]);
+  }
+
+  // Too many vertices were added to address with 16-bit indices.
+  {
+    auto builder = NewTestMeshBuilder(spec, kMaxVertexCount, 2);
+    for (size_t i = 0; i < kMaxVertexCount; ++i) {
+      builder->AddVertex(vec2(0.f, 0.f));
+    }
+    builder->AddIndex(0).AddIndex(kMaxVertexCount - 1);
+    builder->Compact();
+    EXPECT_EQ(vk::IndexType::eUint32, builder->index_type());
+
+    const uint32_t* indices = builder->GetIndices<uint32_t>();
+    EXPECT_EQ(0U, indices[0]);
+    EXPECT_EQ(kMaxVertexCount - 1, indices[1]);
+  }
+}
+
+TEST(MeshBuilder, OptimizeVertexOrderPreservesTriangles) {
+  MeshSpec spec{MeshAttribute::kPosition};
+  const vec2 positions[] = {vec2(0.f, 0.f), vec2(1.f, 0.f), vec2(2.f, 0.f),
+                            vec2(0.f, 1.f), vec2(1.f, 1.f), vec2(2.f, 1.f)};
+  // Two quads, whose triangles reference the vertices in reverse order.
+  const uint32_t indices[] = {5, 4, 2, 4, 1, 2, 4, 3, 1, 3, 0, 1};
+  auto builder = NewTestMeshBuilder(spec, 6, 12);
+  for (auto& position : positions) {
+    builder->AddVertex(position);
+  }
+  for (uint32_t index : indices) {
+    builder->AddIndex(index);
+  }
+
+  VertexCacheStats stats;
+  builder->Optimize(&stats);
+  EXPECT_EQ(4U, stats.triangle_count);
+  EXPECT_LE(stats.misses_after, stats.misses_before);
+
+  // The vertices are now stored in the order of first use.
+  const uint16_t* optimized = builder->GetIndices<uint16_t>();
+  EXPECT_EQ(0U, optimized[0]);
+
+  // Each triangle still has the same positions, in the same winding order,
+  // although the triangles themselves may have been reordered.
+  std::multiset<std::vector<float>> expected;
+  std::multiset<std::vector<float>> actual;
+  for (size_t t = 0; t < 4; ++t) {
+    std::vector<float> before;
+    std::vector<float> after;
+    for (size_t k = 0; k < 3; ++k) {
+      const vec2& a = positions[indices[t * 3 + k]];
+      const vec2& b = *builder->GetEncoded<vec2>(optimized[t * 3 + k],
+                                                 MeshAttribute::kPosition);
+      before.insert(before.end(), {a.x, a.y});
+      after.insert(after.end(), {b.x, b.y});
+    }
+    // Rotate so that the triangle starts with its smallest vertex.
+    auto rotate = [](std::vector<float>* v) {
+      size_t smallest = 0;
+      for (size_t k = 1; k < 3; ++k) {
+        if (std::make_pair((*v)[k * 2], (*v)[k * 2 + 1]) <
+            std::make_pair((*v)[smallest * 2], (*v)[smallest * 2 + 1])) {
+          smallest = k;
+        }
+      }
+      std::rotate(v->begin(), v->begin() + smallest * 2, v->end());
+    };
+    rotate(&before);
+    rotate(&after);
+    expected.insert(before);
+    actual.insert(after);
+  }
+  EXPECT_EQ(expected, actual);
+}
+
+}  // namespace
@@ -4,6 +4,9 @@
 
 #include "escher/shape/rounded_rect.h"
 
+#include <cmath>
+#include <iterator>
+
 #include "escher/shape/mesh_spec.h"
 
 #include "gtest/gtest.h"
@@ -18,24 +21,25 @@ struct Vertex {
   vec2 uv;
 };
 
-TEST(RoundedRect, Tessellation) {
+void TestTessellation(uint32_t corner_divisions) {
   RoundedRectSpec rect_spec(100, 500, 20, 20, 20, 20);
   MeshSpec mesh_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
   ASSERT_EQ(sizeof(Vertex), mesh_spec.GetStride());
 
-  auto counts = GetRoundedRectMeshVertexAndIndexCounts(rect_spec);
+  auto counts =
+      GetRoundedRectMeshVertexAndIndexCounts(rect_spec, corner_divisions);
   const uint32_t vertex_count = counts.first;
   const uint32_t index_count = counts.second;
 
   std::vector<Vertex> vertices;
   vertices.resize(vertex_count);
   GenerateRoundedRectVertices(rect_spec, mesh_spec, vertices.data(),
-                              vertex_count * sizeof(Vertex));
+                              vertex_count * sizeof(Vertex), corner_divisions);
 
-  std::vector<uint32_t> indices;
+  std::vector<uint16_t> indices;
   indices.resize(index_count);
-  GenerateRoundedRectIndices(rect_spec, mesh_spec, indices.data(),
-                             index_count * sizeof(uint32_t));
+  GenerateRoundedRectIndices(indices.data(), index_count * sizeof(uint16_t),
+                             corner_divisions);
 
   // Guarantee that all vertices are referenced by index at least once, and no
   // non-existent vertices are referenced.
@@ -54,6 +58,176 @@ TEST(RoundedRect, Tessellation) {
   }
 }
 
+// Straightforward tessellation, computing each arc vertex with its own
+// trigonometry.  Used to check the optimized GenerateRoundedRectVertices().
+std::vector<Vertex> GenerateReferenceVertices(const RoundedRectSpec& spec,
+                                              uint32_t corner_divisions) {
+  const float w = spec.width;
+  const float h = spec.height;
+  const vec2 centers[] = {
+      vec2(spec.top_left_radius / w, spec.top_left_radius / h),
+      vec2(1.f - spec.top_right_radius / w, spec.top_right_radius / h),
+      vec2(1.f - spec.bottom_right_radius / w,
+           1.f - spec.bottom_right_radius / h),
+      vec2(spec.bottom_left_radius / w, 1.f - spec.bottom_left_radius / h)};
+  const float radii[] = {spec.top_left_radius, spec.top_right_radius,
+                         spec.bottom_right_radius, spec.bottom_left_radius};
+  const float start_angles[] = {3.14159265f, 1.5f * 3.14159265f, 0.f,
+                                0.5f * 3.14159265f};
+
+  std::vector<vec2> uvs;
+  uvs.push_back(0.25f * (centers[0] + centers[1] + centers[2] + centers[3]));
+  uvs.insert(uvs.end(), std::begin(centers), std::end(centers));
+  uvs.push_back(vec2(0.f, centers[0].y));
+  uvs.push_back(vec2(centers[0].x, 0.f));
+  uvs.push_back(vec2(centers[1].x, 0.f));
+  uvs.push_back(vec2(1.f, centers[1].y));
+  uvs.push_back(vec2(1.f, centers[2].y));
+  uvs.push_back(vec2(centers[2].x, 1.f));
+  uvs.push_back(vec2(centers[3].x, 1.f));
+  uvs.push_back(vec2(0.f, centers[3].y));
+  const float angle_step = 0.5f * 3.14159265f / (corner_divisions + 1);
+  for (size_t corner = 0; corner < 4; ++corner) {
+    const vec2 scale(radii[corner] / w, radii[corner] / h);
+    for (uint32_t i = 1; i <= corner_divisions; ++i) {
+      const float angle = start_angles[corner] + i * angle_step;
+      uvs.push_back(centers[corner] +
+                    vec2(std::cos(angle), std::sin(angle)) * scale);
+    }
+  }
+
+  std::vector<Vertex> vertices;
+  for (vec2 uv : uvs) {
+    vertices.push_back({uv * vec2(w, h) - 0.5f * vec2(w, h), uv});
+  }
+  return vertices;
+}
+
+TEST(RoundedRect, Tessellation) {
+  TestTessellation(kDefaultRoundedRectCornerDivisions);
+}
+
+// Coarser tessellations are used as levels of detail; see
+// RoundedRectFactory::NewRoundedRectLod().
+TEST(RoundedRect, TessellationWithFewerCornerDivisions) {
+  TestTessellation(0);
+  TestTessellation(1);
+  TestTessellation(3);
+}
+
+TEST(RoundedRect, MatchesReferenceTessellation) {
+  MeshSpec mesh_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
+  const RoundedRectSpec rect_specs[] = {
+      RoundedRectSpec(100, 500, 20, 20, 20, 20),
+      RoundedRectSpec(200, 400, 90, 20, 20, 50),
+      RoundedRectSpec(50, 50, 25, 0, 10, 25)};
+  // Includes division counts that are too large to be tabulated.
+  const uint32_t corner_divisions_list[] = {0, 1, 3, 8, 16, 17, 40};
+  for (auto& rect_spec : rect_specs) {
+    for (uint32_t corner_divisions : corner_divisions_list) {
+      const uint32_t vertex_count =
+          GetRoundedRectMeshVertexAndIndexCounts(rect_spec, corner_divisions)
+              .first;
+      std::vector<Vertex> vertices(vertex_count);
+      GenerateRoundedRectVertices(rect_spec, mesh_spec, vertices.data(),
+                                  vertex_count * sizeof(Vertex),
+                                  corner_divisions);
+      std::vector<Vertex> expected =
+          GenerateReferenceVertices(rect_spec, corner_divisions);
+      ASSERT_EQ(expected.size(), vertices.size());
+      for (uint32_t i = 0; i < vertex_count; ++i) {
+        EXPECT_NEAR(expected[i].pos.x, vertices[i].pos.x, 0.001f);
+        EXPECT_NEAR(expected[i].pos.y, vertices[i].pos.y, 0.001f);
+        EXPECT_NEAR(expected[i].uv.x, vertices[i].uv.x, 0.00001f);
+        EXPECT_NEAR(expected[i].uv.y, vertices[i].uv.y, 0.00001f);
+      }
+    }
+  }
+}
+
+// Deforming the canonical mesh must produce the same vertices as tessellating
+// the rounded-rect directly.
+TEST(RoundedRect, UnitMeshDeformation) {
+  struct UnitVertex {
+    vec2 corner_sign;
+    vec2 corner_direction;
+  };
+  MeshSpec unit_mesh_spec{MeshAttribute::kPosition |
+                          MeshAttribute::kPositionOffset};
+  MeshSpec mesh_spec{MeshAttribute::kPosition | MeshAttribute::kUV};
+  ASSERT_EQ(sizeof(UnitVertex), unit_mesh_spec.GetStride());
+
+  const RoundedRectSpec rect_specs[] = {
+      RoundedRectSpec(100, 500, 20, 20, 20, 20),
+      RoundedRectSpec(200, 400, 90, 20, 20, 50),
+      RoundedRectSpec(50, 50, 25, 0, 10, 25)};
+  for (auto& rect_spec : rect_specs) {
+    for (uint32_t corner_divisions : kRoundedRectCornerDivisionTiers) {
+      const uint32_t vertex_count =
+          GetRoundedRectMeshVertexAndIndexCounts(rect_spec, corner_divisions)
+              .first;
+
+      std::vector<Vertex> vertices(vertex_count);
+      GenerateRoundedRectVertices(rect_spec, mesh_spec, vertices.data(),
+                                  vertex_count * sizeof(Vertex),
+                                  corner_divisions);
+      std::vector<UnitVertex> unit_vertices(vertex_count);
+      GenerateUnitRoundedRectVertices(
+          unit_mesh_spec, unit_vertices.data(),
+          vertex_count * sizeof(UnitVertex), corner_divisions);
+
+      for (uint32_t i = 0; i < vertex_count; ++i) {
+        vec2 pos = DeformUnitRoundedRectVertex(
+            rect_spec, unit_vertices[i].corner_sign,
+            unit_vertices[i].corner_direction);
+        EXPECT_NEAR(vertices[i].pos.x, pos.x, 0.001f);
+        EXPECT_NEAR(vertices[i].pos.y, pos.y, 0.001f);
+      }
+    }
+  }
+}
+
+TEST(RoundedRect, CornerDivisionTier) {
+  EXPECT_EQ(0U, GetRoundedRectCornerDivisionTier(0.f));
+  EXPECT_EQ(kRoundedRectCornerDivisionTierCount - 1,
+            GetRoundedRectCornerDivisionTier(10000.f));
+  size_t prev_tier = 0;
+  for (float radius = 0.f; radius < 200.f; radius += 0.5f) {
+    size_t tier = GetRoundedRectCornerDivisionTier(radius);
+    EXPECT_LE(prev_tier, tier);
+    prev_tier = tier;
+  }
+}
+
+TEST(RoundedRect, SignedDistance) {
+  RoundedRectSpec spec(100, 60, 10, 20, 0, 30);
+
+  // Straight edges.
+  EXPECT_NEAR(-30.f, spec.SignedDistance(vec2(0, 0)), 0.0001f);
+  EXPECT_NEAR(5.f, spec.SignedDistance(vec2(55, 0)), 0.0001f);
+  EXPECT_NEAR(-2.f, spec.SignedDistance(vec2(0, 28)), 0.0001f);
+
+  // Corners.  The bottom-right corner is square.
+  EXPECT_NEAR(std::sqrt(50.f), spec.SignedDistance(vec2(55, 35)), 0.0001f);
+  EXPECT_NEAR(0.f, spec.SignedDistance(vec2(50, 30)), 0.0001f);
+  const float diagonal = std::sqrt(2.f) * 10.f;
+  EXPECT_NEAR(diagonal - 10.f, spec.SignedDistance(vec2(-50, -30)), 0.0001f);
+  EXPECT_NEAR(0.f,
+              spec.SignedDistance(vec2(-40.f - 10.f / std::sqrt(2.f),
+                                       -20.f - 10.f / std::sqrt(2.f))),
+              0.0001f);
+
+  // The sign agrees with ContainsPoint(), away from the boundary.
+  for (float x = -60.f; x <= 60.f; x += 2.5f) {
+    for (float y = -40.f; y <= 40.f; y += 2.5f) {
+      const float distance = spec.SignedDistance(vec2(x, y));
+      if (std::abs(distance) > 0.001f) {
+        EXPECT_EQ(distance < 0.f, spec.ContainsPoint(vec2(x, y)));
+      }
+    }
+  }
+}
+
 TEST(RoundedRect, HitTesting) {
   {
     // Degenerate rounded-rect: corner radii are zero.
@@ -0,0 +1,102 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "escher/shape/shape_cache.h"
+
+#include "escher/base/reffable.h"
+#include "gtest/gtest.h"
+
+namespace {
+using namespace escher;
+
+const MeshSpec kMeshSpec{MeshAttribute::kPosition | MeshAttribute::kUV};
+
+ShapeCacheKey NewCircleKey(const MeshSpec& mesh_spec, float radius) {
+  ShapeCacheKey key(ShapeCacheKey::Type::kCircle, mesh_spec);
+  key.AddParam(4);
+  key.AddParam(radius, 0.25f);
+  return key;
+}
+
+TEST(ShapeCacheKey, Quantization) {
+  ShapeCacheKey key(ShapeCacheKey::Type::kCircle, kMeshSpec);
+  EXPECT_EQ(1.5f, key.AddParam(1.4f, 0.25f));
+  EXPECT_EQ(-0.75f, key.AddParam(-0.8f, 0.25f));
+  EXPECT_EQ(0.f, key.AddParam(0.1f, 0.25f));
+  EXPECT_EQ(3U, key.param_count);
+
+  // Values that round to the same multiple of the quantum share a key.
+  EXPECT_EQ(NewCircleKey(kMeshSpec, 10.f), NewCircleKey(kMeshSpec, 10.1f));
+  EXPECT_EQ(NewCircleKey(kMeshSpec, 10.f), NewCircleKey(kMeshSpec, 9.9f));
+  EXPECT_FALSE(NewCircleKey(kMeshSpec, 10.f) ==
+               NewCircleKey(kMeshSpec, 10.2f));
+}
+
+TEST(ShapeCacheKey, DistinguishesTypeAndMeshSpec) {
+  ShapeCacheKey circle(ShapeCacheKey::Type::kCircle, kMeshSpec);
+  ShapeCacheKey ring(ShapeCacheKey::Type::kRing, kMeshSpec);
+  EXPECT_FALSE(circle == ring);
+
+  MeshSpec encoded_spec = kMeshSpec;
+  encoded_spec.encodings = MeshAttributeEncoding::kUVUnorm16;
+  EXPECT_FALSE(NewCircleKey(kMeshSpec, 10.f) ==
+               NewCircleKey(encoded_spec, 10.f));
+
+  // Parameters are compared by position.
+  ShapeCacheKey key1(ShapeCacheKey::Type::kRing, kMeshSpec);
+  key1.AddParam(1);
+  key1.AddParam(2);
+  ShapeCacheKey key2(ShapeCacheKey::Type::kRing, kMeshSpec);
+  key2.AddParam(2);
+  key2.AddParam(1);
+  EXPECT_FALSE(key1 == key2);
+}
+
+class Thing : public Reffable {};
+typedef ftl::RefPtr<Thing> ThingPtr;
+
+TEST(ShapeCacheTable, HitsAndMisses) {
+  ShapeCacheTable<Thing> table;
+  const ShapeCacheKey small = NewCircleKey(kMeshSpec, 10.f);
+  const ShapeCacheKey large = NewCircleKey(kMeshSpec, 20.f);
+
+  EXPECT_EQ(nullptr, table.Find(small));
+  ThingPtr thing = ftl::AdoptRef(new Thing());
+  table.Insert(small, thing, 100);
+  EXPECT_EQ(thing, table.Find(small));
+  EXPECT_EQ(thing, table.Find(NewCircleKey(kMeshSpec, 10.1f)));
+  EXPECT_EQ(nullptr, table.Find(large));
+
+  EXPECT_EQ(2U, table.stats().hit_count);
+  EXPECT_EQ(2U, table.stats().miss_count);
+  EXPECT_EQ(100U, table.stats().bytes_uploaded);
+  EXPECT_EQ(200U, table.stats().bytes_saved);
+  EXPECT_EQ(0.5f, table.stats().hit_rate());
+
+  table.ResetStats();
+  EXPECT_EQ(0U, table.stats().hit_count);
+  EXPECT_EQ(1U, table.size());
+}
+
+TEST(ShapeCacheTable, EvictsObjectsReferencedOnlyByTable) {
+  ShapeCacheTable<Thing> table;
+  const ShapeCacheKey small = NewCircleKey(kMeshSpec, 10.f);
+  const ShapeCacheKey large = NewCircleKey(kMeshSpec, 20.f);
+  ThingPtr used = ftl::AdoptRef(new Thing());
+  table.Insert(small, used, 100);
+  table.Insert(large, ftl::AdoptRef(new Thing()), 200);
+
+  EXPECT_EQ(1U, table.EvictUnused());
+  EXPECT_EQ(1U, table.size());
+  EXPECT_EQ(1U, table.stats().eviction_count);
+  EXPECT_EQ(used, table.Find(small));
+  EXPECT_EQ(nullptr, table.Find(large));
+
+  used = nullptr;
+  EXPECT_EQ(1U, table.EvictUnused());
+  EXPECT_EQ(0U, table.size());
+  EXPECT_EQ(2U, table.stats().eviction_count);
+}
+
+}  // namespace
@@ -0,0 +1,146 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/cubic_bezier.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace sketchy;
+
+CubicBezier2f NewCurve(vec2 p0, vec2 p1, vec2 p2, vec2 p3) {
+  CubicBezier2f bez;
+  bez.pts[0] = p0;
+  bez.pts[1] = p1;
+  bez.pts[2] = p2;
+  bez.pts[3] = p3;
+  return bez;
+}
+
+// Curves of various shapes, including an S-curve, cusps and a curve that
+// doubles back on itself.
+std::vector<CubicBezier2f> GetTestCurves() {
+  return {NewCurve({0, 0}, {100, 0}, {200, 0}, {300, 0}),
+          NewCurve({0, 0}, {0, 100}, {100, 100}, {100, 0}),
+          NewCurve({10, 20}, {300, -50}, {-100, 400}, {500, 500}),
+          NewCurve({0, 0}, {200, 200}, {0, 200}, {200, 0}),
+          NewCurve({0, 0}, {100, 100}, {0, 100}, {100, 0}),
+          NewCurve({0, 0}, {1000, 0}, {-1000, 0}, {0, 0})};
+}
+
+// Reference arc length: the length of a fine polyline approximation.
+float PolylineLength(const CubicBezier2f& bez, float t0, float t1) {
+  constexpr int kSegmentCount = 20000;
+  double total = 0.0;
+  vec2 prev = bez.Evaluate(t0);
+  for (int i = 1; i <= kSegmentCount; ++i) {
+    vec2 pt = bez.Evaluate(t0 + (t1 - t0) * i / kSegmentCount);
+    total += distance(prev, pt);
+    prev = pt;
+  }
+  return total;
+}
+
+TEST(CubicBezier, ArcLength) {
+  for (auto& bez : GetTestCurves()) {
+    const float expected = PolylineLength(bez, 0.f, 1.f);
+    EXPECT_NEAR(expected, bez.ArcLength(), expected * 0.001f);
+  }
+}
+
+TEST(CubicBezier, PartialArcLength) {
+  for (auto& bez : GetTestCurves()) {
+    const float expected = PolylineLength(bez, 0.25f, 0.6f);
+    EXPECT_NEAR(expected, bez.ArcLength(0.25f, 0.6f), expected * 0.001f);
+    EXPECT_NEAR(bez.ArcLength(),
+                bez.ArcLength(0.f, 0.5f) + bez.ArcLength(0.5f, 1.f),
+                bez.ArcLength() * 0.001f);
+  }
+}
+
+TEST(CubicBezier, StraightLineArcLength) {
+  auto bez = NewCurve({0, 0}, {3, 4}, {6, 8}, {9, 12});
+  EXPECT_NEAR(15.f, bez.ArcLength(), 0.0001f);
+}
+
+TEST(CubicBezier, DegenerateArcLengthParameterization) {
+  auto bez = NewCurve({5, 5}, {5, 5}, {5, 5}, {5, 5});
+  auto pair = bez.ArcLengthParameterization();
+  EXPECT_EQ(0.f, pair.second);
+  for (float pt : pair.first.pts) {
+    EXPECT_FALSE(std::isnan(pt));
+  }
+}
+
+// Points at evenly-spaced reparameterized parameters should be approximately
+// evenly spaced along the curve.
+TEST(CubicBezier, ArcLengthParameterization) {
+  for (auto& bez : GetTestCurves()) {
+    auto pair = bez.ArcLengthParameterization();
+    EXPECT_NEAR(bez.ArcLength(), pair.second, 0.001f * pair.second);
+    for (float t : {0.25f, 0.5f, 0.75f}) {
+      const float length = bez.ArcLength(0.f, pair.first.Evaluate(t));
+      EXPECT_NEAR(t * pair.second, length, 0.05f * pair.second);
+    }
+  }
+}
+
+TEST(CubicBezier, EvaluatePointsAndNormals) {
+  constexpr size_t kCount = 37;
+  std::vector<float> params;
+  for (size_t i = 0; i < kCount; ++i) {
+    params.push_back(float(i) / (kCount - 1));
+  }
+  std::vector<vec2> points(kCount);
+  std::vector<vec2> normals(kCount);
+
+  for (auto& bez : GetTestCurves()) {
+    EvaluatePointsAndNormals(bez, params.data(), kCount, points.data(),
+                             normals.data());
+    for (size_t i = 0; i < kCount; ++i) {
+      auto expected = EvaluatePointAndNormal(bez, params[i]);
+      EXPECT_NEAR(expected.first.x, points[i].x, 0.001f);
+      EXPECT_NEAR(expected.first.y, points[i].y, 0.001f);
+      // There is no normal at a cusp.
+      if (std::isnan(expected.second.x)) {
+        continue;
+      }
+      EXPECT_NEAR(expected.second.x, normals[i].x, 0.001f);
+      EXPECT_NEAR(expected.second.y, normals[i].y, 0.001f);
+    }
+  }
+}
+
+// FitCubicBezier2f() is an optimized version of FitCubicBezier<vec2>().
+TEST(CubicBezier, FitCubicBezier2f) {
+  for (auto& bez : GetTestCurves()) {
+    // Sample the curve, and use the cumulative distance between the samples as
+    // their parameters, as StrokeFitter does.
+    std::vector<vec2> pts;
+    std::vector<float> params;
+    for (int i = 0; i <= 50; ++i) {
+      pts.push_back(bez.Evaluate(i / 50.f));
+      params.push_back(i == 0 ? 0.f
+                              : params.back() + distance(pts[i - 1], pts[i]));
+    }
+    const int count = pts.size();
+    const float param_scale = 1.f / params.back();
+    const vec2 tangent_0 = pts[1] - pts[0];
+    const vec2 tangent_1 = pts[count - 2] - pts[count - 1];
+
+    auto expected = FitCubicBezier<vec2>(pts.data(), count, params.data(), 0.f,
+                                         param_scale, tangent_0, tangent_1);
+    auto fit = FitCubicBezier2f(pts.data(), count, params.data(), 0.f,
+                                param_scale, tangent_0, tangent_1);
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_NEAR(expected.pts[i].x, fit.pts[i].x, 0.01f);
+      EXPECT_NEAR(expected.pts[i].y, fit.pts[i].y, 0.01f);
+    }
+  }
+}
+
+}  // namespace
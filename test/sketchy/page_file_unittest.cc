@@ -0,0 +1,253 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/page_file.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace sketchy;
+
+StrokePath NewPath(vec2 start, size_t segment_count) {
+  StrokePath path;
+  for (size_t i = 0; i < segment_count; ++i) {
+    CubicBezier2f bez;
+    bez.pts[0] = start + vec2(100.f * i, 0.f);
+    bez.pts[1] = start + vec2(100.f * i + 30.f, 50.f);
+    bez.pts[2] = start + vec2(100.f * i + 70.f, -50.f);
+    bez.pts[3] = start + vec2(100.f * i + 100.f, 0.f);
+    path.push_back(StrokeSegment(bez));
+  }
+  return path;
+}
+
+// Return a single-segment path along the straight line from |start| to |end|.
+// The arc-length parameterization is not computed, so that the points can be
+// arbitrarily large, or not finite.
+StrokePath NewLinePath(vec2 start, vec2 end) {
+  CubicBezier2f bez;
+  bez.pts[0] = start;
+  bez.pts[1] = start;
+  bez.pts[2] = end;
+  bez.pts[3] = end;
+  return StrokePath({StrokeSegment(bez, CubicBezier1f(), 1.f)});
+}
+
+std::string GetTempPath() {
+  char path[] = "/tmp/page_file_unittest_XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  close(fd);
+  return path;
+}
+
+// Overwrite |size| bytes of the file at |path|, at |offset|.
+void OverwriteFile(const std::string& path,
+                   long offset,
+                   const void* data,
+                   size_t size) {
+  FILE* fp = fopen(path.c_str(), "r+b");
+  ASSERT_TRUE(fp);
+  ASSERT_EQ(0, fseek(fp, offset, SEEK_SET));
+  EXPECT_EQ(1U, fwrite(data, size, 1, fp));
+  fclose(fp);
+}
+
+void ExpectPathsEqual(const StrokePath& expected,
+                      const PageFile& file,
+                      size_t index) {
+  StrokePath path;
+  ASSERT_TRUE(file.GetPath(index, &path));
+  ASSERT_EQ(expected.size(), path.size());
+  for (size_t i = 0; i < path.size(); ++i) {
+    EXPECT_TRUE(expected[i] == path[i]);
+    EXPECT_TRUE(expected[i].arc_length_parameterization() ==
+                path[i].arc_length_parameterization());
+    EXPECT_EQ(expected[i].length(), path[i].length());
+  }
+}
+
+TEST(PageFile, WriteAndOpen) {
+  const std::string path = GetTempPath();
+  const StrokePath path1 = NewPath(vec2(10.f, 20.f), 3);
+  const StrokePath path2 = NewPath(vec2(-500.f, 300.f), 1);
+  {
+    PageFileWriter writer;
+    writer.AddStroke(7, path1);
+    writer.AddStroke(3, path2);
+    ASSERT_TRUE(writer.Write(path));
+  }
+
+  auto file = PageFile::Open(path);
+  ASSERT_TRUE(file);
+  ASSERT_EQ(2U, file->stroke_count());
+  // Strokes are sorted by ID.
+  EXPECT_EQ(3U, file->stroke(0).id);
+  EXPECT_EQ(7U, file->stroke(1).id);
+  EXPECT_EQ(0U, file->FindStroke(3));
+  EXPECT_EQ(1U, file->FindStroke(7));
+  EXPECT_EQ(2U, file->FindStroke(5));
+  ExpectPathsEqual(path2, *file, 0);
+  ExpectPathsEqual(path1, *file, 1);
+
+  // The bounds enclose the control points.
+  EXPECT_EQ(10.f, file->stroke(1).bounds_min.x);
+  EXPECT_EQ(-30.f, file->stroke(1).bounds_min.y);
+  EXPECT_EQ(310.f, file->stroke(1).bounds_max.x);
+  EXPECT_EQ(70.f, file->stroke(1).bounds_max.y);
+  EXPECT_FLOAT_EQ(path1[0].length() * 3, file->stroke(1).length);
+
+  // Overwrite the file while it is mapped, copying one of its strokes.
+  {
+    PageFileWriter writer;
+    writer.AddStroke(*file, 0);
+    ASSERT_TRUE(writer.Write(path));
+  }
+  ExpectPathsEqual(path1, *file, 1);
+
+  auto file2 = PageFile::Open(path);
+  ASSERT_TRUE(file2);
+  ASSERT_EQ(1U, file2->stroke_count());
+  EXPECT_EQ(3U, file2->stroke(0).id);
+  ExpectPathsEqual(path2, *file2, 0);
+
+  unlink(path.c_str());
+}
+
+TEST(PageFile, FindStrokesInBox) {
+  const std::string path = GetTempPath();
+  {
+    // Use small cells, so that strokes span several of them.
+    PageFileWriter writer(64.f);
+    writer.AddStroke(1, NewPath(vec2(0.f, 0.f), 2));
+    writer.AddStroke(2, NewPath(vec2(1000.f, 1000.f), 1));
+    writer.AddStroke(3, NewPath(vec2(-1000.f, 2000.f), 10));
+    ASSERT_TRUE(writer.Write(path));
+  }
+  auto file = PageFile::Open(path);
+  ASSERT_TRUE(file);
+
+  EXPECT_EQ(std::vector<size_t>({0}),
+            file->FindStrokesInBox(vec2(150.f, 0.f), vec2(160.f, 10.f)));
+  EXPECT_EQ(std::vector<size_t>({1}),
+            file->FindStrokesInBox(vec2(900.f, 900.f), vec2(1100.f, 1100.f)));
+  EXPECT_EQ(std::vector<size_t>({0, 2}),
+            file->FindStrokesInBox(vec2(-100.f, -100.f), vec2(100.f, 2100.f)));
+  EXPECT_TRUE(
+      file->FindStrokesInBox(vec2(500.f, 500.f), vec2(600.f, 600.f)).empty());
+  // A box that is much larger than the occupied cells.
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}),
+            file->FindStrokesInBox(vec2(-1e6f, -1e6f), vec2(1e6f, 1e6f)));
+  unlink(path.c_str());
+}
+
+TEST(PageFile, HugeStrokesAreKeptOutOfGrid) {
+  const std::string path = GetTempPath();
+  {
+    PageFileWriter writer(1.f);
+    writer.AddStroke(1, NewPath(vec2(0.f, 0.f), 1));
+    // This would cover ~2^62 cells, were it not for the cap.
+    writer.AddStroke(2, NewLinePath(vec2(-1e30f, -1e30f), vec2(1e30f, 1e30f)));
+    writer.AddStroke(3, NewLinePath(vec2(5.f, 5.f), vec2(10.f, 10.f)));
+    ASSERT_TRUE(writer.Write(path));
+  }
+  auto file = PageFile::Open(path);
+  ASSERT_TRUE(file);
+
+  EXPECT_EQ(std::vector<size_t>({0, 1}),
+            file->FindStrokesInBox(vec2(50.f, 0.f), vec2(51.f, 1.f)));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}),
+            file->FindStrokesInBox(vec2(0.f, 0.f), vec2(6.f, 6.f)));
+  EXPECT_EQ(std::vector<size_t>({1}),
+            file->FindStrokesInBox(vec2(1e20f, 1e20f), vec2(1e20f, 1e20f)));
+  // The box spans more than 2^31 cells in each direction.
+  const float inf = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}),
+            file->FindStrokesInBox(vec2(-inf, -inf), vec2(inf, inf)));
+  unlink(path.c_str());
+}
+
+TEST(PageFile, NonFiniteGeometryIsRejected) {
+  const std::string path = GetTempPath();
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  {
+    PageFileWriter writer;
+    EXPECT_TRUE(writer.AddStroke(1, NewPath(vec2(0.f, 0.f), 2)));
+    EXPECT_FALSE(
+        writer.AddStroke(2, NewLinePath(vec2(0.f, 0.f), vec2(inf, 0.f))));
+    EXPECT_FALSE(
+        writer.AddStroke(3, NewLinePath(vec2(nan, 0.f), vec2(0.f, 0.f))));
+    ASSERT_TRUE(writer.Write(path));
+  }
+  auto file = PageFile::Open(path);
+  ASSERT_TRUE(file);
+  EXPECT_EQ(1U, file->stroke_count());
+
+  EXPECT_TRUE(
+      file->FindStrokesInBox(vec2(nan, 0.f), vec2(100.f, 100.f)).empty());
+  EXPECT_TRUE(
+      file->FindStrokesInBox(vec2(0.f, 0.f), vec2(100.f, nan)).empty());
+  // |min| exceeds |max|.
+  EXPECT_TRUE(
+      file->FindStrokesInBox(vec2(100.f, 0.f), vec2(0.f, 100.f)).empty());
+  unlink(path.c_str());
+}
+
+TEST(PageFile, RejectsInvalidFiles) {
+  const std::string path = GetTempPath();
+  EXPECT_FALSE(PageFile::Open(path));
+
+  {
+    PageFileWriter writer;
+    writer.AddStroke(1, NewPath(vec2(0.f, 0.f), 2));
+    ASSERT_TRUE(writer.Write(path));
+  }
+  ASSERT_TRUE(PageFile::Open(path));
+
+  // Corrupt a control point of the second segment.  Segments are only checked
+  // when they are read, so the file still opens.
+  const long point_offset = sizeof(PageFileHeader) + sizeof(PageFileStroke) +
+                            sizeof(PageFileSegment) +
+                            offsetof(PageFileSegment, curve);
+  const vec2 original_point = NewPath(vec2(0.f, 0.f), 2)[1].curve().pts[0];
+  StrokePath stroke_path;
+  for (vec2 bad_point : {vec2(std::numeric_limits<float>::quiet_NaN(), 0.f),
+                         vec2(std::numeric_limits<float>::infinity(), 0.f),
+                         vec2(0.f, 1000.f)}) {
+    OverwriteFile(path, point_offset, &bad_point, sizeof(bad_point));
+    auto file = PageFile::Open(path);
+    ASSERT_TRUE(file);
+    EXPECT_FALSE(file->GetPath(0, &stroke_path));
+  }
+  OverwriteFile(path, point_offset, &original_point, sizeof(original_point));
+  EXPECT_TRUE(PageFile::Open(path)->GetPath(0, &stroke_path));
+
+  // Truncate the grid.
+  ASSERT_EQ(0, truncate(path.c_str(), sizeof(PageFileHeader) +
+                                          sizeof(PageFileStroke) +
+                                          2 * sizeof(PageFileSegment)));
+  EXPECT_FALSE(PageFile::Open(path));
+
+  // Corrupt the magic number.
+  FILE* fp = fopen(path.c_str(), "r+b");
+  ASSERT_TRUE(fp);
+  const uint32_t bad_magic = 0;
+  fwrite(&bad_magic, sizeof(bad_magic), 1, fp);
+  fclose(fp);
+  EXPECT_FALSE(PageFile::Open(path));
+
+  EXPECT_FALSE(PageFile::Open(path + ".does_not_exist"));
+  unlink(path.c_str());
+}
+
+}  // namespace
@@ -0,0 +1,169 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sketchy/stroke_index.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+using namespace sketchy;
+
+// Tessellate a straight path through |points|, with one segment between each
+// consecutive pair of points.
+std::shared_ptr<const StrokeTessellation> NewTessellation(
+    const std::vector<vec2>& points) {
+  StrokePath path;
+  std::vector<size_t> vertex_counts;
+  for (size_t i = 1; i < points.size(); ++i) {
+    CubicBezier2f bez;
+    for (int j = 0; j < 4; ++j) {
+      bez.pts[j] = points[i - 1] + (points[i] - points[i - 1]) * (j / 3.f);
+    }
+    path.push_back(StrokeSegment(bez));
+    vertex_counts.push_back(16);
+  }
+  return std::make_shared<StrokeTessellation>(
+      TessellateStrokePath(std::move(path), vertex_counts));
+}
+
+// Tessellate a single straight segment from |start| to |end|.  The arc-length
+// parameterization is not computed, so that the points can be arbitrarily
+// large, or not finite.
+std::shared_ptr<const StrokeTessellation> NewLineTessellation(vec2 start,
+                                                              vec2 end) {
+  CubicBezier2f bez;
+  bez.pts[0] = start;
+  bez.pts[1] = start;
+  bez.pts[2] = end;
+  bez.pts[3] = end;
+  StrokePath path({StrokeSegment(bez, CubicBezier1f(), 1.f)});
+  return std::make_shared<StrokeTessellation>(
+      TessellateStrokePath(std::move(path), {4}));
+}
+
+TEST(StrokeIndex, FindInBox) {
+  StrokeIndex index;
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}}));
+  index.Update(2, NewTessellation({{1000, 1000}, {1100, 1000}}));
+  index.Update(3, NewTessellation({{0, 2000}, {2000, 2000}}));
+  EXPECT_EQ(3U, index.size());
+
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindInBox({0, 0}, {200, 200}));
+  EXPECT_EQ(std::vector<StrokeId>({2}),
+            index.FindInBox({900, 900}, {1200, 1200}));
+  EXPECT_EQ(std::vector<StrokeId>({1, 2, 3}),
+            index.FindInBox({-100, -100}, {3000, 3000}));
+  EXPECT_TRUE(index.FindInBox({500, 500}, {600, 600}).empty());
+  // A box that is much larger than the occupied cells.
+  EXPECT_EQ(std::vector<StrokeId>({1, 2, 3}),
+            index.FindInBox({-1e6f, -1e6f}, {1e6f, 1e6f}));
+}
+
+TEST(StrokeIndex, FindNearPoint) {
+  StrokeIndex index;
+  // An L-shaped stroke, whose bounding box contains (200, 200).
+  index.Update(1, NewTessellation({{0, 0}, {300, 0}, {300, 300}}));
+  index.Update(2, NewTessellation({{0, 100}, {250, 100}}));
+
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({150, 0}, 1.f));
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({300, 250}, 1.f));
+  EXPECT_EQ(std::vector<StrokeId>({2}), index.FindNearPoint({100, 100}, 1.f));
+  EXPECT_TRUE(index.FindNearPoint({200, 200}, 1.f).empty());
+  // The width of the stroke counts.
+  const float half_width = Stroke::kStrokeWidth * 0.5f;
+  EXPECT_EQ(std::vector<StrokeId>({1, 2}),
+            index.FindNearPoint({150, 50}, 50.f - half_width + 1.f));
+  EXPECT_TRUE(
+      index.FindNearPoint({150, 50}, 50.f - half_width - 1.f).empty());
+}
+
+TEST(StrokeIndex, FindInLasso) {
+  StrokeIndex index;
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}}));
+  index.Update(2, NewTessellation({{500, 100}, {600, 100}}));
+  index.Update(3, NewTessellation({{50, 50}, {50, 1000}}));
+
+  // A triangle around the start of stroke 3 and all of stroke 1.
+  EXPECT_EQ(std::vector<StrokeId>({1, 3}),
+            index.FindInLasso({{-50, -50}, {200, -50}, {-50, 200}}));
+  // The bounding box contains stroke 2, but the lasso doesn't.
+  EXPECT_EQ(std::vector<StrokeId>({1, 3}),
+            index.FindInLasso({{-50, -50}, {700, -50}, {-50, 200}}));
+  EXPECT_TRUE(index.FindInLasso({{0, 0}, {100, 0}}).empty());
+}
+
+TEST(StrokeIndex, UpdateAndRemove) {
+  StrokeIndex index;
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}, {200, 0}}));
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({150, 0}, 1.f));
+
+  // Extend the stroke, keeping its existing segments.
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}, {200, 0}, {2000, 0}}));
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({150, 0}, 1.f));
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({1500, 0}, 1.f));
+
+  // Replace the stroke with a shorter one elsewhere.
+  index.Update(1, NewTessellation({{0, 500}, {100, 500}}));
+  EXPECT_TRUE(index.FindNearPoint({150, 0}, 1.f).empty());
+  EXPECT_TRUE(index.FindNearPoint({1500, 0}, 1.f).empty());
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindNearPoint({50, 500}, 1.f));
+
+  index.Remove(1);
+  EXPECT_EQ(0U, index.size());
+  EXPECT_TRUE(index.FindInBox({-1e6f, -1e6f}, {1e6f, 1e6f}).empty());
+  // No-op.
+  index.Remove(1);
+}
+
+TEST(StrokeIndex, HugeSegmentsAreKeptOutOfGrid) {
+  StrokeIndex index(1.f);
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}}));
+  // This would cover ~2^62 cells, were it not for the cap.
+  index.Update(2, NewLineTessellation({-1e30f, -1e30f}, {1e30f, 1e30f}));
+  index.Update(3, NewTessellation({{5, 5}, {6, 6}}));
+
+  EXPECT_EQ(std::vector<StrokeId>({2}),
+            index.FindInBox({1e20f, 1e20f}, {1e20f, 1e20f}));
+  EXPECT_EQ(std::vector<StrokeId>({1, 2, 3}),
+            index.FindInBox({5, 5}, {6, 6}));
+  const float inf = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(std::vector<StrokeId>({1, 2, 3}),
+            index.FindInBox({-inf, -inf}, {inf, inf}));
+
+  // Moving the huge segment back into the grid, and removing it, leave no
+  // trace of it.
+  index.Update(2, NewLineTessellation({1000, 1000}, {1001, 1001}));
+  EXPECT_TRUE(index.FindInBox({1e20f, 1e20f}, {1e20f, 1e20f}).empty());
+  EXPECT_EQ(std::vector<StrokeId>({2}),
+            index.FindInBox({1000, 1000}, {1000, 1000}));
+  index.Update(2, NewLineTessellation({-1e30f, -1e30f}, {1e30f, 1e30f}));
+  index.Remove(2);
+  EXPECT_TRUE(index.FindInBox({1e20f, 1e20f}, {1e20f, 1e20f}).empty());
+}
+
+TEST(StrokeIndex, NonFiniteBoxes) {
+  StrokeIndex index;
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  index.Update(1, NewTessellation({{0, 0}, {100, 0}}));
+  // Neither segment can be found, but both can be updated and removed.
+  index.Update(2, NewLineTessellation({0, 0}, {inf, 0}));
+  index.Update(3, NewLineTessellation({nan, 0}, {0, 0}));
+  EXPECT_EQ(3U, index.size());
+  EXPECT_EQ(std::vector<StrokeId>({1}), index.FindInBox({0, 0}, {10, 10}));
+  index.Remove(2);
+  index.Remove(3);
+
+  EXPECT_TRUE(index.FindInBox({nan, 0}, {100, 100}).empty());
+  EXPECT_TRUE(index.FindInBox({0, 0}, {100, nan}).empty());
+  EXPECT_TRUE(index.FindNearPoint({nan, nan}, 10.f).empty());
+  // |min| exceeds |max|.
+  EXPECT_TRUE(index.FindInBox({100, 0}, {0, 100}).empty());
+}
+
+}  // namespace